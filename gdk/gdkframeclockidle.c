@@ -30,6 +30,7 @@
 #include "gdkframeclockprivate.h"
 #include "gdkprivate.h"
 #include "gdkprofilerprivate.h"
+#include "gdkworkerpoolprivate.h"
 
 #ifdef G_OS_WIN32
 #include <windows.h>
@@ -433,6 +434,8 @@ gdk_frame_clock_paint_idle (void *data)
 
   before = GDK_PROFILER_CURRENT_TIME;
 
+  gdk_worker_pool_begin_frame ();
+
   priv->paint_idle_id = 0;
   priv->in_paint_idle = TRUE;
   priv->min_next_frame_time = 0;
@@ -694,6 +697,8 @@ gdk_frame_clock_paint_idle (void *data)
   if (!gdk_frame_clock_idle_is_frozen (clock_idle))
     priv->sleep_serial = get_sleep_serial ();
 
+  gdk_worker_pool_end_frame ();
+
   gdk_profiler_end_mark (before, "frameclock cycle", NULL);
 
   return FALSE;
@@ -23,11 +23,16 @@
 
 #include "gdkdmabuffourccprivate.h"
 #include "gdkglcontextprivate.h"
+#include "gdkparalleltaskprivate.h"
 
 #include "gsk/gl/fp16private.h"
 
 #include <epoxy/gl.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 typedef struct _GdkMemoryFormatDescription GdkMemoryFormatDescription;
 
 #define TYPED_FUNCS(name, T, R, G, B, A, bpp, scale) \
@@ -325,6 +330,213 @@ ADD_ALPHA_FUNC(r8g8b8_to_b8g8r8a8, 0, 1, 2, 2, 1, 0, 3)
 ADD_ALPHA_FUNC(r8g8b8_to_a8r8g8b8, 0, 1, 2, 1, 2, 3, 0)
 ADD_ALPHA_FUNC(r8g8b8_to_a8b8g8r8, 0, 1, 2, 3, 2, 1, 0)
 
+PREMULTIPLY_FUNC(a8r8g8b8_to_r8g8b8a8_premultiplied, 1, 2, 3, 0, 0, 1, 2, 3)
+PREMULTIPLY_FUNC(a8r8g8b8_to_b8g8r8a8_premultiplied, 1, 2, 3, 0, 2, 1, 0, 3)
+PREMULTIPLY_FUNC(a8r8g8b8_to_a8r8g8b8_premultiplied, 1, 2, 3, 0, 1, 2, 3, 0)
+PREMULTIPLY_FUNC(a8r8g8b8_to_a8b8g8r8_premultiplied, 1, 2, 3, 0, 3, 2, 1, 0)
+
+#ifdef __SSE2__
+/* SSE2 is part of the x86-64 baseline, so no runtime check is needed.
+ * Does the same math as PREMULTIPLY_FUNC() on 4 pixels at a time,
+ * for conversions that keep the channel order. */
+#define SSE2_PREMULTIPLY_FUNC(name, A, scalar_func) \
+static void \
+name (guchar *dest, \
+      const guchar *src, \
+      gsize n) \
+{ \
+  const __m128i alpha_mask = _mm_set1_epi32 ((int) (0xFFu << (A * 8))); \
+  const __m128i bias = _mm_set1_epi16 (127); \
+  const __m128i one = _mm_set1_epi16 (1); \
+  const __m128i zero = _mm_setzero_si128 (); \
+  for (; n >= 4; n -= 4) \
+    { \
+      __m128i pixels = _mm_loadu_si128 ((const __m128i *) src); \
+      __m128i lo = _mm_unpacklo_epi8 (pixels, zero); \
+      __m128i hi = _mm_unpackhi_epi8 (pixels, zero); \
+      __m128i alo = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (lo, _MM_SHUFFLE (A, A, A, A)), _MM_SHUFFLE (A, A, A, A)); \
+      __m128i ahi = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (hi, _MM_SHUFFLE (A, A, A, A)), _MM_SHUFFLE (A, A, A, A)); \
+      lo = _mm_add_epi16 (_mm_mullo_epi16 (lo, alo), bias); \
+      hi = _mm_add_epi16 (_mm_mullo_epi16 (hi, ahi), bias); \
+      lo = _mm_srli_epi16 (_mm_add_epi16 (_mm_add_epi16 (lo, _mm_srli_epi16 (lo, 8)), one), 8); \
+      hi = _mm_srli_epi16 (_mm_add_epi16 (_mm_add_epi16 (hi, _mm_srli_epi16 (hi, 8)), one), 8); \
+      pixels = _mm_or_si128 (_mm_andnot_si128 (alpha_mask, _mm_packus_epi16 (lo, hi)), \
+                             _mm_and_si128 (alpha_mask, pixels)); \
+      _mm_storeu_si128 ((__m128i *) dest, pixels); \
+      dest += 16; \
+      src += 16; \
+    } \
+  scalar_func (dest, src, n); \
+}
+
+SSE2_PREMULTIPLY_FUNC(r8g8b8a8_premultiply, 3, r8g8b8a8_to_r8g8b8a8_premultiplied)
+SSE2_PREMULTIPLY_FUNC(a8r8g8b8_premultiply, 0, a8r8g8b8_to_a8r8g8b8_premultiplied)
+#else
+#define r8g8b8a8_premultiply r8g8b8a8_to_r8g8b8a8_premultiplied
+#define a8r8g8b8_premultiply a8r8g8b8_to_a8r8g8b8_premultiplied
+#endif
+
+/* Matches the rounding of unpremultiply() + from_float() */
+#define UNPREMULTIPLY_FUNC(name, R1, G1, B1, A1, R2, G2, B2, A2) \
+static void \
+name (guchar *dest, \
+      const guchar *src, \
+      gsize n) \
+{ \
+  for (; n > 0; n--) \
+    { \
+      guint a = src[A1]; \
+      if (a == 0) \
+        { \
+          dest[R2] = src[R1]; \
+          dest[G2] = src[G1]; \
+          dest[B2] = src[B1]; \
+        } \
+      else \
+        { \
+          dest[R2] = MIN ((src[R1] * 510u + a) / (2 * a), 255); \
+          dest[G2] = MIN ((src[G1] * 510u + a) / (2 * a), 255); \
+          dest[B2] = MIN ((src[B1] * 510u + a) / (2 * a), 255); \
+        } \
+      dest[A2] = a; \
+      dest += 4; \
+      src += 4; \
+    } \
+}
+
+UNPREMULTIPLY_FUNC(r8g8b8a8_premultiplied_to_r8g8b8a8, 0, 1, 2, 3, 0, 1, 2, 3)
+UNPREMULTIPLY_FUNC(r8g8b8a8_premultiplied_to_b8g8r8a8, 0, 1, 2, 3, 2, 1, 0, 3)
+UNPREMULTIPLY_FUNC(r8g8b8a8_premultiplied_to_a8r8g8b8, 0, 1, 2, 3, 1, 2, 3, 0)
+UNPREMULTIPLY_FUNC(r8g8b8a8_premultiplied_to_a8b8g8r8, 0, 1, 2, 3, 3, 2, 1, 0)
+UNPREMULTIPLY_FUNC(a8r8g8b8_premultiplied_to_r8g8b8a8, 1, 2, 3, 0, 0, 1, 2, 3)
+UNPREMULTIPLY_FUNC(a8r8g8b8_premultiplied_to_b8g8r8a8, 1, 2, 3, 0, 2, 1, 0, 3)
+UNPREMULTIPLY_FUNC(a8r8g8b8_premultiplied_to_a8r8g8b8, 1, 2, 3, 0, 1, 2, 3, 0)
+UNPREMULTIPLY_FUNC(a8r8g8b8_premultiplied_to_a8b8g8r8, 1, 2, 3, 0, 3, 2, 1, 0)
+
+/* Works for straight and premultiplied alpha alike */
+#define SWIZZLE_FUNC(name, R1, G1, B1, A1, R2, G2, B2, A2) \
+static void \
+name (guchar *dest, \
+      const guchar *src, \
+      gsize n) \
+{ \
+  for (; n > 0; n--) \
+    { \
+      guchar r = src[R1], g = src[G1], b = src[B1], a = src[A1]; \
+      dest[R2] = r; \
+      dest[G2] = g; \
+      dest[B2] = b; \
+      dest[A2] = a; \
+      dest += 4; \
+      src += 4; \
+    } \
+}
+
+SWIZZLE_FUNC(r8g8b8a8_to_b8g8r8a8, 0, 1, 2, 3, 2, 1, 0, 3)
+SWIZZLE_FUNC(r8g8b8a8_to_a8r8g8b8, 0, 1, 2, 3, 1, 2, 3, 0)
+SWIZZLE_FUNC(r8g8b8a8_to_a8b8g8r8, 0, 1, 2, 3, 3, 2, 1, 0)
+SWIZZLE_FUNC(a8r8g8b8_to_r8g8b8a8, 1, 2, 3, 0, 0, 1, 2, 3)
+SWIZZLE_FUNC(a8r8g8b8_to_b8g8r8a8, 1, 2, 3, 0, 2, 1, 0, 3)
+SWIZZLE_FUNC(a8r8g8b8_to_a8b8g8r8, 1, 2, 3, 0, 3, 2, 1, 0)
+
+#define EXPAND_ALPHA_FUNC(name, A2, straight) \
+static void \
+name (guchar *dest, \
+      const guchar *src, \
+      gsize n) \
+{ \
+  for (; n > 0; n--) \
+    { \
+      guchar a = src[0]; \
+      guchar c = straight ? (a ? 255 : 0) : a; \
+      dest[0] = dest[1] = dest[2] = dest[3] = c; \
+      dest[A2] = a; \
+      dest += 4; \
+      src += 1; \
+    } \
+}
+
+EXPAND_ALPHA_FUNC(a8_to_r8g8b8a8_premultiplied, 3, FALSE)
+EXPAND_ALPHA_FUNC(a8_to_r8g8b8a8, 3, TRUE)
+EXPAND_ALPHA_FUNC(a8_to_a8r8g8b8, 0, TRUE)
+
+#define EXPAND_GRAY_FUNC(name, A2) \
+static void \
+name (guchar *dest, \
+      const guchar *src, \
+      gsize n) \
+{ \
+  for (; n > 0; n--) \
+    { \
+      guchar g = src[0]; \
+      dest[0] = dest[1] = dest[2] = dest[3] = g; \
+      dest[A2] = 255; \
+      dest += 4; \
+      src += 1; \
+    } \
+}
+
+EXPAND_GRAY_FUNC(g8_to_r8g8b8a8, 3)
+EXPAND_GRAY_FUNC(g8_to_a8r8g8b8, 0)
+
+#define NARROW_FUNC(name, R2, G2, B2, A2) \
+static void \
+name (guchar *dest, \
+      const guchar *src_data, \
+      gsize n) \
+{ \
+  const guint16 *src = (const guint16 *) src_data; \
+  for (; n > 0; n--) \
+    { \
+      dest[R2] = (src[0] * 255u + 32767) / 65535; \
+      dest[G2] = (src[1] * 255u + 32767) / 65535; \
+      dest[B2] = (src[2] * 255u + 32767) / 65535; \
+      dest[A2] = (src[3] * 255u + 32767) / 65535; \
+      dest += 4; \
+      src += 4; \
+    } \
+}
+
+NARROW_FUNC(r16g16b16a16_to_r8g8b8a8, 0, 1, 2, 3)
+NARROW_FUNC(r16g16b16a16_to_b8g8r8a8, 2, 1, 0, 3)
+
+#define WIDEN_FUNC(name, R1, G1, B1, A1) \
+static void \
+name (guchar *dest_data, \
+      const guchar *src, \
+      gsize n) \
+{ \
+  guint16 *dest = (guint16 *) dest_data; \
+  for (; n > 0; n--) \
+    { \
+      dest[0] = src[R1] * 257; \
+      dest[1] = src[G1] * 257; \
+      dest[2] = src[B1] * 257; \
+      dest[3] = src[A1] * 257; \
+      dest += 4; \
+      src += 4; \
+    } \
+}
+
+WIDEN_FUNC(r8g8b8a8_to_r16g16b16a16, 0, 1, 2, 3)
+WIDEN_FUNC(b8g8r8a8_to_r16g16b16a16, 2, 1, 0, 3)
+
+static void
+r16g16b16a16_float_to_r32g32b32a32_float (guchar       *dest,
+                                          const guchar *src,
+                                          gsize         n)
+{
+  half_to_float ((const guint16 *) src, (float *) dest, 4 * n);
+}
+
+static void
+r32g32b32a32_float_to_r16g16b16a16_float (guchar       *dest,
+                                          const guchar *src,
+                                          gsize         n)
+{
+  float_to_half ((const float *) src, (guint16 *) dest, 4 * n);
+}
+
 struct _GdkMemoryFormatDescription
 {
   GdkMemoryAlpha alpha;
@@ -1647,6 +1859,149 @@ unpremultiply (float *rgba,
     }
 }
 
+typedef void (* GdkMemoryConvertFunc) (guchar *, const guchar *, gsize);
+
+/* Direct conversions that avoid the roundtrip through floats,
+ * indexed by [src_format][dest_format] */
+static const GdkMemoryConvertFunc conversions[GDK_MEMORY_N_FORMATS][GDK_MEMORY_N_FORMATS] = {
+  [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = {
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = r8g8b8a8_to_a8b8g8r8,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = r8g8b8a8_to_b8g8r8a8,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = r8g8b8a8_to_a8r8g8b8,
+    [GDK_MEMORY_B8G8R8A8] = r8g8b8a8_premultiplied_to_r8g8b8a8,
+    [GDK_MEMORY_A8R8G8B8] = r8g8b8a8_premultiplied_to_a8b8g8r8,
+    [GDK_MEMORY_R8G8B8A8] = r8g8b8a8_premultiplied_to_b8g8r8a8,
+    [GDK_MEMORY_A8B8G8R8] = r8g8b8a8_premultiplied_to_a8r8g8b8,
+    [GDK_MEMORY_R16G16B16A16_PREMULTIPLIED] = b8g8r8a8_to_r16g16b16a16,
+  },
+  [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = a8r8g8b8_to_b8g8r8a8,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = a8r8g8b8_to_r8g8b8a8,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = a8r8g8b8_to_a8b8g8r8,
+    [GDK_MEMORY_B8G8R8A8] = a8r8g8b8_premultiplied_to_b8g8r8a8,
+    [GDK_MEMORY_A8R8G8B8] = a8r8g8b8_premultiplied_to_a8r8g8b8,
+    [GDK_MEMORY_R8G8B8A8] = a8r8g8b8_premultiplied_to_r8g8b8a8,
+    [GDK_MEMORY_A8B8G8R8] = a8r8g8b8_premultiplied_to_a8b8g8r8,
+  },
+  [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = r8g8b8a8_to_b8g8r8a8,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = r8g8b8a8_to_a8r8g8b8,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = r8g8b8a8_to_a8b8g8r8,
+    [GDK_MEMORY_B8G8R8A8] = r8g8b8a8_premultiplied_to_b8g8r8a8,
+    [GDK_MEMORY_A8R8G8B8] = r8g8b8a8_premultiplied_to_a8r8g8b8,
+    [GDK_MEMORY_R8G8B8A8] = r8g8b8a8_premultiplied_to_r8g8b8a8,
+    [GDK_MEMORY_A8B8G8R8] = r8g8b8a8_premultiplied_to_a8b8g8r8,
+    [GDK_MEMORY_R16G16B16A16_PREMULTIPLIED] = r8g8b8a8_to_r16g16b16a16,
+  },
+  [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = a8r8g8b8_to_r8g8b8a8,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = a8r8g8b8_to_a8b8g8r8,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = a8r8g8b8_to_b8g8r8a8,
+    [GDK_MEMORY_B8G8R8A8] = a8r8g8b8_premultiplied_to_r8g8b8a8,
+    [GDK_MEMORY_A8R8G8B8] = a8r8g8b8_premultiplied_to_a8b8g8r8,
+    [GDK_MEMORY_R8G8B8A8] = a8r8g8b8_premultiplied_to_b8g8r8a8,
+    [GDK_MEMORY_A8B8G8R8] = a8r8g8b8_premultiplied_to_a8r8g8b8,
+  },
+  [GDK_MEMORY_B8G8R8A8] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = r8g8b8a8_premultiply,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = r8g8b8a8_to_a8b8g8r8_premultiplied,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = r8g8b8a8_to_b8g8r8a8_premultiplied,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = r8g8b8a8_to_a8r8g8b8_premultiplied,
+    [GDK_MEMORY_A8R8G8B8] = r8g8b8a8_to_a8b8g8r8,
+    [GDK_MEMORY_R8G8B8A8] = r8g8b8a8_to_b8g8r8a8,
+    [GDK_MEMORY_A8B8G8R8] = r8g8b8a8_to_a8r8g8b8,
+    [GDK_MEMORY_R16G16B16A16] = b8g8r8a8_to_r16g16b16a16,
+  },
+  [GDK_MEMORY_A8R8G8B8] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = a8r8g8b8_to_b8g8r8a8_premultiplied,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = a8r8g8b8_premultiply,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = a8r8g8b8_to_r8g8b8a8_premultiplied,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = a8r8g8b8_to_a8b8g8r8_premultiplied,
+    [GDK_MEMORY_B8G8R8A8] = a8r8g8b8_to_b8g8r8a8,
+    [GDK_MEMORY_R8G8B8A8] = a8r8g8b8_to_r8g8b8a8,
+    [GDK_MEMORY_A8B8G8R8] = a8r8g8b8_to_a8b8g8r8,
+  },
+  [GDK_MEMORY_R8G8B8A8] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = r8g8b8a8_to_b8g8r8a8_premultiplied,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = r8g8b8a8_to_a8r8g8b8_premultiplied,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = r8g8b8a8_premultiply,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = r8g8b8a8_to_a8b8g8r8_premultiplied,
+    [GDK_MEMORY_B8G8R8A8] = r8g8b8a8_to_b8g8r8a8,
+    [GDK_MEMORY_A8R8G8B8] = r8g8b8a8_to_a8r8g8b8,
+    [GDK_MEMORY_A8B8G8R8] = r8g8b8a8_to_a8b8g8r8,
+    [GDK_MEMORY_R16G16B16A16] = r8g8b8a8_to_r16g16b16a16,
+  },
+  [GDK_MEMORY_A8B8G8R8] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = a8r8g8b8_to_r8g8b8a8_premultiplied,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = a8r8g8b8_to_a8b8g8r8_premultiplied,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = a8r8g8b8_to_b8g8r8a8_premultiplied,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = a8r8g8b8_premultiply,
+    [GDK_MEMORY_B8G8R8A8] = a8r8g8b8_to_r8g8b8a8,
+    [GDK_MEMORY_A8R8G8B8] = a8r8g8b8_to_a8b8g8r8,
+    [GDK_MEMORY_R8G8B8A8] = a8r8g8b8_to_b8g8r8a8,
+  },
+  [GDK_MEMORY_R8G8B8] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = r8g8b8_to_b8g8r8a8,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = r8g8b8_to_a8r8g8b8,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = r8g8b8_to_r8g8b8a8,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = r8g8b8_to_a8b8g8r8,
+    [GDK_MEMORY_B8G8R8A8] = r8g8b8_to_b8g8r8a8,
+    [GDK_MEMORY_A8R8G8B8] = r8g8b8_to_a8r8g8b8,
+    [GDK_MEMORY_R8G8B8A8] = r8g8b8_to_r8g8b8a8,
+    [GDK_MEMORY_A8B8G8R8] = r8g8b8_to_a8b8g8r8,
+  },
+  [GDK_MEMORY_B8G8R8] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = r8g8b8_to_r8g8b8a8,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = r8g8b8_to_a8b8g8r8,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = r8g8b8_to_b8g8r8a8,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = r8g8b8_to_a8r8g8b8,
+    [GDK_MEMORY_B8G8R8A8] = r8g8b8_to_r8g8b8a8,
+    [GDK_MEMORY_A8R8G8B8] = r8g8b8_to_a8b8g8r8,
+    [GDK_MEMORY_R8G8B8A8] = r8g8b8_to_b8g8r8a8,
+    [GDK_MEMORY_A8B8G8R8] = r8g8b8_to_a8r8g8b8,
+  },
+  [GDK_MEMORY_R16G16B16A16_PREMULTIPLIED] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = r16g16b16a16_to_b8g8r8a8,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = r16g16b16a16_to_r8g8b8a8,
+  },
+  [GDK_MEMORY_R16G16B16A16] = {
+    [GDK_MEMORY_B8G8R8A8] = r16g16b16a16_to_b8g8r8a8,
+    [GDK_MEMORY_R8G8B8A8] = r16g16b16a16_to_r8g8b8a8,
+  },
+  [GDK_MEMORY_R16G16B16A16_FLOAT_PREMULTIPLIED] = {
+    [GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED] = r16g16b16a16_float_to_r32g32b32a32_float,
+  },
+  [GDK_MEMORY_R16G16B16A16_FLOAT] = {
+    [GDK_MEMORY_R32G32B32A32_FLOAT] = r16g16b16a16_float_to_r32g32b32a32_float,
+  },
+  [GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED] = {
+    [GDK_MEMORY_R16G16B16A16_FLOAT_PREMULTIPLIED] = r32g32b32a32_float_to_r16g16b16a16_float,
+  },
+  [GDK_MEMORY_R32G32B32A32_FLOAT] = {
+    [GDK_MEMORY_R16G16B16A16_FLOAT] = r32g32b32a32_float_to_r16g16b16a16_float,
+  },
+  [GDK_MEMORY_G8] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = g8_to_r8g8b8a8,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = g8_to_a8r8g8b8,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = g8_to_r8g8b8a8,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = g8_to_a8r8g8b8,
+    [GDK_MEMORY_B8G8R8A8] = g8_to_r8g8b8a8,
+    [GDK_MEMORY_A8R8G8B8] = g8_to_a8r8g8b8,
+    [GDK_MEMORY_R8G8B8A8] = g8_to_r8g8b8a8,
+    [GDK_MEMORY_A8B8G8R8] = g8_to_a8r8g8b8,
+  },
+  [GDK_MEMORY_A8] = {
+    [GDK_MEMORY_B8G8R8A8_PREMULTIPLIED] = a8_to_r8g8b8a8_premultiplied,
+    [GDK_MEMORY_A8R8G8B8_PREMULTIPLIED] = a8_to_r8g8b8a8_premultiplied,
+    [GDK_MEMORY_R8G8B8A8_PREMULTIPLIED] = a8_to_r8g8b8a8_premultiplied,
+    [GDK_MEMORY_A8B8G8R8_PREMULTIPLIED] = a8_to_r8g8b8a8_premultiplied,
+    [GDK_MEMORY_B8G8R8A8] = a8_to_r8g8b8a8,
+    [GDK_MEMORY_A8R8G8B8] = a8_to_a8r8g8b8,
+    [GDK_MEMORY_R8G8B8A8] = a8_to_r8g8b8a8,
+    [GDK_MEMORY_A8B8G8R8] = a8_to_a8r8g8b8,
+  },
+};
+
 void
 gdk_memory_convert (guchar              *dest_data,
                     gsize                dest_stride,
@@ -1661,7 +2016,7 @@ gdk_memory_convert (guchar              *dest_data,
   const GdkMemoryFormatDescription *src_desc = &memory_formats[src_format];
   float *tmp;
   gsize y;
-  void (*func) (guchar *, const guchar *, gsize) = NULL;
+  GdkMemoryConvertFunc func;
 
   g_assert (dest_format < GDK_MEMORY_N_FORMATS);
   g_assert (src_format < GDK_MEMORY_N_FORMATS);
@@ -1686,42 +2041,7 @@ gdk_memory_convert (guchar              *dest_data,
       return;
     }
 
-  if (src_format == GDK_MEMORY_R8G8B8A8 && dest_format == GDK_MEMORY_R8G8B8A8_PREMULTIPLIED)
-    func = r8g8b8a8_to_r8g8b8a8_premultiplied;
-  else if (src_format == GDK_MEMORY_B8G8R8A8 && dest_format == GDK_MEMORY_R8G8B8A8_PREMULTIPLIED)
-    func = r8g8b8a8_to_b8g8r8a8_premultiplied;
-  else if (src_format == GDK_MEMORY_R8G8B8A8 && dest_format == GDK_MEMORY_B8G8R8A8_PREMULTIPLIED)
-    func = r8g8b8a8_to_b8g8r8a8_premultiplied;
-  else if (src_format == GDK_MEMORY_B8G8R8A8 && dest_format == GDK_MEMORY_B8G8R8A8_PREMULTIPLIED)
-    func = r8g8b8a8_to_r8g8b8a8_premultiplied;
-  else if (src_format == GDK_MEMORY_R8G8B8A8 && dest_format == GDK_MEMORY_A8R8G8B8_PREMULTIPLIED)
-    func = r8g8b8a8_to_a8r8g8b8_premultiplied;
-  else if (src_format == GDK_MEMORY_B8G8R8A8 && dest_format == GDK_MEMORY_A8R8G8B8_PREMULTIPLIED)
-    func = r8g8b8a8_to_a8b8g8r8_premultiplied;
-  else if (src_format == GDK_MEMORY_R8G8B8 && dest_format == GDK_MEMORY_R8G8B8A8_PREMULTIPLIED)
-    func = r8g8b8_to_r8g8b8a8;
-  else if (src_format == GDK_MEMORY_B8G8R8 && dest_format == GDK_MEMORY_R8G8B8A8_PREMULTIPLIED)
-    func = r8g8b8_to_b8g8r8a8;
-  else if (src_format == GDK_MEMORY_R8G8B8 && dest_format == GDK_MEMORY_B8G8R8A8_PREMULTIPLIED)
-    func = r8g8b8_to_b8g8r8a8;
-  else if (src_format == GDK_MEMORY_B8G8R8 && dest_format == GDK_MEMORY_B8G8R8A8_PREMULTIPLIED)
-    func = r8g8b8_to_r8g8b8a8;
-  else if (src_format == GDK_MEMORY_R8G8B8 && dest_format == GDK_MEMORY_A8R8G8B8_PREMULTIPLIED)
-    func = r8g8b8_to_a8r8g8b8;
-  else if (src_format == GDK_MEMORY_B8G8R8 && dest_format == GDK_MEMORY_A8R8G8B8_PREMULTIPLIED)
-    func = r8g8b8_to_a8b8g8r8;
-  else if (src_format == GDK_MEMORY_R8G8B8 && dest_format == GDK_MEMORY_R8G8B8A8)
-    func = r8g8b8_to_r8g8b8a8;
-  else if (src_format == GDK_MEMORY_B8G8R8 && dest_format == GDK_MEMORY_R8G8B8A8)
-    func = r8g8b8_to_b8g8r8a8;
-  else if (src_format == GDK_MEMORY_R8G8B8 && dest_format == GDK_MEMORY_B8G8R8A8)
-    func = r8g8b8_to_b8g8r8a8;
-  else if (src_format == GDK_MEMORY_B8G8R8 && dest_format == GDK_MEMORY_B8G8R8A8)
-    func = r8g8b8_to_r8g8b8a8;
-  else if (src_format == GDK_MEMORY_R8G8B8 && dest_format == GDK_MEMORY_A8R8G8B8)
-    func = r8g8b8_to_a8r8g8b8;
-  else if (src_format == GDK_MEMORY_B8G8R8 && dest_format == GDK_MEMORY_A8R8G8B8)
-    func = r8g8b8_to_a8b8g8r8;
+  func = conversions[src_format][dest_format];
 
   if (func != NULL)
     {
@@ -1750,3 +2070,237 @@ gdk_memory_convert (guchar              *dest_data,
 
   g_free (tmp);
 }
+
+/* Images smaller than this are converted in the calling thread,
+ * the overhead of spawning tasks would outweigh the gains */
+#define PARALLEL_MIN_PIXELS (256 * 256)
+/* Number of pixels each thread converts in one go */
+#define PARALLEL_PIXELS_PER_BAND (64 * 1024)
+
+typedef struct _MemoryConvert MemoryConvert;
+
+struct _MemoryConvert
+{
+  guchar              *dest_data;
+  gsize                dest_stride;
+  GdkMemoryFormat      dest_format;
+  const guchar        *src_data;
+  gsize                src_stride;
+  GdkMemoryFormat      src_format;
+  gsize                width;
+  gsize                height;
+  gsize                rows_per_band;
+
+  /* atomic */ int     next_band;
+};
+
+static void
+gdk_memory_convert_band (gpointer data)
+{
+  MemoryConvert *mc = data;
+  gsize y;
+
+  for (y = g_atomic_int_add (&mc->next_band, 1) * mc->rows_per_band;
+       y < mc->height;
+       y = g_atomic_int_add (&mc->next_band, 1) * mc->rows_per_band)
+    {
+      gdk_memory_convert (mc->dest_data + y * mc->dest_stride,
+                          mc->dest_stride,
+                          mc->dest_format,
+                          mc->src_data + y * mc->src_stride,
+                          mc->src_stride,
+                          mc->src_format,
+                          mc->width,
+                          MIN (mc->rows_per_band, mc->height - y));
+    }
+}
+
+/*
+ * gdk_memory_convert_parallel:
+ *
+ * Like gdk_memory_convert(), but splits large images into bands
+ * of rows and converts them on multiple threads.
+ *
+ * Small images are converted in the calling thread.
+ */
+void
+gdk_memory_convert_parallel (guchar              *dest_data,
+                             gsize                dest_stride,
+                             GdkMemoryFormat      dest_format,
+                             const guchar        *src_data,
+                             gsize                src_stride,
+                             GdkMemoryFormat      src_format,
+                             gsize                width,
+                             gsize                height)
+{
+  MemoryConvert mc;
+  gsize n_bands;
+
+  if (width * height < PARALLEL_MIN_PIXELS)
+    {
+      gdk_memory_convert (dest_data, dest_stride, dest_format,
+                          src_data, src_stride, src_format,
+                          width, height);
+      return;
+    }
+
+  mc = (MemoryConvert) {
+    .dest_data = dest_data,
+    .dest_stride = dest_stride,
+    .dest_format = dest_format,
+    .src_data = src_data,
+    .src_stride = src_stride,
+    .src_format = src_format,
+    .width = width,
+    .height = height,
+    .rows_per_band = MAX (1, PARALLEL_PIXELS_PER_BAND / width),
+    .next_band = 0,
+  };
+  n_bands = (height + mc.rows_per_band - 1) / mc.rows_per_band;
+
+  gdk_parallel_task_run (gdk_memory_convert_band, &mc, MIN (n_bands, G_MAXUINT));
+}
+
+typedef struct _MemoryMipmap MemoryMipmap;
+
+struct _MemoryMipmap
+{
+  guchar *dest_data;
+  gsize dest_stride;
+  GdkMemoryFormat dest_format;
+  const guchar *src_data;
+  gsize src_stride;
+  GdkMemoryFormat src_format;
+  gsize src_width;
+  gsize src_height;
+  guint lod_level;
+
+  int next_row;
+};
+
+static void
+gdk_memory_mipmap_rows (gpointer data)
+{
+  MemoryMipmap *mm = data;
+  gsize n = (gsize) 1 << mm->lod_level;
+  gsize dest_width = (mm->src_width + n - 1) >> mm->lod_level;
+  gsize dest_height = (mm->src_height + n - 1) >> mm->lod_level;
+  float *row, *sum;
+  gsize x, y, i, rows, cols;
+
+  row = g_new (float, mm->src_width * 4);
+  sum = g_new (float, dest_width * 4);
+
+  for (y = g_atomic_int_add (&mm->next_row, 1);
+       y < dest_height;
+       y = g_atomic_int_add (&mm->next_row, 1))
+    {
+      memset (sum, 0, sizeof (float) * dest_width * 4);
+      rows = MIN (n, mm->src_height - y * n);
+
+      for (i = 0; i < rows; i++)
+        {
+          gdk_memory_convert ((guchar *) row,
+                              mm->src_width * 4 * sizeof (float),
+                              GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED,
+                              mm->src_data + (y * n + i) * mm->src_stride,
+                              mm->src_stride,
+                              mm->src_format,
+                              mm->src_width,
+                              1);
+
+          for (x = 0; x < mm->src_width; x++)
+            {
+              float *s = &sum[(x >> mm->lod_level) * 4];
+
+              s[0] += row[4 * x + 0];
+              s[1] += row[4 * x + 1];
+              s[2] += row[4 * x + 2];
+              s[3] += row[4 * x + 3];
+            }
+        }
+
+      for (x = 0; x < dest_width; x++)
+        {
+          float scale;
+
+          cols = MIN (n, mm->src_width - x * n);
+          scale = 1.0f / (rows * cols);
+          sum[4 * x + 0] *= scale;
+          sum[4 * x + 1] *= scale;
+          sum[4 * x + 2] *= scale;
+          sum[4 * x + 3] *= scale;
+        }
+
+      gdk_memory_convert (mm->dest_data + y * mm->dest_stride,
+                          mm->dest_stride,
+                          mm->dest_format,
+                          (guchar *) sum,
+                          dest_width * 4 * sizeof (float),
+                          GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED,
+                          dest_width,
+                          1);
+    }
+
+  g_free (sum);
+  g_free (row);
+}
+
+/*
+ * gdk_memory_mipmap:
+ * @lod_level: the mipmap level to create
+ *
+ * Creates a downscaled copy of the source image by averaging
+ * blocks of 2^lod_level x 2^lod_level pixels. The averaging
+ * happens in premultiplied float, so it is correct for all
+ * formats.
+ *
+ * The destination must be large enough to hold
+ * ceil (src_width / 2^lod_level) x ceil (src_height / 2^lod_level)
+ * pixels. Blocks at the right and bottom edges may be partial.
+ *
+ * Large images are processed on multiple threads.
+ */
+void
+gdk_memory_mipmap (guchar          *dest_data,
+                   gsize            dest_stride,
+                   GdkMemoryFormat  dest_format,
+                   const guchar    *src_data,
+                   gsize            src_stride,
+                   GdkMemoryFormat  src_format,
+                   gsize            src_width,
+                   gsize            src_height,
+                   guint            lod_level)
+{
+  MemoryMipmap mm;
+  gsize dest_height;
+
+  g_assert (lod_level < 8 * sizeof (gsize));
+
+  if (lod_level == 0)
+    {
+      gdk_memory_convert (dest_data, dest_stride, dest_format,
+                          src_data, src_stride, src_format,
+                          src_width, src_height);
+      return;
+    }
+
+  mm = (MemoryMipmap) {
+    .dest_data = dest_data,
+    .dest_stride = dest_stride,
+    .dest_format = dest_format,
+    .src_data = src_data,
+    .src_stride = src_stride,
+    .src_format = src_format,
+    .src_width = src_width,
+    .src_height = src_height,
+    .lod_level = lod_level,
+    .next_row = 0,
+  };
+  dest_height = (src_height + ((gsize) 1 << lod_level) - 1) >> lod_level;
+
+  if (src_width * src_height < PARALLEL_MIN_PIXELS)
+    gdk_memory_mipmap_rows (&mm);
+  else
+    gdk_parallel_task_run (gdk_memory_mipmap_rows, &mm, MIN (dest_height, G_MAXUINT));
+}
@@ -83,6 +83,23 @@ void                    gdk_memory_convert                  (guchar
                                                              GdkMemoryFormat             src_format,
                                                              gsize                       width,
                                                              gsize                       height);
+void                    gdk_memory_convert_parallel         (guchar                     *dest_data,
+                                                             gsize                       dest_stride,
+                                                             GdkMemoryFormat             dest_format,
+                                                             const guchar               *src_data,
+                                                             gsize                       src_stride,
+                                                             GdkMemoryFormat             src_format,
+                                                             gsize                       width,
+                                                             gsize                       height);
+void                    gdk_memory_mipmap                   (guchar                     *dest_data,
+                                                             gsize                       dest_stride,
+                                                             GdkMemoryFormat             dest_format,
+                                                             const guchar               *src_data,
+                                                             gsize                       src_stride,
+                                                             GdkMemoryFormat             src_format,
+                                                             gsize                       src_width,
+                                                             gsize                       src_height,
+                                                             guint                       lod_level);
 
 
 G_END_DECLS
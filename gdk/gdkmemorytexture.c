@@ -63,13 +63,13 @@ gdk_memory_texture_download (GdkTexture      *texture,
 {
   GdkMemoryTexture *self = GDK_MEMORY_TEXTURE (texture);
 
-  gdk_memory_convert (data, stride,
-                      format,
-                      (guchar *) g_bytes_get_data (self->bytes, NULL),
-                      self->stride,
-                      texture->format,
-                      gdk_texture_get_width (texture),
-                      gdk_texture_get_height (texture));
+  gdk_memory_convert_parallel (data, stride,
+                               format,
+                               (guchar *) g_bytes_get_data (self->bytes, NULL),
+                               self->stride,
+                               texture->format,
+                               gdk_texture_get_width (texture),
+                               gdk_texture_get_height (texture));
 }
 
 static void
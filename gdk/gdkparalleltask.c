@@ -0,0 +1,181 @@
+/*
+ * Copyright © 2024 the GTK team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkparalleltaskprivate.h"
+
+struct _GdkParallelTask
+{
+  GdkTaskFunc task_func;
+  gpointer task_data;
+  int n_running_tasks;
+  GMutex mutex;
+  GCond cond;
+};
+
+static GPrivate in_worker_thread;
+
+static void
+gdk_parallel_task_thread_func (gpointer data,
+                               gpointer unused)
+{
+  GdkParallelTask *task = data;
+
+  g_private_set (&in_worker_thread, GINT_TO_POINTER (TRUE));
+
+  task->task_func (task->task_data);
+
+  /* Decrement with the mutex held, the waiting thread frees the
+   * mutex as soon as it sees the count drop to 0 */
+  g_mutex_lock (&task->mutex);
+  if (g_atomic_int_dec_and_test (&task->n_running_tasks))
+    g_cond_signal (&task->cond);
+  g_mutex_unlock (&task->mutex);
+}
+
+static GThreadPool *
+gdk_parallel_task_get_pool (void)
+{
+  static GThreadPool *pool;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      pool = g_thread_pool_new (gdk_parallel_task_thread_func,
+                                NULL,
+                                g_get_num_processors (),
+                                FALSE,
+                                NULL);
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
+/**
+ * gdk_parallel_task_run:
+ * @task_func: the function to spawn
+ * @task_data: data to pass to the function
+ * @max_tasks: the maximum number of tasks to spawn
+ *
+ * Spawns up to @max_tasks copies of @task_func on worker threads
+ * and runs one of them in the calling thread. Returns once all of
+ * them have finished.
+ *
+ * The functions are expected to split the work between them, for
+ * example by atomically grabbing chunks of it until none are left.
+ * Tasks that start late may find no work left and return right away.
+ *
+ * When called from one of the worker threads, @task_func is run
+ * only once, in the calling thread, to avoid deadlocks.
+ **/
+void
+gdk_parallel_task_run (GdkTaskFunc task_func,
+                       gpointer    task_data,
+                       guint       max_tasks)
+{
+  GdkParallelTask task;
+  guint i, n_tasks;
+
+  n_tasks = MIN (max_tasks, g_get_num_processors ());
+
+  if (n_tasks <= 1 || g_private_get (&in_worker_thread))
+    {
+      task_func (task_data);
+      return;
+    }
+
+  task.task_func = task_func;
+  task.task_data = task_data;
+  task.n_running_tasks = n_tasks - 1;
+  g_mutex_init (&task.mutex);
+  g_cond_init (&task.cond);
+
+  for (i = 1; i < n_tasks; i++)
+    g_thread_pool_push (gdk_parallel_task_get_pool (), &task, NULL);
+
+  task_func (task_data);
+
+  g_mutex_lock (&task.mutex);
+  while (g_atomic_int_get (&task.n_running_tasks) > 0)
+    g_cond_wait (&task.cond, &task.mutex);
+  g_mutex_unlock (&task.mutex);
+
+  g_mutex_clear (&task.mutex);
+  g_cond_clear (&task.cond);
+}
+
+/**
+ * gdk_parallel_task_spawn:
+ * @task_func: the function to spawn
+ * @task_data: data to pass to the function
+ *
+ * Runs @task_func on a worker thread while the caller continues.
+ *
+ * The task must be waited for with gdk_parallel_task_join(), which
+ * also frees it.
+ *
+ * When called from one of the worker threads, @task_func is run
+ * right away in the calling thread.
+ *
+ * Returns: (transfer full): the running task
+ **/
+GdkParallelTask *
+gdk_parallel_task_spawn (GdkTaskFunc task_func,
+                         gpointer    task_data)
+{
+  GdkParallelTask *task;
+
+  task = g_new (GdkParallelTask, 1);
+  task->task_func = task_func;
+  task->task_data = task_data;
+  g_mutex_init (&task->mutex);
+  g_cond_init (&task->cond);
+
+  if (g_private_get (&in_worker_thread))
+    {
+      task->n_running_tasks = 0;
+      task_func (task_data);
+    }
+  else
+    {
+      task->n_running_tasks = 1;
+      g_thread_pool_push (gdk_parallel_task_get_pool (), task, NULL);
+    }
+
+  return task;
+}
+
+/**
+ * gdk_parallel_task_join:
+ * @task: (transfer full): a task created with gdk_parallel_task_spawn()
+ *
+ * Waits for @task to finish and frees it.
+ **/
+void
+gdk_parallel_task_join (GdkParallelTask *task)
+{
+  g_mutex_lock (&task->mutex);
+  while (g_atomic_int_get (&task->n_running_tasks) > 0)
+    g_cond_wait (&task->cond, &task->mutex);
+  g_mutex_unlock (&task->mutex);
+
+  g_mutex_clear (&task->mutex);
+  g_cond_clear (&task->cond);
+  g_free (task);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright © 2024 the GTK team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GdkParallelTask GdkParallelTask;
+
+typedef void (* GdkTaskFunc) (gpointer user_data);
+
+void                    gdk_parallel_task_run                   (GdkTaskFunc             task_func,
+                                                                 gpointer                task_data,
+                                                                 guint                   max_tasks);
+
+GdkParallelTask *       gdk_parallel_task_spawn                 (GdkTaskFunc             task_func,
+                                                                 gpointer                task_data);
+void                    gdk_parallel_task_join                  (GdkParallelTask        *task);
+
+G_END_DECLS
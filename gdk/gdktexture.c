@@ -44,8 +44,10 @@
 #include "gdkmemorytextureprivate.h"
 #include "gdkpaintable.h"
 #include "gdksnapshot.h"
+#include "gdkworkerpoolprivate.h"
 
 #include <graphene.h>
+#include <math.h>
 #include "loaders/gdkpngprivate.h"
 #include "loaders/gdktiffprivate.h"
 #include "loaders/gdkjpegprivate.h"
@@ -206,7 +208,7 @@ gdk_texture_loadable_icon_load_async (GLoadableIcon       *icon,
   GTask *task;
 
   task = g_task_new (icon, cancellable, callback, user_data);
-  g_task_run_in_thread (task, gdk_texture_loadable_icon_load_in_thread);
+  gdk_worker_pool_run_task (task, GDK_WORKER_PRIORITY_DEFAULT, gdk_texture_loadable_icon_load_in_thread);
   g_object_unref (task);
 }
 
@@ -559,19 +561,22 @@ gdk_texture_can_load (GBytes *bytes)
 
 static GdkTexture *
 gdk_texture_new_from_bytes_internal (GBytes  *bytes,
+                                     int      width,
+                                     int      height,
                                      GError **error)
 {
   if (gdk_is_png (bytes))
     {
+      /* PNG can't be decoded at a reduced size */
       return gdk_load_png (bytes, error);
     }
   else if (gdk_is_jpeg (bytes))
     {
-      return gdk_load_jpeg (bytes, error);
+      return gdk_load_jpeg_at_size (bytes, width, height, error);
     }
   else if (gdk_is_tiff (bytes))
     {
-      return gdk_load_tiff (bytes, error);
+      return gdk_load_tiff_at_size (bytes, width, height, error);
     }
   else
     {
@@ -582,27 +587,83 @@ gdk_texture_new_from_bytes_internal (GBytes  *bytes,
     }
 }
 
+typedef struct {
+  int width;
+  int height;
+} PixbufSizeHint;
+
+/* Picks the smallest size that covers the hint, without scaling up */
+static void
+gdk_texture_pixbuf_size_prepared (GdkPixbufLoader *loader,
+                                  int              width,
+                                  int              height,
+                                  gpointer         data)
+{
+  PixbufSizeHint *hint = data;
+  double scale;
+
+  if (width <= 0 || height <= 0)
+    return;
+
+  scale = 0;
+  if (hint->width > 0)
+    scale = MAX (scale, (double) hint->width / width);
+  if (hint->height > 0)
+    scale = MAX (scale, (double) hint->height / height);
+
+  if (scale <= 0 || scale >= 1.0)
+    return;
+
+  gdk_pixbuf_loader_set_size (loader,
+                              MAX (1, (int) ceil (width * scale)),
+                              MAX (1, (int) ceil (height * scale)));
+}
+
 static GdkTexture *
 gdk_texture_new_from_bytes_pixbuf (GBytes  *bytes,
+                                   int      width,
+                                   int      height,
                                    GError **error)
 {
-  GInputStream *stream;
+  PixbufSizeHint hint = { width, height };
+  GdkPixbufLoader *loader;
   GdkPixbuf *pixbuf;
   GdkTexture *texture;
 
-  stream = g_memory_input_stream_new_from_bytes (bytes);
-  pixbuf = gdk_pixbuf_new_from_stream (stream, NULL, error);
-  g_object_unref (stream);
+  loader = gdk_pixbuf_loader_new ();
+  if (width > 0 || height > 0)
+    g_signal_connect (loader, "size-prepared",
+                      G_CALLBACK (gdk_texture_pixbuf_size_prepared), &hint);
+
+  if (!gdk_pixbuf_loader_write_bytes (loader, bytes, error))
+    {
+      gdk_pixbuf_loader_close (loader, NULL);
+      g_object_unref (loader);
+      return NULL;
+    }
+
+  if (!gdk_pixbuf_loader_close (loader, error))
+    {
+      g_object_unref (loader);
+      return NULL;
+    }
+
+  pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
   if (pixbuf == NULL)
-    return NULL;
+    {
+      g_set_error_literal (error,
+                           GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                           _("Image contains no data."));
+      g_object_unref (loader);
+      return NULL;
+    }
 
   texture = gdk_texture_new_for_pixbuf (pixbuf);
-  g_object_unref (pixbuf);
+  g_object_unref (loader);
 
   return texture;
 }
 
-
 /**
  * gdk_texture_new_from_bytes:
  * @bytes: a `GBytes` containing the data to load
@@ -626,6 +687,51 @@ gdk_texture_new_from_bytes_pixbuf (GBytes  *bytes,
 GdkTexture *
 gdk_texture_new_from_bytes (GBytes  *bytes,
                             GError **error)
+{
+  g_return_val_if_fail (bytes != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return gdk_texture_new_from_bytes_at_size (bytes, -1, -1, error);
+}
+
+/**
+ * gdk_texture_new_from_bytes_at_size:
+ * @bytes: a `GBytes` containing the data to load
+ * @width: the width the texture will be displayed at, or -1
+ * @height: the height the texture will be displayed at, or -1
+ * @error: Return location for an error
+ *
+ * Creates a new texture by loading an image from memory, decoding
+ * it at a reduced size if the image format allows doing that cheaply.
+ *
+ * This is meant for thumbnails and other cases where a large image
+ * is displayed at a small size. It saves memory and decoding time
+ * compared to [ctor@Gdk.Texture.new_from_bytes].
+ *
+ * The aspect ratio is preserved and the image is never scaled up.
+ * The resulting texture will be at least @width x @height unless
+ * the image is smaller than that, but it may be larger, so you
+ * should still scale it when drawing. Pass -1 for a dimension to
+ * not constrain it.
+ *
+ * Currently, JPEG images are decoded at 1/2, 1/4 or 1/8 scale and
+ * TIFF images use reduced-resolution subfiles when they contain them.
+ *
+ * If %NULL is returned, then @error will be set.
+ *
+ * This function is threadsafe, so that you can e.g. use GTask
+ * and [method@Gio.Task.run_in_thread] to avoid blocking the main thread
+ * while loading a big image.
+ *
+ * Return value: A newly-created `GdkTexture`
+ *
+ * Since: 4.14
+ */
+GdkTexture *
+gdk_texture_new_from_bytes_at_size (GBytes  *bytes,
+                                    int      width,
+                                    int      height,
+                                    GError **error)
 {
   GdkTexture *texture;
   GError *internal_error = NULL;
@@ -633,7 +739,7 @@ gdk_texture_new_from_bytes (GBytes  *bytes,
   g_return_val_if_fail (bytes != NULL, NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  texture = gdk_texture_new_from_bytes_internal (bytes, &internal_error);
+  texture = gdk_texture_new_from_bytes_internal (bytes, width, height, &internal_error);
   if (texture)
     return texture;
 
@@ -646,7 +752,7 @@ gdk_texture_new_from_bytes (GBytes  *bytes,
 
   g_clear_error (&internal_error);
 
-  return gdk_texture_new_from_bytes_pixbuf (bytes, error);
+  return gdk_texture_new_from_bytes_pixbuf (bytes, width, height, error);
 }
 
 /**
@@ -0,0 +1,232 @@
+/*
+ * Copyright © 2024 the GTK team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkworkerpoolprivate.h"
+
+#include "gdkprofilerprivate.h"
+
+/* Background jobs are delayed while frames are in progress, but not
+ * forever, so overlapping frames can't starve them. */
+#define MAX_DEFER_TIME (100 * G_TIME_SPAN_MILLISECOND)
+
+typedef struct _GdkWorkerJob GdkWorkerJob;
+
+struct _GdkWorkerJob
+{
+  GTask *task;
+  GTaskThreadFunc task_func;
+  GdkWorkerPriority priority;
+  guint serial;
+};
+
+static GThreadPool *pool;
+
+/* protected by frame_mutex */
+static GMutex frame_mutex;
+static guint frames_in_progress;
+static GQueue deferred_jobs = G_QUEUE_INIT;
+static gint64 deferred_since;
+
+static int job_serial;
+static int n_queued;
+static int n_running;
+static int n_deferred;
+
+static guint queued_counter;
+static guint running_counter;
+static guint deferred_counter;
+
+static void
+gdk_worker_pool_update_counters (void)
+{
+  gdk_profiler_set_int_counter (queued_counter, g_atomic_int_get (&n_queued));
+  gdk_profiler_set_int_counter (running_counter, g_atomic_int_get (&n_running));
+  gdk_profiler_set_int_counter (deferred_counter, g_atomic_int_get (&n_deferred));
+}
+
+static void
+gdk_worker_pool_thread_func (gpointer data,
+                             gpointer unused)
+{
+  GdkWorkerJob *job = data;
+  GTask *task = job->task;
+
+  g_atomic_int_add (&n_queued, -1);
+  g_atomic_int_inc (&n_running);
+  gdk_worker_pool_update_counters ();
+
+  job->task_func (task,
+                  g_task_get_source_object (task),
+                  g_task_get_task_data (task),
+                  g_task_get_cancellable (task));
+
+  g_atomic_int_add (&n_running, -1);
+  gdk_worker_pool_update_counters ();
+
+  g_object_unref (task);
+  g_free (job);
+}
+
+static int
+gdk_worker_job_compare (gconstpointer a,
+                        gconstpointer b,
+                        gpointer      unused)
+{
+  const GdkWorkerJob *job_a = a;
+  const GdkWorkerJob *job_b = b;
+
+  if (job_a->priority != job_b->priority)
+    return job_a->priority < job_b->priority ? -1 : 1;
+
+  /* keep jobs of the same priority in order, even if the serial wraps */
+  return (int) (job_a->serial - job_b->serial);
+}
+
+static GThreadPool *
+gdk_worker_pool_get (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      pool = g_thread_pool_new (gdk_worker_pool_thread_func,
+                                NULL,
+                                MAX (2, g_get_num_processors () - 1),
+                                FALSE,
+                                NULL);
+      g_thread_pool_set_sort_function (pool, gdk_worker_job_compare, NULL);
+
+      queued_counter = gdk_profiler_define_int_counter ("worker queued", "Jobs waiting for a worker thread");
+      running_counter = gdk_profiler_define_int_counter ("worker running", "Jobs running on worker threads");
+      deferred_counter = gdk_profiler_define_int_counter ("worker deferred", "Background jobs waiting for frames to finish");
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
+/* Hands all deferred jobs to the threads. Call with frame_mutex held. */
+static void
+gdk_worker_pool_release_deferred (void)
+{
+  GdkWorkerJob *job;
+
+  while ((job = g_queue_pop_head (&deferred_jobs)))
+    {
+      g_atomic_int_add (&n_deferred, -1);
+      g_atomic_int_inc (&n_queued);
+      g_thread_pool_push (gdk_worker_pool_get (), job, NULL);
+    }
+
+  gdk_worker_pool_update_counters ();
+}
+
+/* Releases deferred jobs that have waited too long. Call with
+ * frame_mutex held. */
+static void
+gdk_worker_pool_check_deferred (void)
+{
+  if (g_queue_is_empty (&deferred_jobs))
+    return;
+
+  if (g_get_monotonic_time () - deferred_since >= MAX_DEFER_TIME)
+    gdk_worker_pool_release_deferred ();
+}
+
+/*
+ * gdk_worker_pool_run_task:
+ * @task: the task to run
+ * @priority: the priority of the task
+ * @task_func: the function to run
+ *
+ * Runs @task_func on the shared worker threads. This works like
+ * g_task_run_in_thread(), but all of GTK shares the same threads
+ * and the pool knows about frames.
+ *
+ * Jobs with higher priority are started first. Background jobs
+ * that are started while a frame clock is laying out or painting
+ * a frame are held back until the frame ends, so that they don't
+ * compete with it for CPU time. They don't occupy a thread while
+ * they wait.
+ */
+void
+gdk_worker_pool_run_task (GTask             *task,
+                          GdkWorkerPriority  priority,
+                          GTaskThreadFunc    task_func)
+{
+  GdkWorkerJob *job;
+
+  g_return_if_fail (G_IS_TASK (task));
+  g_return_if_fail (task_func != NULL);
+
+  job = g_new (GdkWorkerJob, 1);
+  job->task = g_object_ref (task);
+  job->task_func = task_func;
+  job->priority = priority;
+  job->serial = g_atomic_int_add (&job_serial, 1);
+
+  if (priority == GDK_WORKER_PRIORITY_BACKGROUND)
+    {
+      g_mutex_lock (&frame_mutex);
+      if (frames_in_progress > 0)
+        {
+          if (g_queue_is_empty (&deferred_jobs))
+            deferred_since = g_get_monotonic_time ();
+          g_queue_push_tail (&deferred_jobs, job);
+          g_atomic_int_inc (&n_deferred);
+          gdk_worker_pool_check_deferred ();
+          g_mutex_unlock (&frame_mutex);
+          gdk_worker_pool_update_counters ();
+          return;
+        }
+      g_mutex_unlock (&frame_mutex);
+    }
+
+  g_atomic_int_inc (&n_queued);
+  g_thread_pool_push (gdk_worker_pool_get (), job, NULL);
+  gdk_worker_pool_update_counters ();
+}
+
+/*
+ * gdk_worker_pool_begin_frame:
+ *
+ * Tells the pool that a frame clock started a frame.
+ * Background jobs are held back until the matching
+ * gdk_worker_pool_end_frame() call.
+ */
+void
+gdk_worker_pool_begin_frame (void)
+{
+  g_mutex_lock (&frame_mutex);
+  frames_in_progress++;
+  gdk_worker_pool_check_deferred ();
+  g_mutex_unlock (&frame_mutex);
+}
+
+void
+gdk_worker_pool_end_frame (void)
+{
+  g_mutex_lock (&frame_mutex);
+  g_assert (frames_in_progress > 0);
+  frames_in_progress--;
+  if (frames_in_progress == 0)
+    gdk_worker_pool_release_deferred ();
+  g_mutex_unlock (&frame_mutex);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright © 2024 the GTK team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/*
+ * GdkWorkerPriority:
+ * @GDK_WORKER_PRIORITY_DEFAULT: Run as soon as a thread is available.
+ *   Use this for work that the user is waiting for.
+ * @GDK_WORKER_PRIORITY_BACKGROUND: Don't start while a frame is being
+ *   laid out and painted. Use this for speculative work like preloading.
+ */
+typedef enum {
+  GDK_WORKER_PRIORITY_DEFAULT,
+  GDK_WORKER_PRIORITY_BACKGROUND,
+} GdkWorkerPriority;
+
+void                    gdk_worker_pool_run_task                (GTask                  *task,
+                                                                 GdkWorkerPriority       priority,
+                                                                 GTaskThreadFunc         task_func);
+
+void                    gdk_worker_pool_begin_frame             (void);
+void                    gdk_worker_pool_end_frame               (void);
+
+G_END_DECLS
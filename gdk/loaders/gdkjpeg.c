@@ -134,9 +134,57 @@ convert_cmyk_to_rgba (guchar *data,
  /* }}} */
 /* {{{ Public API */
 
+/* Picks the largest DCT scaling factor that keeps the image
+ * at least as large as requested */
+static void
+choose_scale (struct jpeg_decompress_struct *info,
+              int                            width,
+              int                            height)
+{
+  guint denom;
+
+  info->scale_num = 1;
+  info->scale_denom = 1;
+
+  if (width <= 0 && height <= 0)
+    return;
+
+  for (denom = 8; denom > 1; denom /= 2)
+    {
+      if ((width <= 0 || (info->image_width + denom - 1) / denom >= (guint) width) &&
+          (height <= 0 || (info->image_height + denom - 1) / denom >= (guint) height))
+        {
+          info->scale_denom = denom;
+          return;
+        }
+    }
+}
+
 GdkTexture *
 gdk_load_jpeg (GBytes  *input_bytes,
                GError **error)
+{
+  return gdk_load_jpeg_at_size (input_bytes, -1, -1, error);
+}
+
+/*
+ * gdk_load_jpeg_at_size:
+ * @input_bytes: the JPEG data
+ * @width_hint: the minimum width to decode at, or -1
+ * @height_hint: the minimum height to decode at, or -1
+ * @error: return location for an error
+ *
+ * Loads a JPEG image, using DCT scaling to decode it at the
+ * smallest of 1/1, 1/2, 1/4 or 1/8 of its size that is still
+ * at least @width_hint x @height_hint.
+ *
+ * Returns: the texture or %NULL on error
+ */
+GdkTexture *
+gdk_load_jpeg_at_size (GBytes  *input_bytes,
+                       int      width_hint,
+                       int      height_hint,
+                       GError **error)
 {
   struct jpeg_decompress_struct info;
   struct error_handler_data jerr;
@@ -170,6 +218,7 @@ gdk_load_jpeg (GBytes  *input_bytes,
                 g_bytes_get_size (input_bytes));
 
   jpeg_read_header (&info, TRUE);
+  choose_scale (&info, width_hint, height_hint);
   jpeg_start_decompress (&info);
 
   width = info.output_width;
@@ -24,6 +24,10 @@
 
 GdkTexture *gdk_load_jpeg         (GBytes           *bytes,
                                    GError          **error);
+GdkTexture *gdk_load_jpeg_at_size (GBytes           *bytes,
+                                   int               width,
+                                   int               height,
+                                   GError          **error);
 
 GBytes     *gdk_save_jpeg         (GdkTexture     *texture);
 
@@ -372,9 +372,77 @@ load_fallback (TIFF    *tif,
   return texture;
 }
 
+/* Looks for the smallest reduced-resolution subfile that is
+ * still at least as large as requested and makes it current.
+ * Stays on the main image if there is none. */
+static void
+choose_directory (TIFF *tif,
+                  int   width_hint,
+                  int   height_hint)
+{
+  guint32 best_width, best_height;
+  tdir_t best_dir, dir;
+
+  TIFFSetDirectory (tif, 0);
+
+  if (width_hint <= 0 && height_hint <= 0)
+    return;
+
+  TIFFGetFieldDefaulted (tif, TIFFTAG_IMAGEWIDTH, &best_width);
+  TIFFGetFieldDefaulted (tif, TIFFTAG_IMAGELENGTH, &best_height);
+  best_dir = 0;
+
+  for (dir = 1; TIFFSetDirectory (tif, dir); dir++)
+    {
+      guint32 subfile_type, width, height;
+
+      if (!TIFFGetField (tif, TIFFTAG_SUBFILETYPE, &subfile_type) ||
+          (subfile_type & FILETYPE_REDUCEDIMAGE) == 0)
+        continue;
+
+      TIFFGetFieldDefaulted (tif, TIFFTAG_IMAGEWIDTH, &width);
+      TIFFGetFieldDefaulted (tif, TIFFTAG_IMAGELENGTH, &height);
+
+      if ((width_hint > 0 && width < (guint32) width_hint) ||
+          (height_hint > 0 && height < (guint32) height_hint))
+        continue;
+
+      if ((guint64) width * height < (guint64) best_width * best_height)
+        {
+          best_width = width;
+          best_height = height;
+          best_dir = dir;
+        }
+    }
+
+  TIFFSetDirectory (tif, best_dir);
+}
+
 GdkTexture *
 gdk_load_tiff (GBytes  *input_bytes,
                GError **error)
+{
+  return gdk_load_tiff_at_size (input_bytes, -1, -1, error);
+}
+
+/*
+ * gdk_load_tiff_at_size:
+ * @input_bytes: the TIFF data
+ * @width_hint: the minimum width to decode at, or -1
+ * @height_hint: the minimum height to decode at, or -1
+ * @error: return location for an error
+ *
+ * Loads a TIFF image. If the file contains reduced-resolution
+ * subfiles, the smallest one that is at least
+ * @width_hint x @height_hint is loaded instead of the full image.
+ *
+ * Returns: the texture or %NULL on error
+ */
+GdkTexture *
+gdk_load_tiff_at_size (GBytes  *input_bytes,
+                       int      width_hint,
+                       int      height_hint,
+                       GError **error)
 {
   TIFF *tif;
   guint16 samples_per_pixel;
@@ -402,7 +470,7 @@ gdk_load_tiff (GBytes  *input_bytes,
       return NULL;
     }
 
-  TIFFSetDirectory (tif, 0);
+  choose_directory (tif, width_hint, height_hint);
 
   TIFFGetFieldDefaulted (tif, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
   TIFFGetFieldDefaulted (tif, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
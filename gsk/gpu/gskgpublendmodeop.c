@@ -75,6 +75,8 @@ gsk_gpu_blend_mode_op (GskGpuFrame            *frame,
                            blend_mode,
                            clip,
                            desc,
+                           rect,
+                           offset,
                            &instance);
 
   gsk_gpu_rect_to_float (rect, offset, instance->rect);
@@ -75,6 +75,8 @@ gsk_gpu_blur_op_full (GskGpuFrame            *frame,
                            variation,
                            clip,
                            desc,
+                           rect,
+                           offset,
                            &instance);
 
   gsk_gpu_rect_to_float (rect, offset, instance->rect);
@@ -116,6 +116,8 @@ gsk_gpu_border_op (GskGpuFrame            *frame,
                            0,
                            clip,
                            NULL,
+                           &outline->bounds,
+                           offset,
                            &instance);
 
   gsk_rounded_rect_to_float (outline, offset, instance->outline);
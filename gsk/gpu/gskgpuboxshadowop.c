@@ -99,6 +99,8 @@ gsk_gpu_box_shadow_op (GskGpuFrame            *frame,
                            inset ? VARIATION_INSET : 0,
                            clip,
                            NULL,
+                           bounds,
+                           offset,
                            &instance);
 
   gsk_gpu_rect_to_float (bounds, offset, instance->bounds);
@@ -8,6 +8,10 @@
 
 #include "gpu/shaders/gskgpucolorizeinstance.h"
 
+#define VARIATION_SDF 1
+#define VARIATION_WINDING 2
+#define VARIATION_EVEN_ODD 4
+
 typedef struct _GskGpuColorizeOp GskGpuColorizeOp;
 
 struct _GskGpuColorizeOp
@@ -26,7 +30,14 @@ gsk_gpu_colorize_op_print (GskGpuOp    *op,
 
   instance = (GskGpuColorizeInstance *) gsk_gpu_frame_get_vertex_data (frame, shader->vertex_offset);
 
-  gsk_gpu_print_op (string, indent, "colorize");
+  if (shader->variation & VARIATION_SDF)
+    gsk_gpu_print_op (string, indent, "colorize-sdf");
+  else if (shader->variation & VARIATION_WINDING)
+    gsk_gpu_print_op (string, indent, "colorize-winding");
+  else if (shader->variation & VARIATION_EVEN_ODD)
+    gsk_gpu_print_op (string, indent, "colorize-even-odd");
+  else
+    gsk_gpu_print_op (string, indent, "colorize");
   gsk_gpu_print_rect (string, instance->rect);
   gsk_gpu_print_image_descriptor (string, shader->desc, instance->tex_id);
   gsk_gpu_print_rgba (string, instance->color);
@@ -53,23 +64,26 @@ static const GskGpuShaderOpClass GSK_GPU_COLORIZE_OP_CLASS = {
   gsk_gpu_colorize_setup_vao
 };
 
-void
-gsk_gpu_colorize_op (GskGpuFrame            *frame,
-                     GskGpuShaderClip        clip,
-                     GskGpuDescriptors      *descriptors,
-                     guint32                 descriptor,
-                     const graphene_rect_t  *rect,
-                     const graphene_point_t *offset,
-                     const graphene_rect_t  *tex_rect,
-                     const GdkRGBA          *color)
+static void
+gsk_gpu_colorize_op_full (GskGpuFrame            *frame,
+                          guint32                 variation,
+                          GskGpuShaderClip        clip,
+                          GskGpuDescriptors      *descriptors,
+                          guint32                 descriptor,
+                          const graphene_rect_t  *rect,
+                          const graphene_point_t *offset,
+                          const graphene_rect_t  *tex_rect,
+                          const GdkRGBA          *color)
 {
   GskGpuColorizeInstance *instance;
 
   gsk_gpu_shader_op_alloc (frame,
                            &GSK_GPU_COLORIZE_OP_CLASS,
-                           0,
+                           variation,
                            clip,
                            descriptors,
+                           rect,
+                           offset,
                            &instance);
 
   gsk_gpu_rect_to_float (rect, offset, instance->rect);
@@ -77,3 +91,71 @@ gsk_gpu_colorize_op (GskGpuFrame            *frame,
   instance->tex_id = descriptor;
   gsk_gpu_rgba_to_float (color, instance->color);
 }
+
+void
+gsk_gpu_colorize_op (GskGpuFrame            *frame,
+                     GskGpuShaderClip        clip,
+                     GskGpuDescriptors      *descriptors,
+                     guint32                 descriptor,
+                     const graphene_rect_t  *rect,
+                     const graphene_point_t *offset,
+                     const graphene_rect_t  *tex_rect,
+                     const GdkRGBA          *color)
+{
+  gsk_gpu_colorize_op_full (frame,
+                            0,
+                            clip,
+                            descriptors,
+                            descriptor,
+                            rect,
+                            offset,
+                            tex_rect,
+                            color);
+}
+
+/* The alpha channel of the texture is a signed distance field,
+ * as uploaded by gsk_gpu_upload_sdf_glyph_op() */
+void
+gsk_gpu_colorize_sdf_op (GskGpuFrame            *frame,
+                         GskGpuShaderClip        clip,
+                         GskGpuDescriptors      *descriptors,
+                         guint32                 descriptor,
+                         const graphene_rect_t  *rect,
+                         const graphene_point_t *offset,
+                         const graphene_rect_t  *tex_rect,
+                         const GdkRGBA          *color)
+{
+  gsk_gpu_colorize_op_full (frame,
+                            VARIATION_SDF,
+                            clip,
+                            descriptors,
+                            descriptor,
+                            rect,
+                            offset,
+                            tex_rect,
+                            color);
+}
+
+/* The texture contains the winding numbers of a path,
+ * as drawn by gsk_gpu_path_op() */
+void
+gsk_gpu_colorize_path_op (GskGpuFrame            *frame,
+                          GskGpuShaderClip        clip,
+                          GskGpuDescriptors      *descriptors,
+                          guint32                 descriptor,
+                          GskFillRule             fill_rule,
+                          const graphene_rect_t  *rect,
+                          const graphene_point_t *offset,
+                          const graphene_rect_t  *tex_rect,
+                          const GdkRGBA          *color)
+{
+  gsk_gpu_colorize_op_full (frame,
+                            fill_rule == GSK_FILL_RULE_EVEN_ODD ? VARIATION_EVEN_ODD : VARIATION_WINDING,
+                            clip,
+                            descriptors,
+                            descriptor,
+                            rect,
+                            offset,
+                            tex_rect,
+                            color);
+}
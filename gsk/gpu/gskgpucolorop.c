@@ -67,6 +67,8 @@ gsk_gpu_color_op (GskGpuFrame            *frame,
                            0,
                            clip,
                            NULL,
+                           rect,
+                           offset,
                            &instance);
 
   gsk_gpu_rect_to_float (rect, offset, instance->rect);
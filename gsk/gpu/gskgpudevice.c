@@ -5,20 +5,64 @@
 #include "gskgpuframeprivate.h"
 #include "gskgpuuploadopprivate.h"
 
+#include "gskrendernodeprivate.h"
+#include "gskstrokeprivate.h"
+
 #include "gdk/gdkdisplayprivate.h"
+#include "gdk/gdkmemorytextureprivate.h"
 #include "gdk/gdktextureprivate.h"
 
-#define MAX_SLICES_PER_ATLAS 64
+/* Atlases start at this size and grow when they fill up with items
+ * that are still in use */
+#define MIN_ATLAS_SIZE 1024
+#define MAX_ATLAS_SIZE 4096
+
+/* Items in an atlas that have not been used for this long don't count
+ * as occupying it anymore */
+#define ATLAS_ITEM_TIMEOUT (4 * G_TIME_SPAN_SECOND)
+
+/* Atlases that are less than 1/MIN_ATLAS_OCCUPANCY occupied get freed.
+ * The items that are still in use get uploaded to the current atlas
+ * again the next time they are needed. */
+#define MIN_ATLAS_OCCUPANCY 4
+
+/* Tiles of huge textures that have not been used for this long get freed */
+#define TILE_CACHE_TIMEOUT (5 * G_TIME_SPAN_SECOND)
+
+/* Only small textures - like icons - are looked up by their contents */
+#define MAX_CONTENT_CACHE_PIXELS (256 * 256)
+
+/* How far outside of a glyph its distance field reaches, in pixels */
+#define SDF_GLYPH_SPREAD 8
+
+/* Rendered nodes that have not been used for this long get freed */
+#define NODE_CACHE_TIMEOUT (2 * G_TIME_SPAN_SECOND)
+
+/* Path masks that have not been used for this long get freed */
+#define PATH_CACHE_TIMEOUT (2 * G_TIME_SPAN_SECOND)
 
-#define ATLAS_SIZE 1024
+/* Offscreens that have not been reused for this long get freed */
+#define OFFSCREEN_POOL_TIMEOUT (1 * G_TIME_SPAN_SECOND)
 
-#define MAX_ATLAS_ITEM_SIZE 256
+/* How often rendering frames collects expired cache entries */
+#define CACHE_GC_INTERVAL (1 * G_TIME_SPAN_SECOND)
+/* Seconds after the last frame to collect the entries that expired
+ * since then. This must be longer than all the timeouts above. */
+#define CACHE_IDLE_GC_TIMEOUT 6
+
+/* The pool stops growing when its images have this many pixels */
+#define MAX_OFFSCREEN_POOL_PIXELS (16 * 1024 * 1024)
 
 typedef struct _GskGpuCached GskGpuCached;
 typedef struct _GskGpuCachedClass GskGpuCachedClass;
 typedef struct _GskGpuCachedAtlas GskGpuCachedAtlas;
+typedef struct _GskGpuCachedContent GskGpuCachedContent;
 typedef struct _GskGpuCachedGlyph GskGpuCachedGlyph;
+typedef struct _GskGpuCachedNode GskGpuCachedNode;
+typedef struct _GskGpuCachedOffscreen GskGpuCachedOffscreen;
+typedef struct _GskGpuCachedPath GskGpuCachedPath;
 typedef struct _GskGpuCachedTexture GskGpuCachedTexture;
+typedef struct _GskGpuCachedTile GskGpuCachedTile;
 typedef struct _GskGpuDevicePrivate GskGpuDevicePrivate;
 
 struct _GskGpuDevicePrivate
@@ -29,11 +73,27 @@ struct _GskGpuDevicePrivate
   GskGpuCached *first_cached;
   GskGpuCached *last_cached;
   guint cache_gc_source;
+  gint64 last_gc;
+  gint64 last_frame;
 
   GHashTable *texture_cache;
+  GHashTable *tile_cache;
+  GHashTable *content_cache;
+  GHashTable *node_cache;
+  GHashTable *path_cache;
   GHashTable *glyph_cache;
+  GHashTable *offscreen_pool;
+  gsize offscreen_pool_pixels;
+
+  gsize content_cache_hits;
+  gsize content_cache_misses;
+  gsize offscreen_pool_hits;
+  gsize offscreen_pool_misses;
 
   GskGpuCachedAtlas *current_atlas;
+  gsize atlas_size;
+  gsize atlas_occupancy;
+  gsize atlas_evictions;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GskGpuDevice, gsk_gpu_device, G_TYPE_OBJECT)
@@ -56,6 +116,9 @@ struct _GskGpuCached
   const GskGpuCachedClass *class;
   
   GskGpuCachedAtlas *atlas;
+  gsize atlas_pixels;
+  gint64 timestamp;
+
   GskGpuCached *next;
   GskGpuCached *prev;
 };
@@ -98,6 +161,7 @@ gsk_gpu_cached_new (GskGpuDevice            *device,
 
   cached->class = class;
   cached->atlas = atlas;
+  cached->timestamp = G_MININT64;
 
   cached->prev = priv->last_cached;
   priv->last_cached = cached;
@@ -114,31 +178,59 @@ gsk_gpu_cached_use (GskGpuDevice *device,
                     GskGpuCached *cached,
                     gint64        timestamp)
 {
-  /* FIXME */
+  cached->timestamp = MAX (cached->timestamp, timestamp);
 }
 
 /* }}} */
 /* {{{ CachedAtlas */
 
+/* The atlas is filled with a skyline allocator: The skyline is the
+ * top edge of the items allocated so far, stored as a list of
+ * horizontal segments from left to right. New items are placed on
+ * top of it where they end up lowest. */
+typedef struct _GskGpuSkylineSegment GskGpuSkylineSegment;
+
+struct _GskGpuSkylineSegment
+{
+  gsize x;
+  gsize y;
+  gsize width;
+};
+
+#define GDK_ARRAY_NAME gsk_gpu_skyline
+#define GDK_ARRAY_TYPE_NAME GskGpuSkyline
+#define GDK_ARRAY_ELEMENT_TYPE GskGpuSkylineSegment
+#define GDK_ARRAY_BY_VALUE 1
+#define GDK_ARRAY_PREALLOC 32
+#define GDK_ARRAY_NO_MEMSET 1
+#include "gdk/gdkarrayimpl.c"
+
 struct _GskGpuCachedAtlas
 {
   GskGpuCached parent;
 
   GskGpuImage *image;
+  gsize width;
+  gsize height;
+
+  GskGpuSkyline skyline;
 
-  gsize n_slices;
-  struct {
-    gsize width;
-    gsize height;
-  } slices[MAX_SLICES_PER_ATLAS];
+  /* updated by gsk_gpu_device_update_atlases() */
+  gsize live_pixels;
+  gboolean evict;
 };
 
 static void
 gsk_gpu_cached_atlas_free (GskGpuDevice *device,
                            GskGpuCached *cached)
 {
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
   GskGpuCachedAtlas *self = (GskGpuCachedAtlas *) cached;
 
+  if (priv->current_atlas == self)
+    priv->current_atlas = NULL;
+
+  gsk_gpu_skyline_clear (&self->skyline);
   g_object_unref (self->image);
   
   g_free (self);
@@ -149,8 +241,14 @@ gsk_gpu_cached_atlas_should_collect (GskGpuDevice *device,
                                      GskGpuCached *cached,
                                      gint64        timestamp)
 {
-  /* FIXME */
-  return FALSE;
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+  GskGpuCachedAtlas *self = (GskGpuCachedAtlas *) cached;
+
+  if (!self->evict)
+    return FALSE;
+
+  priv->atlas_evictions++;
+  return TRUE;
 }
 
 static const GskGpuCachedClass GSK_GPU_CACHED_ATLAS_CLASS =
@@ -161,12 +259,18 @@ static const GskGpuCachedClass GSK_GPU_CACHED_ATLAS_CLASS =
 };
 
 static GskGpuCachedAtlas *
-gsk_gpu_cached_atlas_new (GskGpuDevice *device)
+gsk_gpu_cached_atlas_new (GskGpuDevice *device,
+                          gsize         size)
 {
   GskGpuCachedAtlas *self;
 
   self = gsk_gpu_cached_new (device, &GSK_GPU_CACHED_ATLAS_CLASS, NULL);
-  self->image = GSK_GPU_DEVICE_GET_CLASS (device)->create_atlas_image (device, ATLAS_SIZE, ATLAS_SIZE);
+  self->image = GSK_GPU_DEVICE_GET_CLASS (device)->create_atlas_image (device, size, size);
+  self->width = size;
+  self->height = size;
+
+  gsk_gpu_skyline_init (&self->skyline);
+  gsk_gpu_skyline_append (&self->skyline, &(GskGpuSkylineSegment) { 0, 0, size });
 
   return self;
 }
@@ -253,6 +357,573 @@ gsk_gpu_cached_texture_new (GskGpuDevice *device,
   return self;
 }
 
+/* }}} */
+/* {{{ CachedTile */
+
+struct _GskGpuCachedTile
+{
+  GskGpuCached parent;
+
+  /* The texture pointer is only used as a hash key, it is not
+   * reset when the texture goes away */
+  gpointer key;
+  guint lod_level;
+  gsize tile_x;
+  gsize tile_y;
+
+  /* atomic */ GdkTexture *texture;
+  GWeakRef texture_ref;
+  GskGpuImage *image;
+  gint64 last_use;
+};
+
+static void gsk_gpu_cached_tile_destroy_cb (gpointer data);
+
+static void
+gsk_gpu_cached_tile_free (GskGpuDevice *device,
+                          GskGpuCached *cached)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+  GskGpuCachedTile *self = (GskGpuCachedTile *) cached;
+  GdkTexture *texture;
+
+  g_hash_table_remove (priv->tile_cache, self);
+  g_object_unref (self->image);
+
+  /* Tiles of long-lived textures get evicted and recreated all the
+   * time, so don't leave the weak ref behind for the texture to
+   * clean up. While we hold a reference, the texture can't be
+   * disposed, so the weak notify can't run concurrently. */
+  texture = g_weak_ref_get (&self->texture_ref);
+  g_weak_ref_clear (&self->texture_ref);
+  if (texture)
+    {
+      g_object_weak_unref (G_OBJECT (texture), (GWeakNotify) gsk_gpu_cached_tile_destroy_cb, self);
+      g_object_unref (texture);
+      g_free (self);
+      return;
+    }
+
+  /* The texture is gone or being disposed, so the weak notify may be
+   * running right now. Whoever comes second frees the tile. */
+  if (g_atomic_pointer_exchange (&self->texture, NULL) == NULL)
+    g_free (self);
+}
+
+static gboolean
+gsk_gpu_cached_tile_should_collect (GskGpuDevice *device,
+                                    GskGpuCached *cached,
+                                    gint64        timestamp)
+{
+  GskGpuCachedTile *self = (GskGpuCachedTile *) cached;
+
+  return g_atomic_pointer_get (&self->texture) == NULL ||
+         timestamp - self->last_use > TILE_CACHE_TIMEOUT;
+}
+
+static guint
+gsk_gpu_cached_tile_hash (gconstpointer data)
+{
+  const GskGpuCachedTile *tile = data;
+
+  return g_direct_hash (tile->key) ^
+         (tile->lod_level << 24) ^
+         (tile->tile_x << 12) ^
+         tile->tile_y;
+}
+
+static gboolean
+gsk_gpu_cached_tile_equal (gconstpointer v1,
+                           gconstpointer v2)
+{
+  const GskGpuCachedTile *tile1 = v1;
+  const GskGpuCachedTile *tile2 = v2;
+
+  return tile1->key == tile2->key
+      && tile1->lod_level == tile2->lod_level
+      && tile1->tile_x == tile2->tile_x
+      && tile1->tile_y == tile2->tile_y;
+}
+
+static const GskGpuCachedClass GSK_GPU_CACHED_TILE_CLASS =
+{
+  sizeof (GskGpuCachedTile),
+  gsk_gpu_cached_tile_free,
+  gsk_gpu_cached_tile_should_collect
+};
+
+static void
+gsk_gpu_cached_tile_destroy_cb (gpointer data)
+{
+  GskGpuCachedTile *cache = data;
+  gboolean cache_still_alive;
+
+  cache_still_alive = g_atomic_pointer_exchange (&cache->texture, NULL) != NULL;
+
+  if (!cache_still_alive)
+    g_free (cache);
+}
+
+static GskGpuCachedTile *
+gsk_gpu_cached_tile_new (GskGpuDevice *device,
+                         GdkTexture   *texture,
+                         guint         lod_level,
+                         gsize         tile_x,
+                         gsize         tile_y,
+                         GskGpuImage  *image)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+  GskGpuCachedTile *self;
+
+  self = gsk_gpu_cached_new (device, &GSK_GPU_CACHED_TILE_CLASS, NULL);
+  self->key = texture;
+  self->lod_level = lod_level;
+  self->tile_x = tile_x;
+  self->tile_y = tile_y;
+  self->texture = texture;
+  g_weak_ref_init (&self->texture_ref, texture);
+  self->image = g_object_ref (image);
+
+  g_object_weak_ref (G_OBJECT (texture), (GWeakNotify) gsk_gpu_cached_tile_destroy_cb, self);
+  g_hash_table_add (priv->tile_cache, self);
+
+  return self;
+}
+
+/* }}} */
+/* {{{ CachedContent */
+
+/* Maps the contents of a memory texture to an image, so that
+ * textures that were created from the same data - like an icon
+ * that got loaded twice - share one upload.
+ *
+ * The entry only keeps a weak ref to the texture it was created
+ * for and compares against that texture's data, so it goes stale
+ * once that texture is gone. */
+struct _GskGpuCachedContent
+{
+  GskGpuCached parent;
+
+  GWeakRef texture;
+  guint hash;
+  GskGpuImage *image;
+};
+
+static void
+gsk_gpu_cached_content_free (GskGpuDevice *device,
+                             GskGpuCached *cached)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+  GskGpuCachedContent *self = (GskGpuCachedContent *) cached;
+
+  g_hash_table_remove (priv->content_cache, self);
+
+  g_weak_ref_clear (&self->texture);
+  g_object_unref (self->image);
+
+  g_free (self);
+}
+
+static gboolean
+gsk_gpu_cached_content_should_collect (GskGpuDevice *device,
+                                       GskGpuCached *cached,
+                                       gint64        timestamp)
+{
+  GskGpuCachedContent *self = (GskGpuCachedContent *) cached;
+  GdkTexture *texture;
+
+  texture = g_weak_ref_get (&self->texture);
+  if (texture == NULL)
+    return TRUE;
+
+  g_object_unref (texture);
+  return FALSE;
+}
+
+static const GskGpuCachedClass GSK_GPU_CACHED_CONTENT_CLASS =
+{
+  sizeof (GskGpuCachedContent),
+  gsk_gpu_cached_content_free,
+  gsk_gpu_cached_content_should_collect
+};
+
+static gboolean
+gsk_gpu_texture_has_cacheable_content (GdkTexture *texture)
+{
+  return GDK_IS_MEMORY_TEXTURE (texture) &&
+         gdk_texture_get_width (texture) * gdk_texture_get_height (texture) <= MAX_CONTENT_CACHE_PIXELS;
+}
+
+static guint
+gsk_gpu_texture_content_hash (GdkTexture *texture)
+{
+  GBytes *bytes;
+  const guchar *data;
+  gsize x, y, stride, row_size;
+  guint64 hash, word;
+
+  bytes = gdk_memory_texture_get_bytes (GDK_MEMORY_TEXTURE (texture), &stride);
+  data = g_bytes_get_data (bytes, NULL);
+  row_size = gdk_texture_get_width (texture) * gdk_memory_format_bytes_per_pixel (gdk_texture_get_format (texture));
+
+  hash = 0xcbf29ce484222325ull ^ gdk_texture_get_format (texture);
+  hash = (hash ^ gdk_texture_get_width (texture)) * 0x100000001b3ull;
+  hash = (hash ^ gdk_texture_get_height (texture)) * 0x100000001b3ull;
+
+  for (y = 0; y < gdk_texture_get_height (texture); y++)
+    {
+      const guchar *row = data + y * stride;
+
+      for (x = 0; x + sizeof (guint64) <= row_size; x += sizeof (guint64))
+        {
+          memcpy (&word, row + x, sizeof (guint64));
+          hash = (hash ^ word) * 0x100000001b3ull;
+        }
+      for (; x < row_size; x++)
+        hash = (hash ^ row[x]) * 0x100000001b3ull;
+    }
+
+  return (guint) (hash ^ (hash >> 32));
+}
+
+static gboolean
+gsk_gpu_texture_content_equal (GdkTexture *texture1,
+                               GdkTexture *texture2)
+{
+  GBytes *bytes1, *bytes2;
+  const guchar *data1, *data2;
+  gsize y, stride1, stride2, row_size;
+
+  if (gdk_texture_get_width (texture1) != gdk_texture_get_width (texture2) ||
+      gdk_texture_get_height (texture1) != gdk_texture_get_height (texture2) ||
+      gdk_texture_get_format (texture1) != gdk_texture_get_format (texture2))
+    return FALSE;
+
+  bytes1 = gdk_memory_texture_get_bytes (GDK_MEMORY_TEXTURE (texture1), &stride1);
+  bytes2 = gdk_memory_texture_get_bytes (GDK_MEMORY_TEXTURE (texture2), &stride2);
+  data1 = g_bytes_get_data (bytes1, NULL);
+  data2 = g_bytes_get_data (bytes2, NULL);
+  row_size = gdk_texture_get_width (texture1) * gdk_memory_format_bytes_per_pixel (gdk_texture_get_format (texture1));
+
+  for (y = 0; y < gdk_texture_get_height (texture1); y++)
+    {
+      if (memcmp (data1 + y * stride1, data2 + y * stride2, row_size) != 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static guint
+gsk_gpu_cached_content_hash (gconstpointer data)
+{
+  const GskGpuCachedContent *content = data;
+
+  return content->hash;
+}
+
+static gboolean
+gsk_gpu_cached_content_equal (gconstpointer v1,
+                              gconstpointer v2)
+{
+  GskGpuCachedContent *content1 = (GskGpuCachedContent *) v1;
+  GskGpuCachedContent *content2 = (GskGpuCachedContent *) v2;
+  GdkTexture *texture1, *texture2;
+  gboolean result;
+
+  if (content1 == content2)
+    return TRUE;
+
+  if (content1->hash != content2->hash)
+    return FALSE;
+
+  texture1 = g_weak_ref_get (&content1->texture);
+  texture2 = g_weak_ref_get (&content2->texture);
+
+  if (texture1 && texture2)
+    result = gsk_gpu_texture_content_equal (texture1, texture2);
+  else
+    result = FALSE;
+
+  g_clear_object (&texture1);
+  g_clear_object (&texture2);
+
+  return result;
+}
+
+/* }}} */
+/* {{{ CachedNode */
+
+/* Keeps the rendering of a node around, so it can be reused when
+ * the same node gets drawn again in a later frame.
+ *
+ * The first time a node is looked up, only an entry without an
+ * image is created. The image is added when the node shows up
+ * again, so nodes that are only drawn once don't cost anything. */
+struct _GskGpuCachedNode
+{
+  GskGpuCached parent;
+
+  GskRenderNode *node;
+  float scale_x;
+  float scale_y;
+
+  GskGpuImage *image;
+  gint64 last_use;
+};
+
+static void
+gsk_gpu_cached_node_free (GskGpuDevice *device,
+                          GskGpuCached *cached)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+  GskGpuCachedNode *self = (GskGpuCachedNode *) cached;
+
+  g_hash_table_remove (priv->node_cache, self);
+
+  gsk_render_node_unref (self->node);
+  g_clear_object (&self->image);
+
+  g_free (self);
+}
+
+static gboolean
+gsk_gpu_cached_node_should_collect (GskGpuDevice *device,
+                                    GskGpuCached *cached,
+                                    gint64        timestamp)
+{
+  GskGpuCachedNode *self = (GskGpuCachedNode *) cached;
+
+  return timestamp - self->last_use > NODE_CACHE_TIMEOUT;
+}
+
+static guint
+gsk_gpu_cached_node_hash (gconstpointer data)
+{
+  const GskGpuCachedNode *node = data;
+
+  return g_direct_hash (node->node) ^
+         ((guint) (node->scale_x * 64) << 16) ^
+         (guint) (node->scale_y * 64);
+}
+
+static gboolean
+gsk_gpu_cached_node_equal (gconstpointer v1,
+                           gconstpointer v2)
+{
+  const GskGpuCachedNode *node1 = v1;
+  const GskGpuCachedNode *node2 = v2;
+
+  return node1->node == node2->node
+      && node1->scale_x == node2->scale_x
+      && node1->scale_y == node2->scale_y;
+}
+
+static const GskGpuCachedClass GSK_GPU_CACHED_NODE_CLASS =
+{
+  sizeof (GskGpuCachedNode),
+  gsk_gpu_cached_node_free,
+  gsk_gpu_cached_node_should_collect
+};
+
+/* }}} */
+/* {{{ CachedPath */
+
+/* Keeps the mask of a filled or stroked path around, so it can be
+ * reused by any fill or stroke node using the same path, no matter
+ * where it ends up on screen.
+ *
+ * Masks are rendered at one of a few subpixel positions, given by
+ * phase_x and phase_y, so that moving a path by fractions of a pixel
+ * doesn't make it wobble.
+ *
+ * Like for nodes, the first lookup only creates an entry without
+ * an image. */
+struct _GskGpuCachedPath
+{
+  GskGpuCached parent;
+
+  GskPath *path;
+  GskFillRule fill_rule;
+  GskStroke *stroke;
+  float scale_x;
+  float scale_y;
+  guint phase_x;
+  guint phase_y;
+
+  GskGpuImage *image;
+  gint64 last_use;
+};
+
+static void
+gsk_gpu_cached_path_free (GskGpuDevice *device,
+                          GskGpuCached *cached)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+  GskGpuCachedPath *self = (GskGpuCachedPath *) cached;
+
+  g_hash_table_remove (priv->path_cache, self);
+
+  gsk_path_unref (self->path);
+  g_clear_pointer (&self->stroke, gsk_stroke_free);
+  g_clear_object (&self->image);
+
+  g_free (self);
+}
+
+static gboolean
+gsk_gpu_cached_path_should_collect (GskGpuDevice *device,
+                                    GskGpuCached *cached,
+                                    gint64        timestamp)
+{
+  GskGpuCachedPath *self = (GskGpuCachedPath *) cached;
+
+  return timestamp - self->last_use > PATH_CACHE_TIMEOUT;
+}
+
+static guint
+gsk_gpu_cached_path_hash (gconstpointer data)
+{
+  const GskGpuCachedPath *path = data;
+
+  return g_direct_hash (path->path) ^
+         ((guint) (path->scale_x * 64) << 16) ^
+         (guint) (path->scale_y * 64) ^
+         (path->phase_x << 28) ^
+         (path->phase_y << 24) ^
+         (path->stroke ? (guint) (path->stroke->line_width * 64) << 8 : path->fill_rule);
+}
+
+static gboolean
+gsk_gpu_cached_path_equal (gconstpointer v1,
+                           gconstpointer v2)
+{
+  const GskGpuCachedPath *path1 = v1;
+  const GskGpuCachedPath *path2 = v2;
+
+  if (path1->path != path2->path ||
+      path1->scale_x != path2->scale_x ||
+      path1->scale_y != path2->scale_y ||
+      path1->phase_x != path2->phase_x ||
+      path1->phase_y != path2->phase_y)
+    return FALSE;
+
+  if (path1->stroke == NULL || path2->stroke == NULL)
+    return path1->stroke == path2->stroke &&
+           path1->fill_rule == path2->fill_rule;
+
+  return gsk_stroke_equal (path1->stroke, path2->stroke);
+}
+
+static const GskGpuCachedClass GSK_GPU_CACHED_PATH_CLASS =
+{
+  sizeof (GskGpuCachedPath),
+  gsk_gpu_cached_path_free,
+  gsk_gpu_cached_path_should_collect
+};
+
+/* }}} */
+/* {{{ CachedOffscreen */
+
+/* Keeps offscreen images around after their frame is done with them,
+ * so later offscreens of the same size and format can render into
+ * them instead of allocating a new image.
+ *
+ * Images of the same kind are chained via next, the hash table only
+ * contains the first one. The pool holds a reference to every image,
+ * so an image is free to be reused when that is the only reference
+ * left: Frames keep references to all the images they use until the
+ * GPU is done with them. */
+struct _GskGpuCachedOffscreen
+{
+  GskGpuCached parent;
+
+  gboolean with_mipmap;
+  GdkMemoryDepth depth;
+  gsize width;
+  gsize height;
+
+  GskGpuImage *image;
+  gint64 last_use;
+
+  GskGpuCachedOffscreen *next;
+};
+
+static void
+gsk_gpu_cached_offscreen_free (GskGpuDevice *device,
+                               GskGpuCached *cached)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+  GskGpuCachedOffscreen *self = (GskGpuCachedOffscreen *) cached;
+  GskGpuCachedOffscreen *first;
+
+  first = g_hash_table_lookup (priv->offscreen_pool, self);
+  if (first == self)
+    {
+      g_hash_table_remove (priv->offscreen_pool, self);
+      if (self->next)
+        g_hash_table_add (priv->offscreen_pool, self->next);
+    }
+  else
+    {
+      while (first->next != self)
+        first = first->next;
+      first->next = self->next;
+    }
+
+  priv->offscreen_pool_pixels -= self->width * self->height;
+  g_object_unref (self->image);
+
+  g_free (self);
+}
+
+static gboolean
+gsk_gpu_cached_offscreen_should_collect (GskGpuDevice *device,
+                                         GskGpuCached *cached,
+                                         gint64        timestamp)
+{
+  GskGpuCachedOffscreen *self = (GskGpuCachedOffscreen *) cached;
+
+  return timestamp - self->last_use > OFFSCREEN_POOL_TIMEOUT;
+}
+
+static guint
+gsk_gpu_cached_offscreen_hash (gconstpointer data)
+{
+  const GskGpuCachedOffscreen *offscreen = data;
+
+  return ((guint) offscreen->width << 16) ^
+         (guint) offscreen->height ^
+         ((guint) offscreen->depth << 28) ^
+         ((guint) offscreen->with_mipmap << 31);
+}
+
+static gboolean
+gsk_gpu_cached_offscreen_equal (gconstpointer v1,
+                                gconstpointer v2)
+{
+  const GskGpuCachedOffscreen *offscreen1 = v1;
+  const GskGpuCachedOffscreen *offscreen2 = v2;
+
+  return offscreen1->width == offscreen2->width
+      && offscreen1->height == offscreen2->height
+      && offscreen1->depth == offscreen2->depth
+      && offscreen1->with_mipmap == offscreen2->with_mipmap;
+}
+
+static gboolean
+gsk_gpu_cached_offscreen_is_unused (GskGpuCachedOffscreen *self)
+{
+  return g_atomic_int_get (&G_OBJECT (self->image)->ref_count) == 1;
+}
+
+static const GskGpuCachedClass GSK_GPU_CACHED_OFFSCREEN_CLASS =
+{
+  sizeof (GskGpuCachedOffscreen),
+  gsk_gpu_cached_offscreen_free,
+  gsk_gpu_cached_offscreen_should_collect
+};
+
 /* }}} */
 /* {{{ CachedGlyph */
 
@@ -274,8 +945,11 @@ static void
 gsk_gpu_cached_glyph_free (GskGpuDevice *device,
                            GskGpuCached *cached)
 {
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
   GskGpuCachedGlyph *self = (GskGpuCachedGlyph *) cached;
 
+  g_hash_table_remove (priv->glyph_cache, self);
+
   g_object_unref (self->font);
   g_object_unref (self->image);
 
@@ -285,10 +959,13 @@ gsk_gpu_cached_glyph_free (GskGpuDevice *device,
 static gboolean
 gsk_gpu_cached_glyph_should_collect (GskGpuDevice *device,
                                      GskGpuCached *cached,
-                                     gint64        timestsamp)
+                                     gint64        timestamp)
 {
-  /* FIXME */
-  return FALSE;
+  /* Glyphs in an atlas live as long as the atlas */
+  if (cached->atlas)
+    return cached->atlas->evict;
+
+  return timestamp - cached->timestamp > ATLAS_ITEM_TIMEOUT;
 }
 
 static guint
@@ -325,19 +1002,121 @@ static const GskGpuCachedClass GSK_GPU_CACHED_GLYPH_CLASS =
 /* }}} */
 /* {{{ GskGpuDevice */
 
+/* Computes how much of every atlas is taken up by items that are
+ * still in use and decides which atlases to evict */
+static void
+gsk_gpu_device_update_atlases (GskGpuDevice *self,
+                               gint64        timestamp)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCached *cached;
+  gsize total_pixels, live_pixels;
+
+  for (cached = priv->first_cached; cached != NULL; cached = cached->next)
+    {
+      if (cached->class == &GSK_GPU_CACHED_ATLAS_CLASS)
+        ((GskGpuCachedAtlas *) cached)->live_pixels = 0;
+      else if (cached->atlas && timestamp - cached->timestamp <= ATLAS_ITEM_TIMEOUT)
+        cached->atlas->live_pixels += cached->atlas_pixels;
+    }
+
+  total_pixels = 0;
+  live_pixels = 0;
+  for (cached = priv->first_cached; cached != NULL; cached = cached->next)
+    {
+      GskGpuCachedAtlas *atlas;
+
+      if (cached->class != &GSK_GPU_CACHED_ATLAS_CLASS)
+        continue;
+
+      atlas = (GskGpuCachedAtlas *) cached;
+      atlas->evict = atlas != priv->current_atlas &&
+                     atlas->live_pixels * MIN_ATLAS_OCCUPANCY < atlas->width * atlas->height;
+
+      total_pixels += atlas->width * atlas->height;
+      live_pixels += atlas->live_pixels;
+    }
+
+  priv->atlas_occupancy = total_pixels ? 100 * live_pixels / total_pixels : 0;
+}
+
 void
 gsk_gpu_device_gc (GskGpuDevice *self,
                    gint64        timestamp)
 {
   GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
-  GskGpuCached *cached, *next;
+  GskGpuCached *cached, *prev;
 
-  for (cached = priv->first_cached; cached != NULL; cached = next)
+  gsk_gpu_device_update_atlases (self, timestamp);
+
+  /* Go backwards, items are always newer than their atlas, so
+   * they get freed before it */
+  for (cached = priv->last_cached; cached != NULL; cached = prev)
     {
-      next = cached->next;
+      prev = cached->prev;
       if (gsk_gpu_cached_should_collect (self, cached, timestamp))
-        gsk_gpu_cached_free (self, priv->first_cached);
+        gsk_gpu_cached_free (self, cached);
+    }
+}
+
+/* Freeing images outside of rendering a frame, like when collecting
+ * from a timeout, needs the device's context */
+static void
+gsk_gpu_device_make_current (GskGpuDevice *self)
+{
+  GskGpuDeviceClass *klass = GSK_GPU_DEVICE_GET_CLASS (self);
+
+  if (klass->make_current)
+    klass->make_current (self);
+}
+
+static gboolean
+gsk_gpu_device_idle_gc_cb (gpointer data)
+{
+  GskGpuDevice *self = data;
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  gint64 now;
+
+  now = g_get_monotonic_time ();
+  gsk_gpu_device_make_current (self);
+  gsk_gpu_device_gc (self, now);
+  priv->last_gc = now;
+
+  /* Keep going while frames are rendered, so the final run happens
+   * once everything used by the last frame has expired */
+  if (now - priv->last_frame < CACHE_IDLE_GC_TIMEOUT * G_TIME_SPAN_SECOND)
+    return G_SOURCE_CONTINUE;
+
+  priv->cache_gc_source = 0;
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * gsk_gpu_device_maybe_gc:
+ * @timestamp: the timestamp of the frame that was just rendered
+ *
+ * Called after rendering a frame. Collects expired cache entries
+ * at most once per CACHE_GC_INTERVAL, and makes sure they are
+ * collected once more after the last frame, so that idle
+ * applications don't keep them around and don't wake up for it
+ * periodically.
+ */
+void
+gsk_gpu_device_maybe_gc (GskGpuDevice *self,
+                         gint64        timestamp)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+
+  priv->last_frame = g_get_monotonic_time ();
+
+  if (timestamp - priv->last_gc >= CACHE_GC_INTERVAL)
+    {
+      gsk_gpu_device_gc (self, timestamp);
+      priv->last_gc = timestamp;
     }
+
+  if (priv->cache_gc_source == 0 && priv->first_cached != NULL)
+    priv->cache_gc_source = g_timeout_add_seconds (CACHE_IDLE_GC_TIMEOUT, gsk_gpu_device_idle_gc_cb, self);
 }
 
 static void
@@ -369,8 +1148,15 @@ gsk_gpu_device_dispose (GObject *object)
   GskGpuDevice *self = GSK_GPU_DEVICE (object);
   GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
 
+  g_clear_handle_id (&priv->cache_gc_source, g_source_remove);
+  gsk_gpu_device_make_current (self);
   gsk_gpu_device_clear_cache (self);
   g_hash_table_unref (priv->glyph_cache);
+  g_hash_table_unref (priv->tile_cache);
+  g_hash_table_unref (priv->content_cache);
+  g_hash_table_unref (priv->node_cache);
+  g_hash_table_unref (priv->path_cache);
+  g_hash_table_unref (priv->offscreen_pool);
   g_hash_table_unref (priv->texture_cache);
 
   G_OBJECT_CLASS (gsk_gpu_device_parent_class)->dispose (object);
@@ -405,6 +1191,16 @@ gsk_gpu_device_init (GskGpuDevice *self)
                                         gsk_gpu_cached_glyph_equal);
   priv->texture_cache = g_hash_table_new (g_direct_hash,
                                           g_direct_equal);
+  priv->tile_cache = g_hash_table_new (gsk_gpu_cached_tile_hash,
+                                       gsk_gpu_cached_tile_equal);
+  priv->content_cache = g_hash_table_new (gsk_gpu_cached_content_hash,
+                                          gsk_gpu_cached_content_equal);
+  priv->node_cache = g_hash_table_new (gsk_gpu_cached_node_hash,
+                                       gsk_gpu_cached_node_equal);
+  priv->path_cache = g_hash_table_new (gsk_gpu_cached_path_hash,
+                                       gsk_gpu_cached_path_equal);
+  priv->offscreen_pool = g_hash_table_new (gsk_gpu_cached_offscreen_hash,
+                                           gsk_gpu_cached_offscreen_equal);
 }
 
 void
@@ -416,6 +1212,7 @@ gsk_gpu_device_setup (GskGpuDevice *self,
 
   priv->display = g_object_ref (display);
   priv->max_image_size = max_image_size;
+  priv->atlas_size = MIN (MIN_ATLAS_SIZE, max_image_size);
 }
 
 GdkDisplay *
@@ -463,21 +1260,6 @@ gsk_gpu_device_create_download_image (GskGpuDevice   *self,
   return GSK_GPU_DEVICE_GET_CLASS (self)->create_download_image (self, depth, width, height);
 }
 
-/* This rounds up to the next number that has <= 2 bits set:
- * 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, ...
- * That is roughly sqrt(2), so it should limit waste
- */
-static gsize
-round_up_atlas_size (gsize num)
-{
-  gsize storage = g_bit_storage (num);
-
-  num = num + (((1 << storage) - 1) >> 2);
-  num &= (((gsize) 7) << storage) >> 2;
-
-  return num;
-}
-
 static gboolean
 gsk_gpu_cached_atlas_allocate (GskGpuCachedAtlas *atlas,
                                gsize              width,
@@ -485,57 +1267,84 @@ gsk_gpu_cached_atlas_allocate (GskGpuCachedAtlas *atlas,
                                gsize             *out_x,
                                gsize             *out_y)
 {
-  gsize i;
-  gsize waste, slice_waste;
-  gsize best_slice;
-  gsize y, best_y;
-  gboolean can_add_slice;
-
-  best_y = 0;
-  best_slice = G_MAXSIZE;
-  can_add_slice = atlas->n_slices < MAX_SLICES_PER_ATLAS;
-  if (can_add_slice)
-    waste = height; /* Require less than 100% waste */
-  else
-    waste = G_MAXSIZE; /* Accept any slice, we can't make better ones */
+  GskGpuSkylineSegment *segment, *next;
+  gsize i, j, n, y, remaining, end;
+  gsize best, best_x, best_y;
 
-  for (i = 0, y = 0; i < atlas->n_slices; y += atlas->slices[i].height, i++)
+  n = gsk_gpu_skyline_get_size (&atlas->skyline);
+  best = G_MAXSIZE;
+  best_x = 0;
+  best_y = G_MAXSIZE;
+
+  for (i = 0; i < n; i++)
     {
-      if (atlas->slices[i].height < height || ATLAS_SIZE - atlas->slices[i].width < width)
-        continue;
+      segment = gsk_gpu_skyline_get (&atlas->skyline, i);
+      if (segment->x + width > atlas->width)
+        break;
+
+      /* The item rests on the highest segment below it */
+      y = 0;
+      remaining = width;
+      for (j = i; remaining > 0; j++)
+        {
+          next = gsk_gpu_skyline_get (&atlas->skyline, j);
+          y = MAX (y, next->y);
+          remaining -= MIN (remaining, next->width);
+        }
 
-      slice_waste = atlas->slices[i].height - height;
-      if (slice_waste < waste)
+      if (y + height <= atlas->height && y < best_y)
         {
-          waste = slice_waste;
-          best_slice = i;
+          best = i;
+          best_x = segment->x;
           best_y = y;
-          if (waste == 0)
-            break;
         }
     }
 
-  if (best_slice >= i && i == atlas->n_slices)
+  if (best == G_MAXSIZE)
+    return FALSE;
+
+  /* Replace the segments below the item with its top edge */
+  end = best_x + width;
+  for (j = best; j < n; j++)
     {
-      if (!can_add_slice)
-        return FALSE;
+      segment = gsk_gpu_skyline_get (&atlas->skyline, j);
+      if (segment->x + segment->width > end)
+        {
+          segment->width -= MAX (end, segment->x) - segment->x;
+          segment->x = MAX (end, segment->x);
+          break;
+        }
+    }
+  gsk_gpu_skyline_splice (&atlas->skyline,
+                          best, j - best,
+                          FALSE,
+                          &(GskGpuSkylineSegment) { best_x, best_y + height, width }, 1);
 
-      atlas->n_slices++;
-      if (atlas->n_slices == MAX_SLICES_PER_ATLAS)
-        atlas->slices[i].height = ATLAS_SIZE - y;
-      else
-        atlas->slices[i].height = round_up_atlas_size (MAX (height, 4));
-      atlas->slices[i].width = 0;
-      best_y = y;
-      best_slice = i;
+  /* Merge with neighbors of the same height */
+  if (best + 1 < gsk_gpu_skyline_get_size (&atlas->skyline))
+    {
+      segment = gsk_gpu_skyline_get (&atlas->skyline, best);
+      next = gsk_gpu_skyline_get (&atlas->skyline, best + 1);
+      if (segment->y == next->y)
+        {
+          segment->width += next->width;
+          gsk_gpu_skyline_splice (&atlas->skyline, best + 1, 1, FALSE, NULL, 0);
+        }
+    }
+  if (best > 0)
+    {
+      segment = gsk_gpu_skyline_get (&atlas->skyline, best - 1);
+      next = gsk_gpu_skyline_get (&atlas->skyline, best);
+      if (segment->y == next->y)
+        {
+          segment->width += next->width;
+          gsk_gpu_skyline_splice (&atlas->skyline, best, 1, FALSE, NULL, 0);
+        }
     }
 
-  *out_x = atlas->slices[best_slice].width;
+  *out_x = best_x;
   *out_y = best_y;
 
-  atlas->slices[best_slice].width += width;
-  g_assert (atlas->slices[best_slice].width <= ATLAS_SIZE);
-
   return TRUE;
 }
 
@@ -549,7 +1358,16 @@ gsk_gpu_device_ensure_atlas (GskGpuDevice *self,
   if (priv->current_atlas && !recreate)
     return;
 
-  priv->current_atlas = gsk_gpu_cached_atlas_new (self);
+  if (priv->current_atlas)
+    {
+      /* If the full atlas is still mostly in use, the working set
+       * doesn't fit, so make the next one bigger */
+      gsk_gpu_device_update_atlases (self, timestamp);
+      if (2 * priv->current_atlas->live_pixels >= priv->current_atlas->width * priv->current_atlas->height)
+        priv->atlas_size = MIN (2 * priv->atlas_size, MIN (MAX_ATLAS_SIZE, priv->max_image_size));
+    }
+
+  priv->current_atlas = gsk_gpu_cached_atlas_new (self, priv->atlas_size);
 }
 
 GskGpuImage *
@@ -572,10 +1390,11 @@ gsk_gpu_device_add_atlas_image (GskGpuDevice      *self,
 {
   GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
 
-  if (width > MAX_ATLAS_ITEM_SIZE || height > MAX_ATLAS_ITEM_SIZE)
-    return NULL;
-
   gsk_gpu_device_ensure_atlas (self, FALSE, timestamp);
+
+  /* Big items would waste too much space */
+  if (width > priv->current_atlas->width / 4 || height > priv->current_atlas->height / 4)
+    return NULL;
   
   if (gsk_gpu_cached_atlas_allocate (priv->current_atlas, width, height, out_x, out_y))
     {
@@ -627,6 +1446,451 @@ gsk_gpu_device_cache_texture_image (GskGpuDevice *self,
   gsk_gpu_cached_use (self, (GskGpuCached *) cache, timestamp);
 }
 
+/*
+ * gsk_gpu_device_lookup_texture_tile_image:
+ * @lod_level: the mipmap level of the tile
+ * @tile_x: the column of the tile
+ * @tile_y: the row of the tile
+ *
+ * Looks up a tile of a texture that is too large to be uploaded
+ * in one piece. Tiles are created and cached by the node processor,
+ * see gsk_gpu_device_cache_texture_tile_image().
+ *
+ * Returns: (nullable) (transfer full): the cached image
+ */
+GskGpuImage *
+gsk_gpu_device_lookup_texture_tile_image (GskGpuDevice *self,
+                                          GdkTexture   *texture,
+                                          guint         lod_level,
+                                          gsize         tile_x,
+                                          gsize         tile_y,
+                                          gint64        timestamp)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedTile lookup = {
+    .key = texture,
+    .lod_level = lod_level,
+    .tile_x = tile_x,
+    .tile_y = tile_y,
+  };
+  GskGpuCachedTile *cache;
+
+  cache = g_hash_table_lookup (priv->tile_cache, &lookup);
+  if (cache == NULL)
+    return NULL;
+
+  /* A dead texture whose memory got reused */
+  if (g_atomic_pointer_get (&cache->texture) != texture)
+    {
+      gsk_gpu_cached_free (self, (GskGpuCached *) cache);
+      return NULL;
+    }
+
+  cache->last_use = timestamp;
+
+  return g_object_ref (cache->image);
+}
+
+void
+gsk_gpu_device_cache_texture_tile_image (GskGpuDevice *self,
+                                         GdkTexture   *texture,
+                                         guint         lod_level,
+                                         gsize         tile_x,
+                                         gsize         tile_y,
+                                         gint64        timestamp,
+                                         GskGpuImage  *image)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedTile lookup = {
+    .key = texture,
+    .lod_level = lod_level,
+    .tile_x = tile_x,
+    .tile_y = tile_y,
+  };
+  GskGpuCachedTile *cache;
+
+  cache = g_hash_table_lookup (priv->tile_cache, &lookup);
+  if (cache)
+    gsk_gpu_cached_free (self, (GskGpuCached *) cache);
+
+  cache = gsk_gpu_cached_tile_new (self, texture, lod_level, tile_x, tile_y, image);
+  cache->last_use = timestamp;
+}
+
+/*
+ * gsk_gpu_device_lookup_texture_content_image:
+ *
+ * Looks for an image that was uploaded from a different texture
+ * with the same contents.
+ *
+ * This only works for small memory textures, for everything else
+ * %NULL is returned.
+ *
+ * On success, the image is also cached for @texture, so the next
+ * gsk_gpu_device_lookup_texture_image() will find it.
+ *
+ * Returns: (nullable) (transfer full): the cached image
+ */
+GskGpuImage *
+gsk_gpu_device_lookup_texture_content_image (GskGpuDevice *self,
+                                             GdkTexture   *texture,
+                                             gint64        timestamp)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedContent lookup;
+  GskGpuCachedContent *cache;
+
+  if (!gsk_gpu_texture_has_cacheable_content (texture))
+    return NULL;
+
+  lookup.hash = gsk_gpu_texture_content_hash (texture);
+  g_weak_ref_init (&lookup.texture, texture);
+  cache = g_hash_table_lookup (priv->content_cache, &lookup);
+  g_weak_ref_clear (&lookup.texture);
+
+  if (cache == NULL)
+    {
+      priv->content_cache_misses++;
+      return NULL;
+    }
+
+  priv->content_cache_hits++;
+  gsk_gpu_device_cache_texture_image (self, texture, timestamp, cache->image);
+
+  return g_object_ref (cache->image);
+}
+
+void
+gsk_gpu_device_cache_texture_content_image (GskGpuDevice *self,
+                                            GdkTexture   *texture,
+                                            gint64        timestamp,
+                                            GskGpuImage  *image)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedContent *cache, *existing;
+
+  if (!gsk_gpu_texture_has_cacheable_content (texture))
+    return;
+
+  cache = gsk_gpu_cached_new (self, &GSK_GPU_CACHED_CONTENT_CLASS, NULL);
+  g_weak_ref_init (&cache->texture, texture);
+  cache->hash = gsk_gpu_texture_content_hash (texture);
+  cache->image = g_object_ref (image);
+
+  existing = g_hash_table_lookup (priv->content_cache, cache);
+  if (existing)
+    gsk_gpu_cached_free (self, (GskGpuCached *) existing);
+
+  g_hash_table_add (priv->content_cache, cache);
+}
+
+/*
+ * gsk_gpu_device_lookup_node_image:
+ * @scale: the scale the node is rendered at
+ * @out_seen: set to %TRUE if the node was looked up before
+ *
+ * Looks up an image of the node that was stored with
+ * gsk_gpu_device_cache_node_image().
+ *
+ * If there is none, the lookup is recorded, and the next lookup
+ * of the same node will set @out_seen. That way, callers can avoid
+ * creating images for nodes that only get drawn once.
+ *
+ * Returns: (nullable) (transfer full): the cached image
+ */
+GskGpuImage *
+gsk_gpu_device_lookup_node_image (GskGpuDevice          *self,
+                                  GskRenderNode         *node,
+                                  const graphene_vec2_t *scale,
+                                  gint64                 timestamp,
+                                  gboolean              *out_seen)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedNode lookup = {
+    .node = node,
+    .scale_x = graphene_vec2_get_x (scale),
+    .scale_y = graphene_vec2_get_y (scale),
+  };
+  GskGpuCachedNode *cache;
+
+  cache = g_hash_table_lookup (priv->node_cache, &lookup);
+  if (cache)
+    {
+      cache->last_use = timestamp;
+      *out_seen = TRUE;
+
+      if (cache->image)
+        return g_object_ref (cache->image);
+      else
+        return NULL;
+    }
+
+  cache = gsk_gpu_cached_new (self, &GSK_GPU_CACHED_NODE_CLASS, NULL);
+  cache->node = gsk_render_node_ref (node);
+  cache->scale_x = lookup.scale_x;
+  cache->scale_y = lookup.scale_y;
+  cache->last_use = timestamp;
+  g_hash_table_add (priv->node_cache, cache);
+
+  *out_seen = FALSE;
+  return NULL;
+}
+
+void
+gsk_gpu_device_cache_node_image (GskGpuDevice          *self,
+                                 GskRenderNode         *node,
+                                 const graphene_vec2_t *scale,
+                                 gint64                 timestamp,
+                                 GskGpuImage           *image)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedNode lookup = {
+    .node = node,
+    .scale_x = graphene_vec2_get_x (scale),
+    .scale_y = graphene_vec2_get_y (scale),
+  };
+  GskGpuCachedNode *cache;
+
+  cache = g_hash_table_lookup (priv->node_cache, &lookup);
+  if (cache == NULL)
+    {
+      cache = gsk_gpu_cached_new (self, &GSK_GPU_CACHED_NODE_CLASS, NULL);
+      cache->node = gsk_render_node_ref (node);
+      cache->scale_x = lookup.scale_x;
+      cache->scale_y = lookup.scale_y;
+      g_hash_table_add (priv->node_cache, cache);
+    }
+
+  g_set_object (&cache->image, image);
+  cache->last_use = timestamp;
+}
+
+/*
+ * gsk_gpu_device_lookup_path_image:
+ * @path: the path
+ * @fill_rule: the fill rule, if @stroke is %NULL
+ * @stroke: (nullable): the stroke for stroked paths
+ * @scale: the scale the mask is rendered at
+ * @phase_x: the horizontal subpixel position of the mask
+ * @phase_y: the vertical subpixel position of the mask
+ * @out_seen: set to %TRUE if the path was looked up before
+ *
+ * Looks up a mask of the path that was stored with
+ * gsk_gpu_device_cache_path_image().
+ *
+ * Works like gsk_gpu_device_lookup_node_image().
+ *
+ * Returns: (nullable) (transfer full): the cached mask
+ */
+GskGpuImage *
+gsk_gpu_device_lookup_path_image (GskGpuDevice          *self,
+                                  GskPath               *path,
+                                  GskFillRule            fill_rule,
+                                  const GskStroke       *stroke,
+                                  const graphene_vec2_t *scale,
+                                  guint                  phase_x,
+                                  guint                  phase_y,
+                                  gint64                 timestamp,
+                                  gboolean              *out_seen)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedPath lookup = {
+    .path = path,
+    .fill_rule = fill_rule,
+    .stroke = (GskStroke *) stroke,
+    .scale_x = graphene_vec2_get_x (scale),
+    .scale_y = graphene_vec2_get_y (scale),
+    .phase_x = phase_x,
+    .phase_y = phase_y,
+  };
+  GskGpuCachedPath *cache;
+
+  cache = g_hash_table_lookup (priv->path_cache, &lookup);
+  if (cache)
+    {
+      cache->last_use = timestamp;
+      *out_seen = TRUE;
+
+      if (cache->image)
+        return g_object_ref (cache->image);
+      else
+        return NULL;
+    }
+
+  cache = gsk_gpu_cached_new (self, &GSK_GPU_CACHED_PATH_CLASS, NULL);
+  cache->path = gsk_path_ref (path);
+  cache->fill_rule = fill_rule;
+  cache->stroke = stroke ? gsk_stroke_copy (stroke) : NULL;
+  cache->scale_x = lookup.scale_x;
+  cache->scale_y = lookup.scale_y;
+  cache->phase_x = phase_x;
+  cache->phase_y = phase_y;
+  cache->last_use = timestamp;
+  g_hash_table_add (priv->path_cache, cache);
+
+  *out_seen = FALSE;
+  return NULL;
+}
+
+void
+gsk_gpu_device_cache_path_image (GskGpuDevice          *self,
+                                 GskPath               *path,
+                                 GskFillRule            fill_rule,
+                                 const GskStroke       *stroke,
+                                 const graphene_vec2_t *scale,
+                                 guint                  phase_x,
+                                 guint                  phase_y,
+                                 gint64                 timestamp,
+                                 GskGpuImage           *image)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedPath lookup = {
+    .path = path,
+    .fill_rule = fill_rule,
+    .stroke = (GskStroke *) stroke,
+    .scale_x = graphene_vec2_get_x (scale),
+    .scale_y = graphene_vec2_get_y (scale),
+    .phase_x = phase_x,
+    .phase_y = phase_y,
+  };
+  GskGpuCachedPath *cache;
+
+  cache = g_hash_table_lookup (priv->path_cache, &lookup);
+  if (cache == NULL)
+    {
+      cache = gsk_gpu_cached_new (self, &GSK_GPU_CACHED_PATH_CLASS, NULL);
+      cache->path = gsk_path_ref (path);
+      cache->fill_rule = fill_rule;
+      cache->stroke = stroke ? gsk_stroke_copy (stroke) : NULL;
+      cache->scale_x = lookup.scale_x;
+      cache->scale_y = lookup.scale_y;
+      cache->phase_x = phase_x;
+      cache->phase_y = phase_y;
+      g_hash_table_add (priv->path_cache, cache);
+    }
+
+  g_set_object (&cache->image, image);
+  cache->last_use = timestamp;
+}
+
+/*
+ * gsk_gpu_device_acquire_offscreen_image:
+ * @frame: the frame the image will be used in
+ *
+ * Like gsk_gpu_device_create_offscreen_image(), but reuses an image
+ * from a previous frame when one of the right size and format is
+ * not in use anymore.
+ *
+ * Reused images keep their previous contents, so they must be
+ * completely overwritten.
+ *
+ * Returns: (nullable): the image
+ */
+GskGpuImage *
+gsk_gpu_device_acquire_offscreen_image (GskGpuDevice   *self,
+                                        GskGpuFrame    *frame,
+                                        gboolean        with_mipmap,
+                                        GdkMemoryDepth  depth,
+                                        gsize           width,
+                                        gsize           height)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedOffscreen lookup, *cache, *first;
+  GskGpuImage *image;
+  gint64 timestamp;
+
+  if (!gsk_gpu_frame_should_optimize (frame, GSK_GPU_OPTIMIZE_OFFSCREEN_POOL))
+    return gsk_gpu_device_create_offscreen_image (self, with_mipmap, depth, width, height);
+
+  timestamp = gsk_gpu_frame_get_timestamp (frame);
+
+  lookup.with_mipmap = with_mipmap;
+  lookup.depth = depth;
+  lookup.width = width;
+  lookup.height = height;
+
+  first = g_hash_table_lookup (priv->offscreen_pool, &lookup);
+  for (cache = first; cache; cache = cache->next)
+    {
+      if (!gsk_gpu_cached_offscreen_is_unused (cache))
+        continue;
+
+      priv->offscreen_pool_hits++;
+      cache->last_use = timestamp;
+      /* The mipmaps are from the old contents */
+      gsk_gpu_image_unset_flags (cache->image, GSK_GPU_IMAGE_MIPMAP);
+      return g_object_ref (cache->image);
+    }
+
+  priv->offscreen_pool_misses++;
+
+  image = gsk_gpu_device_create_offscreen_image (self, with_mipmap, depth, width, height);
+  if (image == NULL ||
+      priv->offscreen_pool_pixels + width * height > MAX_OFFSCREEN_POOL_PIXELS)
+    return image;
+
+  cache = gsk_gpu_cached_new (self, &GSK_GPU_CACHED_OFFSCREEN_CLASS, NULL);
+  cache->with_mipmap = with_mipmap;
+  cache->depth = depth;
+  cache->width = width;
+  cache->height = height;
+  cache->image = g_object_ref (image);
+  cache->last_use = timestamp;
+  priv->offscreen_pool_pixels += width * height;
+
+  if (first)
+    {
+      cache->next = first->next;
+      first->next = cache;
+    }
+  else
+    {
+      g_hash_table_add (priv->offscreen_pool, cache);
+    }
+
+  return image;
+}
+
+void
+gsk_gpu_device_get_content_cache_stats (GskGpuDevice *self,
+                                        gsize        *out_hits,
+                                        gsize        *out_misses)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+
+  *out_hits = priv->content_cache_hits;
+  *out_misses = priv->content_cache_misses;
+}
+
+void
+gsk_gpu_device_get_offscreen_pool_stats (GskGpuDevice *self,
+                                         gsize        *out_hits,
+                                         gsize        *out_misses)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+
+  *out_hits = priv->offscreen_pool_hits;
+  *out_misses = priv->offscreen_pool_misses;
+}
+
+/*
+ * gsk_gpu_device_get_atlas_stats:
+ * @out_occupancy: the percentage of atlas space used by live items
+ * @out_evictions: the number of atlases that were freed so far
+ *
+ * The occupancy is updated whenever the caches are collected.
+ */
+void
+gsk_gpu_device_get_atlas_stats (GskGpuDevice *self,
+                                gsize        *out_occupancy,
+                                gsize        *out_evictions)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+
+  *out_occupancy = priv->atlas_occupancy;
+  *out_evictions = priv->atlas_evictions;
+}
+
 GskGpuImage *
 gsk_gpu_device_lookup_glyph_image (GskGpuDevice           *self,
                                    GskGpuFrame            *frame,
@@ -661,13 +1925,15 @@ gsk_gpu_device_lookup_glyph_image (GskGpuDevice           *self,
       return cache->image;
     }
 
-  cache = g_new (GskGpuCachedGlyph, 1);
   pango_font_get_glyph_extents (font, glyph, &ink_rect, NULL);
   origin.x = floor (ink_rect.x * scale / PANGO_SCALE);
   origin.y = floor (ink_rect.y * scale / PANGO_SCALE);
   rect.size.width = ceil ((ink_rect.x + ink_rect.width) * scale / PANGO_SCALE) - origin.x;
   rect.size.height = ceil ((ink_rect.y + ink_rect.height) * scale / PANGO_SCALE) - origin.y;
-  padding = 1;
+  if (flags & GSK_GPU_GLYPH_SDF)
+    padding = SDF_GLYPH_SPREAD;
+  else
+    padding = 1;
 
   image = gsk_gpu_device_add_atlas_image (self,
                                           gsk_gpu_frame_get_timestamp (frame),
@@ -679,13 +1945,18 @@ gsk_gpu_device_lookup_glyph_image (GskGpuDevice           *self,
       rect.origin.x = atlas_x + padding;
       rect.origin.y = atlas_y + padding;
       cache = gsk_gpu_cached_new (self, &GSK_GPU_CACHED_GLYPH_CLASS, priv->current_atlas);
+      cache->parent.atlas_pixels = (rect.size.width + 2 * padding) * (rect.size.height + 2 * padding);
     }
   else
     {
-      image = gsk_gpu_device_create_upload_image (self, FALSE, GDK_MEMORY_DEFAULT, rect.size.width, rect.size.height),
-      rect.origin.x = 0;
-      rect.origin.y = 0;
-      padding = 0;
+      /* Distance fields need their padding, bitmaps don't */
+      if (!(flags & GSK_GPU_GLYPH_SDF))
+        padding = 0;
+      image = gsk_gpu_device_create_upload_image (self, FALSE, GDK_MEMORY_DEFAULT,
+                                                  rect.size.width + 2 * padding,
+                                                  rect.size.height + 2 * padding),
+      rect.origin.x = padding;
+      rect.origin.y = padding;
       cache = gsk_gpu_cached_new (self, &GSK_GPU_CACHED_GLYPH_CLASS, NULL);
     }
 
@@ -698,19 +1969,44 @@ gsk_gpu_device_lookup_glyph_image (GskGpuDevice           *self,
   cache->origin = GRAPHENE_POINT_INIT (- origin.x + (flags & 3) / 4.f,
                                        - origin.y + ((flags >> 2) & 3) / 4.f);
 
-  gsk_gpu_upload_glyph_op (frame,
-                           cache->image,
-                           font,
-                           glyph,
-                           &(cairo_rectangle_int_t) {
-                               .x = rect.origin.x - padding,
-                               .y = rect.origin.y - padding,
-                               .width = rect.size.width + 2 * padding,
-                               .height = rect.size.height + 2 * padding,
-                           },
-                           scale,
-                           &GRAPHENE_POINT_INIT (cache->origin.x + 1,
-                                                 cache->origin.y + 1));
+  if (flags & GSK_GPU_GLYPH_SDF)
+    {
+      gsk_gpu_upload_sdf_glyph_op (frame,
+                                   cache->image,
+                                   font,
+                                   glyph,
+                                   &(cairo_rectangle_int_t) {
+                                       .x = rect.origin.x - padding,
+                                       .y = rect.origin.y - padding,
+                                       .width = rect.size.width + 2 * padding,
+                                       .height = rect.size.height + 2 * padding,
+                                   },
+                                   scale,
+                                   &GRAPHENE_POINT_INIT (cache->origin.x + padding,
+                                                         cache->origin.y + padding),
+                                   padding);
+
+      /* The field reaches beyond the glyph, it must all be drawn */
+      graphene_rect_inset (&cache->bounds, - (float) padding, - (float) padding);
+      cache->origin.x += padding;
+      cache->origin.y += padding;
+    }
+  else
+    {
+      gsk_gpu_upload_glyph_op (frame,
+                               cache->image,
+                               font,
+                               glyph,
+                               &(cairo_rectangle_int_t) {
+                                   .x = rect.origin.x - padding,
+                                   .y = rect.origin.y - padding,
+                                   .width = rect.size.width + 2 * padding,
+                                   .height = rect.size.height + 2 * padding,
+                               },
+                               scale,
+                               &GRAPHENE_POINT_INIT (cache->origin.x + padding,
+                                                     cache->origin.y + padding));
+    }
 
   g_hash_table_insert (priv->glyph_cache, cache, cache);
   gsk_gpu_cached_use (self, (GskGpuCached *) cache, gsk_gpu_frame_get_timestamp (frame));
@@ -2,6 +2,8 @@
 
 #include "gskgputypesprivate.h"
 
+#include "gsktypes.h"
+
 #include <graphene.h>
 
 G_BEGIN_DECLS
@@ -41,6 +43,7 @@ struct _GskGpuDeviceClass
                                                                          GdkMemoryDepth          depth,
                                                                          gsize                   width,
                                                                          gsize                   height);
+  void                  (* make_current)                                (GskGpuDevice           *self);
 };
 
 GType                   gsk_gpu_device_get_type                         (void) G_GNUC_CONST;
@@ -50,6 +53,8 @@ void                    gsk_gpu_device_setup                            (GskGpuD
                                                                          gsize                   max_image_size);
 void                    gsk_gpu_device_gc                               (GskGpuDevice           *self,
                                                                          gint64                  timestamp);
+void                    gsk_gpu_device_maybe_gc                         (GskGpuDevice           *self,
+                                                                         gint64                  timestamp);
 
 GdkDisplay *            gsk_gpu_device_get_display                      (GskGpuDevice           *self);
 gsize                   gsk_gpu_device_get_max_image_size               (GskGpuDevice           *self);
@@ -60,6 +65,12 @@ GskGpuImage *           gsk_gpu_device_create_offscreen_image           (GskGpuD
                                                                          GdkMemoryDepth          depth,
                                                                          gsize                   width,
                                                                          gsize                   height);
+GskGpuImage *           gsk_gpu_device_acquire_offscreen_image          (GskGpuDevice           *self,
+                                                                         GskGpuFrame            *frame,
+                                                                         gboolean                with_mipmap,
+                                                                         GdkMemoryDepth          depth,
+                                                                         gsize                   width,
+                                                                         gsize                   height);
 GskGpuImage *           gsk_gpu_device_create_upload_image              (GskGpuDevice           *self,
                                                                          gboolean                with_mipmap,
                                                                          GdkMemoryFormat         format,
@@ -77,6 +88,63 @@ void                    gsk_gpu_device_cache_texture_image              (GskGpuD
                                                                          GdkTexture             *texture,
                                                                          gint64                  timestamp,
                                                                          GskGpuImage            *image);
+GskGpuImage *           gsk_gpu_device_lookup_texture_content_image     (GskGpuDevice           *self,
+                                                                         GdkTexture             *texture,
+                                                                         gint64                  timestamp);
+void                    gsk_gpu_device_cache_texture_content_image      (GskGpuDevice           *self,
+                                                                         GdkTexture             *texture,
+                                                                         gint64                  timestamp,
+                                                                         GskGpuImage            *image);
+GskGpuImage *           gsk_gpu_device_lookup_node_image                (GskGpuDevice           *self,
+                                                                         GskRenderNode          *node,
+                                                                         const graphene_vec2_t  *scale,
+                                                                         gint64                  timestamp,
+                                                                         gboolean               *out_seen);
+void                    gsk_gpu_device_cache_node_image                 (GskGpuDevice           *self,
+                                                                         GskRenderNode          *node,
+                                                                         const graphene_vec2_t  *scale,
+                                                                         gint64                  timestamp,
+                                                                         GskGpuImage            *image);
+GskGpuImage *           gsk_gpu_device_lookup_path_image                (GskGpuDevice           *self,
+                                                                         GskPath                *path,
+                                                                         GskFillRule             fill_rule,
+                                                                         const GskStroke        *stroke,
+                                                                         const graphene_vec2_t  *scale,
+                                                                         guint                   phase_x,
+                                                                         guint                   phase_y,
+                                                                         gint64                  timestamp,
+                                                                         gboolean               *out_seen);
+void                    gsk_gpu_device_cache_path_image                 (GskGpuDevice           *self,
+                                                                         GskPath                *path,
+                                                                         GskFillRule             fill_rule,
+                                                                         const GskStroke        *stroke,
+                                                                         const graphene_vec2_t  *scale,
+                                                                         guint                   phase_x,
+                                                                         guint                   phase_y,
+                                                                         gint64                  timestamp,
+                                                                         GskGpuImage            *image);
+void                    gsk_gpu_device_get_content_cache_stats          (GskGpuDevice           *self,
+                                                                         gsize                  *out_hits,
+                                                                         gsize                  *out_misses);
+void                    gsk_gpu_device_get_offscreen_pool_stats         (GskGpuDevice           *self,
+                                                                         gsize                  *out_hits,
+                                                                         gsize                  *out_misses);
+void                    gsk_gpu_device_get_atlas_stats                  (GskGpuDevice           *self,
+                                                                         gsize                  *out_occupancy,
+                                                                         gsize                  *out_evictions);
+GskGpuImage *           gsk_gpu_device_lookup_texture_tile_image        (GskGpuDevice           *self,
+                                                                         GdkTexture             *texture,
+                                                                         guint                   lod_level,
+                                                                         gsize                   tile_x,
+                                                                         gsize                   tile_y,
+                                                                         gint64                  timestamp);
+void                    gsk_gpu_device_cache_texture_tile_image         (GskGpuDevice           *self,
+                                                                         GdkTexture             *texture,
+                                                                         guint                   lod_level,
+                                                                         gsize                   tile_x,
+                                                                         gsize                   tile_y,
+                                                                         gint64                  timestamp,
+                                                                         GskGpuImage            *image);
 
 typedef enum
 {
@@ -85,7 +153,8 @@ typedef enum
   GSK_GPU_GLYPH_X_OFFSET_3 = 0x3,
   GSK_GPU_GLYPH_Y_OFFSET_1 = 0x4,
   GSK_GPU_GLYPH_Y_OFFSET_2 = 0x8,
-  GSK_GPU_GLYPH_Y_OFFSET_3 = 0xC
+  GSK_GPU_GLYPH_Y_OFFSET_3 = 0xC,
+  GSK_GPU_GLYPH_SDF        = 0x10
 } GskGpuGlyphLookupFlags;
 
 GskGpuImage *           gsk_gpu_device_lookup_glyph_image               (GskGpuDevice           *self,
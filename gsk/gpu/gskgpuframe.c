@@ -5,14 +5,17 @@
 #include "gskgpubufferprivate.h"
 #include "gskgpudeviceprivate.h"
 #include "gskgpudownloadopprivate.h"
+#include "gskgpuglobalsopprivate.h"
 #include "gskgpuimageprivate.h"
 #include "gskgpunodeprocessorprivate.h"
 #include "gskgpuopprivate.h"
 #include "gskgpurendererprivate.h"
 #include "gskgpurenderpassopprivate.h"
+#include "gskgpushaderopprivate.h"
 #include "gskgpuuploadopprivate.h"
 
 #include "gskdebugprivate.h"
+#include "gskrectprivate.h"
 #include "gskrendererprivate.h"
 
 #include "gdk/gdkdmabufdownloaderprivate.h"
@@ -23,6 +26,13 @@
 /* GL_MAX_UNIFORM_BLOCK_SIZE is at 16384 */
 #define DEFAULT_STORAGE_BUFFER_SIZE 16 * 1024 * 64
 
+/* Every rectangle of the redraw region is a separate walk of the node tree */
+#define MAX_REGION_RECTS 8
+
+/* How many batches of other ops a shader op may be moved past when
+ * reordering, so that long runs of ops don't take quadratic time */
+#define MAX_REORDER_BATCHES 64
+
 #define GDK_ARRAY_NAME gsk_gpu_ops
 #define GDK_ARRAY_TYPE_NAME GskGpuOps
 #define GDK_ARRAY_ELEMENT_TYPE guchar
@@ -49,6 +59,20 @@ struct _GskGpuFramePrivate
   gsize storage_buffer_used;
 };
 
+/* Ops and vertex data recorded on another thread, see
+ * gsk_gpu_frame_arena_begin() */
+struct _GskGpuFrameArena
+{
+  GskGpuFrame *frame;
+  GskGpuOps ops;
+  GByteArray *vertex_data;
+  /* a multiple of all vertex sizes, so offsets can be rebased */
+  gsize vertex_alignment;
+};
+
+/* The arena that ops of the current thread are recorded into */
+static GPrivate current_arena;
+
 G_DEFINE_TYPE_WITH_PRIVATE (GskGpuFrame, gsk_gpu_frame, G_TYPE_OBJECT)
 
 static void
@@ -188,6 +212,14 @@ gsk_gpu_frame_should_optimize (GskGpuFrame         *self,
   return (priv->optimizations & optimization) == optimization;
 }
 
+gboolean
+gsk_gpu_frame_should_use_sdf_glyphs (GskGpuFrame *self)
+{
+  GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
+
+  return GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (priv->renderer), SDF_GLYPHS);
+}
+
 static void
 gsk_gpu_frame_verbose_print (GskGpuFrame *self,
                              const char  *heading)
@@ -345,13 +377,232 @@ gsk_gpu_frame_sort_ops (GskGpuFrame *self)
     sort_data.command.last->next = NULL;
 }
 
+/* Counts the draw calls the shader ops will be merged into */
+static guint
+gsk_gpu_frame_count_draws (GskGpuFrame *self)
+{
+  GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
+  GskGpuShaderOp *last = NULL;
+  GskGpuOp *op;
+  guint n_draws = 0;
+
+  for (op = priv->first_op; op; op = op->next)
+    {
+      GskGpuShaderOp *shader = (GskGpuShaderOp *) op;
+
+      if (op->op_class->stage != GSK_GPU_STAGE_SHADER)
+        {
+          last = NULL;
+          continue;
+        }
+
+      if (last == NULL ||
+          !gsk_gpu_frame_should_optimize (self, GSK_GPU_OPTIMIZE_MERGE) ||
+          !gsk_gpu_shader_op_can_merge (last, shader) ||
+          shader->vertex_offset != last->vertex_offset + ((GskGpuShaderOpClass *) op->op_class)->vertex_size)
+        n_draws++;
+
+      last = shader;
+    }
+
+  return n_draws;
+}
+
+typedef struct _GskGpuBatch GskGpuBatch;
+
+struct _GskGpuBatch
+{
+  GskGpuShaderOp *first;
+  GskGpuShaderOp *last;
+  graphene_rect_t bounds;
+};
+
+static GskGpuBatch *
+gsk_gpu_frame_find_batch (GArray                *batches,
+                          GskGpuShaderOp        *op,
+                          const graphene_rect_t *bounds)
+{
+  gsize i;
+
+  for (i = 1; i <= MIN (batches->len, MAX_REORDER_BATCHES); i++)
+    {
+      GskGpuBatch *batch = &g_array_index (batches, GskGpuBatch, batches->len - i);
+
+      if (gsk_gpu_shader_op_can_merge (batch->last, op))
+        return batch;
+
+      /* can't move the op in front of something it draws on top of */
+      if (gsk_rect_intersects (&batch->bounds, bounds))
+        return NULL;
+    }
+
+  return NULL;
+}
+
+/*
+ * Reorders the run of shader ops following @prev, so that ops that
+ * can be merged end up next to each other.
+ *
+ * Every op is moved back to the last batch of ops it can be merged
+ * with, unless it overlaps one of the ops it would move past. Ops
+ * that don't overlap can be drawn in any order, so this does not
+ * change the result.
+ *
+ * @margin is the size of a pixel in the coordinates of the ops. Shaders
+ * round the area they draw to outwards to full pixels, so ops closer than
+ * that count as overlapping.
+ *
+ * Returns: the first op after the run
+ */
+static GskGpuOp *
+gsk_gpu_frame_reorder_run (GskGpuOp              *prev,
+                           const graphene_vec2_t *margin,
+                           GArray                *batches,
+                           gboolean              *out_moved)
+{
+  GskGpuOp *op, *next;
+  gsize i;
+
+  g_array_set_size (batches, 0);
+
+  for (op = prev->next; op && op->op_class->stage == GSK_GPU_STAGE_SHADER; op = next)
+    {
+      GskGpuShaderOp *shader = (GskGpuShaderOp *) op;
+      graphene_rect_t bounds;
+      GskGpuBatch *batch;
+
+      next = op->next;
+      graphene_rect_inset_r (&shader->bounds,
+                             - graphene_vec2_get_x (margin),
+                             - graphene_vec2_get_y (margin),
+                             &bounds);
+
+      batch = gsk_gpu_frame_find_batch (batches, shader, &bounds);
+      if (batch)
+        {
+          if (batch != &g_array_index (batches, GskGpuBatch, batches->len - 1))
+            *out_moved = TRUE;
+          ((GskGpuOp *) batch->last)->next = op;
+          batch->last = shader;
+          graphene_rect_union (&batch->bounds, &bounds, &batch->bounds);
+        }
+      else
+        {
+          g_array_append_val (batches, ((GskGpuBatch) { shader, shader, bounds }));
+        }
+    }
+
+  if (batches->len == 0)
+    return op;
+
+  prev->next = (GskGpuOp *) g_array_index (batches, GskGpuBatch, 0).first;
+  for (i = 0; i + 1 < batches->len; i++)
+    {
+      ((GskGpuOp *) g_array_index (batches, GskGpuBatch, i).last)->next =
+          (GskGpuOp *) g_array_index (batches, GskGpuBatch, i + 1).first;
+    }
+  ((GskGpuOp *) g_array_index (batches, GskGpuBatch, i).last)->next = op;
+
+  return op;
+}
+
+/* Rewrites the vertex data in the order the shader ops are in now,
+ * so that ops next to each other can be drawn with one call */
+static void
+gsk_gpu_frame_pack_vertex_data (GskGpuFrame *self)
+{
+  GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
+  guchar *old_data;
+  GskGpuOp *op;
+
+  old_data = g_memdup2 (priv->vertex_buffer_data, priv->vertex_buffer_used);
+  priv->vertex_buffer_used = 0;
+
+  for (op = priv->first_op; op; op = op->next)
+    {
+      GskGpuShaderOp *shader = (GskGpuShaderOp *) op;
+      gsize vertex_size, old_offset;
+
+      if (op->op_class->stage != GSK_GPU_STAGE_SHADER)
+        continue;
+
+      vertex_size = ((GskGpuShaderOpClass *) op->op_class)->vertex_size;
+      old_offset = shader->vertex_offset;
+      /* The data gets padded differently, so this may need a bigger buffer */
+      shader->vertex_offset = gsk_gpu_frame_reserve_vertex_data (self, vertex_size);
+      memcpy (gsk_gpu_frame_get_vertex_data (self, shader->vertex_offset),
+              old_data + old_offset,
+              vertex_size);
+    }
+
+  g_free (old_data);
+}
+
+/* Groups shader ops that use the same pipeline, so they can be merged */
+static void
+gsk_gpu_frame_reorder_ops (GskGpuFrame *self)
+{
+  GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
+  graphene_vec2_t scale, margin;
+  gboolean moved = FALSE;
+  GArray *batches;
+  GskGpuOp *op;
+  guint n_draws = 0;
+
+  if (GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (priv->renderer), VERBOSE))
+    n_draws = gsk_gpu_frame_count_draws (self);
+
+  batches = g_array_new (FALSE, FALSE, sizeof (GskGpuBatch));
+  graphene_vec2_init (&margin, 1, 1);
+
+  for (op = priv->first_op; op; )
+    {
+      if (gsk_gpu_globals_op_get_scale (op, &scale))
+        graphene_vec2_divide (graphene_vec2_one (), &scale, &margin);
+
+      if (op->next && op->next->op_class->stage == GSK_GPU_STAGE_SHADER)
+        op = gsk_gpu_frame_reorder_run (op, &margin, batches, &moved);
+      else
+        op = op->next;
+    }
+
+  g_array_unref (batches);
+
+  if (moved)
+    gsk_gpu_frame_pack_vertex_data (self);
+
+  if (GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (priv->renderer), VERBOSE))
+    gdk_debug_message ("draw calls: %u before reordering, %u after",
+                       n_draws, gsk_gpu_frame_count_draws (self));
+}
+
+static inline GskGpuFrameArena *
+gsk_gpu_frame_get_arena (GskGpuFrame *self)
+{
+  GskGpuFrameArena *arena = g_private_get (&current_arena);
+
+  if (arena == NULL || arena->frame != self)
+    return NULL;
+
+  return arena;
+}
+
 gpointer
 gsk_gpu_frame_alloc_op (GskGpuFrame *self,
                         gsize        size)
 {
   GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
+  GskGpuFrameArena *arena;
   gsize pos;
 
+  arena = gsk_gpu_frame_get_arena (self);
+  if (arena)
+    {
+      pos = gsk_gpu_ops_get_size (&arena->ops);
+      gsk_gpu_ops_splice (&arena->ops, pos, 0, FALSE, NULL, size);
+      return gsk_gpu_ops_index (&arena->ops, pos);
+    }
+
   pos = gsk_gpu_ops_get_size (&priv->ops);
 
   gsk_gpu_ops_splice (&priv->ops,
@@ -371,10 +622,21 @@ gsk_gpu_frame_upload_texture (GskGpuFrame  *self,
   GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
   GskGpuImage *image;
 
+  if (gsk_gpu_frame_should_optimize (self, GSK_GPU_OPTIMIZE_CONTENT_CACHE))
+    {
+      image = gsk_gpu_device_lookup_texture_content_image (priv->device, texture, priv->timestamp);
+      if (image)
+        return image;
+    }
+
   image = GSK_GPU_FRAME_GET_CLASS (self)->upload_texture (self, with_mipmap, texture);
 
   if (image)
-    gsk_gpu_device_cache_texture_image (priv->device, texture, priv->timestamp, image);
+    {
+      gsk_gpu_device_cache_texture_image (priv->device, texture, priv->timestamp, image);
+      if (gsk_gpu_frame_should_optimize (self, GSK_GPU_OPTIMIZE_CONTENT_CACHE))
+        gsk_gpu_device_cache_texture_content_image (priv->device, texture, priv->timestamp, image);
+    }
 
   return image;
 }
@@ -405,23 +667,44 @@ round_up (gsize number, gsize divisor)
   return (number + divisor - 1) / divisor * divisor;
 }
 
-gsize
-gsk_gpu_frame_reserve_vertex_data (GskGpuFrame *self,
-                                   gsize        size)
+static gsize
+lcm (gsize a,
+     gsize b)
+{
+  gsize x = a, y = b;
+
+  while (y != 0)
+    {
+      gsize t = x % y;
+      x = y;
+      y = t;
+    }
+
+  return a / x * b;
+}
+
+static void
+gsk_gpu_frame_ensure_vertex_buffer (GskGpuFrame *self,
+                                    gsize        size_needed)
 {
   GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
-  gsize size_needed;
+  gsize old_size, new_size;
 
   if (priv->vertex_buffer == NULL)
     priv->vertex_buffer = gsk_gpu_frame_create_vertex_buffer (self, DEFAULT_VERTEX_BUFFER_SIZE);
 
-  size_needed = round_up (priv->vertex_buffer_used, size) + size;
-
-  if (gsk_gpu_buffer_get_size (priv->vertex_buffer) < size_needed)
+  old_size = gsk_gpu_buffer_get_size (priv->vertex_buffer);
+  if (old_size < size_needed)
     {
-      gsize old_size = gsk_gpu_buffer_get_size (priv->vertex_buffer);
-      GskGpuBuffer *new_buffer = gsk_gpu_frame_create_vertex_buffer (self, old_size * 2);
-      guchar *new_data = gsk_gpu_buffer_map (new_buffer);
+      GskGpuBuffer *new_buffer;
+      guchar *new_data;
+
+      new_size = old_size * 2;
+      while (new_size < size_needed)
+        new_size *= 2;
+
+      new_buffer = gsk_gpu_frame_create_vertex_buffer (self, new_size);
+      new_data = gsk_gpu_buffer_map (new_buffer);
 
       if (priv->vertex_buffer_data)
         {
@@ -432,6 +715,29 @@ gsk_gpu_frame_reserve_vertex_data (GskGpuFrame *self,
       priv->vertex_buffer = new_buffer;
       priv->vertex_buffer_data = new_data;
     }
+}
+
+gsize
+gsk_gpu_frame_reserve_vertex_data (GskGpuFrame *self,
+                                   gsize        size)
+{
+  GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
+  GskGpuFrameArena *arena;
+  gsize size_needed;
+
+  arena = gsk_gpu_frame_get_arena (self);
+  if (arena)
+    {
+      size_needed = round_up (arena->vertex_data->len, size) + size;
+      g_byte_array_set_size (arena->vertex_data, size_needed);
+      arena->vertex_alignment = lcm (arena->vertex_alignment, size);
+
+      return size_needed - size;
+    }
+
+  size_needed = round_up (priv->vertex_buffer_used, size) + size;
+
+  gsk_gpu_frame_ensure_vertex_buffer (self, size_needed);
 
   priv->vertex_buffer_used = size_needed;
   
@@ -443,6 +749,11 @@ gsk_gpu_frame_get_vertex_data (GskGpuFrame *self,
                                gsize        offset)
 {
   GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
+  GskGpuFrameArena *arena;
+
+  arena = gsk_gpu_frame_get_arena (self);
+  if (arena)
+    return arena->vertex_data->data + offset;
 
   if (priv->vertex_buffer_data == NULL)
     priv->vertex_buffer_data = gsk_gpu_buffer_map (priv->vertex_buffer);
@@ -450,6 +761,91 @@ gsk_gpu_frame_get_vertex_data (GskGpuFrame *self,
   return priv->vertex_buffer_data + offset;
 }
 
+/*
+ * Makes the calling thread record the ops it creates for @self into
+ * a new arena instead of the frame, so ops can be recorded on
+ * multiple threads at once.
+ *
+ * Only ops that don't use the device, descriptors or the storage
+ * buffer may be recorded like this, as those are not thread-safe.
+ * The ops only become part of the frame once the arena is added
+ * with gsk_gpu_frame_append_arena().
+ */
+GskGpuFrameArena *
+gsk_gpu_frame_arena_begin (GskGpuFrame *self)
+{
+  GskGpuFrameArena *arena;
+
+  g_assert (g_private_get (&current_arena) == NULL);
+
+  arena = g_new (GskGpuFrameArena, 1);
+  arena->frame = self;
+  gsk_gpu_ops_init (&arena->ops);
+  arena->vertex_data = g_byte_array_new ();
+  arena->vertex_alignment = 1;
+
+  g_private_set (&current_arena, arena);
+
+  return arena;
+}
+
+void
+gsk_gpu_frame_arena_end (GskGpuFrameArena *arena)
+{
+  g_assert (g_private_get (&current_arena) == arena);
+
+  g_private_set (&current_arena, NULL);
+}
+
+/*
+ * Adds the ops of @arena to the end of the ops of @self, as if they
+ * had been recorded there, and frees the arena.
+ *
+ * The vertex data is copied in one piece, so the offsets of the ops
+ * only need to be moved by the same amount.
+ */
+void
+gsk_gpu_frame_append_arena (GskGpuFrame      *self,
+                            GskGpuFrameArena *arena)
+{
+  GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
+  gsize i, pos, base;
+  GskGpuOp *op;
+
+  g_assert (arena->frame == self);
+  g_assert (gsk_gpu_frame_get_arena (self) == NULL);
+
+  base = 0;
+  if (arena->vertex_data->len > 0)
+    {
+      base = round_up (priv->vertex_buffer_used, arena->vertex_alignment);
+      gsk_gpu_frame_ensure_vertex_buffer (self, base + arena->vertex_data->len);
+      memcpy (gsk_gpu_frame_get_vertex_data (self, base),
+              arena->vertex_data->data,
+              arena->vertex_data->len);
+      priv->vertex_buffer_used = base + arena->vertex_data->len;
+    }
+
+  pos = gsk_gpu_ops_get_size (&priv->ops);
+  gsk_gpu_ops_splice (&priv->ops,
+                      pos,
+                      0, FALSE,
+                      gsk_gpu_ops_get_data (&arena->ops),
+                      gsk_gpu_ops_get_size (&arena->ops));
+
+  for (i = pos; i < gsk_gpu_ops_get_size (&priv->ops); i += op->op_class->size)
+    {
+      op = (GskGpuOp *) gsk_gpu_ops_index (&priv->ops, i);
+
+      if (op->op_class->stage == GSK_GPU_STAGE_SHADER)
+        ((GskGpuShaderOp *) op)->vertex_offset += base;
+    }
+
+  gsk_gpu_ops_clear (&arena->ops);
+  g_byte_array_unref (arena->vertex_data);
+  g_free (arena);
+}
+
 static void
 gsk_gpu_frame_ensure_storage_buffer (GskGpuFrame *self)
 {
@@ -537,6 +933,42 @@ gsk_gpu_frame_record_rect (GskGpuFrame                 *self,
                               GSK_RENDER_PASS_PRESENT);
 }
 
+/* Recording walks the whole node tree for every rectangle, so for
+ * regions with rectangles that cover most of their extents, drawing
+ * the extents once is cheaper. The more rectangles, the more walks
+ * merging saves, so less coverage is needed. But scattered rectangles
+ * are never merged, that would draw mostly pixels that didn't change.
+ */
+static gboolean
+gsk_gpu_frame_should_merge_region (GskGpuFrame          *self,
+                                   const cairo_region_t *region)
+{
+  cairo_rectangle_int_t extents, rect;
+  gsize area;
+  int i, n_rects;
+
+  if (!gsk_gpu_frame_should_optimize (self, GSK_GPU_OPTIMIZE_REGION_MERGE))
+    return FALSE;
+
+  n_rects = cairo_region_num_rectangles (region);
+  if (n_rects <= 1)
+    return FALSE;
+
+  area = 0;
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_region_get_rectangle (region, i, &rect);
+      area += (gsize) rect.width * rect.height;
+    }
+
+  cairo_region_get_extents (region, &extents);
+
+  if (n_rects > MAX_REGION_RECTS)
+    return 4 * area >= (gsize) extents.width * extents.height;
+  else
+    return 2 * area >= (gsize) extents.width * extents.height;
+}
+
 static void
 gsk_gpu_frame_record (GskGpuFrame            *self,
                       gint64                  timestamp,
@@ -550,7 +982,14 @@ gsk_gpu_frame_record (GskGpuFrame            *self,
 
   priv->timestamp = timestamp;
 
-  if (clip)
+  if (clip && gsk_gpu_frame_should_merge_region (self, clip))
+    {
+      cairo_rectangle_int_t extents;
+
+      cairo_region_get_extents (clip, &extents);
+      gsk_gpu_frame_record_rect (self, target, &extents, node, viewport);
+    }
+  else if (clip)
     {
       int i;
 
@@ -588,6 +1027,11 @@ gsk_gpu_frame_submit (GskGpuFrame *self)
   gsk_gpu_frame_verbose_print (self, "start of frame");
   gsk_gpu_frame_sort_ops (self);
   gsk_gpu_frame_verbose_print (self, "after sort");
+  if (gsk_gpu_frame_should_optimize (self, GSK_GPU_OPTIMIZE_REORDER))
+    {
+      gsk_gpu_frame_reorder_ops (self);
+      gsk_gpu_frame_verbose_print (self, "after reorder");
+    }
 
   if (priv->vertex_buffer)
     {
@@ -617,11 +1061,15 @@ gsk_gpu_frame_render (GskGpuFrame            *self,
                       const graphene_rect_t  *viewport,
                       GdkTexture            **texture)
 {
+  GskGpuFramePrivate *priv = gsk_gpu_frame_get_instance_private (self);
+
   gsk_gpu_frame_cleanup (self);
 
   gsk_gpu_frame_record (self, timestamp, target, region, node, viewport, texture);
 
   gsk_gpu_frame_submit (self);
+
+  gsk_gpu_device_maybe_gc (priv->device, timestamp);
 }
 
 typedef struct _Download Download;
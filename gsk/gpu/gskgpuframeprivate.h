@@ -13,6 +13,7 @@ G_BEGIN_DECLS
 #define GSK_GPU_FRAME_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), GSK_TYPE_GPU_FRAME, GskGpuFrameClass))
 
 typedef struct _GskGpuFrameClass GskGpuFrameClass;
+typedef struct _GskGpuFrameArena GskGpuFrameArena;
 
 struct _GskGpuFrame
 {
@@ -52,6 +53,7 @@ GskGpuDevice *          gsk_gpu_frame_get_device                        (GskGpuF
 gint64                  gsk_gpu_frame_get_timestamp                     (GskGpuFrame            *self) G_GNUC_PURE;
 gboolean                gsk_gpu_frame_should_optimize                   (GskGpuFrame            *self,
                                                                          GskGpuOptimizations     optimization) G_GNUC_PURE;
+gboolean                gsk_gpu_frame_should_use_sdf_glyphs             (GskGpuFrame            *self) G_GNUC_PURE;
 
 gpointer                gsk_gpu_frame_alloc_op                          (GskGpuFrame            *self,
                                                                          gsize                   size);
@@ -68,6 +70,11 @@ GskGpuBuffer *          gsk_gpu_frame_write_storage_buffer              (GskGpuF
                                                                          gsize                   size,
                                                                          gsize                  *out_offset);
 
+GskGpuFrameArena *      gsk_gpu_frame_arena_begin                       (GskGpuFrame            *self);
+void                    gsk_gpu_frame_arena_end                         (GskGpuFrameArena       *arena);
+void                    gsk_gpu_frame_append_arena                      (GskGpuFrame            *self,
+                                                                         GskGpuFrameArena       *arena);
+
 gboolean                gsk_gpu_frame_is_busy                           (GskGpuFrame            *self);
 
 void                    gsk_gpu_frame_render                            (GskGpuFrame            *self,
@@ -99,3 +99,24 @@ gsk_gpu_globals_op (GskGpuFrame             *frame,
   gsk_rounded_rect_to_float (clip, graphene_point_zero (), self->instance.clip);
   graphene_vec2_to_float (scale, self->instance.scale);
 }
+
+/*
+ * gsk_gpu_globals_op_get_scale:
+ * @op: any op
+ * @scale: (out): the scale set by @op
+ *
+ * Returns: %FALSE if @op is not a globals op
+ */
+gboolean
+gsk_gpu_globals_op_get_scale (GskGpuOp        *op,
+                              graphene_vec2_t *scale)
+{
+  GskGpuGlobalsOp *self = (GskGpuGlobalsOp *) op;
+
+  if (op->op_class != &GSK_GPU_GLOBALS_OP_CLASS)
+    return FALSE;
+
+  graphene_vec2_init_from_float (scale, self->instance.scale);
+
+  return TRUE;
+}
@@ -156,6 +156,15 @@ gsk_gpu_image_set_flags (GskGpuImage      *self,
   priv->flags |= flags;
 }
 
+void
+gsk_gpu_image_unset_flags (GskGpuImage      *self,
+                           GskGpuImageFlags  flags)
+{
+  GskGpuImagePrivate *priv = gsk_gpu_image_get_instance_private (self);
+
+  priv->flags &= ~flags;
+}
+
 void
 gsk_gpu_image_get_projection_matrix (GskGpuImage       *self,
                                      graphene_matrix_t *out_projection)
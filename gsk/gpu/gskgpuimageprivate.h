@@ -44,6 +44,8 @@ gsize                   gsk_gpu_image_get_height                        (GskGpuI
 GskGpuImageFlags        gsk_gpu_image_get_flags                         (GskGpuImage            *self);
 void                    gsk_gpu_image_set_flags                         (GskGpuImage            *self,
                                                                          GskGpuImageFlags        flags);
+void                    gsk_gpu_image_unset_flags                       (GskGpuImage            *self,
+                                                                         GskGpuImageFlags        flags);
 
 void                    gsk_gpu_image_get_projection_matrix             (GskGpuImage            *self,
                                                                          graphene_matrix_t      *out_projection);
@@ -73,6 +73,8 @@ gsk_gpu_mask_op (GskGpuFrame            *frame,
                            mask_mode,
                            clip,
                            desc,
+                           rect,
+                           offset,
                            &instance);
 
   gsk_gpu_rect_to_float (rect, offset, instance->rect);
@@ -23,6 +23,7 @@
 #include "gskgpulineargradientopprivate.h"
 #include "gskgpumaskopprivate.h"
 #include "gskgpumipmapopprivate.h"
+#include "gskgpupathopprivate.h"
 #include "gskgpuradialgradientopprivate.h"
 #include "gskgpurenderpassopprivate.h"
 #include "gskgpuroundedcoloropprivate.h"
@@ -34,15 +35,19 @@
 
 #include "gskcairoblurprivate.h"
 #include "gskdebugprivate.h"
-#include "gskpath.h"
+#include "gskpathprivate.h"
 #include "gskrectprivate.h"
 #include "gskrendernodeprivate.h"
 #include "gskroundedrectprivate.h"
 #include "gskstrokeprivate.h"
 #include "gsktransformprivate.h"
 
+#include "gdk/gdkmemorytextureprivate.h"
+#include "gdk/gdkparalleltaskprivate.h"
 #include "gdk/gdkrgbaprivate.h"
 
+#include <math.h>
+
 /* A note about coordinate systems
  *
  * The rendering code keeps track of multiple coordinate systems to optimize rendering as
@@ -91,6 +96,22 @@
 typedef struct _GskGpuNodeProcessor GskGpuNodeProcessor;
 typedef struct _GskGpuPatternWriter GskGpuPatternWriter;
 
+/* Text that is at most this far outside of the clip, relative to the
+ * size of the clip, gets its glyphs rendered ahead of time, so they are
+ * ready when scrolling brings the text into view */
+#define GLYPH_PREFETCH_DISTANCE 0.5f
+
+/* The maximum number of glyphs to look up for that per render pass */
+#define GLYPH_PREFETCH_BUDGET 1024
+
+/* Runs of container children with at least this many nodes, that are
+ * all colors, borders or containers of those, get recorded on worker
+ * threads. Only containers with enough children are checked. */
+#define PARALLEL_RECORD_MIN_CHILDREN 16
+#define PARALLEL_RECORD_MIN_NODES 2048
+/* The number of nodes a worker thread records at a time */
+#define PARALLEL_RECORD_CHUNK_NODES 512
+
 typedef enum {
   GSK_GPU_GLOBAL_MATRIX  = (1 << 0),
   GSK_GPU_GLOBAL_SCALE   = (1 << 1),
@@ -111,6 +132,7 @@ struct _GskGpuNodeProcessor
   GskTransform                  *modelview;
   GskGpuClip                     clip;
   float                          opacity;
+  gsize                          glyph_prefetch_budget;
 
   GskGpuGlobals                  pending_globals;
 };
@@ -138,6 +160,8 @@ struct _GskGpuPatternWriter
 
 static void             gsk_gpu_node_processor_add_node                 (GskGpuNodeProcessor            *self,
                                                                          GskRenderNode                  *node);
+static void             gsk_gpu_node_processor_add_node_uncached        (GskGpuNodeProcessor            *self,
+                                                                         GskRenderNode                  *node);
 static gboolean         gsk_gpu_node_processor_create_node_pattern      (GskGpuPatternWriter            *self,
                                                                          GskRenderNode                  *node);
 
@@ -194,6 +218,7 @@ gsk_gpu_node_processor_init (GskGpuNodeProcessor         *self,
   self->offset = GRAPHENE_POINT_INIT (-viewport->origin.x,
                                       -viewport->origin.y);
   self->opacity = 1.0;
+  self->glyph_prefetch_budget = GLYPH_PREFETCH_BUDGET;
   self->pending_globals = GSK_GPU_GLOBAL_MATRIX | GSK_GPU_GLOBAL_SCALE | GSK_GPU_GLOBAL_CLIP | GSK_GPU_GLOBAL_SCISSOR | GSK_GPU_GLOBAL_BLEND;
 }
 
@@ -340,10 +365,11 @@ gsk_gpu_node_processor_init_draw (GskGpuNodeProcessor   *self,
   area.width = ceil (graphene_vec2_get_x (scale) * viewport->size.width);
   area.height = ceil (graphene_vec2_get_y (scale) * viewport->size.height);
 
-  image = gsk_gpu_device_create_offscreen_image (gsk_gpu_frame_get_device (frame),
-                                                 FALSE,
-                                                 depth,
-                                                 area.width, area.height);
+  image = gsk_gpu_device_acquire_offscreen_image (gsk_gpu_frame_get_device (frame),
+                                                  frame,
+                                                  FALSE,
+                                                  depth,
+                                                  area.width, area.height);
   if (image == NULL)
     return NULL;
 
@@ -851,10 +877,11 @@ gsk_gpu_node_processor_ensure_image (GskGpuFrame      *frame,
   width = gsk_gpu_image_get_width (image);
   height = gsk_gpu_image_get_height (image);
 
-  copy = gsk_gpu_device_create_offscreen_image (gsk_gpu_frame_get_device (frame),
-                                                required_flags & (GSK_GPU_IMAGE_CAN_MIPMAP | GSK_GPU_IMAGE_MIPMAP) ? TRUE : FALSE,
-                                                gdk_memory_format_get_depth (gsk_gpu_image_get_format (image)),
-                                                width, height);
+  copy = gsk_gpu_device_acquire_offscreen_image (gsk_gpu_frame_get_device (frame),
+                                                 frame,
+                                                 required_flags & (GSK_GPU_IMAGE_CAN_MIPMAP | GSK_GPU_IMAGE_MIPMAP) ? TRUE : FALSE,
+                                                 gdk_memory_format_get_depth (gsk_gpu_image_get_format (image)),
+                                                 width, height);
 
   if (gsk_gpu_frame_should_optimize (frame, GSK_GPU_OPTIMIZE_BLIT) &&
       (flags & (GSK_GPU_IMAGE_NO_BLIT | GSK_GPU_IMAGE_STRAIGHT_ALPHA | GSK_GPU_IMAGE_FILTERABLE)) == GSK_GPU_IMAGE_FILTERABLE)
@@ -966,6 +993,213 @@ gsk_gpu_node_processor_get_node_as_image (GskGpuNodeProcessor   *self,
   return ensure;
 }
 
+/* Blurs with a larger radius than this, in pixels, are done at a lower
+ * resolution. The blur shader takes one sample per pixel of radius. */
+#define BLUR_DOWNSCALE_RADIUS 16
+/* How often the resolution gets halved at most */
+#define MAX_BLUR_DOWNSCALE_STEPS 4
+
+/*
+ * Renders @rect of the source into an image at 1/2^n_steps of the
+ * scale, by halving the resolution in every step, so that every source
+ * pixel contributes to the result.
+ */
+static GskGpuImage *
+gsk_gpu_node_processor_downscale (GskGpuNodeProcessor   *self,
+                                  GskGpuDescriptors     *source_desc,
+                                  guint32                source_descriptor,
+                                  GdkMemoryDepth         depth,
+                                  const graphene_rect_t *rect,
+                                  guint                  n_steps)
+{
+  GskGpuNodeProcessor other;
+  GskGpuDescriptors *desc;
+  GskGpuImage *image, *result;
+  graphene_vec2_t scale;
+  guint32 descriptor;
+  guint i;
+
+  desc = source_desc;
+  descriptor = source_descriptor;
+  scale = self->scale;
+  result = NULL;
+
+  for (i = 0; i < n_steps; i++)
+    {
+      graphene_vec2_scale (&scale, 0.5f, &scale);
+      image = gsk_gpu_node_processor_init_draw (&other,
+                                                self->frame,
+                                                depth,
+                                                &scale,
+                                                rect);
+      if (image == NULL)
+        {
+          g_clear_object (&result);
+          return NULL;
+        }
+
+      gsk_gpu_node_processor_sync_globals (&other, 0);
+
+      if (result)
+        {
+          descriptor = gsk_gpu_node_processor_add_image (&other, result, GSK_GPU_SAMPLER_DEFAULT);
+          desc = other.desc;
+        }
+
+      /* linear filtering averages the 2x2 source pixels of every pixel */
+      gsk_gpu_texture_op (other.frame,
+                          gsk_gpu_clip_get_shader_clip (&other.clip, &other.offset, rect),
+                          desc,
+                          descriptor,
+                          rect,
+                          &other.offset,
+                          rect);
+
+      gsk_gpu_node_processor_finish_draw (&other, image);
+
+      g_clear_object (&result);
+      result = image;
+    }
+
+  return result;
+}
+
+/*
+ * Large blurs are done like small ones, but on a downscaled copy of
+ * the source, so the passes draw fewer pixels and take fewer samples
+ * per pixel. The result gets scaled back up when drawing it.
+ *
+ * A gaussian blur removes the detail that is lost by this, as long as
+ * the radius at the lower resolution stays large enough.
+ */
+static void
+gsk_gpu_node_processor_downscaled_blur_op (GskGpuNodeProcessor       *self,
+                                           const graphene_rect_t     *rect,
+                                           const graphene_point_t    *shadow_offset,
+                                           float                      blur_radius,
+                                           const GdkRGBA             *shadow_color,
+                                           GskGpuDescriptors         *source_desc,
+                                           guint32                    source_descriptor,
+                                           GdkMemoryDepth             source_depth,
+                                           const graphene_rect_t     *source_rect,
+                                           guint                      n_steps)
+{
+  GskGpuNodeProcessor other;
+  GskGpuImage *source, *intermediate, *blurred;
+  graphene_rect_t clip_rect, blur_rect, intermediate_rect;
+  graphene_point_t real_offset;
+  graphene_vec2_t scale, direction;
+  float clip_radius, pixel_size;
+  guint32 descriptor;
+
+  graphene_vec2_scale (&self->scale, 1.0f / (1 << n_steps), &scale);
+  pixel_size = 1.0f / MIN (graphene_vec2_get_x (&scale), graphene_vec2_get_y (&scale));
+  clip_radius = gsk_cairo_blur_compute_pixels (blur_radius / 2.0);
+
+  /* The visible part of the result, with some room for filtering
+   * when scaling it back up */
+  gsk_gpu_node_processor_get_clip_bounds (self, &clip_rect);
+  graphene_rect_offset (&clip_rect, - shadow_offset->x, - shadow_offset->y);
+  graphene_rect_inset (&clip_rect, - 2 * pixel_size, - 2 * pixel_size);
+  if (!gsk_rect_intersection (rect, &clip_rect, &blur_rect))
+    return;
+
+  graphene_rect_inset_r (&blur_rect, 0.f, - clip_radius, &clip_rect);
+  if (!gsk_rect_intersection (rect, &clip_rect, &intermediate_rect))
+    return;
+
+  source = gsk_gpu_node_processor_downscale (self,
+                                             source_desc,
+                                             source_descriptor,
+                                             source_depth,
+                                             source_rect,
+                                             n_steps);
+  if (source == NULL)
+    return;
+
+  intermediate = gsk_gpu_node_processor_init_draw (&other,
+                                                   self->frame,
+                                                   source_depth,
+                                                   &scale,
+                                                   &intermediate_rect);
+  if (intermediate == NULL)
+    {
+      g_object_unref (source);
+      return;
+    }
+
+  gsk_gpu_node_processor_sync_globals (&other, 0);
+
+  descriptor = gsk_gpu_node_processor_add_image (&other, source, GSK_GPU_SAMPLER_TRANSPARENT);
+  graphene_vec2_init (&direction, blur_radius, 0.0f);
+  gsk_gpu_blur_op (other.frame,
+                   gsk_gpu_clip_get_shader_clip (&other.clip, &other.offset, &intermediate_rect),
+                   other.desc,
+                   descriptor,
+                   &intermediate_rect,
+                   &other.offset,
+                   source_rect,
+                   &direction);
+
+  gsk_gpu_node_processor_finish_draw (&other, intermediate);
+  g_object_unref (source);
+
+  blurred = gsk_gpu_node_processor_init_draw (&other,
+                                              self->frame,
+                                              source_depth,
+                                              &scale,
+                                              &blur_rect);
+  if (blurred == NULL)
+    {
+      g_object_unref (intermediate);
+      return;
+    }
+
+  gsk_gpu_node_processor_sync_globals (&other, 0);
+
+  descriptor = gsk_gpu_node_processor_add_image (&other, intermediate, GSK_GPU_SAMPLER_TRANSPARENT);
+  graphene_vec2_init (&direction, 0.0f, blur_radius);
+  if (shadow_color)
+    {
+      gsk_gpu_blur_shadow_op (other.frame,
+                              gsk_gpu_clip_get_shader_clip (&other.clip, &other.offset, &blur_rect),
+                              other.desc,
+                              descriptor,
+                              &blur_rect,
+                              &other.offset,
+                              &intermediate_rect,
+                              &direction,
+                              shadow_color);
+    }
+  else
+    {
+      gsk_gpu_blur_op (other.frame,
+                       gsk_gpu_clip_get_shader_clip (&other.clip, &other.offset, &blur_rect),
+                       other.desc,
+                       descriptor,
+                       &blur_rect,
+                       &other.offset,
+                       &intermediate_rect,
+                       &direction);
+    }
+
+  gsk_gpu_node_processor_finish_draw (&other, blurred);
+  g_object_unref (intermediate);
+
+  real_offset = GRAPHENE_POINT_INIT (self->offset.x + shadow_offset->x,
+                                     self->offset.y + shadow_offset->y);
+  descriptor = gsk_gpu_node_processor_add_image (self, blurred, GSK_GPU_SAMPLER_DEFAULT);
+  gsk_gpu_texture_op (self->frame,
+                      gsk_gpu_clip_get_shader_clip (&self->clip, &real_offset, &blur_rect),
+                      self->desc,
+                      descriptor,
+                      &blur_rect,
+                      &real_offset,
+                      &blur_rect);
+
+  g_object_unref (blurred);
+}
+
 static void
 gsk_gpu_node_processor_blur_op (GskGpuNodeProcessor       *self,
                                 const graphene_rect_t     *rect,
@@ -984,7 +1218,32 @@ gsk_gpu_node_processor_blur_op (GskGpuNodeProcessor       *self,
   graphene_rect_t clip_rect, intermediate_rect;
   graphene_point_t real_offset;
   int width, height;
-  float clip_radius;
+  float clip_radius, pixel_radius;
+  guint n_steps;
+
+  if (gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_BLUR_DOWNSCALE))
+    {
+      pixel_radius = blur_radius * MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale));
+      for (n_steps = 0;
+           n_steps < MAX_BLUR_DOWNSCALE_STEPS && pixel_radius / (1 << n_steps) > BLUR_DOWNSCALE_RADIUS;
+           n_steps++)
+        ;
+
+      if (n_steps > 0)
+        {
+          gsk_gpu_node_processor_downscaled_blur_op (self,
+                                                     rect,
+                                                     shadow_offset,
+                                                     blur_radius,
+                                                     shadow_color,
+                                                     source_desc,
+                                                     source_descriptor,
+                                                     source_depth,
+                                                     source_rect,
+                                                     n_steps);
+          return;
+        }
+    }
 
   clip_radius = gsk_cairo_blur_compute_pixels (blur_radius / 2.0);
 
@@ -997,10 +1256,11 @@ gsk_gpu_node_processor_blur_op (GskGpuNodeProcessor       *self,
   width = ceil (graphene_vec2_get_x (&self->scale) * intermediate_rect.size.width);
   height = ceil (graphene_vec2_get_y (&self->scale) * intermediate_rect.size.height);
 
-  intermediate = gsk_gpu_device_create_offscreen_image (gsk_gpu_frame_get_device (self->frame),
-                                                        FALSE,
-                                                        source_depth,
-                                                        width, height);
+  intermediate = gsk_gpu_device_acquire_offscreen_image (gsk_gpu_frame_get_device (self->frame),
+                                                         self->frame,
+                                                         FALSE,
+                                                         source_depth,
+                                                         width, height);
 
   gsk_gpu_node_processor_init (&other,
                                self->frame,
@@ -1903,6 +2163,161 @@ gsk_gpu_node_processor_add_border_node (GskGpuNodeProcessor *self,
                      colors);
 }
 
+/* Size of the tiles used for textures larger than the maximum image size */
+#define TEXTURE_TILE_SIZE 1024
+/* Texels that tiles overlap with their neighbours on each side, so
+ * linear filtering doesn't create seams at tile edges */
+#define TEXTURE_TILE_BORDER 1
+
+static GdkTexture *
+gsk_gpu_texture_tile_new (GdkMemoryTexture *memtex,
+                          guint             lod_level,
+                          gsize             x,
+                          gsize             y,
+                          gsize             width,
+                          gsize             height)
+{
+  GdkTexture *texture = GDK_TEXTURE (memtex);
+  GdkMemoryFormat format;
+  GBytes *src_bytes, *bytes;
+  gsize bpp, src_stride, stride, tile_width, tile_height;
+  const guchar *src;
+  guchar *data;
+
+  if (lod_level == 0)
+    return gdk_memory_texture_new_subtexture (memtex, x, y, width, height);
+
+  format = gdk_texture_get_format (texture);
+  bpp = gdk_memory_format_bytes_per_pixel (format);
+  tile_width = (width + ((gsize) 1 << lod_level) - 1) >> lod_level;
+  tile_height = (height + ((gsize) 1 << lod_level) - 1) >> lod_level;
+  stride = tile_width * bpp;
+  data = g_malloc (stride * tile_height);
+
+  src_bytes = gdk_memory_texture_get_bytes (memtex, &src_stride);
+  src = g_bytes_get_data (src_bytes, NULL);
+  gdk_memory_mipmap (data, stride, format,
+                     src + y * src_stride + x * bpp, src_stride, format,
+                     width, height,
+                     lod_level);
+
+  bytes = g_bytes_new_take (data, stride * tile_height);
+  texture = gdk_memory_texture_new (tile_width, tile_height, format, bytes, stride);
+  g_bytes_unref (bytes);
+
+  return texture;
+}
+
+/*
+ * Draws a texture that is too large to be uploaded in one piece.
+ *
+ * The texture is split into tiles, and only the tiles that intersect
+ * the clip get uploaded. If the texture is drawn downscaled, tiles
+ * are created from a mipmap level that matches the scale, so drawing
+ * a huge image at a small size does not need to upload all of it.
+ * Tiles are kept in the device's cache.
+ */
+static void
+gsk_gpu_node_processor_add_texture_tiles (GskGpuNodeProcessor   *self,
+                                          const graphene_rect_t *texture_bounds,
+                                          GdkTexture            *texture)
+{
+  GskGpuDevice *device;
+  GdkMemoryTexture *memtex;
+  graphene_rect_t clip_bounds;
+  gsize width, height, tile_size, texels_per_tile;
+  gsize first_x, first_y, last_x, last_y, tile_x, tile_y, border;
+  float texel_ratio, scale_x, scale_y;
+  guint lod_level;
+  gint64 timestamp;
+
+  gsk_gpu_node_processor_get_clip_bounds (self, &clip_bounds);
+  if (!gsk_rect_intersection (&clip_bounds, texture_bounds, &clip_bounds))
+    return;
+
+  device = gsk_gpu_frame_get_device (self->frame);
+  timestamp = gsk_gpu_frame_get_timestamp (self->frame);
+  width = gdk_texture_get_width (texture);
+  height = gdk_texture_get_height (texture);
+
+  /* how many texels end up in one device pixel */
+  texel_ratio = MIN (width / (texture_bounds->size.width * graphene_vec2_get_x (&self->scale)),
+                     height / (texture_bounds->size.height * graphene_vec2_get_y (&self->scale)));
+  if (texel_ratio >= 2 && gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_MIPMAP))
+    lod_level = MIN ((guint) floorf (log2f (texel_ratio)), g_bit_storage (MAX (width, height)) - 1);
+  else
+    lod_level = 0;
+
+  tile_size = MIN (TEXTURE_TILE_SIZE, gsk_gpu_device_get_max_image_size (device) - 2 * TEXTURE_TILE_BORDER);
+  texels_per_tile = tile_size << lod_level;
+  border = TEXTURE_TILE_BORDER << lod_level;
+  scale_x = width / texture_bounds->size.width;
+  scale_y = height / texture_bounds->size.height;
+
+  first_x = floorf ((clip_bounds.origin.x - texture_bounds->origin.x) * scale_x / texels_per_tile);
+  first_y = floorf ((clip_bounds.origin.y - texture_bounds->origin.y) * scale_y / texels_per_tile);
+  last_x = ceilf ((clip_bounds.origin.x + clip_bounds.size.width - texture_bounds->origin.x) * scale_x / texels_per_tile);
+  last_y = ceilf ((clip_bounds.origin.y + clip_bounds.size.height - texture_bounds->origin.y) * scale_y / texels_per_tile);
+  last_x = MIN (last_x, (width + texels_per_tile - 1) / texels_per_tile);
+  last_y = MIN (last_y, (height + texels_per_tile - 1) / texels_per_tile);
+
+  memtex = NULL;
+
+  for (tile_y = first_y; tile_y < last_y; tile_y++)
+    {
+      for (tile_x = first_x; tile_x < last_x; tile_x++)
+        {
+          gsize x = tile_x * texels_per_tile;
+          gsize y = tile_y * texels_per_tile;
+          gsize w = MIN (texels_per_tile, width - x);
+          gsize h = MIN (texels_per_tile, height - y);
+          gsize image_x = x > border ? x - border : 0;
+          gsize image_y = y > border ? y - border : 0;
+          gsize image_w = MIN (x + w + border, width) - image_x;
+          gsize image_h = MIN (y + h + border, height) - image_y;
+          graphene_rect_t tile_rect, image_rect;
+          GskGpuImage *image;
+
+          tile_rect = GRAPHENE_RECT_INIT (texture_bounds->origin.x + x / scale_x,
+                                          texture_bounds->origin.y + y / scale_y,
+                                          w / scale_x,
+                                          h / scale_y);
+          image_rect = GRAPHENE_RECT_INIT (texture_bounds->origin.x + image_x / scale_x,
+                                           texture_bounds->origin.y + image_y / scale_y,
+                                           image_w / scale_x,
+                                           image_h / scale_y);
+
+          image = gsk_gpu_device_lookup_texture_tile_image (device, texture, lod_level, tile_x, tile_y, timestamp);
+          if (image == NULL)
+            {
+              GdkTexture *tile;
+
+              if (memtex == NULL)
+                memtex = gdk_memory_texture_from_texture (texture, gdk_texture_get_format (texture));
+
+              tile = gsk_gpu_texture_tile_new (memtex, lod_level, image_x, image_y, image_w, image_h);
+              image = gsk_gpu_upload_texture_op_try (self->frame, FALSE, tile);
+              g_object_unref (tile);
+              if (image == NULL)
+                {
+                  GSK_DEBUG (FALLBACK, "Failed to upload tile %zu,%zu of texture of size %zux%zu",
+                             tile_x, tile_y, width, height);
+                  continue;
+                }
+
+              g_object_ref (image);
+              gsk_gpu_device_cache_texture_tile_image (device, texture, lod_level, tile_x, tile_y, timestamp, image);
+            }
+
+          gsk_gpu_node_processor_image_op (self, image, &tile_rect, &image_rect);
+
+          g_object_unref (image);
+        }
+    }
+
+  g_clear_object (&memtex);
+}
+
 static void
 gsk_gpu_node_processor_add_texture_node (GskGpuNodeProcessor *self,
                                          GskRenderNode       *node)
@@ -1916,6 +2331,13 @@ gsk_gpu_node_processor_add_texture_node (GskGpuNodeProcessor *self,
   texture = gsk_texture_node_get_texture (node);
   timestamp = gsk_gpu_frame_get_timestamp (self->frame);
 
+  if (gdk_texture_get_width (texture) > gsk_gpu_device_get_max_image_size (device) ||
+      gdk_texture_get_height (texture) > gsk_gpu_device_get_max_image_size (device))
+    {
+      gsk_gpu_node_processor_add_texture_tiles (self, &node->bounds, texture);
+      return;
+    }
+
   image = gsk_gpu_device_lookup_texture_image (device, texture, timestamp);
   if (image == NULL)
     {
@@ -2965,6 +3387,150 @@ gsk_gpu_node_processor_create_mask_pattern (GskGpuPatternWriter *self,
   return TRUE;
 }
 
+/* Glyphs at least this big on screen are drawn from distance fields,
+ * smaller ones look better when rendered hinted */
+#define MIN_SDF_GLYPH_SIZE 32
+
+/* The font size that distance fields are rendered at */
+#define SDF_GLYPH_SIZE 64
+
+/*
+ * Returns the scale to render the glyphs of a text node at as
+ * distance fields, or 0 if they should be rendered as bitmaps.
+ *
+ * The scale only depends on the font, so the same glyphs can be
+ * used no matter how the text gets transformed.
+ */
+static float
+gsk_gpu_get_sdf_glyph_scale (GskGpuFrame   *frame,
+                             GskRenderNode *node,
+                             float          scale)
+{
+  PangoFontDescription *desc;
+  float size;
+
+  if (!gsk_gpu_frame_should_use_sdf_glyphs (frame) ||
+      gsk_text_node_has_color_glyphs (node))
+    return 0;
+
+  desc = pango_font_describe_with_absolute_size (gsk_text_node_get_font (node));
+  size = (float) pango_font_description_get_size (desc) / PANGO_SCALE;
+  pango_font_description_free (desc);
+
+  if (size <= 0 || size * scale < MIN_SDF_GLYPH_SIZE)
+    return 0;
+
+  return SDF_GLYPH_SIZE / size;
+}
+
+static float
+gsk_gpu_node_processor_get_glyph_scale (GskGpuNodeProcessor    *self,
+                                        GskRenderNode          *node,
+                                        GskGpuGlyphLookupFlags *flags)
+{
+  float scale, sdf_scale;
+
+  scale = MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale));
+  sdf_scale = gsk_gpu_get_sdf_glyph_scale (self->frame, node, scale);
+  if (sdf_scale > 0)
+    {
+      *flags = GSK_GPU_GLYPH_SDF;
+      return sdf_scale;
+    }
+
+  *flags = 0;
+  return scale;
+}
+
+/*
+ * Looks up the glyphs of all text in @node that is inside of @area,
+ * so that the ones missing from the cache start rendering now instead
+ * of in the frame where they become visible.
+ */
+static void
+gsk_gpu_node_processor_prefetch_glyphs (GskGpuNodeProcessor    *self,
+                                        GskRenderNode          *node,
+                                        const graphene_point_t *offset,
+                                        const graphene_rect_t  *area)
+{
+  graphene_rect_t bounds;
+
+  graphene_rect_offset_r (&node->bounds, offset->x, offset->y, &bounds);
+  if (!graphene_rect_intersection (&bounds, area, NULL))
+    return;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        guint i;
+
+        for (i = 0; i < gsk_container_node_get_n_children (node) && self->glyph_prefetch_budget > 0; i++)
+          gsk_gpu_node_processor_prefetch_glyphs (self, gsk_container_node_get_child (node, i), offset, area);
+      }
+      break;
+
+    case GSK_CLIP_NODE:
+      gsk_gpu_node_processor_prefetch_glyphs (self, gsk_clip_node_get_child (node), offset, area);
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      gsk_gpu_node_processor_prefetch_glyphs (self, gsk_rounded_clip_node_get_child (node), offset, area);
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskTransform *transform = gsk_transform_node_get_transform (node);
+        float dx, dy;
+
+        /* Other transforms change the scale, so the glyphs would
+         * likely not be the ones needed later */
+        if (gsk_transform_get_category (transform) < GSK_TRANSFORM_CATEGORY_2D_TRANSLATE)
+          break;
+
+        gsk_transform_to_translate (transform, &dx, &dy);
+        gsk_gpu_node_processor_prefetch_glyphs (self,
+                                                gsk_transform_node_get_child (node),
+                                                &GRAPHENE_POINT_INIT (offset->x + dx, offset->y + dy),
+                                                area);
+      }
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        GskGpuDevice *device = gsk_gpu_frame_get_device (self->frame);
+        const PangoGlyphInfo *glyphs;
+        GskGpuGlyphLookupFlags flags;
+        graphene_rect_t glyph_bounds;
+        graphene_point_t glyph_offset;
+        PangoFont *font;
+        guint i, num_glyphs;
+        float scale;
+
+        glyphs = gsk_text_node_get_glyphs (node, NULL);
+        num_glyphs = MIN (gsk_text_node_get_num_glyphs (node), self->glyph_prefetch_budget);
+        font = gsk_text_node_get_font (node);
+        scale = gsk_gpu_node_processor_get_glyph_scale (self, node, &flags);
+
+        for (i = 0; i < num_glyphs; i++)
+          gsk_gpu_device_lookup_glyph_image (device,
+                                             self->frame,
+                                             font,
+                                             glyphs[i].glyph,
+                                             flags,
+                                             scale,
+                                             &glyph_bounds,
+                                             &glyph_offset);
+
+        self->glyph_prefetch_budget -= num_glyphs;
+      }
+      break;
+
+    default:
+      break;
+    }
+}
+
 static void
 gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
                                        GskRenderNode       *node)
@@ -2975,6 +3541,7 @@ gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
   graphene_point_t offset;
   guint i, num_glyphs;
   float scale, inv_scale;
+  GskGpuGlyphLookupFlags flags;
   GdkRGBA color;
 
   if (self->opacity < 1.0 &&
@@ -2994,7 +3561,7 @@ gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
   offset.x += self->offset.x;
   offset.y += self->offset.y;
 
-  scale = MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale));
+  scale = gsk_gpu_node_processor_get_glyph_scale (self, node, &flags);
   inv_scale = 1.f / scale;
 
   for (i = 0; i < num_glyphs; i++)
@@ -3008,7 +3575,7 @@ gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
                                                  self->frame,
                                                  font,
                                                  glyphs[i].glyph,
-                                                 0,
+                                                 flags,
                                                  scale,
                                                  &glyph_bounds,
                                                  &glyph_offset);
@@ -3026,6 +3593,15 @@ gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
                             &glyph_bounds,
                             &glyph_offset,
                             &glyph_tex_rect);
+      else if (flags & GSK_GPU_GLYPH_SDF)
+        gsk_gpu_colorize_sdf_op (self->frame,
+                                 gsk_gpu_clip_get_shader_clip (&self->clip, &glyph_offset, &glyph_bounds),
+                                 self->desc,
+                                 descriptor,
+                                 &glyph_bounds,
+                                 &glyph_offset,
+                                 &glyph_tex_rect,
+                                 &color);
       else
         gsk_gpu_colorize_op (self->frame,
                              gsk_gpu_clip_get_shader_clip (&self->clip, &glyph_offset, &glyph_bounds),
@@ -3057,6 +3633,13 @@ gsk_gpu_node_processor_create_glyph_pattern (GskGpuPatternWriter *self,
   if (gsk_text_node_has_color_glyphs (node))
     return FALSE;
 
+  scale = MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale));
+  inv_scale = 1.f / scale;
+
+  /* The uber shader can't draw distance fields */
+  if (gsk_gpu_get_sdf_glyph_scale (self->frame, node, scale) > 0)
+    return FALSE;
+
   device = gsk_gpu_frame_get_device (self->frame);
   num_glyphs = gsk_text_node_get_num_glyphs (node);
   glyphs = gsk_text_node_get_glyphs (node, NULL);
@@ -3065,9 +3648,6 @@ gsk_gpu_node_processor_create_glyph_pattern (GskGpuPatternWriter *self,
   offset.x += self->offset.x;
   offset.y += self->offset.y;
 
-  scale = MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale));
-  inv_scale = 1.f / scale;
-
   gsk_gpu_pattern_writer_append_uint (self, GSK_GPU_PATTERN_GLYPHS);
   gsk_gpu_pattern_writer_append_rgba (self, gsk_text_node_get_color (node));
   gsk_gpu_pattern_writer_append_uint (self, num_glyphs);
@@ -3425,86 +4005,509 @@ gsk_gpu_node_processor_create_repeat_pattern (GskGpuPatternWriter *self,
   return TRUE;
 }
 
-typedef struct _FillData FillData;
-struct _FillData
+/* Paths are turned into lines with this precision, in pixels.
+ * This is the default tolerance of cairo. */
+#define PATH_TOLERANCE 0.1
+
+typedef struct _GskGpuPathWriter GskGpuPathWriter;
+
+struct _GskGpuPathWriter
 {
-  GskPath *path;
-  GdkRGBA color;
-  GskFillRule fill_rule;
+  GskGpuNodeProcessor          *self;
+  graphene_rect_t               bounds;
+  double                        tolerance;
+  const GskStroke              *stroke;
+  graphene_point_t              start;
+  graphene_point_t              current;
+  GArray                       *points;
+  GArray                       *outline;
+  guint                         n_pen_vertices;
 };
 
 static void
-gsk_fill_data_free (gpointer data)
+gsk_gpu_path_writer_add_line (GskGpuPathWriter       *writer,
+                              const graphene_point_t *start,
+                              const graphene_point_t *end)
 {
-  FillData *fill = data;
+  GskGpuNodeProcessor *self = writer->self;
+  graphene_rect_t rect;
+  float left, right, top, bottom;
 
-  gsk_path_unref (fill->path);
-  g_free (fill);
+  /* Horizontal lines don't change the winding number */
+  if (start->y == end->y)
+    return;
+
+  left = MIN (start->x, end->x);
+  right = writer->bounds.origin.x + writer->bounds.size.width;
+  top = MAX (MIN (start->y, end->y), writer->bounds.origin.y);
+  bottom = MIN (MAX (start->y, end->y), writer->bounds.origin.y + writer->bounds.size.height);
+  if (left >= right || top >= bottom)
+    return;
+
+  rect = GRAPHENE_RECT_INIT (left, top, right - left, bottom - top);
+  gsk_gpu_path_op (self->frame,
+                   gsk_gpu_clip_get_shader_clip (&self->clip, &self->offset, &rect),
+                   &rect,
+                   &self->offset,
+                   start,
+                   end);
 }
 
 static void
-gsk_gpu_node_processor_fill_path (gpointer  data,
-                                  cairo_t  *cr)
+gsk_gpu_path_writer_add_polygon (GskGpuPathWriter       *writer,
+                                 const graphene_point_t *points,
+                                 gsize                   n_points)
 {
-  FillData *fill = data;
+  gsize i;
 
-  switch (fill->fill_rule)
-  {
-    case GSK_FILL_RULE_WINDING:
-      cairo_set_fill_rule (cr, CAIRO_FILL_RULE_WINDING);
-      break;
-    case GSK_FILL_RULE_EVEN_ODD:
-      cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
-      break;
-    default:
-      g_assert_not_reached ();
-      break;
-  }
-  gsk_path_to_cairo (fill->path, cr);
-  gdk_cairo_set_source_rgba (cr, &fill->color);
-  cairo_fill (cr);
+  for (i = 0; i < n_points; i++)
+    gsk_gpu_path_writer_add_line (writer, &points[i], &points[(i + 1) % n_points]);
 }
 
-static void
-gsk_gpu_node_processor_add_fill_node (GskGpuNodeProcessor *self,
-                                      GskRenderNode       *node)
+/* Returns the number of corners of the polygon that approximates
+ * circles with @radius. This is computed like cairo does it for its
+ * pens, so round joins and caps get the same corners as with cairo.
+ */
+static guint
+gsk_gpu_path_writer_get_pen_vertices (GskGpuPathWriter *writer,
+                                      float             radius)
 {
-  graphene_rect_t clip_bounds, source_rect;
-  GskGpuImage *mask_image, *source_image;
-  guint32 descriptors[2];
-  GskRenderNode *child;
+  guint n;
 
-  if (!gsk_gpu_node_processor_clip_node_bounds (self, node, &clip_bounds))
-    return;
+  if (writer->tolerance >= radius)
+    return 4;
 
-  child = gsk_fill_node_get_child (node);
+  n = ceil (2 * G_PI / acos (1.0 - writer->tolerance / radius));
+  n += n % 2;
+
+  return MAX (n, 4);
+}
+
+static inline void
+gsk_gpu_path_writer_append_point (GskGpuPathWriter *writer,
+                                  float             x,
+                                  float             y)
+{
+  graphene_point_t point = GRAPHENE_POINT_INIT (x, y);
+
+  g_array_append_val (writer->outline, point);
+}
+
+/* Appends the corners of the pen around @center that are between
+ * the angles @start and @start + @sweep. Angles grow clockwise on
+ * screen, because y points down. */
+static void
+gsk_gpu_path_writer_append_arc (GskGpuPathWriter       *writer,
+                                const graphene_point_t *center,
+                                double                  start,
+                                double                  sweep)
+{
+  float radius = writer->stroke->line_width / 2;
+  double angle;
+  int i;
+
+  for (i = floor (start * writer->n_pen_vertices / (2 * G_PI)) + 1; ; i++)
+    {
+      angle = 2 * G_PI * i / writer->n_pen_vertices;
+      if (angle >= start + sweep - 1e-6)
+        break;
+
+      gsk_gpu_path_writer_append_point (writer,
+                                        center->x + radius * cos (angle),
+                                        center->y + radius * sin (angle));
+    }
+}
+
+/* The normal on the left side of the line from @start to @end,
+ * with the length of half the line width */
+static void
+gsk_gpu_path_writer_get_normal (GskGpuPathWriter       *writer,
+                                const graphene_point_t *start,
+                                const graphene_point_t *end,
+                                graphene_point_t       *normal)
+{
+  float dx, dy, scale;
+
+  dx = end->x - start->x;
+  dy = end->y - start->y;
+  scale = writer->stroke->line_width / 2 / sqrtf (dx * dx + dy * dy);
+
+  normal->x = dy * scale;
+  normal->y = - dx * scale;
+}
+
+static gboolean
+gsk_gpu_path_writer_fill_op (GskPathOperation        op,
+                             const graphene_point_t *pts,
+                             gsize                   n_pts,
+                             float                   weight,
+                             gpointer                data)
+{
+  GskGpuPathWriter *writer = data;
+
+  switch (op)
+    {
+    case GSK_PATH_MOVE:
+      /* Fills close all contours */
+      gsk_gpu_path_writer_add_line (writer, &writer->current, &writer->start);
+      writer->start = pts[0];
+      writer->current = pts[0];
+      break;
+
+    case GSK_PATH_CLOSE:
+    case GSK_PATH_LINE:
+      gsk_gpu_path_writer_add_line (writer, &pts[0], &pts[1]);
+      writer->current = pts[1];
+      break;
+
+    case GSK_PATH_QUAD:
+    case GSK_PATH_CUBIC:
+    case GSK_PATH_CONIC:
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+
+  return TRUE;
+}
+
+/* Appends the left side of the stroke of @points to the outline,
+ * walking the points backwards if @reverse is set.
+ *
+ * Joins on the outside of a turn are arcs. Joins on the inside go
+ * through the point itself, like cairo does it. The small loop that
+ * makes goes around in the same direction as the rest of the outline,
+ * so its winding number adds to the one of the stroke and doesn't cut
+ * a hole into it.
+ */
+static void
+gsk_gpu_path_writer_append_side (GskGpuPathWriter       *writer,
+                                 const graphene_point_t *points,
+                                 gsize                   n_points,
+                                 gboolean                reverse,
+                                 gboolean                closed)
+{
+  graphene_point_t normal, next_normal;
+  gsize i, n_lines;
+
+#define POINT(i) (&points[reverse ? n_points - 1 - (i) % n_points : (i) % n_points])
+
+  gsk_gpu_path_writer_get_normal (writer, POINT (0), POINT (1), &normal);
+  if (!closed)
+    gsk_gpu_path_writer_append_point (writer, POINT (0)->x + normal.x, POINT (0)->y + normal.y);
+
+  n_lines = closed ? n_points : n_points - 1;
+  for (i = 0; i < n_lines; i++)
+    {
+      const graphene_point_t *point = POINT (i + 1);
+      double start, sweep;
+
+      gsk_gpu_path_writer_append_point (writer, point->x + normal.x, point->y + normal.y);
+      if (!closed && i + 1 == n_lines)
+        break;
+
+      gsk_gpu_path_writer_get_normal (writer, point, POINT (i + 2), &next_normal);
+      start = atan2 (normal.y, normal.x);
+      sweep = atan2 (next_normal.y, next_normal.x) - start;
+      if (sweep <= - G_PI)
+        sweep += 2 * G_PI;
+      else if (sweep > G_PI)
+        sweep -= 2 * G_PI;
+
+      if (sweep > 0)
+        gsk_gpu_path_writer_append_arc (writer, point, start, sweep);
+      else if (sweep < 0)
+        gsk_gpu_path_writer_append_point (writer, point->x, point->y);
+
+      gsk_gpu_path_writer_append_point (writer, point->x + next_normal.x, point->y + next_normal.y);
+      normal = next_normal;
+    }
+
+#undef POINT
+}
+
+/* Appends the cap at @end of the line from @start to @end,
+ * going from its left side to its right side */
+static void
+gsk_gpu_path_writer_append_cap (GskGpuPathWriter       *writer,
+                                const graphene_point_t *start,
+                                const graphene_point_t *end)
+{
+  graphene_point_t normal;
+
+  gsk_gpu_path_writer_get_normal (writer, start, end, &normal);
+
+  switch (writer->stroke->line_cap)
+    {
+    case GSK_LINE_CAP_ROUND:
+      gsk_gpu_path_writer_append_arc (writer, end, atan2 (normal.y, normal.x), G_PI);
+      break;
+
+    case GSK_LINE_CAP_SQUARE:
+      /* The normal turned clockwise points along the line */
+      gsk_gpu_path_writer_append_point (writer, end->x + normal.x - normal.y, end->y + normal.y + normal.x);
+      gsk_gpu_path_writer_append_point (writer, end->x - normal.x - normal.y, end->y - normal.y + normal.x);
+      break;
+
+    case GSK_LINE_CAP_BUTT:
+    default:
+      break;
+    }
+}
+
+static void
+gsk_gpu_path_writer_add_outline (GskGpuPathWriter *writer)
+{
+  gsk_gpu_path_writer_add_polygon (writer,
+                                   (graphene_point_t *) writer->outline->data,
+                                   writer->outline->len);
+  g_array_set_size (writer->outline, 0);
+}
+
+/*
+ * Strokes with round joins are turned into their outline: The left
+ * side of the contour, the end cap, the right side going back and
+ * the start cap. Closed contours have no caps, so their two sides
+ * are separate polygons going around in opposite directions.
+ *
+ * Unlike a union of overlapping shapes, the outline has only one
+ * edge in the pixels along the border of the stroke, so the area
+ * coverage of those pixels is exact.
+ */
+static void
+gsk_gpu_path_writer_stroke_contour (GskGpuPathWriter *writer,
+                                    gboolean          closed)
+{
+  graphene_point_t *points = (graphene_point_t *) writer->points->data;
+  gsize i, j, n;
+
+  for (i = 1, j = 1; i < writer->points->len; i++)
+    {
+      if (!graphene_point_equal (&points[i], &points[j - 1]))
+        points[j++] = points[i];
+    }
+  n = MIN (j, writer->points->len);
+  if (closed && n > 1 && graphene_point_equal (&points[0], &points[n - 1]))
+    n--;
+
+  if (n == 1)
+    {
+      if (writer->stroke->line_cap == GSK_LINE_CAP_ROUND)
+        {
+          gsk_gpu_path_writer_append_point (writer, points[0].x + writer->stroke->line_width / 2, points[0].y);
+          gsk_gpu_path_writer_append_arc (writer, &points[0], 0, 2 * G_PI);
+          gsk_gpu_path_writer_add_outline (writer);
+        }
+    }
+  else if (closed)
+    {
+      gsk_gpu_path_writer_append_side (writer, points, n, FALSE, TRUE);
+      gsk_gpu_path_writer_add_outline (writer);
+      gsk_gpu_path_writer_append_side (writer, points, n, TRUE, TRUE);
+      gsk_gpu_path_writer_add_outline (writer);
+    }
+  else
+    {
+      gsk_gpu_path_writer_append_side (writer, points, n, FALSE, FALSE);
+      gsk_gpu_path_writer_append_cap (writer, &points[n - 2], &points[n - 1]);
+      gsk_gpu_path_writer_append_side (writer, points, n, TRUE, FALSE);
+      gsk_gpu_path_writer_append_cap (writer, &points[1], &points[0]);
+      gsk_gpu_path_writer_add_outline (writer);
+    }
+
+  g_array_set_size (writer->points, 0);
+}
+
+static gboolean
+gsk_gpu_path_writer_stroke_op (GskPathOperation        op,
+                               const graphene_point_t *pts,
+                               gsize                   n_pts,
+                               float                   weight,
+                               gpointer                data)
+{
+  GskGpuPathWriter *writer = data;
+
+  switch (op)
+    {
+    case GSK_PATH_MOVE:
+      if (writer->points->len > 0)
+        gsk_gpu_path_writer_stroke_contour (writer, FALSE);
+      g_array_append_val (writer->points, pts[0]);
+      break;
+
+    case GSK_PATH_CLOSE:
+      g_array_append_val (writer->points, pts[1]);
+      gsk_gpu_path_writer_stroke_contour (writer, TRUE);
+      break;
+
+    case GSK_PATH_LINE:
+      g_array_append_val (writer->points, pts[1]);
+      break;
+
+    case GSK_PATH_QUAD:
+    case GSK_PATH_CUBIC:
+    case GSK_PATH_CONIC:
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+
+  return TRUE;
+}
+
+/*
+ * Draws the winding numbers of the fill of @path - or of its stroke,
+ * if @stroke is given - into a float image covering @bounds.
+ *
+ * Returns NULL if the path can't be drawn this way.
+ */
+static GskGpuImage *
+gsk_gpu_node_processor_draw_path (GskGpuNodeProcessor   *self,
+                                  const graphene_rect_t *bounds,
+                                  GskPath               *path,
+                                  const GskStroke       *stroke)
+{
+  GskGpuNodeProcessor other;
+  GskGpuPathWriter writer;
+  GskGpuImage *image;
+  float scale;
+
+  if (!gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_PATHS))
+    return NULL;
+
+  if (stroke &&
+      (stroke->line_join != GSK_LINE_JOIN_ROUND || stroke->n_dash > 0 || stroke->line_width <= 0))
+    return NULL;
+
+  image = gsk_gpu_node_processor_init_draw (&other,
+                                            self->frame,
+                                            GDK_MEMORY_FLOAT16,
+                                            &self->scale,
+                                            bounds);
+  if (image == NULL)
+    return NULL;
+
+  /* Winding numbers can be negative, so this needs a float image */
+  if (gdk_memory_format_get_depth (gsk_gpu_image_get_format (image)) != GDK_MEMORY_FLOAT16 &&
+      gdk_memory_format_get_depth (gsk_gpu_image_get_format (image)) != GDK_MEMORY_FLOAT32)
+    {
+      gsk_gpu_node_processor_finish_draw (&other, image);
+      g_object_unref (image);
+      return NULL;
+    }
+
+  other.blend = GSK_GPU_BLEND_ADD;
+  other.pending_globals |= GSK_GPU_GLOBAL_BLEND;
+  gsk_gpu_node_processor_sync_globals (&other, 0);
+
+  scale = MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale));
+  writer.self = &other;
+  writer.bounds = *bounds;
+  writer.tolerance = PATH_TOLERANCE / scale;
+  writer.stroke = stroke;
+  writer.start = GRAPHENE_POINT_INIT (0, 0);
+  writer.current = GRAPHENE_POINT_INIT (0, 0);
+
+  if (stroke)
+    {
+      writer.points = g_array_new (FALSE, FALSE, sizeof (graphene_point_t));
+      writer.outline = g_array_new (FALSE, FALSE, sizeof (graphene_point_t));
+      writer.n_pen_vertices = gsk_gpu_path_writer_get_pen_vertices (&writer, stroke->line_width / 2);
+      gsk_path_foreach_with_tolerance (path,
+                                       GSK_PATH_FOREACH_ALLOW_ONLY_LINES,
+                                       writer.tolerance,
+                                       gsk_gpu_path_writer_stroke_op,
+                                       &writer);
+      if (writer.points->len > 0)
+        gsk_gpu_path_writer_stroke_contour (&writer, FALSE);
+      g_array_unref (writer.outline);
+      g_array_unref (writer.points);
+    }
+  else
+    {
+      writer.points = NULL;
+      writer.outline = NULL;
+      gsk_path_foreach_with_tolerance (path,
+                                       GSK_PATH_FOREACH_ALLOW_ONLY_LINES,
+                                       writer.tolerance,
+                                       gsk_gpu_path_writer_fill_op,
+                                       &writer);
+      gsk_gpu_path_writer_add_line (&writer, &writer.current, &writer.start);
+    }
+
+  gsk_gpu_node_processor_finish_draw (&other, image);
+
+  return image;
+}
+
+/* Turns the winding numbers from gsk_gpu_node_processor_draw_path()
+ * into a mask like the one drawn by cairo */
+static GskGpuImage *
+gsk_gpu_node_processor_resolve_path (GskGpuNodeProcessor   *self,
+                                     GskGpuImage           *winding,
+                                     GskFillRule            fill_rule,
+                                     const graphene_rect_t *bounds)
+{
+  GskGpuNodeProcessor other;
+  GskGpuImage *image;
+  guint32 descriptor;
+
+  image = gsk_gpu_node_processor_init_draw (&other,
+                                            self->frame,
+                                            GDK_MEMORY_U8,
+                                            &self->scale,
+                                            bounds);
+  if (image == NULL)
+    return NULL;
+
+  gsk_gpu_node_processor_sync_globals (&other, 0);
+
+  descriptor = gsk_gpu_node_processor_add_image (&other, winding, GSK_GPU_SAMPLER_DEFAULT);
+  gsk_gpu_colorize_path_op (other.frame,
+                            gsk_gpu_clip_get_shader_clip (&other.clip, &other.offset, bounds),
+                            other.desc,
+                            descriptor,
+                            fill_rule,
+                            bounds,
+                            &other.offset,
+                            bounds,
+                            &GDK_RGBA_WHITE);
+
+  gsk_gpu_node_processor_finish_draw (&other, image);
+
+  return image;
+}
+
+/*
+ * Draws the child of a fill or stroke node through @mask_image,
+ * which covers @mask_rect and contains the path in the color of
+ * the child if that is a color node.
+ */
+static void
+gsk_gpu_node_processor_add_path_mask (GskGpuNodeProcessor   *self,
+                                      GskRenderNode         *node,
+                                      GskRenderNode         *child,
+                                      GskGpuImage           *mask_image,
+                                      const graphene_rect_t *mask_rect,
+                                      const graphene_rect_t *clip_bounds)
+{
+  graphene_rect_t source_rect;
+  GskGpuImage *source_image;
+  guint32 descriptors[2];
 
-  mask_image = gsk_gpu_upload_cairo_op (self->frame,
-                                        &self->scale,
-                                        &clip_bounds,
-                                        gsk_gpu_node_processor_fill_path,
-                                        g_memdup (&(FillData) {
-                                            .path = gsk_path_ref (gsk_fill_node_get_path (node)),
-                                            .color = GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE
-                                                   ? *gsk_color_node_get_color (child)
-                                                   : GDK_RGBA_WHITE,
-                                            .fill_rule = gsk_fill_node_get_fill_rule (node)
-                                        }, sizeof (FillData)),
-                                        (GDestroyNotify) gsk_fill_data_free);
-  g_return_if_fail (mask_image != NULL);
   if (GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE)
     {
       gsk_gpu_node_processor_image_op (self,
                                        mask_image,
-                                       &clip_bounds,
-                                       &clip_bounds);
+                                       clip_bounds,
+                                       mask_rect);
       return;
     }
 
   source_image = gsk_gpu_node_processor_get_node_as_image (self,
                                                            0,
                                                            GSK_GPU_IMAGE_STRAIGHT_ALPHA,
-                                                           &clip_bounds,
+                                                           clip_bounds,
                                                            child,
                                                            &source_rect);
   if (source_image == NULL)
@@ -3526,11 +4529,99 @@ gsk_gpu_node_processor_add_fill_node (GskGpuNodeProcessor *self,
                    descriptors[0],
                    &source_rect,
                    descriptors[1],
-                   &clip_bounds);
+                   mask_rect);
 
   g_object_unref (source_image);
 }
 
+/* Returns FALSE if the path needs to be drawn with cairo */
+static gboolean
+gsk_gpu_node_processor_add_path (GskGpuNodeProcessor   *self,
+                                 GskRenderNode         *node,
+                                 GskRenderNode         *child,
+                                 const graphene_rect_t *clip_bounds,
+                                 GskPath               *path,
+                                 GskFillRule            fill_rule,
+                                 const GskStroke       *stroke)
+{
+  GskGpuImage *winding, *mask_image;
+
+  winding = gsk_gpu_node_processor_draw_path (self, clip_bounds, path, stroke);
+  if (winding == NULL)
+    return FALSE;
+
+  if (GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE)
+    {
+      GdkRGBA color = *gsk_color_node_get_color (child);
+      guint32 descriptor;
+
+      color.alpha *= self->opacity;
+      descriptor = gsk_gpu_node_processor_add_image (self, winding, GSK_GPU_SAMPLER_DEFAULT);
+      gsk_gpu_colorize_path_op (self->frame,
+                                gsk_gpu_clip_get_shader_clip (&self->clip, &self->offset, clip_bounds),
+                                self->desc,
+                                descriptor,
+                                fill_rule,
+                                clip_bounds,
+                                &self->offset,
+                                clip_bounds,
+                                &color);
+      g_object_unref (winding);
+      return TRUE;
+    }
+
+  mask_image = gsk_gpu_node_processor_resolve_path (self, winding, fill_rule, clip_bounds);
+  g_object_unref (winding);
+  if (mask_image == NULL)
+    return TRUE;
+
+  gsk_gpu_node_processor_add_path_mask (self, node, child, mask_image, clip_bounds, clip_bounds);
+
+  g_object_unref (mask_image);
+
+  return TRUE;
+}
+
+typedef struct _FillData FillData;
+struct _FillData
+{
+  GskPath *path;
+  GdkRGBA color;
+  GskFillRule fill_rule;
+};
+
+static void
+gsk_fill_data_free (gpointer data)
+{
+  FillData *fill = data;
+
+  gsk_path_unref (fill->path);
+  g_free (fill);
+}
+
+static void
+gsk_gpu_node_processor_fill_path (gpointer  data,
+                                  cairo_t  *cr)
+{
+  FillData *fill = data;
+
+  switch (fill->fill_rule)
+  {
+    case GSK_FILL_RULE_WINDING:
+      cairo_set_fill_rule (cr, CAIRO_FILL_RULE_WINDING);
+      break;
+    case GSK_FILL_RULE_EVEN_ODD:
+      cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+  gsk_path_to_cairo (fill->path, cr);
+  gdk_cairo_set_source_rgba (cr, &fill->color);
+  cairo_fill (cr);
+}
+
 typedef struct _StrokeData StrokeData;
 struct _StrokeData
 {
@@ -3544,30 +4635,262 @@ gsk_stroke_data_free (gpointer data)
 {
   StrokeData *stroke = data;
 
-  gsk_path_unref (stroke->path);
-  gsk_stroke_clear (&stroke->stroke);
-  g_free (stroke);
+  gsk_path_unref (stroke->path);
+  gsk_stroke_clear (&stroke->stroke);
+  g_free (stroke);
+}
+
+static void
+gsk_gpu_node_processor_stroke_path (gpointer  data,
+                                    cairo_t  *cr)
+{
+  StrokeData *stroke = data;
+
+  gsk_stroke_to_cairo (&stroke->stroke, cr);
+  gsk_path_to_cairo (stroke->path, cr);
+  gdk_cairo_set_source_rgba (cr, &stroke->color);
+  cairo_stroke (cr);
+}
+
+/* Largest path mask that gets kept for reuse, in pixels */
+#define MAX_PATH_CACHE_PIXELS (1024 * 1024)
+/* Number of subpixel positions path masks are rendered at, per axis */
+#define PATH_CACHE_PHASES 4
+
+/* Renders the fill or stroke of @path into a white mask covering @viewport */
+static GskGpuImage *
+gsk_gpu_node_processor_draw_path_mask (GskGpuNodeProcessor   *self,
+                                       const graphene_rect_t *viewport,
+                                       GskPath               *path,
+                                       GskFillRule            fill_rule,
+                                       const GskStroke       *stroke)
+{
+  GskGpuImage *winding, *image;
+
+  winding = gsk_gpu_node_processor_draw_path (self, viewport, path, stroke);
+  if (winding)
+    {
+      image = gsk_gpu_node_processor_resolve_path (self, winding, fill_rule, viewport);
+      g_object_unref (winding);
+      return image;
+    }
+
+  if (stroke)
+    image = gsk_gpu_upload_cairo_op (self->frame,
+                                     &self->scale,
+                                     viewport,
+                                     gsk_gpu_node_processor_stroke_path,
+                                     g_memdup (&(StrokeData) {
+                                         .path = gsk_path_ref (path),
+                                         .color = GDK_RGBA_WHITE,
+                                         .stroke = GSK_STROKE_INIT_COPY (stroke)
+                                     }, sizeof (StrokeData)),
+                                     (GDestroyNotify) gsk_stroke_data_free);
+  else
+    image = gsk_gpu_upload_cairo_op (self->frame,
+                                     &self->scale,
+                                     viewport,
+                                     gsk_gpu_node_processor_fill_path,
+                                     g_memdup (&(FillData) {
+                                         .path = gsk_path_ref (path),
+                                         .color = GDK_RGBA_WHITE,
+                                         .fill_rule = fill_rule
+                                     }, sizeof (FillData)),
+                                     (GDestroyNotify) gsk_fill_data_free);
+  if (image == NULL)
+    return NULL;
+
+  return g_object_ref (image);
+}
+
+/*
+ * Path masks are kept in the device and shared by all fill and
+ * stroke nodes using the same path, so paths that move around -
+ * like spinners or icons in scrolling lists - only get rendered
+ * once.
+ *
+ * The mask covers the whole path, not just the visible part of it,
+ * and is rendered at the closest of PATH_CACHE_PHASES subpixel
+ * positions. Transforms other than scales don't need to be part
+ * of the key, because they are applied when drawing the mask.
+ *
+ * Returns: %TRUE if the node was drawn
+ */
+static gboolean
+gsk_gpu_node_processor_add_cached_path (GskGpuNodeProcessor   *self,
+                                        GskRenderNode         *node,
+                                        GskRenderNode         *child,
+                                        const graphene_rect_t *clip_bounds,
+                                        GskPath               *path,
+                                        GskFillRule            fill_rule,
+                                        const GskStroke       *stroke)
+{
+  GskGpuDevice *device;
+  GskGpuImage *image;
+  graphene_rect_t path_bounds, viewport, mask_rect, draw_rect;
+  float scale_x, scale_y, x, y, width, height;
+  guint phase_x, phase_y;
+  gint64 timestamp;
+  gboolean seen;
+
+  if (!gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_PATH_CACHE))
+    return FALSE;
+
+  if (stroke)
+    {
+      if (!gsk_path_get_stroke_bounds (path, stroke, &path_bounds))
+        return FALSE;
+    }
+  else
+    {
+      if (!gsk_path_get_bounds (path, &path_bounds))
+        return FALSE;
+    }
+
+  scale_x = graphene_vec2_get_x (&self->scale);
+  scale_y = graphene_vec2_get_y (&self->scale);
+
+  /* Split the device position of the path into whole pixels and a phase */
+  x = (path_bounds.origin.x + self->offset.x) * scale_x;
+  y = (path_bounds.origin.y + self->offset.y) * scale_y;
+  phase_x = roundf ((x - floorf (x)) * PATH_CACHE_PHASES);
+  phase_y = roundf ((y - floorf (y)) * PATH_CACHE_PHASES);
+  x = floorf (x);
+  y = floorf (y);
+  if (phase_x == PATH_CACHE_PHASES)
+    {
+      x += 1;
+      phase_x = 0;
+    }
+  if (phase_y == PATH_CACHE_PHASES)
+    {
+      y += 1;
+      phase_y = 0;
+    }
+
+  width = ceilf (path_bounds.size.width * scale_x + (float) phase_x / PATH_CACHE_PHASES);
+  height = ceilf (path_bounds.size.height * scale_y + (float) phase_y / PATH_CACHE_PHASES);
+  if (width * height > MAX_PATH_CACHE_PIXELS)
+    return FALSE;
+
+  device = gsk_gpu_frame_get_device (self->frame);
+  timestamp = gsk_gpu_frame_get_timestamp (self->frame);
+
+  image = gsk_gpu_device_lookup_path_image (device,
+                                            path, fill_rule, stroke,
+                                            &self->scale,
+                                            phase_x, phase_y,
+                                            timestamp,
+                                            &seen);
+  if (image == NULL)
+    {
+      if (!seen)
+        return FALSE;
+
+      viewport = GRAPHENE_RECT_INIT (path_bounds.origin.x - (float) phase_x / PATH_CACHE_PHASES / scale_x,
+                                     path_bounds.origin.y - (float) phase_y / PATH_CACHE_PHASES / scale_y,
+                                     width / scale_x,
+                                     height / scale_y);
+      image = gsk_gpu_node_processor_draw_path_mask (self, &viewport, path, fill_rule, stroke);
+      if (image == NULL)
+        return FALSE;
+
+      gsk_gpu_device_cache_path_image (device,
+                                       path, fill_rule, stroke,
+                                       &self->scale,
+                                       phase_x, phase_y,
+                                       timestamp,
+                                       image);
+    }
+
+  /* The path starts at the same subpixel position in the mask
+   * as on screen, so the mask can be put onto the pixel grid */
+  mask_rect = GRAPHENE_RECT_INIT (x / scale_x - self->offset.x,
+                                  y / scale_y - self->offset.y,
+                                  gsk_gpu_image_get_width (image) / scale_x,
+                                  gsk_gpu_image_get_height (image) / scale_y);
+
+  if (GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE)
+    {
+      GdkRGBA color = *gsk_color_node_get_color (child);
+
+      if (gsk_rect_intersection (&mask_rect, clip_bounds, &draw_rect))
+        {
+          color.alpha *= self->opacity;
+          gsk_gpu_colorize_op (self->frame,
+                               gsk_gpu_clip_get_shader_clip (&self->clip, &self->offset, &draw_rect),
+                               self->desc,
+                               gsk_gpu_node_processor_add_image (self, image, GSK_GPU_SAMPLER_DEFAULT),
+                               &draw_rect,
+                               &self->offset,
+                               &mask_rect,
+                               &color);
+        }
+    }
+  else
+    {
+      gsk_gpu_node_processor_add_path_mask (self, node, child, image, &mask_rect, clip_bounds);
+    }
+
+  g_object_unref (image);
+
+  return TRUE;
 }
 
 static void
-gsk_gpu_node_processor_stroke_path (gpointer  data,
-                                    cairo_t  *cr)
+gsk_gpu_node_processor_add_fill_node (GskGpuNodeProcessor *self,
+                                      GskRenderNode       *node)
 {
-  StrokeData *stroke = data;
+  graphene_rect_t clip_bounds;
+  GskGpuImage *mask_image;
+  GskRenderNode *child;
 
-  gsk_stroke_to_cairo (&stroke->stroke, cr);
-  gsk_path_to_cairo (stroke->path, cr);
-  gdk_cairo_set_source_rgba (cr, &stroke->color);
-  cairo_stroke (cr);
+  if (!gsk_gpu_node_processor_clip_node_bounds (self, node, &clip_bounds))
+    return;
+
+  child = gsk_fill_node_get_child (node);
+
+  if (gsk_gpu_node_processor_add_cached_path (self,
+                                              node,
+                                              child,
+                                              &clip_bounds,
+                                              gsk_fill_node_get_path (node),
+                                              gsk_fill_node_get_fill_rule (node),
+                                              NULL))
+    return;
+
+  if (gsk_gpu_node_processor_add_path (self,
+                                       node,
+                                       child,
+                                       &clip_bounds,
+                                       gsk_fill_node_get_path (node),
+                                       gsk_fill_node_get_fill_rule (node),
+                                       NULL))
+    return;
+
+  mask_image = gsk_gpu_upload_cairo_op (self->frame,
+                                        &self->scale,
+                                        &clip_bounds,
+                                        gsk_gpu_node_processor_fill_path,
+                                        g_memdup (&(FillData) {
+                                            .path = gsk_path_ref (gsk_fill_node_get_path (node)),
+                                            .color = GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE
+                                                   ? *gsk_color_node_get_color (child)
+                                                   : GDK_RGBA_WHITE,
+                                            .fill_rule = gsk_fill_node_get_fill_rule (node)
+                                        }, sizeof (FillData)),
+                                        (GDestroyNotify) gsk_fill_data_free);
+  g_return_if_fail (mask_image != NULL);
+
+  gsk_gpu_node_processor_add_path_mask (self, node, child, mask_image, &clip_bounds, &clip_bounds);
 }
 
 static void
 gsk_gpu_node_processor_add_stroke_node (GskGpuNodeProcessor *self,
                                         GskRenderNode       *node)
 {
-  graphene_rect_t clip_bounds, source_rect;
-  GskGpuImage *mask_image, *source_image;
-  guint32 descriptors[2];
+  graphene_rect_t clip_bounds;
+  GskGpuImage *mask_image;
   GskRenderNode *child;
 
   if (!gsk_gpu_node_processor_clip_node_bounds (self, node, &clip_bounds))
@@ -3575,6 +4898,24 @@ gsk_gpu_node_processor_add_stroke_node (GskGpuNodeProcessor *self,
 
   child = gsk_stroke_node_get_child (node);
 
+  if (gsk_gpu_node_processor_add_cached_path (self,
+                                              node,
+                                              child,
+                                              &clip_bounds,
+                                              gsk_stroke_node_get_path (node),
+                                              GSK_FILL_RULE_WINDING,
+                                              gsk_stroke_node_get_stroke (node)))
+    return;
+
+  if (gsk_gpu_node_processor_add_path (self,
+                                       node,
+                                       child,
+                                       &clip_bounds,
+                                       gsk_stroke_node_get_path (node),
+                                       GSK_FILL_RULE_WINDING,
+                                       gsk_stroke_node_get_stroke (node)))
+    return;
+
   mask_image = gsk_gpu_upload_cairo_op (self->frame,
                                         &self->scale,
                                         &clip_bounds,
@@ -3588,43 +4929,8 @@ gsk_gpu_node_processor_add_stroke_node (GskGpuNodeProcessor *self,
                                         }, sizeof (StrokeData)),
                                         (GDestroyNotify) gsk_stroke_data_free);
   g_return_if_fail (mask_image != NULL);
-  if (GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE)
-    {
-      gsk_gpu_node_processor_image_op (self,
-                                       mask_image,
-                                       &clip_bounds,
-                                       &clip_bounds);
-      return;
-    }
-
-  source_image = gsk_gpu_node_processor_get_node_as_image (self,
-                                                           0,
-                                                           GSK_GPU_IMAGE_STRAIGHT_ALPHA,
-                                                           &clip_bounds,
-                                                           child,
-                                                           &source_rect);
-  if (source_image == NULL)
-    return;
-
-  gsk_gpu_node_processor_add_images (self,
-                                     2,
-                                     (GskGpuImage *[2]) { source_image, mask_image },
-                                     (GskGpuSampler[2]) { GSK_GPU_SAMPLER_DEFAULT, GSK_GPU_SAMPLER_DEFAULT },
-                                     descriptors);
-
-  gsk_gpu_mask_op (self->frame,
-                   gsk_gpu_clip_get_shader_clip (&self->clip, &self->offset, &node->bounds),
-                   self->desc,
-                   &node->bounds,
-                   &self->offset,
-                   self->opacity,
-                   GSK_MASK_MODE_ALPHA,
-                   descriptors[0],
-                   &source_rect,
-                   descriptors[1],
-                   &clip_bounds);
 
-  g_object_unref (source_image);
+  gsk_gpu_node_processor_add_path_mask (self, node, child, mask_image, &clip_bounds, &clip_bounds);
 }
 
 static void
@@ -3674,12 +4980,219 @@ gsk_gpu_node_processor_create_subsurface_pattern (GskGpuPatternWriter *self,
   return gsk_gpu_node_processor_create_node_pattern (self, gsk_subsurface_node_get_child (node));
 }
 
+/* Returns the number of nodes in @node if they can be recorded on
+ * a worker thread, or 0 if they can't.
+ *
+ * That's the case for nodes that only create ops from the state of
+ * the node processor without looking at the device or descriptors,
+ * and that don't need to change the globals.
+ */
+static gsize
+gsk_gpu_node_count_parallel_nodes (GskRenderNode *node)
+{
+  switch ((guint) gsk_render_node_get_node_type (node))
+    {
+    case GSK_COLOR_NODE:
+    case GSK_BORDER_NODE:
+      return 1;
+
+    case GSK_CONTAINER_NODE:
+      {
+        gsize n_nodes = 1;
+        guint i;
+
+        for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+          {
+            gsize n = gsk_gpu_node_count_parallel_nodes (gsk_container_node_get_child (node, i));
+
+            if (n == 0)
+              return 0;
+
+            n_nodes += n;
+          }
+
+        return n_nodes;
+      }
+
+    default:
+      return 0;
+    }
+}
+
+/* Like gsk_gpu_node_processor_add_node() for nodes that
+ * gsk_gpu_node_count_parallel_nodes() accepted.
+ *
+ * This does not modify @self, so multiple threads can use it at once.
+ */
+static void
+gsk_gpu_node_processor_add_parallel_node (GskGpuNodeProcessor *self,
+                                          GskRenderNode       *node)
+{
+  if (node->bounds.size.width == 0 || node->bounds.size.height == 0)
+    return;
+  if (!gsk_gpu_clip_may_intersect_rect (&self->clip, &self->offset, &node->bounds))
+    return;
+
+  switch ((guint) gsk_render_node_get_node_type (node))
+    {
+    case GSK_COLOR_NODE:
+      gsk_gpu_node_processor_add_color_node (self, node);
+      break;
+
+    case GSK_BORDER_NODE:
+      gsk_gpu_node_processor_add_border_node (self, node);
+      break;
+
+    case GSK_CONTAINER_NODE:
+      for (guint i = 0; i < gsk_container_node_get_n_children (node); i++)
+        gsk_gpu_node_processor_add_parallel_node (self, gsk_container_node_get_child (node, i));
+      break;
+
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+}
+
+typedef struct {
+  GskGpuNodeProcessor *processor;
+  GskRenderNode **children;
+  /* the first child of every chunk, and the end of the last one */
+  const guint *chunks;
+  guint n_chunks;
+  GskGpuFrameArena **arenas;
+  int next_chunk;
+} ParallelRecord;
+
+static void
+gsk_gpu_node_processor_record_chunks_task (gpointer data)
+{
+  ParallelRecord *record = data;
+  guint i, j;
+
+  for (i = g_atomic_int_add (&record->next_chunk, 1);
+       i < record->n_chunks;
+       i = g_atomic_int_add (&record->next_chunk, 1))
+    {
+      GskGpuFrameArena *arena;
+
+      arena = gsk_gpu_frame_arena_begin (record->processor->frame);
+
+      for (j = record->chunks[i]; j < record->chunks[i + 1]; j++)
+        gsk_gpu_node_processor_add_parallel_node (record->processor, record->children[j]);
+
+      gsk_gpu_frame_arena_end (arena);
+
+      record->arenas[i] = arena;
+    }
+}
+
+/* Records the chunks of @children on multiple threads, each into its
+ * own arena, and then adds the arenas to the frame in order, so the
+ * ops end up the same as if they had been recorded one after another.
+ */
+static void
+gsk_gpu_node_processor_add_nodes_parallel (GskGpuNodeProcessor  *self,
+                                           GskRenderNode       **children,
+                                           const guint          *chunks,
+                                           guint                 n_chunks)
+{
+  ParallelRecord record;
+  guint i;
+
+  /* The worker threads can't emit globals ops */
+  gsk_gpu_node_processor_sync_globals (self, 0);
+
+  record.processor = self;
+  record.children = children;
+  record.chunks = chunks;
+  record.n_chunks = n_chunks;
+  record.arenas = g_new (GskGpuFrameArena *, n_chunks);
+  record.next_chunk = 0;
+
+  gdk_parallel_task_run (gsk_gpu_node_processor_record_chunks_task, &record, n_chunks);
+
+  for (i = 0; i < n_chunks; i++)
+    gsk_gpu_frame_append_arena (self->frame, record.arenas[i]);
+
+  g_free (record.arenas);
+}
+
 static void
 gsk_gpu_node_processor_add_container_node (GskGpuNodeProcessor *self,
                                            GskRenderNode       *node)
 {
-  for (guint i = 0; i < gsk_container_node_get_n_children (node); i++)
-    gsk_gpu_node_processor_add_node (self, gsk_container_node_get_child (node, i));
+  GskRenderNode **children;
+  GArray *chunks;
+  guint i, n_children;
+
+  children = gsk_container_node_get_children (node, &n_children);
+
+  if (n_children < PARALLEL_RECORD_MIN_CHILDREN ||
+      self->opacity < 1.0 ||
+      !gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_PARALLEL_RECORD))
+    {
+      for (i = 0; i < n_children; i++)
+        gsk_gpu_node_processor_add_node (self, children[i]);
+      return;
+    }
+
+  chunks = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (i = 0; i < n_children; )
+    {
+      gsize n, n_nodes, chunk_nodes;
+      guint start;
+
+      /* Find the next run of children that can be recorded in parallel
+       * and split it into chunks */
+      start = i;
+      n_nodes = 0;
+      chunk_nodes = 0;
+      g_array_set_size (chunks, 0);
+      g_array_append_val (chunks, start);
+      for (; i < n_children; i++)
+        {
+          n = gsk_gpu_node_count_parallel_nodes (children[i]);
+          if (n == 0)
+            break;
+
+          n_nodes += n;
+          chunk_nodes += n;
+          if (chunk_nodes >= PARALLEL_RECORD_CHUNK_NODES)
+            {
+              guint end = i + 1;
+
+              g_array_append_val (chunks, end);
+              chunk_nodes = 0;
+            }
+        }
+      if (chunk_nodes > 0)
+        g_array_append_val (chunks, i);
+
+      /* A single chunk may be a large container, whose children are
+       * better split up when it gets added */
+      if (n_nodes >= PARALLEL_RECORD_MIN_NODES && chunks->len > 2)
+        {
+          gsk_gpu_node_processor_add_nodes_parallel (self,
+                                                     children,
+                                                     (const guint *) chunks->data,
+                                                     chunks->len - 1);
+        }
+      else
+        {
+          for (; start < i; start++)
+            gsk_gpu_node_processor_add_node (self, children[start]);
+        }
+
+      if (i < n_children)
+        {
+          gsk_gpu_node_processor_add_node (self, children[i]);
+          i++;
+        }
+    }
+
+  g_array_unref (chunks);
 }
 
 static gboolean
@@ -3897,19 +5410,157 @@ static const struct
   },
 };
 
+/* Largest node rendering that gets kept for reuse, in pixels */
+#define MAX_NODE_CACHE_PIXELS (1024 * 1024)
+
+static gboolean
+gsk_gpu_node_is_expensive (GskRenderNode *node)
+{
+  switch ((guint) gsk_render_node_get_node_type (node))
+    {
+    case GSK_BLUR_NODE:
+    case GSK_SHADOW_NODE:
+    case GSK_FILL_NODE:
+    case GSK_STROKE_NODE:
+      return TRUE;
+
+    case GSK_TEXT_NODE:
+      return gsk_text_node_get_num_glyphs (node) >= 256;
+
+    default:
+      return FALSE;
+    }
+}
+
+/*
+ * Expensive nodes that are drawn again in a later frame - because
+ * the widget that created them did not change - are rendered into
+ * an offscreen once, which is then kept in the device and reused
+ * until the node goes away.
+ *
+ * This only works if the node ends up aligned to the same pixel
+ * grid, so it is skipped for transforms other than scale and
+ * translation, and for fractional offsets.
+ *
+ * Returns: %TRUE if the node was drawn
+ */
+static gboolean
+gsk_gpu_node_processor_add_cached_node (GskGpuNodeProcessor *self,
+                                        GskRenderNode       *node)
+{
+  GskGpuDevice *device;
+  GskGpuImage *image;
+  graphene_rect_t bounds;
+  float scale_x, scale_y, x, y;
+  gint64 timestamp;
+  gboolean seen;
+
+  if (!gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_NODE_CACHE) ||
+      self->modelview != NULL ||
+      !gsk_gpu_node_is_expensive (node))
+    return FALSE;
+
+  scale_x = graphene_vec2_get_x (&self->scale);
+  scale_y = graphene_vec2_get_y (&self->scale);
+  x = self->offset.x * scale_x;
+  y = self->offset.y * scale_y;
+  if (x != floorf (x) || y != floorf (y))
+    return FALSE;
+
+  rect_round_to_pixels (&node->bounds, &self->scale, &bounds);
+  if (bounds.size.width * scale_x * bounds.size.height * scale_y > MAX_NODE_CACHE_PIXELS)
+    return FALSE;
+
+  device = gsk_gpu_frame_get_device (self->frame);
+  timestamp = gsk_gpu_frame_get_timestamp (self->frame);
+
+  image = gsk_gpu_device_lookup_node_image (device, node, &self->scale, timestamp, &seen);
+  if (image == NULL)
+    {
+      GskGpuNodeProcessor other;
+      cairo_rectangle_int_t area;
+
+      if (!seen)
+        return FALSE;
+
+      area = (cairo_rectangle_int_t) {
+          0, 0,
+          ceilf (bounds.size.width * scale_x),
+          ceilf (bounds.size.height * scale_y)
+      };
+      image = gsk_gpu_device_acquire_offscreen_image (device,
+                                                      self->frame,
+                                                      FALSE,
+                                                      gsk_render_node_get_preferred_depth (node),
+                                                      area.width, area.height);
+      if (image == NULL)
+        return FALSE;
+
+      gsk_gpu_render_pass_begin_op (self->frame,
+                                    image,
+                                    &area,
+                                    GSK_RENDER_PASS_OFFSCREEN);
+
+      gsk_gpu_node_processor_init (&other,
+                                   self->frame,
+                                   NULL,
+                                   image,
+                                   &area,
+                                   &bounds);
+      gsk_gpu_node_processor_add_node_uncached (&other, node);
+      gsk_gpu_node_processor_finish (&other);
+
+      gsk_gpu_render_pass_end_op (self->frame,
+                                  image,
+                                  GSK_RENDER_PASS_OFFSCREEN);
+
+      gsk_gpu_device_cache_node_image (device, node, &self->scale, timestamp, image);
+    }
+
+  gsk_gpu_node_processor_sync_globals (self, 0);
+  gsk_gpu_node_processor_image_op (self, image, &bounds, &bounds);
+
+  g_object_unref (image);
+
+  return TRUE;
+}
+
 static void
 gsk_gpu_node_processor_add_node (GskGpuNodeProcessor *self,
                                  GskRenderNode       *node)
 {
-  GskRenderNodeType node_type;
-
   /* This catches the corner cases of empty nodes, so after this check
    * there's quaranteed to be at least 1 pixel that needs to be drawn */
   if (node->bounds.size.width == 0 || node->bounds.size.height == 0)
     return;
   if (!gsk_gpu_clip_may_intersect_rect (&self->clip, &self->offset, &node->bounds))
+    {
+      if (self->glyph_prefetch_budget > 0 &&
+          gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_GLYPH_PREFETCH))
+        {
+          graphene_rect_t area;
+
+          graphene_rect_inset_r (&self->clip.rect.bounds,
+                                 - GLYPH_PREFETCH_DISTANCE * self->clip.rect.bounds.size.width,
+                                 - GLYPH_PREFETCH_DISTANCE * self->clip.rect.bounds.size.height,
+                                 &area);
+          gsk_gpu_node_processor_prefetch_glyphs (self, node, &self->offset, &area);
+        }
+      return;
+    }
+
+  if (gsk_gpu_node_processor_add_cached_node (self, node))
     return;
 
+  gsk_gpu_node_processor_add_node_uncached (self, node);
+}
+
+static void
+gsk_gpu_node_processor_add_node_uncached (GskGpuNodeProcessor *self,
+                                          GskRenderNode       *node)
+{
+  GskRenderNodeType node_type;
+
   node_type = gsk_render_node_get_node_type (node);
   if (node_type >= G_N_ELEMENTS (nodes_vtable))
     {
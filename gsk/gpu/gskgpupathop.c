@@ -0,0 +1,91 @@
+#include "config.h"
+
+#include "gskgpupathopprivate.h"
+
+#include "gskgpuframeprivate.h"
+#include "gskgpuprintprivate.h"
+#include "gskgpushaderopprivate.h"
+#include "gskrectprivate.h"
+
+#include "gpu/shaders/gskgpupathinstance.h"
+
+typedef struct _GskGpuPathOp GskGpuPathOp;
+
+struct _GskGpuPathOp
+{
+  GskGpuShaderOp op;
+};
+
+static void
+gsk_gpu_path_op_print (GskGpuOp    *op,
+                       GskGpuFrame *frame,
+                       GString     *string,
+                       guint        indent)
+{
+  GskGpuShaderOp *shader = (GskGpuShaderOp *) op;
+  GskGpuPathInstance *instance;
+
+  instance = (GskGpuPathInstance *) gsk_gpu_frame_get_vertex_data (frame, shader->vertex_offset);
+
+  gsk_gpu_print_op (string, indent, "path");
+  gsk_gpu_print_rect (string, instance->rect);
+  g_string_append_printf (string, "%g %g -> %g %g ",
+                          instance->line[0], instance->line[1],
+                          instance->line[2], instance->line[3]);
+  gsk_gpu_print_newline (string);
+}
+
+static const GskGpuShaderOpClass GSK_GPU_PATH_OP_CLASS = {
+  {
+    GSK_GPU_OP_SIZE (GskGpuPathOp),
+    GSK_GPU_STAGE_SHADER,
+    gsk_gpu_shader_op_finish,
+    gsk_gpu_path_op_print,
+#ifdef GDK_RENDERING_VULKAN
+    gsk_gpu_shader_op_vk_command,
+#endif
+    gsk_gpu_shader_op_gl_command
+  },
+  "gskgpupath",
+  sizeof (GskGpuPathInstance),
+#ifdef GDK_RENDERING_VULKAN
+  &gsk_gpu_path_info,
+#endif
+  gsk_gpu_path_setup_attrib_locations,
+  gsk_gpu_path_setup_vao
+};
+
+/*
+ * gsk_gpu_path_op:
+ * @rect: the area right of the line, up to the right edge of the path
+ * @start: start of the line
+ * @end: end of the line
+ *
+ * Adds the winding contribution of one line of a path. Drawing all
+ * lines of a path with additive blending into a float image results
+ * in the winding number of every pixel, which gsk_gpu_colorize_path_op()
+ * turns into coverage.
+ */
+void
+gsk_gpu_path_op (GskGpuFrame            *frame,
+                 GskGpuShaderClip        clip,
+                 const graphene_rect_t  *rect,
+                 const graphene_point_t *offset,
+                 const graphene_point_t *start,
+                 const graphene_point_t *end)
+{
+  GskGpuPathInstance *instance;
+
+  gsk_gpu_shader_op_alloc (frame,
+                           &GSK_GPU_PATH_OP_CLASS,
+                           0,
+                           clip,
+                           NULL,
+                           rect,
+                           offset,
+                           &instance);
+
+  gsk_gpu_rect_to_float (rect, offset, instance->rect);
+  gsk_gpu_point_to_float (start, offset, &instance->line[0]);
+  gsk_gpu_point_to_float (end, offset, &instance->line[2]);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "gskgputypesprivate.h"
+
+#include <graphene.h>
+
+G_BEGIN_DECLS
+
+void                    gsk_gpu_path_op                                 (GskGpuFrame                    *frame,
+                                                                         GskGpuShaderClip                clip,
+                                                                         const graphene_rect_t          *rect,
+                                                                         const graphene_point_t         *offset,
+                                                                         const graphene_point_t         *start,
+                                                                         const graphene_point_t         *end);
+
+
+G_END_DECLS
+
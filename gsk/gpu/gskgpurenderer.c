@@ -6,6 +6,7 @@
 #include "gskgpudeviceprivate.h"
 #include "gskgpuframeprivate.h"
 #include "gskprivate.h"
+#include "gskprofilerprivate.h"
 #include "gskrendererprivate.h"
 #include "gskrendernodeprivate.h"
 #include "gskgpuimageprivate.h"
@@ -30,6 +31,17 @@ static const GdkDebugKey gsk_gpu_optimization_keys[] = {
   { "blit", GSK_GPU_OPTIMIZE_BLIT, "Use shaders instead of vkCmdBlit()/glBlitFramebuffer()" },
   { "gradients", GSK_GPU_OPTIMIZE_GRADIENTS, "Don't supersample gradients" },
   { "mipmap", GSK_GPU_OPTIMIZE_MIPMAP, "Avoid creating mipmaps" },
+  { "content-cache", GSK_GPU_OPTIMIZE_CONTENT_CACHE, "Don't share uploads between textures with the same contents" },
+  { "node-cache", GSK_GPU_OPTIMIZE_NODE_CACHE, "Don't reuse renderings of expensive nodes from previous frames" },
+  { "region-merge", GSK_GPU_OPTIMIZE_REGION_MERGE, "Record the nodes once for every rectangle of the redraw region" },
+  { "async-upload", GSK_GPU_OPTIMIZE_ASYNC_UPLOAD, "Don't convert textures or render glyphs for upload on worker threads" },
+  { "glyph-prefetch", GSK_GPU_OPTIMIZE_GLYPH_PREFETCH, "Don't render glyphs of text close to the visible area ahead of time" },
+  { "paths", GSK_GPU_OPTIMIZE_PATHS, "Draw fills and strokes with cairo" },
+  { "path-cache", GSK_GPU_OPTIMIZE_PATH_CACHE, "Don't reuse path masks from previous frames" },
+  { "reorder", GSK_GPU_OPTIMIZE_REORDER, "Don't reorder draws so more of them can be merged" },
+  { "blur-downscale", GSK_GPU_OPTIMIZE_BLUR_DOWNSCALE, "Do large blurs at full resolution" },
+  { "offscreen-pool", GSK_GPU_OPTIMIZE_OFFSCREEN_POOL, "Don't reuse offscreen images" },
+  { "parallel-record", GSK_GPU_OPTIMIZE_PARALLEL_RECORD, "Don't record large containers of colors and borders on worker threads" },
 
   { "gl-baseinstance", GSK_GPU_OPTIMIZE_GL_BASE_INSTANCE, "Assume no ARB/EXT_base_instance support" },
 };
@@ -43,6 +55,13 @@ struct _GskGpuRendererPrivate
   GskGpuOptimizations optimizations;
 
   GskGpuFrame *frames[GSK_GPU_MAX_FRAMES];
+
+  GQuark content_cache_hits;
+  GQuark content_cache_misses;
+  GQuark offscreen_pool_hits;
+  GQuark offscreen_pool_misses;
+  GQuark atlas_occupancy;
+  GQuark atlas_evictions;
 };
 
 static void     gsk_gpu_renderer_dmabuf_downloader_init         (GdkDmabufDownloaderInterface   *iface);
@@ -375,6 +394,28 @@ gsk_gpu_renderer_render_texture (GskRenderer           *renderer,
   return texture;
 }
 
+static void
+gsk_gpu_renderer_update_profiler (GskGpuRenderer *self)
+{
+  GskGpuRendererPrivate *priv = gsk_gpu_renderer_get_instance_private (self);
+  GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
+  gsize hits, misses, occupancy, evictions;
+
+  /* The device is shared between renderers, so these are the numbers
+   * for all windows using it */
+  gsk_gpu_device_get_content_cache_stats (priv->device, &hits, &misses);
+  gsk_profiler_counter_set (profiler, priv->content_cache_hits, hits);
+  gsk_profiler_counter_set (profiler, priv->content_cache_misses, misses);
+
+  gsk_gpu_device_get_offscreen_pool_stats (priv->device, &hits, &misses);
+  gsk_profiler_counter_set (profiler, priv->offscreen_pool_hits, hits);
+  gsk_profiler_counter_set (profiler, priv->offscreen_pool_misses, misses);
+
+  gsk_gpu_device_get_atlas_stats (priv->device, &occupancy, &evictions);
+  gsk_profiler_counter_set (profiler, priv->atlas_occupancy, occupancy);
+  gsk_profiler_counter_set (profiler, priv->atlas_evictions, evictions);
+}
+
 static void
 gsk_gpu_renderer_render (GskRenderer          *renderer,
                          GskRenderNode        *root,
@@ -419,6 +460,8 @@ gsk_gpu_renderer_render (GskRenderer          *renderer,
 
   gdk_draw_context_end_frame (priv->context);
 
+  gsk_gpu_renderer_update_profiler (self);
+
   g_clear_pointer (&render_region, cairo_region_destroy);
 }
 
@@ -458,8 +501,34 @@ static void
 gsk_gpu_renderer_init (GskGpuRenderer *self)
 {
   GskGpuRendererPrivate *priv = gsk_gpu_renderer_get_instance_private (self);
+  GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
 
   priv->optimizations = GSK_GPU_RENDERER_GET_CLASS (self)->optimizations;
+
+  priv->content_cache_hits = gsk_profiler_add_counter (profiler,
+                                                       "content-cache-hits",
+                                                       "Texture uploads shared by content",
+                                                       FALSE);
+  priv->content_cache_misses = gsk_profiler_add_counter (profiler,
+                                                         "content-cache-misses",
+                                                         "Texture uploads not found by content",
+                                                         FALSE);
+  priv->offscreen_pool_hits = gsk_profiler_add_counter (profiler,
+                                                        "offscreen-pool-hits",
+                                                        "Offscreens drawn into reused images",
+                                                        FALSE);
+  priv->offscreen_pool_misses = gsk_profiler_add_counter (profiler,
+                                                          "offscreen-pool-misses",
+                                                          "Offscreens that needed a new image",
+                                                          FALSE);
+  priv->atlas_occupancy = gsk_profiler_add_counter (profiler,
+                                                    "atlas-occupancy",
+                                                    "Percentage of atlas space used by live glyphs",
+                                                    FALSE);
+  priv->atlas_evictions = gsk_profiler_add_counter (profiler,
+                                                    "atlas-evictions",
+                                                    "Atlases freed because they were mostly unused",
+                                                    FALSE);
 }
 
 GdkDrawContext *
@@ -346,10 +346,11 @@ gsk_gpu_render_pass_op_offscreen (GskGpuFrame           *frame,
   width = ceil (graphene_vec2_get_x (scale) * viewport->size.width);
   height = ceil (graphene_vec2_get_y (scale) * viewport->size.height);
 
-  image = gsk_gpu_device_create_offscreen_image (gsk_gpu_frame_get_device (frame),
-                                                 FALSE,
-                                                 gsk_render_node_get_preferred_depth (node),
-                                                 width, height);
+  image = gsk_gpu_device_acquire_offscreen_image (gsk_gpu_frame_get_device (frame),
+                                                  frame,
+                                                  FALSE,
+                                                  gsk_render_node_get_preferred_depth (node),
+                                                  width, height);
 
   gsk_gpu_render_pass_begin_op (frame,
                                 image,
@@ -67,6 +67,8 @@ gsk_gpu_rounded_color_op (GskGpuFrame            *frame,
                            0,
                            clip,
                            NULL,
+                           &outline->bounds,
+                           offset,
                            &instance);
 
   gsk_rounded_rect_to_float (outline, offset, instance->outline);
@@ -57,10 +57,7 @@ gsk_gpu_shader_op_vk_command_n (GskGpuOp              *op,
     {
       GskGpuShaderOp *next_shader = (GskGpuShaderOp *) next;
   
-      if (next->op_class != op->op_class ||
-          next_shader->desc != self->desc ||
-          next_shader->variation != self->variation ||
-          next_shader->clip != self->clip ||
+      if (!gsk_gpu_shader_op_can_merge (self, next_shader) ||
           next_shader->vertex_offset != self->vertex_offset + i * shader_op_class->vertex_size)
         break;
 
@@ -143,10 +140,7 @@ gsk_gpu_shader_op_gl_command_n (GskGpuOp          *op,
     {
       GskGpuShaderOp *next_shader = (GskGpuShaderOp *) next;
 
-      if (next->op_class != op->op_class ||
-          next_shader->desc != self->desc ||
-          next_shader->variation != self->variation ||
-          next_shader->clip != self->clip ||
+      if (!gsk_gpu_shader_op_can_merge (self, next_shader) ||
           next_shader->vertex_offset != self->vertex_offset + i * shader_op_class->vertex_size)
         break;
 
@@ -188,6 +182,8 @@ gsk_gpu_shader_op_alloc (GskGpuFrame               *frame,
                          guint32                    variation,
                          GskGpuShaderClip           clip,
                          GskGpuDescriptors         *desc,
+                         const graphene_rect_t     *bounds,
+                         const graphene_point_t    *offset,
                          gpointer                   out_vertex_data)
 {
   GskGpuShaderOp *self;
@@ -200,6 +196,7 @@ gsk_gpu_shader_op_alloc (GskGpuFrame               *frame,
     self->desc = g_object_ref (desc);
   else
     self->desc = NULL;
+  graphene_rect_offset_r (bounds, offset->x, offset->y, &self->bounds);
   self->vertex_offset = gsk_gpu_frame_reserve_vertex_data (frame, op_class->vertex_size);
 
   *((gpointer *) out_vertex_data) = gsk_gpu_frame_get_vertex_data (frame, self->vertex_offset);
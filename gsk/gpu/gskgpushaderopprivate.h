@@ -4,6 +4,8 @@
 
 #include "gskgputypesprivate.h"
 
+#include <graphene.h>
+
 G_BEGIN_DECLS
 
 struct _GskGpuShaderOp
@@ -14,6 +16,8 @@ struct _GskGpuShaderOp
   guint32 variation;
   GskGpuShaderClip clip;
   gsize vertex_offset;
+  /* the area the op may draw to, in the coordinates of its vertex data */
+  graphene_rect_t bounds;
 };
 
 struct _GskGpuShaderOpClass
@@ -34,6 +38,8 @@ GskGpuShaderOp *        gsk_gpu_shader_op_alloc                         (GskGpuF
                                                                          guint32                 variation,
                                                                          GskGpuShaderClip        clip,
                                                                          GskGpuDescriptors      *desc,
+                                                                         const graphene_rect_t  *bounds,
+                                                                         const graphene_point_t *offset,
                                                                          gpointer                out_vertex_data);
 
 void                    gsk_gpu_shader_op_finish                        (GskGpuOp               *op);
@@ -55,6 +61,18 @@ GskGpuOp *              gsk_gpu_shader_op_gl_command                    (GskGpuO
                                                                          GskGpuFrame            *frame,
                                                                          GskGLCommandState      *state);
 
+/* Ops that can be drawn with the same pipeline and descriptors, so they
+ * can be merged into one draw call if their vertex data is adjacent */
+static inline gboolean
+gsk_gpu_shader_op_can_merge (const GskGpuShaderOp *self,
+                             const GskGpuShaderOp *other)
+{
+  return ((GskGpuOp *) self)->op_class == ((GskGpuOp *) other)->op_class &&
+         self->desc == other->desc &&
+         self->variation == other->variation &&
+         self->clip == other->clip;
+}
+
 static inline void
 gsk_gpu_rgba_to_float (const GdkRGBA *rgba,
                        float          values[4])
@@ -65,8 +83,6 @@ gsk_gpu_rgba_to_float (const GdkRGBA *rgba,
   values[3] = rgba->alpha;
 }
 
-#include <graphene.h>
-
 static inline void
 gsk_gpu_point_to_float (const graphene_point_t *point,
                         const graphene_point_t *offset,
@@ -73,6 +73,8 @@ gsk_gpu_straight_alpha_op (GskGpuFrame            *frame,
                            VARIATION_STRAIGHT_ALPHA,
                            clip,
                            desc,
+                           rect,
+                           offset,
                            &instance);
 
   gsk_gpu_rect_to_float (rect, offset, instance->rect);
@@ -68,6 +68,8 @@ gsk_gpu_texture_op (GskGpuFrame            *frame,
                            0,
                            clip,
                            desc,
+                           rect,
+                           offset,
                            &instance);
 
   gsk_gpu_rect_to_float (rect, offset, instance->rect);
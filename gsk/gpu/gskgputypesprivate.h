@@ -117,7 +117,18 @@ typedef enum {
   GSK_GPU_OPTIMIZE_BLIT                 = 1 <<  3,
   GSK_GPU_OPTIMIZE_GRADIENTS            = 1 <<  4,
   GSK_GPU_OPTIMIZE_MIPMAP               = 1 <<  5,
+  GSK_GPU_OPTIMIZE_CONTENT_CACHE        = 1 <<  6,
+  GSK_GPU_OPTIMIZE_NODE_CACHE           = 1 <<  7,
+  GSK_GPU_OPTIMIZE_REGION_MERGE         = 1 <<  8,
+  GSK_GPU_OPTIMIZE_ASYNC_UPLOAD         = 1 <<  9,
+  GSK_GPU_OPTIMIZE_GLYPH_PREFETCH       = 1 << 10,
+  GSK_GPU_OPTIMIZE_PATHS                = 1 << 11,
+  GSK_GPU_OPTIMIZE_PATH_CACHE           = 1 << 12,
+  GSK_GPU_OPTIMIZE_REORDER              = 1 << 13,
+  GSK_GPU_OPTIMIZE_BLUR_DOWNSCALE       = 1 << 14,
+  GSK_GPU_OPTIMIZE_OFFSCREEN_POOL       = 1 << 15,
+  GSK_GPU_OPTIMIZE_PARALLEL_RECORD      = 1 << 16,
   /* These require hardware support */
-  GSK_GPU_OPTIMIZE_GL_BASE_INSTANCE     = 1 <<  6,
+  GSK_GPU_OPTIMIZE_GL_BASE_INSTANCE     = 1 << 17,
 } GskGpuOptimizations;
 
@@ -13,8 +13,14 @@
 #endif
 
 #include "gdk/gdkglcontextprivate.h"
+#include "gdk/gdkmemorytextureprivate.h"
+#include "gdk/gdkparalleltaskprivate.h"
 #include "gsk/gskdebugprivate.h"
 
+/* Textures smaller than this are converted right when the op runs,
+ * handing them to a thread costs more than it saves */
+#define MIN_ASYNC_UPLOAD_PIXELS (128 * 128)
+
 static GskGpuOp *
 gsk_gpu_upload_op_gl_command_with_area (GskGpuOp                    *op,
                                         GskGpuFrame                 *frame,
@@ -205,6 +211,18 @@ gsk_gpu_upload_op_vk_command (GskGpuOp              *op,
 #endif
 
 typedef struct _GskGpuUploadTextureOp GskGpuUploadTextureOp;
+typedef struct _GskGpuAsyncDownload GskGpuAsyncDownload;
+
+/* Memory textures get converted on a worker thread while the rest
+ * of the frame is recorded, so the op only has to copy the result */
+struct _GskGpuAsyncDownload
+{
+  GdkTexture *texture;
+  GdkMemoryFormat format;
+  guchar *data;
+  gsize stride;
+  GdkParallelTask *task;
+};
 
 struct _GskGpuUploadTextureOp
 {
@@ -213,13 +231,60 @@ struct _GskGpuUploadTextureOp
   GskGpuImage *image;
   GskGpuBuffer *buffer;
   GdkTexture *texture;
+  GskGpuAsyncDownload *download;
 };
 
+static void
+gsk_gpu_async_download_run (gpointer data)
+{
+  GskGpuAsyncDownload *download = data;
+  GdkTextureDownloader *downloader;
+
+  downloader = gdk_texture_downloader_new (download->texture);
+  gdk_texture_downloader_set_format (downloader, download->format);
+  gdk_texture_downloader_download_into (downloader, download->data, download->stride);
+  gdk_texture_downloader_free (downloader);
+}
+
+static GskGpuAsyncDownload *
+gsk_gpu_async_download_new (GdkTexture      *texture,
+                            GdkMemoryFormat  format)
+{
+  GskGpuAsyncDownload *download;
+
+  download = g_new (GskGpuAsyncDownload, 1);
+  download->texture = g_object_ref (texture);
+  download->format = format;
+  download->stride = gdk_texture_get_width (texture) * gdk_memory_format_bytes_per_pixel (format);
+  download->data = g_malloc (download->stride * gdk_texture_get_height (texture));
+  download->task = gdk_parallel_task_spawn (gsk_gpu_async_download_run, download);
+
+  return download;
+}
+
+static const guchar *
+gsk_gpu_async_download_wait (GskGpuAsyncDownload *download)
+{
+  g_clear_pointer (&download->task, gdk_parallel_task_join);
+
+  return download->data;
+}
+
+static void
+gsk_gpu_async_download_free (GskGpuAsyncDownload *download)
+{
+  g_clear_pointer (&download->task, gdk_parallel_task_join);
+  g_free (download->data);
+  g_object_unref (download->texture);
+  g_free (download);
+}
+
 static void
 gsk_gpu_upload_texture_op_finish (GskGpuOp *op)
 {
   GskGpuUploadTextureOp *self = (GskGpuUploadTextureOp *) op;
 
+  g_clear_pointer (&self->download, gsk_gpu_async_download_free);
   g_object_unref (self->image);
   g_clear_object (&self->buffer);
   g_object_unref (self->texture);
@@ -246,6 +311,18 @@ gsk_gpu_upload_texture_op_draw (GskGpuOp *op,
   GskGpuUploadTextureOp *self = (GskGpuUploadTextureOp *) op;
   GdkTextureDownloader *downloader;
 
+  if (self->download)
+    {
+      const guchar *src;
+      gsize y;
+
+      src = gsk_gpu_async_download_wait (self->download);
+      for (y = 0; y < gdk_texture_get_height (self->texture); y++)
+        memcpy (data + y * stride, src + y * self->download->stride, self->download->stride);
+
+      return;
+    }
+
   downloader = gdk_texture_downloader_new (self->texture);
   gdk_texture_downloader_set_format (downloader, gsk_gpu_image_get_format (self->image));
   gdk_texture_downloader_download_into (downloader, data, stride);
@@ -333,6 +410,13 @@ gsk_gpu_upload_texture_op_try (GskGpuFrame *frame,
   self->texture = g_object_ref (texture);
   self->image = image;
 
+  if (gsk_gpu_frame_should_optimize (frame, GSK_GPU_OPTIMIZE_ASYNC_UPLOAD) &&
+      GDK_IS_MEMORY_TEXTURE (texture) &&
+      gdk_texture_get_width (texture) * gdk_texture_get_height (texture) >= MIN_ASYNC_UPLOAD_PIXELS)
+    self->download = gsk_gpu_async_download_new (texture, gsk_gpu_image_get_format (image));
+  else
+    self->download = NULL;
+
   return self->image;
 }
 
@@ -476,6 +560,23 @@ gsk_gpu_upload_cairo_op (GskGpuFrame           *frame,
 }
 
 typedef struct _GskGpuUploadGlyphOp GskGpuUploadGlyphOp;
+typedef struct _GskGpuAsyncGlyph GskGpuAsyncGlyph;
+
+/* Glyphs get rendered on a worker thread while the rest of the frame
+ * is recorded. Pango fonts must not be used from other threads, so the
+ * worker only gets the cairo font, which is threadsafe */
+struct _GskGpuAsyncGlyph
+{
+  cairo_scaled_font_t *scaled_font;
+  PangoGlyph glyph;
+  cairo_rectangle_int_t area;
+  float scale;
+  graphene_point_t origin;
+  gsize spread;
+  guchar *data;
+  gsize stride;
+  GdkParallelTask *task;
+};
 
 struct _GskGpuUploadGlyphOp
 {
@@ -487,15 +588,27 @@ struct _GskGpuUploadGlyphOp
   PangoGlyph glyph;
   float scale;
   graphene_point_t origin;
+  gsize spread;
+  GskGpuAsyncGlyph *async;
 
   GskGpuBuffer *buffer;
 };
 
+static void
+gsk_gpu_async_glyph_free (GskGpuAsyncGlyph *async)
+{
+  g_clear_pointer (&async->task, gdk_parallel_task_join);
+  g_free (async->data);
+  cairo_scaled_font_destroy (async->scaled_font);
+  g_free (async);
+}
+
 static void
 gsk_gpu_upload_glyph_op_finish (GskGpuOp *op)
 {
   GskGpuUploadGlyphOp *self = (GskGpuUploadGlyphOp *) op;
 
+  g_clear_pointer (&self->async, gsk_gpu_async_glyph_free);
   g_object_unref (self->image);
   g_object_unref (self->font);
 
@@ -510,42 +623,267 @@ gsk_gpu_upload_glyph_op_print (GskGpuOp    *op,
 {
   GskGpuUploadGlyphOp *self = (GskGpuUploadGlyphOp *) op;
 
-  gsk_gpu_print_op (string, indent, "upload-glyph");
+  gsk_gpu_print_op (string, indent, self->spread ? "upload-sdf-glyph" : "upload-glyph");
   gsk_gpu_print_int_rect (string, &self->area);
   g_string_append_printf (string, "glyph %u @ %g ", self->glyph, self->scale);
   gsk_gpu_print_newline (string);
 }
 
+#define SDF_INF 1e20
+
+/* One pass of the squared euclidean distance transform from
+ * Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled
+ * Functions", over n values of grid that are step apart */
 static void
-gsk_gpu_upload_glyph_op_draw (GskGpuOp *op,
-                              guchar   *data,
-                              gsize     stride)
+gsk_gpu_sdf_transform_1d (double *grid,
+                          gsize   step,
+                          gsize   n,
+                          double *f,
+                          double *z,
+                          gsize  *v)
+{
+  gsize q, r, k;
+  double s;
+
+  v[0] = 0;
+  z[0] = -SDF_INF;
+  z[1] = SDF_INF;
+  f[0] = grid[0];
+
+  for (q = 1, k = 0; q < n; q++)
+    {
+      f[q] = grid[q * step];
+      while (TRUE)
+        {
+          r = v[k];
+          s = (f[q] - f[r] + (double) q * q - (double) r * r) / (2.0 * q - 2.0 * r);
+          /* z[0] is -infinity, so this always stops at k == 0 */
+          if (s > z[k])
+            break;
+          k--;
+        }
+      k++;
+      v[k] = q;
+      z[k] = s;
+      z[k + 1] = SDF_INF;
+    }
+
+  for (q = 0, k = 0; q < n; q++)
+    {
+      while (z[k + 1] < q)
+        k++;
+      r = v[k];
+      grid[q * step] = f[r] + ((double) q - r) * ((double) q - r);
+    }
+}
+
+static void
+gsk_gpu_sdf_transform (double *grid,
+                       gsize   width,
+                       gsize   height)
+{
+  gsize n = MAX (width, height);
+  double *f = g_new (double, n);
+  double *z = g_new (double, n + 1);
+  gsize *v = g_new (gsize, n);
+  gsize x, y;
+
+  for (x = 0; x < width; x++)
+    gsk_gpu_sdf_transform_1d (grid + x, width, height, f, z, v);
+  for (y = 0; y < height; y++)
+    gsk_gpu_sdf_transform_1d (grid + y * width, 1, width, f, z, v);
+
+  g_free (v);
+  g_free (z);
+  g_free (f);
+}
+
+/* Replaces the rendered glyph coverage with its signed distance field,
+ * 0.5 is the outline and values grow towards the inside. Partially
+ * covered pixels are used to place the outline between pixels. */
+static void
+gsk_gpu_sdf_from_coverage (guchar *data,
+                           gsize   width,
+                           gsize   height,
+                           gsize   stride,
+                           gsize   spread)
+{
+  double *outside, *inside;
+  gsize x, y, i;
+
+  outside = g_new (double, width * height);
+  inside = g_new (double, width * height);
+
+  for (y = 0; y < height; y++)
+    {
+      const guint32 *row = (const guint32 *) (data + y * stride);
+
+      for (x = 0; x < width; x++)
+        {
+          double a = (row[x] >> 24) / 255.0;
+
+          i = y * width + x;
+          if (a >= 1.0)
+            {
+              outside[i] = 0;
+              inside[i] = SDF_INF;
+            }
+          else if (a <= 0.0)
+            {
+              outside[i] = SDF_INF;
+              inside[i] = 0;
+            }
+          else
+            {
+              double d = 0.5 - a;
+
+              outside[i] = d > 0 ? d * d : 0;
+              inside[i] = d < 0 ? d * d : 0;
+            }
+        }
+    }
+
+  gsk_gpu_sdf_transform (outside, width, height);
+  gsk_gpu_sdf_transform (inside, width, height);
+
+  for (y = 0; y < height; y++)
+    {
+      guint32 *row = (guint32 *) (data + y * stride);
+
+      for (x = 0; x < width; x++)
+        {
+          double d, value;
+          guint32 c;
+
+          i = y * width + x;
+          d = sqrt (outside[i]) - sqrt (inside[i]);
+          value = CLAMP (0.5 - d / (2.0 * spread), 0.0, 1.0);
+          c = (guint32) (value * 255.0 + 0.5);
+          row[x] = c * 0x01010101u;
+        }
+    }
+
+  g_free (inside);
+  g_free (outside);
+}
+
+static cairo_t *
+gsk_gpu_glyph_cairo_create (guchar                      *data,
+                            gsize                        stride,
+                            const cairo_rectangle_int_t *area,
+                            float                        scale,
+                            const graphene_point_t      *origin)
 {
-  GskGpuUploadGlyphOp *self = (GskGpuUploadGlyphOp *) op;
   cairo_surface_t *surface;
   cairo_t *cr;
 
   surface = cairo_image_surface_create_for_data (data,
                                                  CAIRO_FORMAT_ARGB32,
-                                                 self->area.width,
-                                                 self->area.height,
+                                                 area->width,
+                                                 area->height,
                                                  stride);
-  cairo_surface_set_device_offset (surface, self->origin.x, self->origin.y);
-  cairo_surface_set_device_scale (surface, self->scale, self->scale);
+  cairo_surface_set_device_offset (surface, origin->x, origin->y);
+  cairo_surface_set_device_scale (surface, scale, scale);
 
   cr = cairo_create (surface);
+  cairo_surface_destroy (surface);
+
   cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
   cairo_paint (cr);
   cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
 
   /* Make sure the entire surface is initialized to black */
   cairo_set_source_rgba (cr, 0, 0, 0, 0);
-  cairo_rectangle (cr, 0.0, 0.0, self->area.width, self->area.height);
+  cairo_rectangle (cr, 0.0, 0.0, area->width, area->height);
   cairo_fill (cr);
 
-  /* Draw glyph */
   cairo_set_source_rgba (cr, 1, 1, 1, 1);
 
+  return cr;
+}
+
+static void
+gsk_gpu_glyph_cairo_finish (cairo_t *cr)
+{
+  cairo_surface_finish (cairo_get_target (cr));
+  cairo_destroy (cr);
+}
+
+static void
+gsk_gpu_async_glyph_run (gpointer data)
+{
+  GskGpuAsyncGlyph *async = data;
+  cairo_t *cr;
+
+  cr = gsk_gpu_glyph_cairo_create (async->data, async->stride, &async->area, async->scale, &async->origin);
+
+  cairo_set_scaled_font (cr, async->scaled_font);
+  cairo_show_glyphs (cr, &(cairo_glyph_t) { async->glyph, 0, 0 }, 1);
+
+  gsk_gpu_glyph_cairo_finish (cr);
+
+  if (async->spread)
+    gsk_gpu_sdf_from_coverage (async->data, async->area.width, async->area.height, async->stride, async->spread);
+}
+
+/* Returns NULL if the glyph needs Pango to be drawn */
+static GskGpuAsyncGlyph *
+gsk_gpu_async_glyph_new (PangoFont                   *font,
+                         PangoGlyph                   glyph,
+                         const cairo_rectangle_int_t *area,
+                         float                        scale,
+                         const graphene_point_t      *origin,
+                         gsize                        spread)
+{
+  GskGpuAsyncGlyph *async;
+  cairo_scaled_font_t *scaled_font;
+
+  /* Pango draws hex boxes for these itself */
+  if ((glyph & PANGO_GLYPH_UNKNOWN_FLAG) || glyph == PANGO_GLYPH_EMPTY)
+    return NULL;
+
+  if (!PANGO_IS_CAIRO_FONT (font))
+    return NULL;
+
+  scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
+  if (scaled_font == NULL || cairo_scaled_font_status (scaled_font) != CAIRO_STATUS_SUCCESS)
+    return NULL;
+
+  async = g_new (GskGpuAsyncGlyph, 1);
+  async->scaled_font = cairo_scaled_font_reference (scaled_font);
+  async->glyph = glyph;
+  async->area = *area;
+  async->scale = scale;
+  async->origin = *origin;
+  async->spread = spread;
+  async->stride = area->width * 4;
+  async->data = g_malloc (async->stride * area->height);
+  async->task = gdk_parallel_task_spawn (gsk_gpu_async_glyph_run, async);
+
+  return async;
+}
+
+static void
+gsk_gpu_upload_glyph_op_draw (GskGpuOp *op,
+                              guchar   *data,
+                              gsize     stride)
+{
+  GskGpuUploadGlyphOp *self = (GskGpuUploadGlyphOp *) op;
+  cairo_t *cr;
+
+  if (self->async)
+    {
+      gsize y;
+
+      g_clear_pointer (&self->async->task, gdk_parallel_task_join);
+      for (y = 0; y < self->area.height; y++)
+        memcpy (data + y * stride, self->async->data + y * self->async->stride, self->async->stride);
+
+      return;
+    }
+
+  cr = gsk_gpu_glyph_cairo_create (data, stride, &self->area, self->scale, &self->origin);
+
   pango_cairo_show_glyph_string (cr,
                                  self->font,
                                  &(PangoGlyphString) {
@@ -555,27 +893,112 @@ gsk_gpu_upload_glyph_op_draw (GskGpuOp *op,
                                      } }
                                  });
 
-  cairo_destroy (cr);
+  gsk_gpu_glyph_cairo_finish (cr);
 
-  cairo_surface_finish (surface);
-  cairo_surface_destroy (surface);
+  if (self->spread)
+    gsk_gpu_sdf_from_coverage (data, self->area.width, self->area.height, stride, self->spread);
 }
 
 #ifdef GDK_RENDERING_VULKAN
+/* Glyphs for the same atlas end up next to each other in the upload
+ * stage, so all of them get copied from one buffer in one command */
 static GskGpuOp *
 gsk_gpu_upload_glyph_op_vk_command (GskGpuOp              *op,
                                     GskGpuFrame           *frame,
                                     GskVulkanCommandState *state)
 {
   GskGpuUploadGlyphOp *self = (GskGpuUploadGlyphOp *) op;
+  GskVulkanImage *image = GSK_VULKAN_IMAGE (self->image);
+  VkBufferImageCopy *regions;
+  GskGpuOp *next;
+  gsize bpp, size, offset, n_regions, i;
+  guchar *data;
 
-  return gsk_gpu_upload_op_vk_command_with_area (op,
-                                                 frame,
-                                                 state,
-                                                 GSK_VULKAN_IMAGE (self->image),
-                                                 &self->area,
-                                                 gsk_gpu_upload_glyph_op_draw,
-                                                 &self->buffer);
+  bpp = gdk_memory_format_bytes_per_pixel (gsk_gpu_image_get_format (self->image));
+  size = 0;
+  n_regions = 0;
+  for (next = op;
+       next && next->op_class == op->op_class && ((GskGpuUploadGlyphOp *) next)->image == self->image;
+       next = next->next)
+    {
+      GskGpuUploadGlyphOp *glyph = (GskGpuUploadGlyphOp *) next;
+
+      size += glyph->area.width * glyph->area.height * bpp;
+      n_regions++;
+    }
+
+  self->buffer = gsk_vulkan_buffer_new_write (GSK_VULKAN_DEVICE (gsk_gpu_frame_get_device (frame)), size);
+  data = gsk_gpu_buffer_map (self->buffer);
+  regions = g_new (VkBufferImageCopy, n_regions);
+
+  offset = 0;
+  for (next = op, i = 0; i < n_regions; next = next->next, i++)
+    {
+      GskGpuUploadGlyphOp *glyph = (GskGpuUploadGlyphOp *) next;
+      gsize stride = glyph->area.width * bpp;
+
+      gsk_gpu_upload_glyph_op_draw (next, data + offset, stride);
+
+      regions[i] = (VkBufferImageCopy) {
+          .bufferOffset = offset,
+          .bufferRowLength = glyph->area.width,
+          .bufferImageHeight = glyph->area.height,
+          .imageSubresource = {
+              .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+              .mipLevel = 0,
+              .baseArrayLayer = 0,
+              .layerCount = 1
+          },
+          .imageOffset = {
+              .x = glyph->area.x,
+              .y = glyph->area.y,
+              .z = 0
+          },
+          .imageExtent = {
+              .width = glyph->area.width,
+              .height = glyph->area.height,
+              .depth = 1
+          }
+      };
+
+      offset += glyph->area.height * stride;
+    }
+
+  gsk_gpu_buffer_unmap (self->buffer);
+
+  vkCmdPipelineBarrier (state->vk_command_buffer,
+                        VK_PIPELINE_STAGE_HOST_BIT,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        0,
+                        0, NULL,
+                        1, &(VkBufferMemoryBarrier) {
+                            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                            .srcAccessMask = VK_ACCESS_HOST_WRITE_BIT,
+                            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+                            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                            .buffer = gsk_vulkan_buffer_get_vk_buffer (GSK_VULKAN_BUFFER (self->buffer)),
+                            .offset = 0,
+                            .size = VK_WHOLE_SIZE,
+                        },
+                        0, NULL);
+  gsk_vulkan_image_transition (image,
+                               state->semaphores,
+                               state->vk_command_buffer,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               VK_ACCESS_TRANSFER_WRITE_BIT);
+
+  vkCmdCopyBufferToImage (state->vk_command_buffer,
+                          gsk_vulkan_buffer_get_vk_buffer (GSK_VULKAN_BUFFER (self->buffer)),
+                          gsk_vulkan_image_get_vk_image (image),
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                          n_regions,
+                          regions);
+
+  g_free (regions);
+
+  return next;
 }
 #endif
 
@@ -604,14 +1027,15 @@ static const GskGpuOpClass GSK_GPU_UPLOAD_GLYPH_OP_CLASS = {
   gsk_gpu_upload_glyph_op_gl_command,
 };
 
-void
-gsk_gpu_upload_glyph_op (GskGpuFrame                 *frame,
-                         GskGpuImage                 *image,
-                         PangoFont                   *font,
-                         const PangoGlyph             glyph,
-                         const cairo_rectangle_int_t *area,
-                         float                        scale,
-                         const graphene_point_t      *origin)
+static void
+gsk_gpu_upload_glyph_op_full (GskGpuFrame                 *frame,
+                              GskGpuImage                 *image,
+                              PangoFont                   *font,
+                              const PangoGlyph             glyph,
+                              const cairo_rectangle_int_t *area,
+                              float                        scale,
+                              const graphene_point_t      *origin,
+                              gsize                        spread)
 {
   GskGpuUploadGlyphOp *self;
 
@@ -623,4 +1047,46 @@ gsk_gpu_upload_glyph_op (GskGpuFrame                 *frame,
   self->glyph = glyph;
   self->scale = scale;
   self->origin = *origin;
+  self->spread = spread;
+
+  if (gsk_gpu_frame_should_optimize (frame, GSK_GPU_OPTIMIZE_ASYNC_UPLOAD))
+    self->async = gsk_gpu_async_glyph_new (font, glyph, area, scale, origin, spread);
+  else
+    self->async = NULL;
+}
+
+void
+gsk_gpu_upload_glyph_op (GskGpuFrame                 *frame,
+                         GskGpuImage                 *image,
+                         PangoFont                   *font,
+                         const PangoGlyph             glyph,
+                         const cairo_rectangle_int_t *area,
+                         float                        scale,
+                         const graphene_point_t      *origin)
+{
+  gsk_gpu_upload_glyph_op_full (frame, image, font, glyph, area, scale, origin, 0);
+}
+
+/*
+ * gsk_gpu_upload_sdf_glyph_op:
+ * @spread: the distance in pixels at which the field saturates
+ *
+ * Like gsk_gpu_upload_glyph_op(), but uploads the signed distance
+ * field of the glyph, for drawing with gsk_gpu_colorize_sdf_op().
+ *
+ * @area must leave room for @spread pixels around the glyph.
+ */
+void
+gsk_gpu_upload_sdf_glyph_op (GskGpuFrame                 *frame,
+                             GskGpuImage                 *image,
+                             PangoFont                   *font,
+                             const PangoGlyph             glyph,
+                             const cairo_rectangle_int_t *area,
+                             float                        scale,
+                             const graphene_point_t      *origin,
+                             gsize                        spread)
+{
+  g_assert (spread > 0);
+
+  gsk_gpu_upload_glyph_op_full (frame, image, font, glyph, area, scale, origin, spread);
 }
@@ -27,6 +27,14 @@ void                    gsk_gpu_upload_glyph_op                         (GskGpuF
                                                                          const cairo_rectangle_int_t    *area,
                                                                          float                           scale,
                                                                          const graphene_point_t         *origin);
+void                    gsk_gpu_upload_sdf_glyph_op                     (GskGpuFrame                    *frame,
+                                                                         GskGpuImage                    *image,
+                                                                         PangoFont                      *font,
+                                                                         PangoGlyph                      glyph,
+                                                                         const cairo_rectangle_int_t    *area,
+                                                                         float                           scale,
+                                                                         const graphene_point_t         *origin,
+                                                                         gsize                           spread);
 
 G_END_DECLS
 
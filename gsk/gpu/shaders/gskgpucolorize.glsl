@@ -1,5 +1,9 @@
 #include "common.glsl"
 
+#define VARIATION_SDF ((GSK_VARIATION & 1u) == 1u)
+#define VARIATION_WINDING ((GSK_VARIATION & 2u) == 2u)
+#define VARIATION_EVEN_ODD ((GSK_VARIATION & 4u) == 4u)
+
 PASS(0) vec2 _pos;
 PASS_FLAT(1) Rect _rect;
 PASS_FLAT(2) vec4 _color;
@@ -39,7 +43,25 @@ void
 run (out vec4 color,
      out vec2 position)
 {
-  float alpha = gsk_texture (_tex_id, _tex_coord).a * rect_coverage (_rect, _pos);
+  float alpha = gsk_texture (_tex_id, _tex_coord).a;
+
+  if (VARIATION_SDF)
+    {
+      /* 0.5 is the outline, blend over one pixel around it */
+      float width = 0.5 * fwidth (alpha);
+      alpha = smoothstep (0.5 - width, 0.5 + width, alpha);
+    }
+  else if (VARIATION_WINDING)
+    {
+      /* The texture contains winding numbers */
+      alpha = min (abs (alpha), 1.0);
+    }
+  else if (VARIATION_EVEN_ODD)
+    {
+      alpha = 1.0 - abs (1.0 - mod (abs (alpha), 2.0));
+    }
+
+  alpha *= rect_coverage (_rect, _pos);
   color = _color * alpha;
   position = _pos;
 }
@@ -0,0 +1,90 @@
+#include "common.glsl"
+
+PASS(0) vec2 _pos;
+PASS_FLAT(1) vec4 _line;
+
+
+
+#ifdef GSK_VERTEX_SHADER
+
+IN(0) vec4 in_rect;
+IN(1) vec4 in_line;
+
+void
+run (out vec2 pos)
+{
+  Rect r = rect_from_gsk (in_rect);
+
+  pos = rect_get_position (r);
+
+  _pos = pos;
+  _line = in_line * GSK_GLOBAL_SCALE.xyxy;
+}
+
+#endif
+
+
+
+#ifdef GSK_FRAGMENT_SHADER
+
+/* The integral of clamp (u, 0, 1) */
+float
+coverage_integral (float u)
+{
+  if (u <= 0.0)
+    return 0.0;
+  else if (u >= 1.0)
+    return u - 0.5;
+  else
+    return 0.5 * u * u;
+}
+
+/* Computes the part of the pixel that is right of the line, signed by
+ * the direction of the line. Summing this up for all lines of a path
+ * gives the winding number, with fractions at the edges. */
+void
+run (out vec4 color,
+     out vec2 position)
+{
+  vec2 top, bottom;
+  float dir, y0, y1, coverage;
+
+  if (_line.y < _line.w)
+    {
+      top = _line.xy;
+      bottom = _line.zw;
+      dir = 1.0;
+    }
+  else
+    {
+      top = _line.zw;
+      bottom = _line.xy;
+      dir = -1.0;
+    }
+
+  y0 = max (top.y, _pos.y - 0.5);
+  y1 = min (bottom.y, _pos.y + 0.5);
+
+  if (y1 > y0)
+    {
+      float x0 = mix (top.x, bottom.x, (y0 - top.y) / (bottom.y - top.y));
+      float x1 = mix (top.x, bottom.x, (y1 - top.y) / (bottom.y - top.y));
+      float u0 = _pos.x + 0.5 - x0;
+      float u1 = _pos.x + 0.5 - x1;
+      float average;
+
+      if (abs (u1 - u0) < 1.0 / 1024.0)
+        average = clamp (0.5 * (u0 + u1), 0.0, 1.0);
+      else
+        average = (coverage_integral (u1) - coverage_integral (u0)) / (u1 - u0);
+
+      coverage = dir * average * (y1 - y0);
+    }
+  else
+    coverage = 0.0;
+
+  color = vec4 (coverage);
+  position = _pos;
+}
+
+#endif
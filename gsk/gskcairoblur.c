@@ -22,6 +22,8 @@
 
 #include "gskcairoblurprivate.h"
 
+#include "gskrendernodeprivate.h"
+
 #include <math.h>
 #include <string.h>
 
@@ -343,6 +345,7 @@ gsk_cairo_blur_start_drawing (cairo_t         *cr,
 
   blur_cr = cairo_create (surface);
   cairo_set_user_data (blur_cr, &original_cr_key, cairo_reference (cr), (cairo_destroy_func_t) cairo_destroy);
+  gsk_cairo_set_texture_surfaces (blur_cr, gsk_cairo_get_texture_surfaces (cr));
 
   if (cairo_has_current_point (cr))
     {
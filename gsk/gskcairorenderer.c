@@ -25,8 +25,12 @@
 #include "gskdebugprivate.h"
 #include "gskrendererprivate.h"
 #include "gskrendernodeprivate.h"
+#include "gdk/gdkparalleltaskprivate.h"
 #include "gdk/gdktextureprivate.h"
 
+/* in device pixels */
+#define DEFAULT_TILE_SIZE 256
+
 typedef struct {
   GQuark cpu_time;
   GQuark gpu_time;
@@ -48,6 +52,34 @@ struct _GskCairoRendererClass
 
 G_DEFINE_TYPE (GskCairoRenderer, gsk_cairo_renderer, GSK_TYPE_RENDERER)
 
+/* GSK_CAIRO_TILE_SIZE allows the testsuite to split even small
+ * renderings into many tiles */
+static int
+gsk_cairo_renderer_get_tile_size (void)
+{
+  static gsize tile_size = 0;
+
+  if (g_once_init_enter (&tile_size))
+    {
+      const char *env = g_getenv ("GSK_CAIRO_TILE_SIZE");
+      gsize size = DEFAULT_TILE_SIZE;
+
+      if (env != NULL)
+        {
+          guint64 value = g_ascii_strtoull (env, NULL, 10);
+
+          if (value > 0 && value <= 4096)
+            size = value;
+          else
+            g_warning ("Invalid GSK_CAIRO_TILE_SIZE \"%s\", using %d", env, DEFAULT_TILE_SIZE);
+        }
+
+      g_once_init_leave (&tile_size, size);
+    }
+
+  return tile_size;
+}
+
 static gboolean
 gsk_cairo_renderer_realize (GskRenderer  *renderer,
                             GdkDisplay   *display,
@@ -70,19 +102,284 @@ gsk_cairo_renderer_unrealize (GskRenderer *renderer)
   g_clear_object (&self->cairo_context);
 }
 
+/* Textures that need to be downloaded on the main thread (GL and dmabuf
+ * textures) and Cairo nodes (whose recording surfaces cannot be replayed from
+ * multiple threads at once) prevent drawing in tiles.
+ *
+ * Every tile draws the whole tree, so the textures get collected into
+ * @textures, to be downloaded only once for all tiles.
+ */
+static gboolean
+gsk_cairo_renderer_can_draw_texture_in_tiles (GdkTexture *texture,
+                                              GHashTable *textures)
+{
+  if (GDK_IS_GL_TEXTURE (texture) || GDK_IS_DMABUF_TEXTURE (texture))
+    return FALSE;
+
+  g_hash_table_insert (textures, texture, NULL);
+
+  return TRUE;
+}
+
+static gboolean
+gsk_cairo_renderer_can_draw_in_tiles (GskRenderNode *node,
+                                      GHashTable    *textures)
+{
+  guint i;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CAIRO_NODE:
+      return FALSE;
+
+    case GSK_TEXTURE_NODE:
+      return gsk_cairo_renderer_can_draw_texture_in_tiles (gsk_texture_node_get_texture (node), textures);
+
+    case GSK_TEXTURE_SCALE_NODE:
+      return gsk_cairo_renderer_can_draw_texture_in_tiles (gsk_texture_scale_node_get_texture (node), textures);
+
+    case GSK_CONTAINER_NODE:
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        {
+          if (!gsk_cairo_renderer_can_draw_in_tiles (gsk_container_node_get_child (node, i), textures))
+            return FALSE;
+        }
+      return TRUE;
+
+    case GSK_TRANSFORM_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_transform_node_get_child (node), textures);
+
+    case GSK_OPACITY_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_opacity_node_get_child (node), textures);
+
+    case GSK_COLOR_MATRIX_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_color_matrix_node_get_child (node), textures);
+
+    case GSK_REPEAT_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_repeat_node_get_child (node), textures);
+
+    case GSK_CLIP_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_clip_node_get_child (node), textures);
+
+    case GSK_ROUNDED_CLIP_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_rounded_clip_node_get_child (node), textures);
+
+    case GSK_SHADOW_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_shadow_node_get_child (node), textures);
+
+    case GSK_BLUR_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_blur_node_get_child (node), textures);
+
+    case GSK_DEBUG_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_debug_node_get_child (node), textures);
+
+    case GSK_FILL_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_fill_node_get_child (node), textures);
+
+    case GSK_STROKE_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_stroke_node_get_child (node), textures);
+
+    case GSK_SUBSURFACE_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_subsurface_node_get_child (node), textures);
+
+    case GSK_BLEND_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_blend_node_get_bottom_child (node), textures) &&
+             gsk_cairo_renderer_can_draw_in_tiles (gsk_blend_node_get_top_child (node), textures);
+
+    case GSK_CROSS_FADE_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_cross_fade_node_get_start_child (node), textures) &&
+             gsk_cairo_renderer_can_draw_in_tiles (gsk_cross_fade_node_get_end_child (node), textures);
+
+    case GSK_MASK_NODE:
+      return gsk_cairo_renderer_can_draw_in_tiles (gsk_mask_node_get_source (node), textures) &&
+             gsk_cairo_renderer_can_draw_in_tiles (gsk_mask_node_get_mask (node), textures);
+
+    case GSK_TEXT_NODE:
+      /* Drawing through pango is not threadsafe */
+      return gsk_text_node_prepare_threaded_draw (node);
+
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_CONIC_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    case GSK_GL_SHADER_NODE:
+    default:
+      return TRUE;
+    }
+}
+
+typedef struct {
+  GskRenderNode *root;
+  const cairo_region_t *region;
+  double scale_x;
+  double scale_y;
+  /* the surfaces of the textures in the tree */
+  GHashTable *textures;
+  /* the tile rectangles in user space of the target */
+  graphene_rect_t *tiles;
+  cairo_surface_t **surfaces;
+  guint n_tiles;
+  int next_tile;
+} TileDraw;
+
 static void
-gsk_cairo_renderer_do_render (GskRenderer   *renderer,
-                              cairo_t       *cr,
-                              GskRenderNode *root)
+gsk_cairo_renderer_draw_tiles_task (gpointer data)
+{
+  TileDraw *draw = data;
+  guint i;
+
+  for (i = g_atomic_int_add (&draw->next_tile, 1);
+       i < draw->n_tiles;
+       i = g_atomic_int_add (&draw->next_tile, 1))
+    {
+      const graphene_rect_t *tile = &draw->tiles[i];
+      cairo_surface_t *surface;
+      cairo_t *cr;
+
+      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                            round (tile->size.width * draw->scale_x),
+                                            round (tile->size.height * draw->scale_y));
+      cairo_surface_set_device_scale (surface, draw->scale_x, draw->scale_y);
+
+      cr = cairo_create (surface);
+      cairo_translate (cr, - tile->origin.x, - tile->origin.y);
+      gdk_cairo_region (cr, draw->region);
+      cairo_clip (cr);
+      gsk_cairo_set_texture_surfaces (cr, draw->textures);
+
+      gsk_render_node_draw (draw->root, cr);
+
+      cairo_destroy (cr);
+
+      draw->surfaces[i] = surface;
+    }
+}
+
+/* Splits the region into tiles, draws the tiles on multiple threads
+ * into image surfaces and then composites them onto @cr.
+ *
+ * This only works if @cr maps to the device with a pixel-aligned
+ * translation, otherwise it returns %FALSE and nothing is drawn.
+ */
+static gboolean
+gsk_cairo_renderer_draw_tiles (cairo_t              *cr,
+                               GskRenderNode        *root,
+                               const cairo_region_t *region,
+                               GHashTable           *textures)
+{
+  cairo_rectangle_int_t extents;
+  cairo_matrix_t ctm;
+  TileDraw draw;
+  double tx, ty;
+  int tile_size, x0, y0, x1, y1, x, y;
+  guint i;
+
+  cairo_get_matrix (cr, &ctm);
+  if (ctm.xx != 1 || ctm.yy != 1 || ctm.xy != 0 || ctm.yx != 0)
+    return FALSE;
+
+  cairo_surface_get_device_scale (cairo_get_target (cr), &draw.scale_x, &draw.scale_y);
+  tx = ctm.x0 * draw.scale_x;
+  ty = ctm.y0 * draw.scale_y;
+  if (tx != floor (tx) || ty != floor (ty))
+    return FALSE;
+
+  cairo_region_get_extents (region, &extents);
+  x0 = floor ((extents.x + ctm.x0) * draw.scale_x);
+  y0 = floor ((extents.y + ctm.y0) * draw.scale_y);
+  x1 = ceil ((extents.x + extents.width + ctm.x0) * draw.scale_x);
+  y1 = ceil ((extents.y + extents.height + ctm.y0) * draw.scale_y);
+
+  tile_size = gsk_cairo_renderer_get_tile_size ();
+
+  draw.root = root;
+  draw.region = region;
+  draw.textures = textures;
+  draw.tiles = g_new (graphene_rect_t, ((x1 - x0 + tile_size - 1) / tile_size) * ((y1 - y0 + tile_size - 1) / tile_size));
+  draw.n_tiles = 0;
+  draw.next_tile = 0;
+
+  for (y = y0; y < y1; y += tile_size)
+    {
+      for (x = x0; x < x1; x += tile_size)
+        {
+          graphene_rect_t tile;
+          cairo_rectangle_int_t int_tile;
+
+          graphene_rect_init (&tile,
+                              x / draw.scale_x - ctm.x0,
+                              y / draw.scale_y - ctm.y0,
+                              MIN (tile_size, x1 - x) / draw.scale_x,
+                              MIN (tile_size, y1 - y) / draw.scale_y);
+          int_tile.x = floor (tile.origin.x);
+          int_tile.y = floor (tile.origin.y);
+          int_tile.width = ceil (tile.origin.x + tile.size.width) - int_tile.x;
+          int_tile.height = ceil (tile.origin.y + tile.size.height) - int_tile.y;
+          if (cairo_region_contains_rectangle (region, &int_tile) == CAIRO_REGION_OVERLAP_OUT)
+            continue;
+
+          draw.tiles[draw.n_tiles++] = tile;
+        }
+    }
+
+  draw.surfaces = g_new0 (cairo_surface_t *, draw.n_tiles);
+
+  gsk_cairo_download_textures (textures);
+
+  gdk_parallel_task_run (gsk_cairo_renderer_draw_tiles_task, &draw, draw.n_tiles);
+
+  cairo_save (cr);
+  for (i = 0; i < draw.n_tiles; i++)
+    {
+      const graphene_rect_t *tile = &draw.tiles[i];
+
+      cairo_set_source_surface (cr, draw.surfaces[i], tile->origin.x, tile->origin.y);
+      cairo_rectangle (cr,
+                       tile->origin.x, tile->origin.y,
+                       tile->size.width, tile->size.height);
+      cairo_fill (cr);
+      cairo_surface_destroy (draw.surfaces[i]);
+    }
+  cairo_restore (cr);
+
+  g_free (draw.surfaces);
+  g_free (draw.tiles);
+
+  return TRUE;
+}
+
+static void
+gsk_cairo_renderer_do_render (GskRenderer          *renderer,
+                              cairo_t              *cr,
+                              GskRenderNode        *root,
+                              const cairo_region_t *region)
 {
   GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
   GskProfiler *profiler;
+  gboolean drawn = FALSE;
   gint64 cpu_time;
 
   profiler = gsk_renderer_get_profiler (renderer);
   gsk_profiler_timer_begin (profiler, self->profile_timers.cpu_time);
 
-  gsk_render_node_draw (root, cr);
+  if (GSK_RENDERER_DEBUG_CHECK (renderer, CAIRO_TILES))
+    {
+      GHashTable *textures;
+
+      textures = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) cairo_surface_destroy);
+      drawn = gsk_cairo_renderer_can_draw_in_tiles (root, textures) &&
+              gsk_cairo_renderer_draw_tiles (cr, root, region, textures);
+      g_hash_table_unref (textures);
+    }
+
+  if (!drawn)
+    gsk_render_node_draw (root, cr);
 
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
@@ -97,6 +394,7 @@ gsk_cairo_renderer_render_texture (GskRenderer           *renderer,
 {
   GdkTexture *texture;
   cairo_surface_t *surface;
+  cairo_region_t *region;
   cairo_t *cr;
   int width, height;
   /* limit from cairo's source code */
@@ -140,7 +438,14 @@ gsk_cairo_renderer_render_texture (GskRenderer           *renderer,
 
   cairo_translate (cr, - viewport->origin.x, - viewport->origin.y);
 
-  gsk_cairo_renderer_do_render (renderer, cr, root);
+  region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+                                            floor (viewport->origin.x),
+                                            floor (viewport->origin.y),
+                                            ceil (viewport->origin.x + width) - floor (viewport->origin.x),
+                                            ceil (viewport->origin.y + height) - floor (viewport->origin.y)
+                                          });
+  gsk_cairo_renderer_do_render (renderer, cr, root, region);
+  cairo_region_destroy (region);
 
   cairo_destroy (cr);
 
@@ -178,7 +483,8 @@ gsk_cairo_renderer_render (GskRenderer          *renderer,
       cairo_restore (cr);
     }
 
-  gsk_cairo_renderer_do_render (renderer, cr, root);
+  gsk_cairo_renderer_do_render (renderer, cr, root,
+                                gdk_draw_context_get_frame_region (GDK_DRAW_CONTEXT (self->cairo_context)));
 
   cairo_destroy (cr);
 
@@ -18,6 +18,8 @@ static const GdkDebugKey gsk_debug_keys[] = {
   { "staging", GSK_DEBUG_STAGING, "Use a staging image for texture upload (Vulkan only)" },
   { "offload-disable", GSK_DEBUG_OFFLOAD_DISABLE, "Disable graphics offload" },
   { "cairo", GSK_DEBUG_CAIRO, "Overlay error pattern over Cairo drawing (finds fallbacks)" },
+  { "cairo-tiles", GSK_DEBUG_CAIRO_TILES, "Draw in tiles on multiple threads (when using cairo)" },
+  { "sdf-glyphs", GSK_DEBUG_SDF_GLYPHS, "Draw large text from distance fields (when using ngl or vulkan)" },
 };
 
 static guint gsk_debug_flags;
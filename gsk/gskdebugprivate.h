@@ -21,6 +21,8 @@ typedef enum {
   GSK_DEBUG_STAGING               = 1 << 11,
   GSK_DEBUG_OFFLOAD_DISABLE       = 1 << 12,
   GSK_DEBUG_CAIRO                 = 1 << 13,
+  GSK_DEBUG_CAIRO_TILES           = 1 << 14,
+  GSK_DEBUG_SDF_GLYPHS            = 1 << 15,
 } GskDebugFlags;
 
 #define GSK_DEBUG_ANY ((1 << 13) - 1)
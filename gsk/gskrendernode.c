@@ -40,6 +40,7 @@
 
 #include "gskdebugprivate.h"
 #include "gskrendererprivate.h"
+#include "gskrendernodebinaryprivate.h"
 #include "gskrendernodeparserprivate.h"
 
 #include <graphene-gobject.h>
@@ -621,9 +622,11 @@ gsk_render_node_write_to_file (GskRenderNode *node,
  * @error_func: (nullable) (scope call): Callback on parsing errors
  * @user_data: (closure error_func): user_data for @error_func
  *
- * Loads data previously created via [method@Gsk.RenderNode.serialize].
+ * Loads data previously created via [method@Gsk.RenderNode.serialize]
+ * or [method@Gsk.RenderNode.serialize_binary].
  *
- * For a discussion of the supported format, see that function.
+ * The format is detected automatically. For a discussion of the
+ * supported formats, see those functions.
  *
  * Returns: (nullable) (transfer full): a new `GskRenderNode`
  */
@@ -634,7 +637,10 @@ gsk_render_node_deserialize (GBytes            *bytes,
 {
   GskRenderNode *node = NULL;
 
-  node = gsk_render_node_deserialize_from_bytes (bytes, error_func, user_data);
+  if (gsk_render_node_bytes_are_binary (bytes))
+    node = gsk_render_node_deserialize_binary (bytes, error_func, user_data);
+  else
+    node = gsk_render_node_deserialize_from_bytes (bytes, error_func, user_data);
 
   return node;
 }
@@ -0,0 +1,1842 @@
+/*
+ * Copyright © 2024 the GTK team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskrendernodebinaryprivate.h"
+
+#include "gskenumtypes.h"
+#include "gskpath.h"
+#include "gskrendernodeprivate.h"
+#include "gskstroke.h"
+#include "gsktransform.h"
+
+#include "gdk/gdkmemoryformatprivate.h"
+#include "gdk/gdktextureprivate.h"
+#include <gtk/css/gtkcss.h>
+
+#include <math.h>
+#include <string.h>
+
+/* The binary format is meant to be loaded quickly, ideally straight
+ * from a mapped file. All values are little endian and 4-byte aligned.
+ *
+ *   header:    magic, version, n_strings, n_textures, n_nodes
+ *   strings:   n_strings × { u32 length, length bytes, NUL, padding }
+ *   textures:  n_textures × { u32 width, height, format, stride,
+ *                             u64 offset, u64 size }
+ *   nodes:     n_nodes × { u32 type, u32 size, size bytes }
+ *   pixels:    the texture data, every texture aligned to 16 bytes
+ *
+ * Nodes refer to strings, textures and other nodes by their index.
+ * Child nodes are always written before their parents, so that nodes
+ * can be created in order, and the last node is the root. Nodes that
+ * occur multiple times in the tree are only written once.
+ *
+ * Texture data is stored in the texture's own memory format, so that
+ * loading a texture does not need any conversion and does not copy
+ * the data out of the mapped file.
+ */
+
+static const char magic[8] = { 'G', 'S', 'K', 'B', 'N', 'O', 'D', 'E' };
+
+#define VERSION 1
+#define TEXTURE_ALIGNMENT 16
+#define NO_INDEX G_MAXUINT32
+
+gboolean
+gsk_render_node_bytes_are_binary (GBytes *bytes)
+{
+  gsize size;
+  const guchar *data;
+
+  data = g_bytes_get_data (bytes, &size);
+
+  return size >= sizeof (magic) && memcmp (data, magic, sizeof (magic)) == 0;
+}
+
+/* {{{ Writing */
+
+typedef struct
+{
+  GByteArray *nodes;
+  GByteArray *strings;
+  GHashTable *string_indexes;
+  GPtrArray *textures;
+  GHashTable *texture_indexes;
+  GPtrArray *cairo_pixels;
+  GHashTable *node_indexes;
+  guint n_strings;
+  guint n_nodes;
+} Writer;
+
+static void
+writer_init (Writer *w)
+{
+  w->nodes = g_byte_array_new ();
+  w->strings = g_byte_array_new ();
+  w->string_indexes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  w->textures = g_ptr_array_new ();
+  w->texture_indexes = g_hash_table_new (NULL, NULL);
+  w->cairo_pixels = g_ptr_array_new_with_free_func (g_object_unref);
+  w->node_indexes = g_hash_table_new (NULL, NULL);
+  w->n_strings = 0;
+  w->n_nodes = 0;
+}
+
+static void
+writer_clear (Writer *w)
+{
+  g_byte_array_unref (w->nodes);
+  g_byte_array_unref (w->strings);
+  g_hash_table_unref (w->string_indexes);
+  g_ptr_array_unref (w->textures);
+  g_hash_table_unref (w->texture_indexes);
+  g_ptr_array_unref (w->cairo_pixels);
+  g_hash_table_unref (w->node_indexes);
+}
+
+static void
+append_u32 (GByteArray *array,
+            guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (array, (guchar *) &value, sizeof (value));
+}
+
+static void
+append_u64 (GByteArray *array,
+            guint64     value)
+{
+  value = GUINT64_TO_LE (value);
+  g_byte_array_append (array, (guchar *) &value, sizeof (value));
+}
+
+static void
+append_padding (GByteArray *array,
+                gsize       alignment)
+{
+  static const guchar zeros[TEXTURE_ALIGNMENT] = { 0, };
+
+  if (array->len % alignment)
+    g_byte_array_append (array, zeros, alignment - array->len % alignment);
+}
+
+static void
+write_u32 (Writer  *w,
+           guint32  value)
+{
+  append_u32 (w->nodes, value);
+}
+
+static void
+write_float (Writer *w,
+             float   value)
+{
+  union { float f; guint32 u; } u = { value };
+
+  append_u32 (w->nodes, u.u);
+}
+
+static void
+write_point (Writer                 *w,
+             const graphene_point_t *point)
+{
+  write_float (w, point->x);
+  write_float (w, point->y);
+}
+
+static void
+write_rect (Writer                *w,
+            const graphene_rect_t *rect)
+{
+  write_float (w, rect->origin.x);
+  write_float (w, rect->origin.y);
+  write_float (w, rect->size.width);
+  write_float (w, rect->size.height);
+}
+
+static void
+write_rounded_rect (Writer               *w,
+                    const GskRoundedRect *rect)
+{
+  guint i;
+
+  write_rect (w, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      write_float (w, rect->corner[i].width);
+      write_float (w, rect->corner[i].height);
+    }
+}
+
+static void
+write_rgba (Writer        *w,
+            const GdkRGBA *rgba)
+{
+  write_float (w, rgba->red);
+  write_float (w, rgba->green);
+  write_float (w, rgba->blue);
+  write_float (w, rgba->alpha);
+}
+
+static void
+write_stops (Writer             *w,
+             const GskColorStop *stops,
+             gsize               n_stops)
+{
+  gsize i;
+
+  write_u32 (w, n_stops);
+  for (i = 0; i < n_stops; i++)
+    {
+      write_float (w, stops[i].offset);
+      write_rgba (w, &stops[i].color);
+    }
+}
+
+static void
+write_string (Writer     *w,
+              const char *string)
+{
+  gpointer index;
+  gsize len;
+
+  if (string == NULL)
+    {
+      write_u32 (w, NO_INDEX);
+      return;
+    }
+
+  if (!g_hash_table_lookup_extended (w->string_indexes, string, NULL, &index))
+    {
+      index = GUINT_TO_POINTER (w->n_strings++);
+      g_hash_table_insert (w->string_indexes, g_strdup (string), index);
+
+      len = strlen (string);
+      append_u32 (w->strings, len);
+      g_byte_array_append (w->strings, (const guchar *) string, len + 1);
+      append_padding (w->strings, 4);
+    }
+
+  write_u32 (w, GPOINTER_TO_UINT (index));
+}
+
+static void
+write_texture (Writer     *w,
+               GdkTexture *texture)
+{
+  gpointer index;
+
+  if (!g_hash_table_lookup_extended (w->texture_indexes, texture, NULL, &index))
+    {
+      index = GUINT_TO_POINTER (w->textures->len);
+      g_hash_table_insert (w->texture_indexes, texture, index);
+      g_ptr_array_add (w->textures, texture);
+    }
+
+  write_u32 (w, GPOINTER_TO_UINT (index));
+}
+
+static void
+write_transform (Writer       *w,
+                 GskTransform *transform)
+{
+  char *s;
+
+  s = gsk_transform_to_string (transform);
+  write_string (w, s);
+  g_free (s);
+}
+
+static void
+write_path (Writer  *w,
+            GskPath *path)
+{
+  char *s;
+
+  s = gsk_path_to_string (path);
+  write_string (w, s);
+  g_free (s);
+}
+
+static guint write_node (Writer        *w,
+                         GskRenderNode *node);
+
+static GdkTexture *
+cairo_node_get_pixels (GskRenderNode *node,
+                       int           *out_x,
+                       int           *out_y)
+{
+  cairo_surface_t *surface, *image;
+  GdkTexture *texture;
+  cairo_t *cr;
+  int x, y, width, height;
+
+  surface = gsk_cairo_node_get_surface (node);
+  if (surface == NULL)
+    return NULL;
+
+  x = floor (node->bounds.origin.x);
+  y = floor (node->bounds.origin.y);
+  width = ceil (node->bounds.origin.x + node->bounds.size.width) - x;
+  height = ceil (node->bounds.origin.y + node->bounds.size.height) - y;
+  if (width <= 0 || height <= 0)
+    return NULL;
+
+  image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cr = cairo_create (image);
+  cairo_set_source_surface (cr, surface, -x, -y);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  texture = gdk_texture_new_for_surface (image);
+  cairo_surface_destroy (image);
+
+  *out_x = x;
+  *out_y = y;
+
+  return texture;
+}
+
+static void
+write_node_data (Writer        *w,
+                 GskRenderNode *node)
+{
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        guint i;
+
+        write_u32 (w, gsk_container_node_get_n_children (node));
+        for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+          write_u32 (w, write_node (w, gsk_container_node_get_child (node, i)));
+      }
+      break;
+
+    case GSK_COLOR_NODE:
+      write_rect (w, &node->bounds);
+      write_rgba (w, gsk_color_node_get_color (node));
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      write_float (w, gsk_cross_fade_node_get_progress (node));
+      write_u32 (w, write_node (w, gsk_cross_fade_node_get_start_child (node)));
+      write_u32 (w, write_node (w, gsk_cross_fade_node_get_end_child (node)));
+      break;
+
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+      write_rect (w, &node->bounds);
+      write_point (w, gsk_linear_gradient_node_get_start (node));
+      write_point (w, gsk_linear_gradient_node_get_end (node));
+      write_stops (w,
+                   gsk_linear_gradient_node_get_color_stops (node, NULL),
+                   gsk_linear_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+      write_rect (w, &node->bounds);
+      write_point (w, gsk_radial_gradient_node_get_center (node));
+      write_float (w, gsk_radial_gradient_node_get_hradius (node));
+      write_float (w, gsk_radial_gradient_node_get_vradius (node));
+      write_float (w, gsk_radial_gradient_node_get_start (node));
+      write_float (w, gsk_radial_gradient_node_get_end (node));
+      write_stops (w,
+                   gsk_radial_gradient_node_get_color_stops (node, NULL),
+                   gsk_radial_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_CONIC_GRADIENT_NODE:
+      write_rect (w, &node->bounds);
+      write_point (w, gsk_conic_gradient_node_get_center (node));
+      write_float (w, gsk_conic_gradient_node_get_rotation (node));
+      write_stops (w,
+                   gsk_conic_gradient_node_get_color_stops (node, NULL),
+                   gsk_conic_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_OPACITY_NODE:
+      write_float (w, gsk_opacity_node_get_opacity (node));
+      write_u32 (w, write_node (w, gsk_opacity_node_get_child (node)));
+      break;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      write_rounded_rect (w, gsk_outset_shadow_node_get_outline (node));
+      write_rgba (w, gsk_outset_shadow_node_get_color (node));
+      write_float (w, gsk_outset_shadow_node_get_dx (node));
+      write_float (w, gsk_outset_shadow_node_get_dy (node));
+      write_float (w, gsk_outset_shadow_node_get_spread (node));
+      write_float (w, gsk_outset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+      write_rounded_rect (w, gsk_inset_shadow_node_get_outline (node));
+      write_rgba (w, gsk_inset_shadow_node_get_color (node));
+      write_float (w, gsk_inset_shadow_node_get_dx (node));
+      write_float (w, gsk_inset_shadow_node_get_dy (node));
+      write_float (w, gsk_inset_shadow_node_get_spread (node));
+      write_float (w, gsk_inset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_CLIP_NODE:
+      write_rect (w, gsk_clip_node_get_clip (node));
+      write_u32 (w, write_node (w, gsk_clip_node_get_child (node)));
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      write_rounded_rect (w, gsk_rounded_clip_node_get_clip (node));
+      write_u32 (w, write_node (w, gsk_rounded_clip_node_get_child (node)));
+      break;
+
+    case GSK_FILL_NODE:
+      write_u32 (w, write_node (w, gsk_fill_node_get_child (node)));
+      write_path (w, gsk_fill_node_get_path (node));
+      write_u32 (w, gsk_fill_node_get_fill_rule (node));
+      break;
+
+    case GSK_STROKE_NODE:
+      {
+        const GskStroke *stroke = gsk_stroke_node_get_stroke (node);
+        const float *dash;
+        gsize i, n_dash;
+
+        write_u32 (w, write_node (w, gsk_stroke_node_get_child (node)));
+        write_path (w, gsk_stroke_node_get_path (node));
+        write_float (w, gsk_stroke_get_line_width (stroke));
+        write_u32 (w, gsk_stroke_get_line_cap (stroke));
+        write_u32 (w, gsk_stroke_get_line_join (stroke));
+        write_float (w, gsk_stroke_get_miter_limit (stroke));
+        write_float (w, gsk_stroke_get_dash_offset (stroke));
+        dash = gsk_stroke_get_dash (stroke, &n_dash);
+        write_u32 (w, n_dash);
+        for (i = 0; i < n_dash; i++)
+          write_float (w, dash[i]);
+      }
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      write_transform (w, gsk_transform_node_get_transform (node));
+      write_u32 (w, write_node (w, gsk_transform_node_get_child (node)));
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        float m[16], v[4];
+        guint i;
+
+        graphene_matrix_to_float (gsk_color_matrix_node_get_color_matrix (node), m);
+        for (i = 0; i < 16; i++)
+          write_float (w, m[i]);
+        graphene_vec4_to_float (gsk_color_matrix_node_get_color_offset (node), v);
+        for (i = 0; i < 4; i++)
+          write_float (w, v[i]);
+        write_u32 (w, write_node (w, gsk_color_matrix_node_get_child (node)));
+      }
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        const GdkRGBA *colors = gsk_border_node_get_colors (node);
+        const float *widths = gsk_border_node_get_widths (node);
+        guint i;
+
+        write_rounded_rect (w, gsk_border_node_get_outline (node));
+        for (i = 0; i < 4; i++)
+          write_float (w, widths[i]);
+        for (i = 0; i < 4; i++)
+          write_rgba (w, &colors[i]);
+      }
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        gsize i, n_shadows = gsk_shadow_node_get_n_shadows (node);
+
+        write_u32 (w, write_node (w, gsk_shadow_node_get_child (node)));
+        write_u32 (w, n_shadows);
+        for (i = 0; i < n_shadows; i++)
+          {
+            const GskShadow *shadow = gsk_shadow_node_get_shadow (node, i);
+
+            write_rgba (w, &shadow->color);
+            write_float (w, shadow->dx);
+            write_float (w, shadow->dy);
+            write_float (w, shadow->radius);
+          }
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      write_rect (w, &node->bounds);
+      write_texture (w, gsk_texture_node_get_texture (node));
+      break;
+
+    case GSK_TEXTURE_SCALE_NODE:
+      write_rect (w, &node->bounds);
+      write_texture (w, gsk_texture_scale_node_get_texture (node));
+      write_u32 (w, gsk_texture_scale_node_get_filter (node));
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        PangoFontDescription *desc;
+        const PangoGlyphInfo *glyphs;
+        char *font_name;
+        guint i, n_glyphs;
+
+        desc = pango_font_describe (gsk_text_node_get_font (node));
+        font_name = pango_font_description_to_string (desc);
+        write_string (w, font_name);
+        g_free (font_name);
+        pango_font_description_free (desc);
+
+        write_rgba (w, gsk_text_node_get_color (node));
+        write_point (w, gsk_text_node_get_offset (node));
+
+        glyphs = gsk_text_node_get_glyphs (node, &n_glyphs);
+        write_u32 (w, n_glyphs);
+        for (i = 0; i < n_glyphs; i++)
+          {
+            write_u32 (w, glyphs[i].glyph);
+            write_u32 (w, glyphs[i].geometry.width);
+            write_u32 (w, glyphs[i].geometry.x_offset);
+            write_u32 (w, glyphs[i].geometry.y_offset);
+            write_u32 (w, glyphs[i].attr.is_cluster_start | (glyphs[i].attr.is_color << 1));
+          }
+      }
+      break;
+
+    case GSK_DEBUG_NODE:
+      write_string (w, gsk_debug_node_get_message (node));
+      write_u32 (w, write_node (w, gsk_debug_node_get_child (node)));
+      break;
+
+    case GSK_BLUR_NODE:
+      write_float (w, gsk_blur_node_get_radius (node));
+      write_u32 (w, write_node (w, gsk_blur_node_get_child (node)));
+      break;
+
+    case GSK_GL_SHADER_NODE:
+      {
+        GskGLShader *shader = gsk_gl_shader_node_get_shader (node);
+        GBytes *source = gsk_gl_shader_get_source (shader);
+        GBytes *args = gsk_gl_shader_node_get_args (node);
+        char *sourcecode;
+        gsize size;
+        guint i;
+
+        write_rect (w, &node->bounds);
+
+        sourcecode = g_strndup (g_bytes_get_data (source, NULL), g_bytes_get_size (source));
+        write_string (w, sourcecode);
+        g_free (sourcecode);
+
+        size = g_bytes_get_size (args);
+        write_u32 (w, size);
+        g_byte_array_append (w->nodes, g_bytes_get_data (args, NULL), size);
+        append_padding (w->nodes, 4);
+
+        write_u32 (w, gsk_gl_shader_node_get_n_children (node));
+        for (i = 0; i < gsk_gl_shader_node_get_n_children (node); i++)
+          write_u32 (w, write_node (w, gsk_gl_shader_node_get_child (node, i)));
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      write_rect (w, &node->bounds);
+      write_rect (w, gsk_repeat_node_get_child_bounds (node));
+      write_u32 (w, write_node (w, gsk_repeat_node_get_child (node)));
+      break;
+
+    case GSK_BLEND_NODE:
+      write_u32 (w, gsk_blend_node_get_blend_mode (node));
+      write_u32 (w, write_node (w, gsk_blend_node_get_bottom_child (node)));
+      write_u32 (w, write_node (w, gsk_blend_node_get_top_child (node)));
+      break;
+
+    case GSK_MASK_NODE:
+      write_u32 (w, gsk_mask_node_get_mask_mode (node));
+      write_u32 (w, write_node (w, gsk_mask_node_get_source (node)));
+      write_u32 (w, write_node (w, gsk_mask_node_get_mask (node)));
+      break;
+
+    case GSK_CAIRO_NODE:
+      {
+        GdkTexture *pixels;
+        int x, y;
+
+        write_rect (w, &node->bounds);
+
+        pixels = cairo_node_get_pixels (node, &x, &y);
+        if (pixels)
+          {
+            write_texture (w, pixels);
+            write_u32 (w, x);
+            write_u32 (w, y);
+            g_ptr_array_add (w->cairo_pixels, pixels);
+          }
+        else
+          {
+            write_u32 (w, NO_INDEX);
+          }
+      }
+      break;
+
+    case GSK_SUBSURFACE_NODE:
+      write_u32 (w, write_node (w, gsk_subsurface_node_get_child (node)));
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+}
+
+static guint
+write_node (Writer        *w,
+            GskRenderNode *node)
+{
+  GByteArray *nodes;
+  gpointer index;
+
+  if (g_hash_table_lookup_extended (w->node_indexes, node, NULL, &index))
+    return GPOINTER_TO_UINT (index);
+
+  /* Children get written while writing the data of this node,
+   * so collect that data separately and append it afterwards.
+   */
+  nodes = w->nodes;
+  w->nodes = g_byte_array_new ();
+
+  write_node_data (w, node);
+
+  append_u32 (nodes, gsk_render_node_get_node_type (node));
+  append_u32 (nodes, w->nodes->len);
+  g_byte_array_append (nodes, w->nodes->data, w->nodes->len);
+
+  g_byte_array_unref (w->nodes);
+  w->nodes = nodes;
+
+  index = GUINT_TO_POINTER (w->n_nodes++);
+  g_hash_table_insert (w->node_indexes, node, index);
+
+  return GPOINTER_TO_UINT (index);
+}
+
+/**
+ * gsk_render_node_serialize_binary:
+ * @node: a `GskRenderNode`
+ *
+ * Serializes the @node into a compact binary format for later
+ * deserialization via [func@Gsk.RenderNode.deserialize].
+ *
+ * Compared to [method@Gsk.RenderNode.serialize], the result is not
+ * human-readable, but it is smaller and a lot faster to load, in
+ * particular for nodes with large textures. Textures are stored in
+ * their own memory format, so loading a mapped file does not copy
+ * their data.
+ *
+ * The same caveats as for [method@Gsk.RenderNode.serialize] apply:
+ * the format is meant for testing, benchmarking and debugging and
+ * is not meant as a permanent storage format.
+ *
+ * Returns: a `GBytes` representing the node.
+ *
+ * Since: 4.14
+ **/
+GBytes *
+gsk_render_node_serialize_binary (GskRenderNode *node)
+{
+  GByteArray *result;
+  Writer w;
+  gsize offset;
+  guint i;
+  GPtrArray *pixels;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE (node), NULL);
+
+  writer_init (&w);
+
+  write_node (&w, node);
+
+  result = g_byte_array_new ();
+  g_byte_array_append (result, (const guchar *) magic, sizeof (magic));
+  append_u32 (result, VERSION);
+  append_u32 (result, w.n_strings);
+  append_u32 (result, w.textures->len);
+  append_u32 (result, w.n_nodes);
+  g_byte_array_append (result, w.strings->data, w.strings->len);
+
+  pixels = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+
+  offset = result->len + w.textures->len * (4 * sizeof (guint32) + 2 * sizeof (guint64)) + w.nodes->len;
+  for (i = 0; i < w.textures->len; i++)
+    {
+      GdkTexture *texture = g_ptr_array_index (w.textures, i);
+      GdkTextureDownloader *downloader;
+      GdkMemoryFormat format;
+      GBytes *bytes;
+      gsize stride;
+
+      format = gdk_texture_get_format (texture);
+      downloader = gdk_texture_downloader_new (texture);
+      gdk_texture_downloader_set_format (downloader, format);
+      bytes = gdk_texture_downloader_download_bytes (downloader, &stride);
+      gdk_texture_downloader_free (downloader);
+
+      offset = (offset + TEXTURE_ALIGNMENT - 1) & ~(gsize) (TEXTURE_ALIGNMENT - 1);
+
+      append_u32 (result, gdk_texture_get_width (texture));
+      append_u32 (result, gdk_texture_get_height (texture));
+      append_u32 (result, format);
+      append_u32 (result, stride);
+      append_u64 (result, offset);
+      append_u64 (result, g_bytes_get_size (bytes));
+
+      offset += g_bytes_get_size (bytes);
+      g_ptr_array_add (pixels, bytes);
+    }
+
+  g_byte_array_append (result, w.nodes->data, w.nodes->len);
+
+  for (i = 0; i < pixels->len; i++)
+    {
+      GBytes *bytes = g_ptr_array_index (pixels, i);
+
+      append_padding (result, TEXTURE_ALIGNMENT);
+      g_byte_array_append (result, g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes));
+    }
+
+  g_assert (result->len == offset);
+
+  g_ptr_array_unref (pixels);
+  writer_clear (&w);
+
+  return g_byte_array_free_to_bytes (result);
+}
+
+/* }}} */
+/* {{{ Reading */
+
+typedef struct
+{
+  GBytes *bytes;
+  const guchar *data;
+  gsize size;
+  gsize pos;
+  gsize end;
+  gboolean failed;
+  GskParseErrorFunc error_func;
+  gpointer user_data;
+
+  const char **strings;
+  guint n_strings;
+  GdkTexture **textures;
+  guint n_textures;
+  GskRenderNode **nodes;
+  guint n_nodes;
+} Reader;
+
+static void
+reader_error (Reader     *r,
+              const char *message)
+{
+  GskParseLocation location = { r->pos, r->pos, 0, r->pos, r->pos };
+  GError *error;
+
+  if (r->failed)
+    return;
+
+  r->failed = TRUE;
+
+  if (r->error_func == NULL)
+    return;
+
+  error = g_error_new_literal (GTK_CSS_PARSER_ERROR, GTK_CSS_PARSER_ERROR_SYNTAX, message);
+  r->error_func (&location, &location, error, r->user_data);
+  g_error_free (error);
+}
+
+static gboolean
+reader_has (Reader *r,
+            gsize   size)
+{
+  if (r->failed)
+    return FALSE;
+
+  if (r->end - r->pos < size)
+    {
+      reader_error (r, "Unexpected end of data");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static guint32
+read_u32 (Reader *r)
+{
+  guint32 value;
+
+  if (!reader_has (r, sizeof (value)))
+    return 0;
+
+  memcpy (&value, r->data + r->pos, sizeof (value));
+  r->pos += sizeof (value);
+
+  return GUINT32_FROM_LE (value);
+}
+
+static guint64
+read_u64 (Reader *r)
+{
+  guint64 value;
+
+  if (!reader_has (r, sizeof (value)))
+    return 0;
+
+  memcpy (&value, r->data + r->pos, sizeof (value));
+  r->pos += sizeof (value);
+
+  return GUINT64_FROM_LE (value);
+}
+
+static float
+read_float (Reader *r)
+{
+  union { float f; guint32 u; } u;
+
+  u.u = read_u32 (r);
+
+  return u.f;
+}
+
+static void
+read_point (Reader           *r,
+            graphene_point_t *point)
+{
+  point->x = read_float (r);
+  point->y = read_float (r);
+}
+
+static void
+read_rect (Reader          *r,
+           graphene_rect_t *rect)
+{
+  rect->origin.x = read_float (r);
+  rect->origin.y = read_float (r);
+  rect->size.width = read_float (r);
+  rect->size.height = read_float (r);
+}
+
+static void
+read_rounded_rect (Reader         *r,
+                   GskRoundedRect *rect)
+{
+  guint i;
+
+  read_rect (r, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      rect->corner[i].width = read_float (r);
+      rect->corner[i].height = read_float (r);
+    }
+}
+
+static void
+read_rgba (Reader  *r,
+           GdkRGBA *rgba)
+{
+  rgba->red = read_float (r);
+  rgba->green = read_float (r);
+  rgba->blue = read_float (r);
+  rgba->alpha = read_float (r);
+}
+
+static guint
+read_count (Reader *r,
+            gsize   item_size)
+{
+  guint count = read_u32 (r);
+
+  /* catch garbage before allocating memory for it */
+  if (!reader_has (r, (gsize) count * item_size))
+    return 0;
+
+  return count;
+}
+
+static GskColorStop *
+read_stops (Reader *r,
+            gsize  *n_stops)
+{
+  GskColorStop *stops;
+  gsize i;
+
+  *n_stops = read_count (r, 5 * sizeof (float));
+  if (*n_stops < 2)
+    {
+      reader_error (r, "Gradients need at least 2 color stops");
+      return NULL;
+    }
+
+  stops = g_new (GskColorStop, *n_stops);
+  for (i = 0; i < *n_stops; i++)
+    {
+      stops[i].offset = read_float (r);
+      read_rgba (r, &stops[i].color);
+
+      /* written this way to catch NaN */
+      if (i == 0 && !(stops[i].offset >= 0))
+        reader_error (r, "Color stop offset must be >= 0");
+      else if (i > 0 && !(stops[i].offset >= stops[i - 1].offset))
+        reader_error (r, "Color stop offset must be >= previous value");
+      else if (!(stops[i].offset <= 1))
+        reader_error (r, "Color stop offset must be <= 1");
+    }
+
+  if (r->failed)
+    g_clear_pointer (&stops, g_free);
+
+  return stops;
+}
+
+static guint
+read_enum (Reader *r,
+           GType   type)
+{
+  GEnumClass *class;
+  guint value;
+
+  value = read_u32 (r);
+  if (r->failed)
+    return 0;
+
+  class = g_type_class_ref (type);
+  if (g_enum_get_value (class, value) == NULL)
+    {
+      reader_error (r, "Invalid enum value");
+      value = 0;
+    }
+  g_type_class_unref (class);
+
+  return value;
+}
+
+static const char *
+read_string (Reader *r)
+{
+  guint32 index = read_u32 (r);
+
+  if (r->failed || index == NO_INDEX)
+    return NULL;
+
+  if (index >= r->n_strings)
+    {
+      reader_error (r, "Invalid string index");
+      return NULL;
+    }
+
+  return r->strings[index];
+}
+
+static GdkTexture *
+read_texture (Reader *r)
+{
+  guint32 index = read_u32 (r);
+
+  if (r->failed)
+    return NULL;
+
+  if (index >= r->n_textures)
+    {
+      reader_error (r, "Invalid texture index");
+      return NULL;
+    }
+
+  return r->textures[index];
+}
+
+static GskRenderNode *
+read_node (Reader *r)
+{
+  guint32 index = read_u32 (r);
+
+  if (r->failed)
+    return NULL;
+
+  /* only nodes that have been read already can be referenced,
+   * which also rules out cycles */
+  if (index >= r->n_nodes)
+    {
+      reader_error (r, "Invalid node index");
+      return NULL;
+    }
+
+  return r->nodes[index];
+}
+
+static GskTransform *
+read_transform (Reader *r)
+{
+  GskTransform *transform = NULL;
+  const char *s;
+
+  s = read_string (r);
+  if (s == NULL || !gsk_transform_parse (s, &transform))
+    {
+      reader_error (r, "Invalid transform");
+      return NULL;
+    }
+
+  return transform;
+}
+
+static GskPath *
+read_path (Reader *r)
+{
+  GskPath *path;
+  const char *s;
+
+  s = read_string (r);
+  path = s ? gsk_path_parse (s) : NULL;
+  if (path == NULL)
+    reader_error (r, "Invalid path");
+
+  return path;
+}
+
+static PangoFont *
+font_from_string (const char *string)
+{
+  PangoFontDescription *desc;
+  PangoFontMap *font_map;
+  PangoContext *context;
+  PangoFont *font;
+
+  desc = pango_font_description_from_string (string);
+  font_map = pango_cairo_font_map_get_default ();
+  context = pango_font_map_create_context (font_map);
+  font = pango_font_map_load_font (font_map, context, desc);
+
+  pango_font_description_free (desc);
+  g_object_unref (context);
+
+  return font;
+}
+
+static GskRenderNode *
+read_text_node (Reader *r)
+{
+  PangoGlyphString *glyphs;
+  PangoFont *font;
+  const char *font_name;
+  GskRenderNode *result;
+  graphene_point_t offset;
+  GdkRGBA color;
+  guint i, n_glyphs;
+
+  font_name = read_string (r);
+  read_rgba (r, &color);
+  read_point (r, &offset);
+  n_glyphs = read_count (r, 5 * sizeof (guint32));
+  if (r->failed)
+    return NULL;
+
+  font = font_name ? font_from_string (font_name) : NULL;
+  if (font == NULL)
+    {
+      reader_error (r, "This font does not exist");
+      return NULL;
+    }
+
+  glyphs = pango_glyph_string_new ();
+  pango_glyph_string_set_size (glyphs, n_glyphs);
+  for (i = 0; i < n_glyphs; i++)
+    {
+      PangoGlyphInfo *gi = &glyphs->glyphs[i];
+      guint32 flags;
+
+      gi->glyph = read_u32 (r);
+      gi->geometry.width = (gint32) read_u32 (r);
+      gi->geometry.x_offset = (gint32) read_u32 (r);
+      gi->geometry.y_offset = (gint32) read_u32 (r);
+      flags = read_u32 (r);
+      gi->attr.is_cluster_start = flags & 1;
+      gi->attr.is_color = (flags >> 1) & 1;
+    }
+
+  result = gsk_text_node_new (font, glyphs, &color, &offset);
+  /* glyphs without ink */
+  if (result == NULL)
+    result = gsk_container_node_new (NULL, 0);
+
+  pango_glyph_string_free (glyphs);
+  g_object_unref (font);
+
+  return result;
+}
+
+static GskRenderNode *
+read_node_data (Reader            *r,
+                GskRenderNodeType  type)
+{
+  switch (type)
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        GskRenderNode **children;
+        GskRenderNode *result;
+        guint i, n_children;
+
+        n_children = read_count (r, sizeof (guint32));
+        children = g_new (GskRenderNode *, n_children);
+        for (i = 0; i < n_children; i++)
+          children[i] = read_node (r);
+
+        result = r->failed ? NULL : gsk_container_node_new (children, n_children);
+        g_free (children);
+
+        return result;
+      }
+
+    case GSK_COLOR_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkRGBA color;
+
+        read_rect (r, &bounds);
+        read_rgba (r, &color);
+        if (r->failed)
+          return NULL;
+
+        return gsk_color_node_new (&color, &bounds);
+      }
+
+    case GSK_CROSS_FADE_NODE:
+      {
+        GskRenderNode *start, *end;
+        float progress;
+
+        progress = read_float (r);
+        start = read_node (r);
+        end = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_cross_fade_node_new (start, end, progress);
+      }
+
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t start, end;
+        GskColorStop *stops;
+        GskRenderNode *result;
+        gsize n_stops;
+
+        read_rect (r, &bounds);
+        read_point (r, &start);
+        read_point (r, &end);
+        stops = read_stops (r, &n_stops);
+        if (r->failed)
+          {
+            g_free (stops);
+            return NULL;
+          }
+
+        if (type == GSK_REPEATING_LINEAR_GRADIENT_NODE)
+          result = gsk_repeating_linear_gradient_node_new (&bounds, &start, &end, stops, n_stops);
+        else
+          result = gsk_linear_gradient_node_new (&bounds, &start, &end, stops, n_stops);
+        g_free (stops);
+
+        return result;
+      }
+
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t center;
+        float hradius, vradius, start, end;
+        GskColorStop *stops;
+        GskRenderNode *result;
+        gsize n_stops;
+
+        read_rect (r, &bounds);
+        read_point (r, &center);
+        hradius = read_float (r);
+        vradius = read_float (r);
+        start = read_float (r);
+        end = read_float (r);
+        if (!(hradius > 0 && vradius > 0))
+          reader_error (r, "Gradient radius must be > 0");
+        else if (!(start >= 0 && end > start))
+          reader_error (r, "Gradient start must be >= 0 and < end");
+        stops = read_stops (r, &n_stops);
+        if (r->failed)
+          {
+            g_free (stops);
+            return NULL;
+          }
+
+        if (type == GSK_REPEATING_RADIAL_GRADIENT_NODE)
+          result = gsk_repeating_radial_gradient_node_new (&bounds, &center, hradius, vradius, start, end, stops, n_stops);
+        else
+          result = gsk_radial_gradient_node_new (&bounds, &center, hradius, vradius, start, end, stops, n_stops);
+        g_free (stops);
+
+        return result;
+      }
+
+    case GSK_CONIC_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t center;
+        float rotation;
+        GskColorStop *stops;
+        GskRenderNode *result;
+        gsize n_stops;
+
+        read_rect (r, &bounds);
+        read_point (r, &center);
+        rotation = read_float (r);
+        stops = read_stops (r, &n_stops);
+        if (r->failed)
+          {
+            g_free (stops);
+            return NULL;
+          }
+
+        result = gsk_conic_gradient_node_new (&bounds, &center, rotation, stops, n_stops);
+        g_free (stops);
+
+        return result;
+      }
+
+    case GSK_OPACITY_NODE:
+      {
+        GskRenderNode *child;
+        float opacity;
+
+        opacity = read_float (r);
+        child = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_opacity_node_new (child, opacity);
+      }
+
+    case GSK_OUTSET_SHADOW_NODE:
+    case GSK_INSET_SHADOW_NODE:
+      {
+        GskRoundedRect outline;
+        GdkRGBA color;
+        float dx, dy, spread, blur;
+
+        read_rounded_rect (r, &outline);
+        read_rgba (r, &color);
+        dx = read_float (r);
+        dy = read_float (r);
+        spread = read_float (r);
+        blur = read_float (r);
+        if (!(blur >= 0))
+          reader_error (r, "Blur radius must be >= 0");
+        if (r->failed)
+          return NULL;
+
+        if (type == GSK_OUTSET_SHADOW_NODE)
+          return gsk_outset_shadow_node_new (&outline, &color, dx, dy, spread, blur);
+        else
+          return gsk_inset_shadow_node_new (&outline, &color, dx, dy, spread, blur);
+      }
+
+    case GSK_CLIP_NODE:
+      {
+        graphene_rect_t clip;
+        GskRenderNode *child;
+
+        read_rect (r, &clip);
+        child = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_clip_node_new (child, &clip);
+      }
+
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        GskRoundedRect clip;
+        GskRenderNode *child;
+
+        read_rounded_rect (r, &clip);
+        child = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_rounded_clip_node_new (child, &clip);
+      }
+
+    case GSK_FILL_NODE:
+      {
+        GskRenderNode *child, *result;
+        GskFillRule fill_rule;
+        GskPath *path;
+
+        child = read_node (r);
+        path = read_path (r);
+        fill_rule = read_enum (r, GSK_TYPE_FILL_RULE);
+        if (r->failed)
+          {
+            g_clear_pointer (&path, gsk_path_unref);
+            return NULL;
+          }
+
+        result = gsk_fill_node_new (child, path, fill_rule);
+        gsk_path_unref (path);
+
+        return result;
+      }
+
+    case GSK_STROKE_NODE:
+      {
+        GskRenderNode *child, *result;
+        GskStroke *stroke;
+        GskPath *path;
+        GskLineCap line_cap;
+        GskLineJoin line_join;
+        float line_width, miter_limit, dash_offset;
+        float *dash;
+        guint i, n_dash;
+
+        child = read_node (r);
+        path = read_path (r);
+        line_width = read_float (r);
+        line_cap = read_enum (r, GSK_TYPE_LINE_CAP);
+        line_join = read_enum (r, GSK_TYPE_LINE_JOIN);
+        miter_limit = read_float (r);
+        dash_offset = read_float (r);
+        n_dash = read_count (r, sizeof (float));
+        dash = g_new (float, n_dash);
+        for (i = 0; i < n_dash; i++)
+          {
+            dash[i] = read_float (r);
+            if (!(dash[i] >= 0))
+              reader_error (r, "Dash lengths must be >= 0");
+          }
+
+        if (!(line_width > 0))
+          reader_error (r, "Line width must be > 0");
+        if (!(miter_limit >= 0))
+          reader_error (r, "Miter limit must be >= 0");
+
+        if (r->failed)
+          {
+            result = NULL;
+          }
+        else
+          {
+            stroke = gsk_stroke_new (line_width);
+            gsk_stroke_set_line_cap (stroke, line_cap);
+            gsk_stroke_set_line_join (stroke, line_join);
+            gsk_stroke_set_miter_limit (stroke, miter_limit);
+            gsk_stroke_set_dash_offset (stroke, dash_offset);
+            gsk_stroke_set_dash (stroke, dash, n_dash);
+            result = gsk_stroke_node_new (child, path, stroke);
+            gsk_stroke_free (stroke);
+          }
+
+        g_clear_pointer (&path, gsk_path_unref);
+        g_free (dash);
+
+        return result;
+      }
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskRenderNode *child, *result;
+        GskTransform *transform;
+
+        transform = read_transform (r);
+        child = read_node (r);
+        if (r->failed)
+          {
+            gsk_transform_unref (transform);
+            return NULL;
+          }
+
+        result = gsk_transform_node_new (child, transform);
+        gsk_transform_unref (transform);
+
+        return result;
+      }
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        graphene_matrix_t matrix;
+        graphene_vec4_t offset;
+        GskRenderNode *child;
+        float m[16], v[4];
+        guint i;
+
+        for (i = 0; i < 16; i++)
+          m[i] = read_float (r);
+        for (i = 0; i < 4; i++)
+          v[i] = read_float (r);
+        child = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        graphene_matrix_init_from_float (&matrix, m);
+        graphene_vec4_init_from_float (&offset, v);
+
+        return gsk_color_matrix_node_new (child, &matrix, &offset);
+      }
+
+    case GSK_BORDER_NODE:
+      {
+        GskRoundedRect outline;
+        float widths[4];
+        GdkRGBA colors[4];
+        guint i;
+
+        read_rounded_rect (r, &outline);
+        for (i = 0; i < 4; i++)
+          widths[i] = read_float (r);
+        for (i = 0; i < 4; i++)
+          read_rgba (r, &colors[i]);
+        if (r->failed)
+          return NULL;
+
+        return gsk_border_node_new (&outline, widths, colors);
+      }
+
+    case GSK_SHADOW_NODE:
+      {
+        GskRenderNode *child, *result;
+        GskShadow *shadows;
+        gsize i, n_shadows;
+
+        child = read_node (r);
+        n_shadows = read_count (r, 7 * sizeof (float));
+        if (n_shadows == 0)
+          {
+            reader_error (r, "Shadow nodes need at least one shadow");
+            return NULL;
+          }
+
+        shadows = g_new (GskShadow, n_shadows);
+        for (i = 0; i < n_shadows; i++)
+          {
+            read_rgba (r, &shadows[i].color);
+            shadows[i].dx = read_float (r);
+            shadows[i].dy = read_float (r);
+            shadows[i].radius = read_float (r);
+          }
+
+        result = r->failed ? NULL : gsk_shadow_node_new (child, shadows, n_shadows);
+        g_free (shadows);
+
+        return result;
+      }
+
+    case GSK_TEXTURE_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkTexture *texture;
+
+        read_rect (r, &bounds);
+        texture = read_texture (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_texture_node_new (texture, &bounds);
+      }
+
+    case GSK_TEXTURE_SCALE_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkTexture *texture;
+        GskScalingFilter filter;
+
+        read_rect (r, &bounds);
+        texture = read_texture (r);
+        filter = read_enum (r, GSK_TYPE_SCALING_FILTER);
+        if (r->failed)
+          return NULL;
+
+        return gsk_texture_scale_node_new (texture, &bounds, filter);
+      }
+
+    case GSK_TEXT_NODE:
+      return read_text_node (r);
+
+    case GSK_DEBUG_NODE:
+      {
+        GskRenderNode *child;
+        const char *message;
+
+        message = read_string (r);
+        child = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_debug_node_new (child, g_strdup (message));
+      }
+
+    case GSK_BLUR_NODE:
+      {
+        GskRenderNode *child;
+        float radius;
+
+        radius = read_float (r);
+        child = read_node (r);
+        if (!(radius >= 0))
+          reader_error (r, "Blur radius must be >= 0");
+        if (r->failed)
+          return NULL;
+
+        return gsk_blur_node_new (child, radius);
+      }
+
+    case GSK_GL_SHADER_NODE:
+      {
+        GskRenderNode **children, *result;
+        graphene_rect_t bounds;
+        const char *sourcecode;
+        GskGLShader *shader;
+        GBytes *source, *args;
+        guint i, n_children;
+        gsize args_size;
+
+        read_rect (r, &bounds);
+        sourcecode = read_string (r);
+        args_size = read_u32 (r);
+        if (!reader_has (r, (args_size + 3) & ~3))
+          return NULL;
+        args = g_bytes_new_from_bytes (r->bytes, r->pos, args_size);
+        r->pos += (args_size + 3) & ~3;
+        n_children = read_count (r, sizeof (guint32));
+        children = g_new (GskRenderNode *, n_children);
+        for (i = 0; i < n_children; i++)
+          children[i] = read_node (r);
+
+        if (sourcecode == NULL)
+          reader_error (r, "Shader nodes need source code");
+
+        if (r->failed)
+          {
+            result = NULL;
+          }
+        else
+          {
+            source = g_bytes_new_static (sourcecode, strlen (sourcecode));
+            shader = gsk_gl_shader_new_from_bytes (source);
+            g_bytes_unref (source);
+
+            if (g_bytes_get_size (args) != gsk_gl_shader_get_args_size (shader))
+              {
+                reader_error (r, "Shader arguments have the wrong size");
+                result = NULL;
+              }
+            else
+              {
+                result = gsk_gl_shader_node_new (shader, &bounds, args, children, n_children);
+              }
+            g_object_unref (shader);
+          }
+
+        g_bytes_unref (args);
+        g_free (children);
+
+        return result;
+      }
+
+    case GSK_REPEAT_NODE:
+      {
+        graphene_rect_t bounds, child_bounds;
+        GskRenderNode *child;
+
+        read_rect (r, &bounds);
+        read_rect (r, &child_bounds);
+        child = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_repeat_node_new (&bounds, child, &child_bounds);
+      }
+
+    case GSK_BLEND_NODE:
+      {
+        GskRenderNode *bottom, *top;
+        GskBlendMode mode;
+
+        mode = read_enum (r, GSK_TYPE_BLEND_MODE);
+        bottom = read_node (r);
+        top = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_blend_node_new (bottom, top, mode);
+      }
+
+    case GSK_MASK_NODE:
+      {
+        GskRenderNode *source, *mask;
+        GskMaskMode mode;
+
+        mode = read_enum (r, GSK_TYPE_MASK_MODE);
+        source = read_node (r);
+        mask = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_mask_node_new (source, mask, mode);
+      }
+
+    case GSK_CAIRO_NODE:
+      {
+        graphene_rect_t bounds;
+        GskRenderNode *result;
+        GdkTexture *pixels = NULL;
+        guint32 index;
+        int x = 0, y = 0;
+
+        read_rect (r, &bounds);
+        index = read_u32 (r);
+        if (index != NO_INDEX)
+          {
+            if (index < r->n_textures)
+              pixels = r->textures[index];
+            else
+              reader_error (r, "Invalid texture index");
+            x = (gint32) read_u32 (r);
+            y = (gint32) read_u32 (r);
+          }
+        if (r->failed)
+          return NULL;
+
+        result = gsk_cairo_node_new (&bounds);
+        if (pixels)
+          {
+            cairo_surface_t *surface;
+            cairo_t *cr;
+
+            cr = gsk_cairo_node_get_draw_context (result);
+            surface = gdk_texture_download_surface (pixels);
+            cairo_set_source_surface (cr, surface, x, y);
+            cairo_paint (cr);
+            cairo_surface_destroy (surface);
+            cairo_destroy (cr);
+          }
+
+        return result;
+      }
+
+    case GSK_SUBSURFACE_NODE:
+      {
+        GskRenderNode *child;
+
+        child = read_node (r);
+        if (r->failed)
+          return NULL;
+
+        return gsk_subsurface_node_new (child, NULL);
+      }
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      reader_error (r, "Unknown node type");
+      return NULL;
+    }
+}
+
+static void
+read_strings (Reader *r)
+{
+  guint i;
+
+  r->strings = g_new0 (const char *, r->n_strings);
+  for (i = 0; i < r->n_strings; i++)
+    {
+      guint32 len = read_u32 (r);
+
+      if (!reader_has (r, ((gsize) len + 1 + 3) & ~3))
+        return;
+
+      if (r->data[r->pos + len] != '\0')
+        {
+          reader_error (r, "String is not terminated");
+          return;
+        }
+
+      r->strings[i] = (const char *) r->data + r->pos;
+      r->pos += (len + 1 + 3) & ~3;
+    }
+}
+
+static void
+read_textures (Reader *r)
+{
+  guint i;
+
+  r->textures = g_new0 (GdkTexture *, r->n_textures);
+  for (i = 0; i < r->n_textures; i++)
+    {
+      guint32 width, height, format, stride;
+      guint64 offset, size;
+      GBytes *bytes;
+
+      width = read_u32 (r);
+      height = read_u32 (r);
+      format = read_u32 (r);
+      stride = read_u32 (r);
+      offset = read_u64 (r);
+      size = read_u64 (r);
+      if (r->failed)
+        return;
+
+      if (width == 0 || height == 0 || width > G_MAXINT || height > G_MAXINT ||
+          format >= GDK_MEMORY_N_FORMATS ||
+          stride < (gsize) width * gdk_memory_format_bytes_per_pixel (format) ||
+          size < (gsize) stride * (height - 1) + width * gdk_memory_format_bytes_per_pixel (format))
+        {
+          reader_error (r, "Invalid texture");
+          return;
+        }
+
+      if (offset > r->size || size > r->size - offset)
+        {
+          reader_error (r, "Texture data out of bounds");
+          return;
+        }
+
+      bytes = g_bytes_new_from_bytes (r->bytes, offset, size);
+      r->textures[i] = gdk_memory_texture_new (width, height, format, bytes, stride);
+      g_bytes_unref (bytes);
+    }
+}
+
+static void
+read_nodes (Reader *r)
+{
+  guint i, n_nodes;
+
+  n_nodes = r->n_nodes;
+  r->n_nodes = 0;
+  r->nodes = g_new0 (GskRenderNode *, n_nodes);
+
+  for (i = 0; i < n_nodes; i++)
+    {
+      GskRenderNodeType type;
+      guint32 size;
+      gsize end;
+
+      type = read_u32 (r);
+      size = read_u32 (r);
+      if (!reader_has (r, size))
+        return;
+
+      end = r->end;
+      r->end = r->pos + size;
+
+      r->nodes[i] = read_node_data (r, type);
+      if (r->nodes[i] == NULL)
+        reader_error (r, "Invalid node");
+      else if (!r->failed && r->pos != r->end)
+        reader_error (r, "Node data has the wrong size");
+      if (r->failed)
+        {
+          g_clear_pointer (&r->nodes[i], gsk_render_node_unref);
+          return;
+        }
+
+      r->end = end;
+      r->n_nodes++;
+    }
+}
+
+GskRenderNode *
+gsk_render_node_deserialize_binary (GBytes            *bytes,
+                                    GskParseErrorFunc  error_func,
+                                    gpointer           user_data)
+{
+  GskRenderNode *result = NULL;
+  Reader r = { 0, };
+  guint i;
+
+  r.bytes = bytes;
+  r.data = g_bytes_get_data (bytes, &r.size);
+  r.end = r.size;
+  r.error_func = error_func;
+  r.user_data = user_data;
+
+  if (!gsk_render_node_bytes_are_binary (bytes))
+    {
+      reader_error (&r, "Not a binary render node file");
+      return NULL;
+    }
+  r.pos = sizeof (magic);
+
+  if (read_u32 (&r) != VERSION)
+    {
+      reader_error (&r, "Unsupported version of the binary format");
+      return NULL;
+    }
+
+  r.n_strings = read_count (&r, sizeof (guint32));
+  r.n_textures = read_count (&r, 4 * sizeof (guint32) + 2 * sizeof (guint64));
+  r.n_nodes = read_count (&r, 2 * sizeof (guint32));
+  if (!r.failed && r.n_nodes == 0)
+    reader_error (&r, "No nodes");
+
+  if (!r.failed)
+    read_strings (&r);
+  if (!r.failed)
+    read_textures (&r);
+  if (!r.failed)
+    read_nodes (&r);
+
+  if (!r.failed)
+    result = gsk_render_node_ref (r.nodes[r.n_nodes - 1]);
+
+  if (r.nodes)
+    {
+      for (i = 0; i < r.n_nodes; i++)
+        gsk_render_node_unref (r.nodes[i]);
+      g_free (r.nodes);
+    }
+  if (r.textures)
+    {
+      for (i = 0; i < r.n_textures; i++)
+        g_clear_object (&r.textures[i]);
+      g_free (r.textures);
+    }
+  g_free (r.strings);
+
+  return result;
+}
+
+/* }}} */
+
+/* vim:set foldmethod=marker: */
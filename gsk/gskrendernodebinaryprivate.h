@@ -0,0 +1,13 @@
+#pragma once
+
+#include "gskrendernode.h"
+
+G_BEGIN_DECLS
+
+gboolean                gsk_render_node_bytes_are_binary        (GBytes                 *bytes);
+
+GskRenderNode *         gsk_render_node_deserialize_binary      (GBytes                 *bytes,
+                                                                 GskParseErrorFunc       error_func,
+                                                                 gpointer                user_data);
+
+G_END_DECLS
@@ -1755,6 +1755,73 @@ gsk_texture_node_draw_oversized (GskRenderNode *node,
   cairo_paint (cr);
 }
 
+static const cairo_user_data_key_t texture_surfaces_key;
+
+/* Fills in the values of @surfaces, a hash table from textures to
+ * surfaces, with the surfaces that drawing the textures would create.
+ * Textures that are too large to be drawn from a single surface get
+ * no surface.
+ *
+ * Use this with gsk_cairo_set_texture_surfaces() to download every
+ * texture only once when the same nodes are drawn multiple times.
+ */
+void
+gsk_cairo_download_textures (GHashTable *surfaces)
+{
+  GHashTableIter iter;
+  gpointer texture;
+
+  g_hash_table_iter_init (&iter, surfaces);
+  while (g_hash_table_iter_next (&iter, &texture, NULL))
+    {
+      if (gdk_texture_get_width (texture) > MAX_CAIRO_IMAGE_WIDTH ||
+          gdk_texture_get_height (texture) > MAX_CAIRO_IMAGE_HEIGHT)
+        continue;
+
+      g_hash_table_iter_replace (&iter, gdk_texture_download_surface (texture));
+    }
+}
+
+/* Makes texture nodes drawn to @cr use the surfaces from @surfaces
+ * instead of downloading their texture.
+ *
+ * The table must not change while it is set, so it can be used by
+ * multiple threads at once.
+ */
+void
+gsk_cairo_set_texture_surfaces (cairo_t    *cr,
+                                GHashTable *surfaces)
+{
+  if (surfaces)
+    cairo_set_user_data (cr, &texture_surfaces_key, g_hash_table_ref (surfaces), (cairo_destroy_func_t) g_hash_table_unref);
+  else
+    cairo_set_user_data (cr, &texture_surfaces_key, NULL, NULL);
+}
+
+GHashTable *
+gsk_cairo_get_texture_surfaces (cairo_t *cr)
+{
+  return cairo_get_user_data (cr, &texture_surfaces_key);
+}
+
+static cairo_surface_t *
+gsk_cairo_download_texture (cairo_t    *cr,
+                            GdkTexture *texture)
+{
+  GHashTable *surfaces;
+  cairo_surface_t *surface;
+
+  surfaces = gsk_cairo_get_texture_surfaces (cr);
+  if (surfaces)
+    {
+      surface = g_hash_table_lookup (surfaces, texture);
+      if (surface)
+        return cairo_surface_reference (surface);
+    }
+
+  return gdk_texture_download_surface (texture);
+}
+
 static void
 gsk_texture_node_draw (GskRenderNode *node,
                        cairo_t       *cr)
@@ -1773,7 +1840,7 @@ gsk_texture_node_draw (GskRenderNode *node,
       return;
     }
 
-  surface = gdk_texture_download_surface (self->texture);
+  surface = gsk_cairo_download_texture (cr, self->texture);
   pattern = cairo_pattern_create_for_surface (surface);
   cairo_pattern_set_extend (pattern, CAIRO_EXTEND_PAD);
 
@@ -1948,7 +2015,7 @@ gsk_texture_scale_node_draw (GskRenderNode *node,
   cairo_surface_set_device_offset (surface2, -clip_rect.origin.x, -clip_rect.origin.y);
   cr2 = cairo_create (surface2);
 
-  surface = gdk_texture_download_surface (self->texture);
+  surface = gsk_cairo_download_texture (cr, self->texture);
   pattern = cairo_pattern_create_for_surface (surface);
   cairo_pattern_set_extend (pattern, CAIRO_EXTEND_PAD);
 
@@ -3181,11 +3248,21 @@ gsk_container_node_draw (GskRenderNode *node,
                          cairo_t       *cr)
 {
   GskContainerNode *container = (GskContainerNode *) node;
+  graphene_rect_t clip_rect;
   guint i;
 
+  /* Renderers clip to the region that changed since the last frame,
+   * so skip children that are completely outside of it */
+  _graphene_rect_init_from_clip_extents (&clip_rect, cr);
+
   for (i = 0; i < container->n_children; i++)
     {
-      gsk_render_node_draw (container->children[i], cr);
+      GskRenderNode *child = container->children[i];
+
+      if (!gsk_rect_intersects (&clip_rect, &child->bounds))
+        continue;
+
+      gsk_render_node_draw (child, cr);
     }
 }
 
@@ -5660,6 +5737,7 @@ struct _GskTextNode
 
   PangoFont *font;
   gboolean has_color_glyphs;
+  gboolean has_unknown_glyphs;
 
   GdkRGBA color;
   graphene_point_t offset;
@@ -5680,22 +5758,73 @@ gsk_text_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static cairo_scaled_font_t *
+gsk_text_node_get_scaled_font (GskTextNode *self)
+{
+  /* Unknown glyphs are drawn as hex boxes by pango */
+  if (self->has_unknown_glyphs ||
+      !PANGO_IS_CAIRO_FONT (self->font))
+    return NULL;
+
+  return pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (self->font));
+}
+
 static void
 gsk_text_node_draw (GskRenderNode *node,
                     cairo_t       *cr)
 {
   GskTextNode *self = (GskTextNode *) node;
-  PangoGlyphString glyphs;
-
-  glyphs.num_glyphs = self->num_glyphs;
-  glyphs.glyphs = self->glyphs;
-  glyphs.log_clusters = NULL;
+  cairo_scaled_font_t *scaled_font;
 
   cairo_save (cr);
 
   gdk_cairo_set_source_rgba (cr, &self->color);
   cairo_translate (cr, self->offset.x, self->offset.y);
-  pango_cairo_show_glyph_string (cr, self->font, &glyphs);
+
+  scaled_font = gsk_text_node_get_scaled_font (self);
+  if (scaled_font)
+    {
+      cairo_glyph_t stack_glyphs[64];
+      cairo_glyph_t *cairo_glyphs;
+      int x_position;
+      guint i;
+
+      /* Same layout as pango_cairo_show_glyph_string(), but this only
+       * reads the already resolved scaled font, so it can run in a
+       * worker thread, see gsk_text_node_prepare_threaded_draw()
+       */
+      if (self->num_glyphs <= G_N_ELEMENTS (stack_glyphs))
+        cairo_glyphs = stack_glyphs;
+      else
+        cairo_glyphs = g_new (cairo_glyph_t, self->num_glyphs);
+
+      x_position = 0;
+      for (i = 0; i < self->num_glyphs; i++)
+        {
+          PangoGlyphInfo *gi = &self->glyphs[i];
+
+          cairo_glyphs[i].index = gi->glyph;
+          cairo_glyphs[i].x = (double) (x_position + gi->geometry.x_offset) / PANGO_SCALE;
+          cairo_glyphs[i].y = (double) gi->geometry.y_offset / PANGO_SCALE;
+          x_position += gi->geometry.width;
+        }
+
+      cairo_set_scaled_font (cr, scaled_font);
+      cairo_show_glyphs (cr, cairo_glyphs, self->num_glyphs);
+
+      if (cairo_glyphs != stack_glyphs)
+        g_free (cairo_glyphs);
+    }
+  else
+    {
+      PangoGlyphString glyphs;
+
+      glyphs.num_glyphs = self->num_glyphs;
+      glyphs.glyphs = self->glyphs;
+      glyphs.log_clusters = NULL;
+
+      pango_cairo_show_glyph_string (cr, self->font, &glyphs);
+    }
 
   cairo_restore (cr);
 }
@@ -5792,6 +5921,7 @@ gsk_text_node_new (PangoFont              *font,
   self->color = *color;
   self->offset = *offset;
   self->has_color_glyphs = FALSE;
+  self->has_unknown_glyphs = FALSE;
 
   glyph_infos = g_malloc_n (glyphs->num_glyphs, sizeof (PangoGlyphInfo));
 
@@ -5807,6 +5937,9 @@ gsk_text_node_new (PangoFont              *font,
       if (glyphs->glyphs[i].attr.is_color)
         self->has_color_glyphs = TRUE;
 
+      if (glyphs->glyphs[i].glyph & PANGO_GLYPH_UNKNOWN_FLAG)
+        self->has_unknown_glyphs = TRUE;
+
       n++;
     }
 
@@ -5925,6 +6058,26 @@ gsk_text_node_get_offset (const GskRenderNode *node)
   return &self->offset;
 }
 
+/*<private>
+ * gsk_text_node_prepare_threaded_draw:
+ * @node: (type GskTextNode): a text `GskRenderNode`
+ *
+ * Resolves the cairo font of the text node, so that
+ * drawing the node afterwards does not modify any
+ * shared pango state.
+ *
+ * This must be called from the main thread.
+ *
+ * Returns: %TRUE if the node can be drawn from other threads
+ */
+gboolean
+gsk_text_node_prepare_threaded_draw (const GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+
+  return gsk_text_node_get_scaled_font (self) != NULL;
+}
+
 /* }}} */
 /* {{{ GSK_BLUR_NODE */
 
@@ -6130,6 +6283,7 @@ gsk_blur_node_draw (GskRenderNode *node,
                                    - blur_bounds.origin.y);
 
   cr2 = cairo_create (surface);
+  gsk_cairo_set_texture_surfaces (cr2, gsk_cairo_get_texture_surfaces (cr));
   gsk_render_node_draw (self->child, cr2);
   cairo_destroy (cr2);
 
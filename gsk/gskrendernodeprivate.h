@@ -87,11 +87,17 @@ void            gsk_container_node_diff_with            (GskRenderNode
 void            gsk_render_node_draw_fallback           (GskRenderNode               *node,
                                                          cairo_t                     *cr);
 
+void            gsk_cairo_download_textures             (GHashTable                  *surfaces);
+void            gsk_cairo_set_texture_surfaces          (cairo_t                     *cr,
+                                                         GHashTable                  *surfaces);
+GHashTable *    gsk_cairo_get_texture_surfaces          (cairo_t                     *cr);
+
 bool            gsk_border_node_get_uniform             (const GskRenderNode         *self) G_GNUC_PURE;
 bool            gsk_border_node_get_uniform_color       (const GskRenderNode         *self) G_GNUC_PURE;
 
 void            gsk_text_node_serialize_glyphs          (GskRenderNode               *self,
                                                          GString                     *str);
+gboolean        gsk_text_node_prepare_threaded_draw     (const GskRenderNode         *node);
 
 GskRenderNode ** gsk_container_node_get_children        (const GskRenderNode         *node,
                                                          guint                       *n_children);
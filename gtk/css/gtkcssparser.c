@@ -117,6 +117,29 @@ gtk_css_parser_new_for_bytes (GBytes                *bytes,
   return result;
 }
 
+/*
+ * gtk_css_parser_new_for_precompiled_bytes:
+ * @bytes: tokens created by gtk_css_tokenizer_precompile()
+ *
+ * Like gtk_css_parser_new_for_bytes(), but for precompiled tokens.
+ */
+GtkCssParser *
+gtk_css_parser_new_for_precompiled_bytes (GBytes                *bytes,
+                                          GFile                 *file,
+                                          GtkCssParserErrorFunc  error_func,
+                                          gpointer               user_data,
+                                          GDestroyNotify         user_destroy)
+{
+  GtkCssTokenizer *tokenizer;
+  GtkCssParser *result;
+
+  tokenizer = gtk_css_tokenizer_new_precompiled (bytes);
+  result = gtk_css_parser_new (tokenizer, file, error_func, user_data, user_destroy);
+  gtk_css_tokenizer_unref (tokenizer);
+
+  return result;
+}
+
 static void
 gtk_css_parser_finalize (GtkCssParser *self)
 {
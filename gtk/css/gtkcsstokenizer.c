@@ -34,10 +34,15 @@ struct _GtkCssTokenizer
 
   const char            *data;
   const char            *end;
+  gboolean               precompiled;
 
   GtkCssLocation         position;
 };
 
+/* Precompiled data starts with this, followed by one record per token */
+#define PRECOMPILED_MAGIC "GCT\1"
+#define PRECOMPILED_MAGIC_LEN 4
+
 void
 gtk_css_token_clear (GtkCssToken *token)
 {
@@ -584,6 +589,35 @@ gtk_css_tokenizer_new (GBytes *bytes)
   return tokenizer;
 }
 
+/**
+ * gtk_css_tokenizer_new_precompiled:
+ * @bytes: data created by gtk_css_tokenizer_precompile()
+ *
+ * Creates a tokenizer that replays the tokens stored in @bytes.
+ *
+ * Data that was not created by gtk_css_tokenizer_precompile() in
+ * this process, like data read from a cache, must be checked with
+ * gtk_css_tokenizer_is_precompiled() first. Reading tokens from
+ * corrupt data fails with an error, but the tokens read until then
+ * may already have been used.
+ *
+ * Returns: a new tokenizer
+ */
+GtkCssTokenizer *
+gtk_css_tokenizer_new_precompiled (GBytes *bytes)
+{
+  GtkCssTokenizer *tokenizer;
+
+  g_return_val_if_fail (g_bytes_get_size (bytes) >= PRECOMPILED_MAGIC_LEN &&
+                        memcmp (g_bytes_get_data (bytes, NULL), PRECOMPILED_MAGIC, PRECOMPILED_MAGIC_LEN) == 0, NULL);
+
+  tokenizer = gtk_css_tokenizer_new (bytes);
+  tokenizer->data += PRECOMPILED_MAGIC_LEN;
+  tokenizer->precompiled = TRUE;
+
+  return tokenizer;
+}
+
 GtkCssTokenizer *
 gtk_css_tokenizer_ref (GtkCssTokenizer *tokenizer)
 {
@@ -1284,6 +1318,344 @@ gtk_css_tokenizer_read_match (GtkCssTokenizer *tokenizer,
     }
 }
 
+/* {{{ Precompiled tokens */
+
+/* Every record is the token type, the end location of the token
+ * relative to its start and the contents of the token, if any.
+ *
+ * Unsigned numbers are stored 7 bits at a time, with the high bit set
+ * when more bytes follow. Doubles are stored in native byte order,
+ * precompiled data is meant to be cached on the machine that made it.
+ */
+
+static void
+precompile_uint (GString *out,
+                 gsize    value)
+{
+  while (value >= 0x80)
+    {
+      g_string_append_c (out, (value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+  g_string_append_c (out, value);
+}
+
+static void
+precompile_double (GString *out,
+                   double   value)
+{
+  g_string_append_len (out, (const char *) &value, sizeof (double));
+}
+
+static void
+precompile_string (GString    *out,
+                   const char *string,
+                   gsize       len)
+{
+  precompile_uint (out, len);
+  g_string_append_len (out, string, len);
+}
+
+static void
+precompile_token (GString              *out,
+                  const GtkCssToken    *token,
+                  const GtkCssLocation *start,
+                  const GtkCssLocation *end)
+{
+  g_string_append_c (out, token->type);
+
+  precompile_uint (out, end->bytes - start->bytes);
+  precompile_uint (out, end->chars - start->chars);
+  precompile_uint (out, end->lines - start->lines);
+  if (end->lines != start->lines)
+    {
+      precompile_uint (out, end->line_bytes);
+      precompile_uint (out, end->line_chars);
+    }
+
+  switch (token->type)
+    {
+    case GTK_CSS_TOKEN_STRING:
+    case GTK_CSS_TOKEN_IDENT:
+    case GTK_CSS_TOKEN_FUNCTION:
+    case GTK_CSS_TOKEN_AT_KEYWORD:
+    case GTK_CSS_TOKEN_HASH_UNRESTRICTED:
+    case GTK_CSS_TOKEN_HASH_ID:
+    case GTK_CSS_TOKEN_URL:
+      precompile_string (out, gtk_css_token_get_string (token), token->string.len);
+      break;
+
+    case GTK_CSS_TOKEN_DELIM:
+      precompile_uint (out, token->delim.delim);
+      break;
+
+    case GTK_CSS_TOKEN_SIGNED_INTEGER:
+    case GTK_CSS_TOKEN_SIGNLESS_INTEGER:
+    case GTK_CSS_TOKEN_SIGNED_NUMBER:
+    case GTK_CSS_TOKEN_SIGNLESS_NUMBER:
+    case GTK_CSS_TOKEN_PERCENTAGE:
+      precompile_double (out, token->number.number);
+      break;
+
+    case GTK_CSS_TOKEN_SIGNED_INTEGER_DIMENSION:
+    case GTK_CSS_TOKEN_SIGNLESS_INTEGER_DIMENSION:
+    case GTK_CSS_TOKEN_SIGNED_DIMENSION:
+    case GTK_CSS_TOKEN_SIGNLESS_DIMENSION:
+      precompile_double (out, token->dimension.value);
+      precompile_string (out, token->dimension.dimension, strlen (token->dimension.dimension));
+      break;
+
+    default:
+      break;
+    }
+}
+
+/* All replay functions check that they stay inside the data and
+ * return %FALSE if they don't, so corrupt data can't make them read
+ * past the end.
+ */
+static gboolean
+replay_uint (GtkCssTokenizer *tokenizer,
+             gsize           *result)
+{
+  guint shift = 0;
+  guchar c;
+
+  *result = 0;
+
+  do
+    {
+      if (tokenizer->data == tokenizer->end || shift >= 8 * sizeof (gsize))
+        return FALSE;
+
+      c = *tokenizer->data++;
+      *result |= (gsize) (c & 0x7f) << shift;
+      shift += 7;
+    }
+  while (c & 0x80);
+
+  return TRUE;
+}
+
+static gboolean
+replay_double (GtkCssTokenizer *tokenizer,
+               double          *result)
+{
+  if (gtk_css_tokenizer_remaining (tokenizer) < sizeof (double))
+    return FALSE;
+
+  memcpy (result, tokenizer->data, sizeof (double));
+  tokenizer->data += sizeof (double);
+
+  return TRUE;
+}
+
+static gboolean
+replay_data (GtkCssTokenizer  *tokenizer,
+             const char      **data,
+             gsize            *len)
+{
+  if (!replay_uint (tokenizer, len) ||
+      gtk_css_tokenizer_remaining (tokenizer) < *len)
+    return FALSE;
+
+  *data = tokenizer->data;
+  tokenizer->data += *len;
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_tokenizer_replay_token (GtkCssTokenizer *tokenizer,
+                                GtkCssToken     *token)
+{
+  GtkCssLocation *position = &tokenizer->position;
+  gsize type, bytes, chars, lines, line_bytes, line_chars, len, delim;
+  const char *data;
+
+  gtk_css_token_init (token, GTK_CSS_TOKEN_EOF);
+
+  type = (guchar) *tokenizer->data++;
+  /* EOF is never stored */
+  if (type == GTK_CSS_TOKEN_EOF || type > GTK_CSS_TOKEN_SIGNLESS_DIMENSION)
+    return FALSE;
+
+  if (!replay_uint (tokenizer, &bytes) ||
+      !replay_uint (tokenizer, &chars) ||
+      !replay_uint (tokenizer, &lines))
+    return FALSE;
+
+  if (lines)
+    {
+      if (!replay_uint (tokenizer, &line_bytes) ||
+          !replay_uint (tokenizer, &line_chars))
+        return FALSE;
+    }
+  else
+    {
+      line_bytes = position->line_bytes + bytes;
+      line_chars = position->line_chars + chars;
+    }
+
+  switch (type)
+    {
+    case GTK_CSS_TOKEN_STRING:
+    case GTK_CSS_TOKEN_IDENT:
+    case GTK_CSS_TOKEN_FUNCTION:
+    case GTK_CSS_TOKEN_AT_KEYWORD:
+    case GTK_CSS_TOKEN_HASH_UNRESTRICTED:
+    case GTK_CSS_TOKEN_HASH_ID:
+    case GTK_CSS_TOKEN_URL:
+      if (!replay_data (tokenizer, &data, &len) || len > G_MAXINT)
+        return FALSE;
+      token->string.type = type;
+      token->string.len = len;
+      if (len < 16)
+        {
+          memcpy (token->string.u.buf, data, len);
+          token->string.u.buf[len] = 0;
+        }
+      else
+        token->string.u.string = g_strndup (data, len);
+      break;
+
+    case GTK_CSS_TOKEN_DELIM:
+      if (!replay_uint (tokenizer, &delim) || !g_unichar_validate (delim))
+        return FALSE;
+      token->delim.type = type;
+      token->delim.delim = delim;
+      break;
+
+    case GTK_CSS_TOKEN_SIGNED_INTEGER:
+    case GTK_CSS_TOKEN_SIGNLESS_INTEGER:
+    case GTK_CSS_TOKEN_SIGNED_NUMBER:
+    case GTK_CSS_TOKEN_SIGNLESS_NUMBER:
+    case GTK_CSS_TOKEN_PERCENTAGE:
+      if (!replay_double (tokenizer, &token->number.number))
+        return FALSE;
+      token->number.type = type;
+      break;
+
+    case GTK_CSS_TOKEN_SIGNED_INTEGER_DIMENSION:
+    case GTK_CSS_TOKEN_SIGNLESS_INTEGER_DIMENSION:
+    case GTK_CSS_TOKEN_SIGNED_DIMENSION:
+    case GTK_CSS_TOKEN_SIGNLESS_DIMENSION:
+      if (!replay_double (tokenizer, &token->dimension.value) ||
+          !replay_data (tokenizer, &data, &len) ||
+          len >= sizeof (token->dimension.dimension))
+        return FALSE;
+      token->dimension.type = type;
+      memcpy (token->dimension.dimension, data, len);
+      token->dimension.dimension[len] = 0;
+      break;
+
+    default:
+      token->type = type;
+      break;
+    }
+
+  position->bytes += bytes;
+  position->chars += chars;
+  position->lines += lines;
+  position->line_bytes = line_bytes;
+  position->line_chars = line_chars;
+
+  return TRUE;
+}
+
+/**
+ * gtk_css_tokenizer_is_precompiled:
+ * @bytes: the data to check
+ *
+ * Checks if @bytes were created by gtk_css_tokenizer_precompile().
+ *
+ * This replays all the tokens, so it also detects truncated
+ * or otherwise corrupt data.
+ *
+ * Returns: %TRUE if the data is valid precompiled data
+ */
+gboolean
+gtk_css_tokenizer_is_precompiled (GBytes *bytes)
+{
+  GtkCssTokenizer *tokenizer;
+  GtkCssToken token;
+  gboolean result;
+  gsize size;
+  const char *data = g_bytes_get_data (bytes, &size);
+
+  if (size < PRECOMPILED_MAGIC_LEN ||
+      memcmp (data, PRECOMPILED_MAGIC, PRECOMPILED_MAGIC_LEN) != 0)
+    return FALSE;
+
+  tokenizer = gtk_css_tokenizer_new_precompiled (bytes);
+
+  result = TRUE;
+  while (result && tokenizer->data < tokenizer->end)
+    {
+      result = gtk_css_tokenizer_replay_token (tokenizer, &token);
+      gtk_css_token_clear (&token);
+    }
+
+  gtk_css_tokenizer_unref (tokenizer);
+
+  return result;
+}
+
+/**
+ * gtk_css_tokenizer_precompile:
+ * @bytes: CSS text
+ *
+ * Tokenizes @bytes and stores the tokens in a binary form. A
+ * tokenizer created for the result returns the same tokens and
+ * locations as one created for @bytes, without having to look at
+ * the text again.
+ *
+ * Text with syntax errors is not precompiled, so that the errors
+ * get reported when the text is parsed.
+ *
+ * Returns: (transfer full) (nullable): the precompiled tokens
+ *   or %NULL if the text contains errors
+ */
+GBytes *
+gtk_css_tokenizer_precompile (GBytes *bytes)
+{
+  GtkCssTokenizer *tokenizer;
+  GtkCssLocation start;
+  GtkCssToken token;
+  GString *out;
+
+  out = g_string_sized_new (g_bytes_get_size (bytes));
+  g_string_append_len (out, PRECOMPILED_MAGIC, PRECOMPILED_MAGIC_LEN);
+
+  tokenizer = gtk_css_tokenizer_new (bytes);
+
+  while (TRUE)
+    {
+      GError *error = NULL;
+
+      start = tokenizer->position;
+      if (!gtk_css_tokenizer_read_token (tokenizer, &token, &error))
+        {
+          g_error_free (error);
+          gtk_css_token_clear (&token);
+          gtk_css_tokenizer_unref (tokenizer);
+          g_string_free (out, TRUE);
+          return NULL;
+        }
+      if (gtk_css_token_is (&token, GTK_CSS_TOKEN_EOF))
+        break;
+
+      precompile_token (out, &token, &start, &tokenizer->position);
+      gtk_css_token_clear (&token);
+    }
+
+  gtk_css_tokenizer_unref (tokenizer);
+
+  return g_string_free_to_bytes (out);
+}
+
+/* }}} */
+
 gboolean
 gtk_css_tokenizer_read_token (GtkCssTokenizer  *tokenizer,
                               GtkCssToken      *token,
@@ -1295,6 +1667,17 @@ gtk_css_tokenizer_read_token (GtkCssTokenizer  *tokenizer,
       return TRUE;
     }
 
+  if (tokenizer->precompiled)
+    {
+      if (gtk_css_tokenizer_replay_token (tokenizer, token))
+        return TRUE;
+
+      /* Don't try to read anything after corrupt data */
+      tokenizer->data = tokenizer->end;
+      gtk_css_tokenizer_parse_error (error, "Corrupt precompiled data");
+      return FALSE;
+    }
+
   if (tokenizer->data[0] == '/' && gtk_css_tokenizer_remaining (tokenizer) > 1 &&
       tokenizer->data[1] == '*')
     return gtk_css_tokenizer_read_comment (tokenizer, token, error);
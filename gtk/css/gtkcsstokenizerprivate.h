@@ -138,6 +138,7 @@ void                    gtk_css_token_print                     (const GtkCssTok
 char *                  gtk_css_token_to_string                 (const GtkCssToken      *token);
 
 GtkCssTokenizer *       gtk_css_tokenizer_new                   (GBytes                 *bytes);
+GtkCssTokenizer *       gtk_css_tokenizer_new_precompiled       (GBytes                 *bytes);
 
 GtkCssTokenizer *       gtk_css_tokenizer_ref                   (GtkCssTokenizer        *tokenizer);
 void                    gtk_css_tokenizer_unref                 (GtkCssTokenizer        *tokenizer);
@@ -148,5 +149,8 @@ gboolean                gtk_css_tokenizer_read_token            (GtkCssTokenizer
                                                                  GtkCssToken            *token,
                                                                  GError                **error);
 
+gboolean                gtk_css_tokenizer_is_precompiled        (GBytes                 *bytes);
+GBytes *                gtk_css_tokenizer_precompile            (GBytes                 *bytes);
+
 G_END_DECLS
 
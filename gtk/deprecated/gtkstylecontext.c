@@ -84,6 +84,7 @@ struct _GtkStyleContextPrivate
   GdkDisplay *display;
 
   guint cascade_changed_id;
+  guint cascade_rules_changed_id;
   GtkStyleCascade *cascade;
   GtkCssNode *cssnode;
   GSList *saved_nodes;
@@ -151,6 +152,14 @@ gtk_style_context_cascade_changed (GtkStyleCascade *cascade,
   gtk_css_node_invalidate_style_provider (gtk_style_context_get_root (context));
 }
 
+static void
+gtk_style_context_cascade_rules_changed (GtkStyleCascade          *cascade,
+                                         const GtkCssSelectorTree *rules,
+                                         GtkStyleContext          *context)
+{
+  gtk_css_node_invalidate_style_rules (gtk_style_context_get_root (context), rules);
+}
+
 static void
 gtk_style_context_set_cascade (GtkStyleContext *context,
                                GtkStyleCascade *cascade)
@@ -164,6 +173,8 @@ gtk_style_context_set_cascade (GtkStyleContext *context,
     {
       g_signal_handler_disconnect (priv->cascade, priv->cascade_changed_id);
       priv->cascade_changed_id = 0;
+      g_signal_handler_disconnect (priv->cascade, priv->cascade_rules_changed_id);
+      priv->cascade_rules_changed_id = 0;
       g_object_unref (priv->cascade);
     }
 
@@ -174,6 +185,10 @@ gtk_style_context_set_cascade (GtkStyleContext *context,
                                                    "gtk-private-changed",
                                                    G_CALLBACK (gtk_style_context_cascade_changed),
                                                    context);
+      priv->cascade_rules_changed_id = g_signal_connect (cascade,
+                                                         "gtk-private-rules-changed",
+                                                         G_CALLBACK (gtk_style_context_cascade_rules_changed),
+                                                         context);
     }
 
   priv->cascade = cascade;
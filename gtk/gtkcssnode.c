@@ -21,12 +21,14 @@
 
 #include "gtkcssstaticstyleprivate.h"
 #include "gtkcssanimatedstyleprivate.h"
+#include "gtkcssselectorprivate.h"
 #include "gtkcssstylepropertyprivate.h"
 #include "gtkmarshalers.h"
 #include "gtksettingsprivate.h"
 #include "gtktypebuiltins.h"
 #include "gtkprivate.h"
 #include "gdkprofilerprivate.h"
+#include "gdk/gdkparalleltaskprivate.h"
 
 /*
  * CSS nodes are the backbone of the GtkStyleContext implementation and
@@ -125,6 +127,29 @@ static int invalidated_nodes;
 static int created_styles;
 static guint invalidated_nodes_counter;
 static guint created_styles_counter;
+static guint shared_style_hits_counter;
+static guint shared_style_misses_counter;
+static guint shared_styles_counter;
+
+/* Changes whenever nodes get invalidated from the outside, so
+ * that selectors matched ahead of time can be checked for being
+ * up to date */
+static guint invalidation_serial;
+
+/* Children are only matched on multiple threads when at least
+ * this many of them need a new style */
+#define MIN_PARALLEL_MATCHES 16
+#define MATCHES_PER_TASK 8
+
+struct _GtkCssNodeMatch
+{
+  GtkCssNode *node;
+  GtkStyleProvider *provider;
+  guint serial;
+  GtkCssChange style_change;
+  GtkCssChange change;
+  GtkCssLookup lookup;
+};
 
 static void
 gtk_css_node_set_invalid (GtkCssNode *node,
@@ -355,12 +380,25 @@ store_in_global_parent_cache (GtkCssNode                  *node,
                                                  style);
 }
 
+static GtkCssChange
+gtk_css_node_get_style_change (GtkCssNode   *cssnode,
+                               GtkCssChange  change)
+{
+  /* Need to recompute the change flags */
+  if (change & GTK_CSS_CHANGE_NEEDS_RECOMPUTE)
+    return 0;
+
+  return gtk_css_static_style_get_change (gtk_css_style_get_static_style (cssnode->style));
+}
+
 static GtkCssStyle *
 gtk_css_node_create_style (GtkCssNode                   *cssnode,
                            const GtkCountingBloomFilter *filter,
                            GtkCssChange                  change)
 {
   const GtkCssNodeDeclaration *decl;
+  GtkStyleProvider *provider;
+  GtkCssNodeMatch *match;
   GtkCssStyle *style;
   GtkCssChange style_change;
 
@@ -372,20 +410,25 @@ gtk_css_node_create_style (GtkCssNode                   *cssnode,
 
   created_styles++;
 
-  if (change & GTK_CSS_CHANGE_NEEDS_RECOMPUTE)
-    {
-      /* Need to recompute the change flags */
-      style_change = 0;
-    }
-  else
-    {
-      style_change = gtk_css_static_style_get_change (gtk_css_style_get_static_style (cssnode->style));
-    }
+  style_change = gtk_css_node_get_style_change (cssnode, change);
+  provider = gtk_css_node_get_style_provider (cssnode);
 
-  style = gtk_css_static_style_new_compute (gtk_css_node_get_style_provider (cssnode),
-                                            filter,
-                                            cssnode,
-                                            style_change);
+  match = cssnode->match;
+  cssnode->match = NULL;
+
+  if (match &&
+      match->serial == invalidation_serial &&
+      match->provider == provider &&
+      match->style_change == style_change)
+    style = gtk_css_static_style_new_from_lookup (provider,
+                                                  &match->lookup,
+                                                  cssnode,
+                                                  match->change);
+  else
+    style = gtk_css_static_style_new_compute (provider,
+                                              filter,
+                                              cssnode,
+                                              style_change);
 
   store_in_global_parent_cache (cssnode, decl, style);
 
@@ -605,6 +648,9 @@ gtk_css_node_class_init (GtkCssNodeClass *klass)
     {
       invalidated_nodes_counter = gdk_profiler_define_int_counter ("invalidated-nodes", "CSS Node Invalidations");
       created_styles_counter = gdk_profiler_define_int_counter ("created-styles", "CSS Style Creations");
+      shared_style_hits_counter = gdk_profiler_define_int_counter ("shared-style-hits", "CSS Styles shared with other nodes");
+      shared_style_misses_counter = gdk_profiler_define_int_counter ("shared-style-misses", "CSS Styles computed for sharing");
+      shared_styles_counter = gdk_profiler_define_int_counter ("shared-styles", "CSS Styles available for sharing");
     }
 }
 
@@ -902,6 +948,25 @@ gtk_css_node_set_style (GtkCssNode  *cssnode,
   return style_changed;
 }
 
+/* Propagating changes during validation doesn't change the serial,
+ * it can't make selectors matched ahead of time invalid */
+static void
+gtk_css_node_do_invalidate (GtkCssNode   *cssnode,
+                            GtkCssChange  change)
+{
+  if (!cssnode->invalid)
+    change &= ~GTK_CSS_CHANGE_TIMESTAMP;
+
+  if (change == 0)
+    return;
+
+  cssnode->pending_changes |= change;
+
+  if (cssnode->parent)
+    cssnode->parent->needs_propagation = TRUE;
+  gtk_css_node_invalidate_style (cssnode);
+}
+
 static void
 gtk_css_node_propagate_pending_changes (GtkCssNode *cssnode,
                                         gboolean    style_changed)
@@ -921,7 +986,7 @@ gtk_css_node_propagate_pending_changes (GtkCssNode *cssnode,
        child = gtk_css_node_get_next_sibling (child))
     {
       child_change = child->pending_changes;
-      gtk_css_node_invalidate (child, change);
+      gtk_css_node_do_invalidate (child, change);
       if (child->visible)
         change |= _gtk_css_change_for_sibling (child_change);
     }
@@ -1258,6 +1323,28 @@ gtk_css_node_invalidate_style_provider (GtkCssNode *cssnode)
     }
 }
 
+/* Like gtk_css_node_invalidate_style_provider(), but only for the
+ * nodes that @rules could apply to. Children of those nodes still get
+ * restyled via the usual parent style propagation.
+ */
+void
+gtk_css_node_invalidate_style_rules (GtkCssNode               *cssnode,
+                                     const GtkCssSelectorTree *rules)
+{
+  GtkCssNode *child;
+
+  if (gtk_css_selector_tree_could_match (rules, NULL, cssnode))
+    gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_SOURCE);
+
+  for (child = cssnode->first_child;
+       child;
+       child = child->next_sibling)
+    {
+      if (gtk_css_node_get_style_provider_or_null (child) == NULL)
+        gtk_css_node_invalidate_style_rules (child, rules);
+    }
+}
+
 static void
 gtk_css_node_invalidate_timestamp (GtkCssNode *cssnode)
 {
@@ -1293,17 +1380,158 @@ void
 gtk_css_node_invalidate (GtkCssNode   *cssnode,
                          GtkCssChange  change)
 {
-  if (!cssnode->invalid)
-    change &= ~GTK_CSS_CHANGE_TIMESTAMP;
+  invalidation_serial++;
 
-  if (change == 0)
-    return;
+  gtk_css_node_do_invalidate (cssnode, change);
+}
 
-  cssnode->pending_changes |= change;
+static gboolean
+gtk_css_node_needs_match (GtkCssNode *cssnode)
+{
+  return cssnode->visible &&
+         cssnode->invalid &&
+         cssnode->style_is_invalid &&
+         gtk_css_style_needs_recreation (GTK_CSS_STYLE (gtk_css_style_get_static_style (cssnode->style)),
+                                         cssnode->pending_changes);
+}
 
-  if (cssnode->parent)
-    cssnode->parent->needs_propagation = TRUE;
-  gtk_css_node_invalidate_style (cssnode);
+typedef struct
+{
+  const GtkCountingBloomFilter *filter;
+  GtkCssNodeMatch *matches;
+  int n_matches;
+  int next;
+} GtkCssNodeMatchTask;
+
+static void
+gtk_css_node_match_task (gpointer data)
+{
+  GtkCssNodeMatchTask *task = data;
+  int i;
+
+  /* Selector matching only reads the nodes and the providers,
+   * nothing else runs on the main thread while this happens */
+  while ((i = g_atomic_int_add (&task->next, 1)) < task->n_matches)
+    {
+      GtkCssNodeMatch *match = &task->matches[i];
+
+      gtk_style_provider_lookup (match->provider,
+                                 task->filter,
+                                 match->node,
+                                 &match->lookup,
+                                 match->change == 0 ? &match->change : NULL);
+    }
+}
+
+/*
+ * Matches the selectors for the children of @cssnode that are
+ * going to need a new style on multiple threads, so that only
+ * computing the values is left for gtk_css_node_create_style().
+ *
+ * Children that will likely find their style in the global parent
+ * cache are skipped, so are nodes with few children.
+ */
+static GtkCssNodeMatch *
+gtk_css_node_match_children (GtkCssNode             *cssnode,
+                             GtkCountingBloomFilter *filter,
+                             guint                  *out_n_matches)
+{
+  GtkCssNodeMatchTask task;
+  GtkCssNodeMatch *matches;
+  GHashTable *decls;
+  GPtrArray *children;
+  GtkCssNode *child;
+  guint i;
+
+  i = 0;
+  for (child = gtk_css_node_get_first_child (cssnode);
+       child && i < MIN_PARALLEL_MATCHES;
+       child = gtk_css_node_get_next_sibling (child))
+    {
+      if (gtk_css_node_needs_match (child))
+        i++;
+    }
+
+  if (i < MIN_PARALLEL_MATCHES)
+    return NULL;
+
+  children = g_ptr_array_new ();
+  decls = g_hash_table_new (gtk_css_node_declaration_hash,
+                            gtk_css_node_declaration_equal);
+
+  for (child = gtk_css_node_get_first_child (cssnode);
+       child;
+       child = gtk_css_node_get_next_sibling (child))
+    {
+      if (!gtk_css_node_needs_match (child))
+        continue;
+
+      if (may_use_global_parent_cache (child) &&
+          !g_hash_table_add (decls, child->decl))
+        continue;
+
+      g_ptr_array_add (children, child);
+    }
+
+  g_hash_table_unref (decls);
+
+  if (children->len < MIN_PARALLEL_MATCHES)
+    {
+      g_ptr_array_unref (children);
+      return NULL;
+    }
+
+  matches = g_new (GtkCssNodeMatch, children->len);
+  for (i = 0; i < children->len; i++)
+    {
+      GtkCssNodeMatch *match = &matches[i];
+
+      child = g_ptr_array_index (children, i);
+
+      match->node = g_object_ref (child);
+      match->provider = gtk_css_node_get_style_provider (child);
+      match->serial = invalidation_serial;
+      match->style_change = gtk_css_node_get_style_change (child, child->pending_changes);
+      match->change = match->style_change;
+      _gtk_css_lookup_init (&match->lookup);
+
+      child->match = match;
+    }
+
+  task.filter = filter;
+  task.matches = matches;
+  task.n_matches = children->len;
+  task.next = 0;
+
+  gtk_css_node_declaration_add_bloom_hashes (cssnode->decl, filter);
+  gdk_parallel_task_run (gtk_css_node_match_task,
+                         &task,
+                         (children->len + MATCHES_PER_TASK - 1) / MATCHES_PER_TASK);
+  gtk_css_node_declaration_remove_bloom_hashes (cssnode->decl, filter);
+
+  *out_n_matches = children->len;
+  g_ptr_array_unref (children);
+
+  return matches;
+}
+
+static void
+gtk_css_node_free_matches (GtkCssNodeMatch *matches,
+                           guint            n_matches)
+{
+  guint i;
+
+  for (i = 0; i < n_matches; i++)
+    {
+      /* Unused if the child's style didn't need to be computed after all */
+      if (matches[i].node->match == &matches[i])
+        matches[i].node->match = NULL;
+
+      _gtk_css_lookup_destroy (&matches[i].lookup);
+      g_object_unref (matches[i].node);
+    }
+
+  g_free (matches);
 }
 
 static void
@@ -1311,6 +1539,8 @@ gtk_css_node_validate_internal (GtkCssNode             *cssnode,
                                 GtkCountingBloomFilter *filter,
                                 gint64                  timestamp)
 {
+  GtkCssNodeMatch *matches;
+  guint n_matches = 0;
   GtkCssNode *child;
   gboolean bloomed = FALSE;
 
@@ -1326,6 +1556,8 @@ gtk_css_node_validate_internal (GtkCssNode             *cssnode,
 
   GTK_CSS_NODE_GET_CLASS (cssnode)->validate (cssnode);
 
+  matches = gtk_css_node_match_children (cssnode, filter, &n_matches);
+
   for (child = gtk_css_node_get_first_child (cssnode);
        child;
        child = gtk_css_node_get_next_sibling (child))
@@ -1344,6 +1576,9 @@ gtk_css_node_validate_internal (GtkCssNode             *cssnode,
 
   if (bloomed)
     gtk_css_node_declaration_remove_bloom_hashes (cssnode->decl, filter);
+
+  if (matches)
+    gtk_css_node_free_matches (matches, n_matches);
 }
 
 void
@@ -1363,11 +1598,21 @@ gtk_css_node_validate (GtkCssNode *cssnode)
 
   if (GDK_PROFILER_IS_RUNNING)
     {
+      static guint last_hits, last_misses;
+      guint hits, misses, n_shared;
+
+      gtk_css_static_style_get_shared_stats (&hits, &misses, &n_shared);
+
       gdk_profiler_end_mark (before,  "css validation", "");
       gdk_profiler_set_int_counter (invalidated_nodes_counter, invalidated_nodes);
       gdk_profiler_set_int_counter (created_styles_counter, created_styles);
+      gdk_profiler_set_int_counter (shared_style_hits_counter, hits - last_hits);
+      gdk_profiler_set_int_counter (shared_style_misses_counter, misses - last_misses);
+      gdk_profiler_set_int_counter (shared_styles_counter, n_shared);
       invalidated_nodes = 0;
       created_styles = 0;
+      last_hits = hits;
+      last_misses = misses;
     }
 }
 
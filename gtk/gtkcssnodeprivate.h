@@ -35,6 +35,7 @@ G_BEGIN_DECLS
 #define GTK_CSS_NODE_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), GTK_TYPE_CSS_NODE, GtkCssNodeClass))
 
 typedef struct _GtkCssNodeClass         GtkCssNodeClass;
+typedef struct _GtkCssNodeMatch         GtkCssNodeMatch;
 
 struct _GtkCssNode
 {
@@ -51,6 +52,7 @@ struct _GtkCssNode
   GtkCssNodeDeclaration *decl;
   GtkCssStyle           *style;
   GtkCssNodeStyleCache  *cache;                 /* cache for children to look up styles */
+  GtkCssNodeMatch       *match;                 /* selectors matched ahead of time by the parent, or NULL */
 
   GtkCssChange           pending_changes;       /* changes that accumulated since the style was last computed */
 
@@ -144,6 +146,9 @@ GtkCssStyle *           gtk_css_node_get_style          (GtkCssNode            *
 
 void                    gtk_css_node_invalidate_style_provider
                                                         (GtkCssNode            *cssnode);
+void                    gtk_css_node_invalidate_style_rules
+                                                        (GtkCssNode            *cssnode,
+                                                         const GtkCssSelectorTree *rules);
 void                    gtk_css_node_invalidate_frame_clock
                                                         (GtkCssNode            *cssnode,
                                                          gboolean               just_timestamp);
@@ -21,9 +21,11 @@
 
 #include "gtkdebug.h"
 #include "gtkcssstaticstyleprivate.h"
+#include "gtkstyleproviderprivate.h"
 
 struct _GtkCssNodeStyleCache {
   guint        ref_count;
+  guint        generation;
   GtkCssStyle *style;
   GHashTable  *children;
 };
@@ -40,6 +42,7 @@ gtk_css_node_style_cache_new (GtkCssStyle *style)
   result = g_new0 (GtkCssNodeStyleCache, 1);
 
   result->ref_count = 1;
+  result->generation = gtk_style_provider_get_generation ();
   result->style = g_object_ref (style);
 
   return result;
@@ -175,6 +178,12 @@ gtk_css_node_style_cache_lookup (GtkCssNodeStyleCache        *parent,
   if (result == NULL)
     return NULL;
 
+  /* Providers can change their rules without invalidating every node,
+   * so the parent may outlive the styles cached for its children.
+   */
+  if (result->generation != gtk_style_provider_get_generation ())
+    return NULL;
+
   return gtk_css_node_style_cache_ref (result);
 }
 
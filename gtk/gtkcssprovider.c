@@ -38,6 +38,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <glib/gstdio.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include "gdk/gdkprofilerprivate.h"
@@ -112,6 +113,7 @@ struct GtkCssRuleset
   GtkCssSelectorTree *selector_match;
   PropertyValue *styles;
   guint n_styles;
+  guint rules_id;
   guint owns_styles : 1;
 };
 
@@ -133,6 +135,11 @@ struct _GtkCssProviderPrivate
   GtkCssSelectorTree *tree;
   GResource *resource;
   char *path;
+
+  /* for gtk_css_provider_add_rules() */
+  guint last_rules_id;
+  guint loading_rules_id;
+  guint defines_changed : 1;
 };
 
 enum {
@@ -355,7 +362,8 @@ static GtkCssScanner *
 gtk_css_scanner_new (GtkCssProvider *provider,
                      GtkCssScanner  *parent,
                      GFile          *file,
-                     GBytes         *bytes)
+                     GBytes         *bytes,
+                     gboolean        precompiled)
 {
   GtkCssScanner *scanner;
 
@@ -365,11 +373,18 @@ gtk_css_scanner_new (GtkCssProvider *provider,
   scanner->provider = provider;
   scanner->parent = parent;
 
-  scanner->parser = gtk_css_parser_new_for_bytes (bytes,
-                                                  file,
-                                                  gtk_css_scanner_parser_error,
-                                                  scanner,
-                                                  NULL);
+  if (precompiled)
+    scanner->parser = gtk_css_parser_new_for_precompiled_bytes (bytes,
+                                                                file,
+                                                                gtk_css_scanner_parser_error,
+                                                                scanner,
+                                                                NULL);
+  else
+    scanner->parser = gtk_css_parser_new_for_bytes (bytes,
+                                                    file,
+                                                    gtk_css_scanner_parser_error,
+                                                    scanner,
+                                                    NULL);
 
   return scanner;
 }
@@ -587,6 +602,7 @@ css_provider_commit (GtkCssProvider  *css_provider,
 
       new = &g_array_index (priv->rulesets, GtkCssRuleset, priv->rulesets->len - 1);
       gtk_css_ruleset_init_copy (new, ruleset, gtk_css_selectors_get (selectors, i));
+      new->rules_id = priv->loading_rules_id;
     }
 }
 
@@ -721,6 +737,7 @@ parse_color_definition (GtkCssScanner *scanner)
     }
 
   g_hash_table_insert (priv->symbolic_colors, name, color);
+  priv->defines_changed = TRUE;
 
   return TRUE;
 }
@@ -749,7 +766,10 @@ parse_keyframes (GtkCssScanner *scanner)
 
   keyframes = _gtk_css_keyframes_parse (scanner->parser);
   if (keyframes != NULL)
-    g_hash_table_insert (priv->keyframes, name, keyframes);
+    {
+      g_hash_table_insert (priv->keyframes, name, keyframes);
+      priv->defines_changed = TRUE;
+    }
 
   if (!gtk_css_parser_has_token (scanner->parser, GTK_CSS_TOKEN_EOF))
     gtk_css_parser_error_syntax (scanner->parser, "Expected '}' after declarations");
@@ -1019,6 +1039,252 @@ gtk_css_provider_postprocess (GtkCssProvider *css_provider)
   gdk_profiler_end_mark (before, "create selector tree", NULL);
 }
 
+/* Undoes the freeing of selectors in gtk_css_provider_postprocess(),
+ * so the rulesets can be modified and the tree can be rebuilt.
+ */
+static void
+gtk_css_provider_unpack (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+  guint i;
+
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset;
+
+      ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+      if (ruleset->selector == NULL)
+        ruleset->selector = _gtk_css_selector_tree_get_selector (ruleset->selector_match);
+      ruleset->selector_match = NULL;
+    }
+
+  _gtk_css_selector_tree_free (priv->tree);
+  priv->tree = NULL;
+}
+
+/* Builds a tree of all the selectors of the rules with @rules_id,
+ * or of all rules starting at @first if @rules_id is 0.
+ */
+static GtkCssSelectorTree *
+gtk_css_provider_build_rules_tree (GtkCssProvider *css_provider,
+                                   guint           rules_id,
+                                   guint           first)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+  GtkCssSelectorTreeBuilder *builder;
+  GtkCssSelectorTree *tree;
+  guint i;
+
+  builder = _gtk_css_selector_tree_builder_new ();
+  for (i = first; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset;
+
+      ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      if (rules_id != 0 && ruleset->rules_id != rules_id)
+        continue;
+
+      _gtk_css_selector_tree_builder_add (builder,
+                                          ruleset->selector,
+                                          NULL,
+                                          ruleset);
+    }
+
+  tree = _gtk_css_selector_tree_builder_build (builder);
+  _gtk_css_selector_tree_builder_free (builder);
+
+  return tree;
+}
+
+/* Restyles the nodes affected by @rules, or all nodes if named colors
+ * or keyframes were changed, because those can be referenced by rules
+ * that were not touched.
+ */
+static void
+gtk_css_provider_rules_changed (GtkCssProvider     *css_provider,
+                                GtkCssSelectorTree *rules)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+
+  if (priv->defines_changed)
+    gtk_style_provider_changed (GTK_STYLE_PROVIDER (css_provider));
+  else if (rules != NULL)
+    gtk_style_provider_rules_changed (GTK_STYLE_PROVIDER (css_provider), rules);
+
+  _gtk_css_selector_tree_free (rules);
+}
+
+/* Stylesheets smaller than this are tokenized faster than the
+ * cache can be checked.
+ */
+#define MIN_PRECOMPILE_SIZE (16 * 1024)
+#define PRECOMPILED_CACHE_VERSION "3"
+/* Only the most recently used stylesheets are kept */
+#define MAX_PRECOMPILED_CACHE_FILES 16
+
+typedef struct {
+  char *path;
+  gint64 mtime;
+} CacheFile;
+
+static int
+cache_file_compare_newest_first (gconstpointer a,
+                                 gconstpointer b)
+{
+  const CacheFile *file_a = a;
+  const CacheFile *file_b = b;
+
+  if (file_a->mtime > file_b->mtime)
+    return -1;
+  else if (file_a->mtime < file_b->mtime)
+    return 1;
+  else
+    return 0;
+}
+
+/* Removes all but the most recently used files from the cache
+ * directory. Cache hits update the modification time of their file.
+ */
+static void
+gtk_css_provider_prune_precompiled (const char *dir)
+{
+  GArray *files;
+  GDir *gdir;
+  const char *name;
+  guint i;
+
+  gdir = g_dir_open (dir, 0, NULL);
+  if (gdir == NULL)
+    return;
+
+  files = g_array_new (FALSE, FALSE, sizeof (CacheFile));
+  while ((name = g_dir_read_name (gdir)))
+    {
+      CacheFile file;
+      GStatBuf buf;
+
+      file.path = g_build_filename (dir, name, NULL);
+      if (!g_file_test (file.path, G_FILE_TEST_IS_REGULAR) ||
+          g_stat (file.path, &buf) != 0)
+        {
+          g_free (file.path);
+          continue;
+        }
+
+      file.mtime = buf.st_mtime;
+      g_array_append_val (files, file);
+    }
+  g_dir_close (gdir);
+
+  g_array_sort (files, cache_file_compare_newest_first);
+
+  for (i = 0; i < files->len; i++)
+    {
+      CacheFile *file = &g_array_index (files, CacheFile, i);
+
+      if (i >= MAX_PRECOMPILED_CACHE_FILES)
+        g_remove (file->path);
+
+      g_free (file->path);
+    }
+
+  g_array_unref (files);
+}
+
+/* Returns the tokens of @bytes from the on-disk cache, creating the
+ * cache entry if it doesn't exist yet. Cache files are named after the
+ * checksum of the stylesheet. They start with a header containing the
+ * GTK version and the checksum, then a line with the checksum of the
+ * data from gtk_css_tokenizer_precompile() that follows.
+ *
+ * Checking the data checksum is much cheaper than replaying all tokens
+ * with gtk_css_tokenizer_is_precompiled(), and the replay still checks
+ * its bounds. Cache files from other GTK versions or with corrupt data
+ * are ignored and replaced.
+ *
+ * Returns NULL if the stylesheet should be parsed from text.
+ */
+static GBytes *
+gtk_css_provider_get_precompiled (GBytes *bytes)
+{
+  GBytes *result = NULL;
+  GMappedFile *mapped;
+  char *checksum, *header, *dir, *path;
+  gsize header_len, data_start;
+
+  if (g_bytes_get_size (bytes) < MIN_PRECOMPILE_SIZE ||
+      GTK_DEBUG_CHECK (NO_CSS_CACHE))
+    return NULL;
+
+  checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, bytes);
+  header = g_strdup_printf ("GtkCss" PRECOMPILED_CACHE_VERSION " %d.%d.%d %s\n",
+                            GTK_MAJOR_VERSION, GTK_MINOR_VERSION, GTK_MICRO_VERSION,
+                            checksum);
+  header_len = strlen (header);
+  /* the data checksum has the same length as @checksum */
+  data_start = header_len + strlen (checksum) + 1;
+  dir = g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "css", NULL);
+  path = g_build_filename (dir, checksum, NULL);
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped)
+    {
+      GBytes *contents = g_mapped_file_get_bytes (mapped);
+      const char *data = g_bytes_get_data (contents, NULL);
+
+      if (g_bytes_get_size (contents) > data_start &&
+          memcmp (data, header, header_len) == 0 &&
+          data[data_start - 1] == '\n')
+        {
+          char *data_checksum;
+
+          result = g_bytes_new_from_bytes (contents, data_start, g_bytes_get_size (contents) - data_start);
+          data_checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, result);
+          if (memcmp (data + header_len, data_checksum, data_start - header_len - 1) == 0)
+            g_utime (path, NULL);
+          else
+            g_clear_pointer (&result, g_bytes_unref);
+          g_free (data_checksum);
+        }
+
+      g_bytes_unref (contents);
+      g_mapped_file_unref (mapped);
+    }
+
+  if (result == NULL)
+    {
+      GString *contents;
+
+      result = gtk_css_tokenizer_precompile (bytes);
+      if (result)
+        {
+          char *data_checksum;
+
+          data_checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, result);
+          contents = g_string_new (header);
+          g_string_append (contents, data_checksum);
+          g_string_append_c (contents, '\n');
+          g_string_append_len (contents, g_bytes_get_data (result, NULL), g_bytes_get_size (result));
+          g_free (data_checksum);
+
+          /* Failing to write the cache is not an error, we'll try again next time */
+          if (g_mkdir_with_parents (dir, 0755) == 0 &&
+              g_file_set_contents (path, contents->str, contents->len, NULL))
+            gtk_css_provider_prune_precompiled (dir);
+
+          g_string_free (contents, TRUE);
+        }
+    }
+
+  g_free (path);
+  g_free (dir);
+  g_free (header);
+  g_free (checksum);
+
+  return result;
+}
+
 static void
 gtk_css_provider_load_internal (GtkCssProvider *self,
                                 GtkCssScanner  *parent,
@@ -1062,11 +1328,15 @@ gtk_css_provider_load_internal (GtkCssProvider *self,
   if (bytes)
     {
       GtkCssScanner *scanner;
+      GBytes *precompiled;
+
+      precompiled = gtk_css_provider_get_precompiled (bytes);
 
       scanner = gtk_css_scanner_new (self,
                                      parent,
                                      file,
-                                     bytes);
+                                     precompiled ? precompiled : bytes,
+                                     precompiled != NULL);
 
       parse_stylesheet (scanner);
 
@@ -1075,6 +1345,7 @@ gtk_css_provider_load_internal (GtkCssProvider *self,
       if (parent == NULL)
         gtk_css_provider_postprocess (self);
 
+      g_clear_pointer (&precompiled, g_bytes_unref);
       g_bytes_unref (bytes);
     }
 
@@ -1252,6 +1523,121 @@ gtk_css_provider_load_from_resource (GtkCssProvider *css_provider,
   g_object_unref (file);
 }
 
+/**
+ * gtk_css_provider_add_rules:
+ * @css_provider: a `GtkCssProvider`
+ * @string: the CSS to add
+ *
+ * Parses @string and adds the resulting rules to @css_provider,
+ * keeping the rules that were loaded before.
+ *
+ * Unlike loading the complete stylesheet again, this only restyles
+ * the widgets that the new rules can apply to. This makes it a good
+ * fit for small changes at runtime, like highlighting a widget.
+ *
+ * Named colors and keyframes defined in @string are added too, but
+ * they cause all widgets to be restyled and are not removed by
+ * [method@Gtk.CssProvider.remove_rules].
+ *
+ * Returns: an id for the added rules, to be passed to
+ *   [method@Gtk.CssProvider.remove_rules]
+ *
+ * Since: 4.14
+ */
+guint
+gtk_css_provider_add_rules (GtkCssProvider *css_provider,
+                            const char     *string)
+{
+  GtkCssProviderPrivate *priv;
+  GtkCssScanner *scanner;
+  GtkCssSelectorTree *rules;
+  GBytes *bytes;
+  guint first;
+
+  g_return_val_if_fail (GTK_IS_CSS_PROVIDER (css_provider), 0);
+  g_return_val_if_fail (string != NULL, 0);
+
+  priv = gtk_css_provider_get_instance_private (css_provider);
+
+  gtk_css_provider_unpack (css_provider);
+
+  priv->last_rules_id++;
+  priv->loading_rules_id = priv->last_rules_id;
+  priv->defines_changed = FALSE;
+  first = priv->rulesets->len;
+
+  bytes = g_bytes_new_static (string, strlen (string));
+  scanner = gtk_css_scanner_new (css_provider, NULL, NULL, bytes, FALSE);
+  parse_stylesheet (scanner);
+  gtk_css_scanner_destroy (scanner);
+  g_bytes_unref (bytes);
+
+  priv->loading_rules_id = 0;
+
+  rules = gtk_css_provider_build_rules_tree (css_provider, 0, first);
+
+  gtk_css_provider_postprocess (css_provider);
+
+  gtk_css_provider_rules_changed (css_provider, rules);
+
+  return priv->last_rules_id;
+}
+
+/**
+ * gtk_css_provider_remove_rules:
+ * @css_provider: a `GtkCssProvider`
+ * @id: the id returned by [method@Gtk.CssProvider.add_rules]
+ *
+ * Removes the rules that were added with
+ * [method@Gtk.CssProvider.add_rules] and restyles the widgets
+ * they applied to.
+ *
+ * Loading a new stylesheet into @css_provider removes all added
+ * rules, after that this function does nothing.
+ *
+ * Since: 4.14
+ */
+void
+gtk_css_provider_remove_rules (GtkCssProvider *css_provider,
+                               guint           id)
+{
+  GtkCssProviderPrivate *priv;
+  GtkCssSelectorTree *rules;
+  guint i, j;
+
+  g_return_if_fail (GTK_IS_CSS_PROVIDER (css_provider));
+  g_return_if_fail (id != 0);
+
+  priv = gtk_css_provider_get_instance_private (css_provider);
+
+  gtk_css_provider_unpack (css_provider);
+
+  rules = gtk_css_provider_build_rules_tree (css_provider, id, 0);
+
+  for (i = 0, j = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset;
+
+      ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      if (ruleset->rules_id == id)
+        {
+          gtk_css_ruleset_clear (ruleset);
+          continue;
+        }
+
+      if (i != j)
+        g_array_index (priv->rulesets, GtkCssRuleset, j) = *ruleset;
+      j++;
+    }
+  g_array_set_size (priv->rulesets, j);
+
+  priv->defines_changed = FALSE;
+
+  gtk_css_provider_postprocess (css_provider);
+
+  gtk_css_provider_rules_changed (css_provider, rules);
+}
+
 char *
 _gtk_get_theme_dir (void)
 {
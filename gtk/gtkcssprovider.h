@@ -73,6 +73,13 @@ void             gtk_css_provider_load_named     (GtkCssProvider  *provider,
                                                   const char      *name,
                                                   const char      *variant);
 
+GDK_AVAILABLE_IN_4_14
+guint            gtk_css_provider_add_rules      (GtkCssProvider  *css_provider,
+                                                  const char      *string);
+GDK_AVAILABLE_IN_4_14
+void             gtk_css_provider_remove_rules   (GtkCssProvider  *css_provider,
+                                                  guint            id);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GtkCssProvider, g_object_unref)
 
 G_END_DECLS
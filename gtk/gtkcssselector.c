@@ -126,6 +126,34 @@ struct _GtkCssSelectorTree
   gint32 matches_offset; /* pointers that we return as matches if selector matches */
 };
 
+/* The tree is stored in one allocation, starting with this index of the
+ * root level of the tree. Most root level selectors check the name, id
+ * or a class of the node, so instead of trying every one of them we look
+ * up the ones that can match in a hash table and only try those.
+ *
+ * The lists of roots are stored after the tree as offsets to the roots,
+ * terminated by GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET.
+ */
+typedef struct
+{
+  GHashTable *roots;            /* ROOT_KEY () => offset of list of roots */
+  gint32      other_roots;      /* offset of list of roots that must always be tried */
+} GtkCssSelectorTreeIndex;
+
+typedef enum {
+  ROOT_NAME,
+  ROOT_ID,
+  ROOT_CLASS
+} RootKind;
+
+#define ROOT_KEY(kind, quark) GUINT_TO_POINTER (((guint) (quark) << 2) | (kind))
+
+static inline GtkCssSelectorTreeIndex *
+gtk_css_selector_tree_get_index (const GtkCssSelectorTree *tree)
+{
+  return (GtkCssSelectorTreeIndex *) ((guint8 *) tree - sizeof (GtkCssSelectorTreeIndex));
+}
+
 static gboolean
 gtk_css_selector_equal (const GtkCssSelector *a,
 			const GtkCssSelector *b)
@@ -1924,20 +1952,68 @@ gtk_css_selector_tree_match (const GtkCssSelectorTree      *tree,
   return TRUE;
 }
 
+static const gint32 *
+gtk_css_selector_tree_lookup_roots (const GtkCssSelectorTree *tree,
+                                    RootKind                  kind,
+                                    GQuark                    quark)
+{
+  GtkCssSelectorTreeIndex *index = gtk_css_selector_tree_get_index (tree);
+  gint32 offset;
+
+  /* lists are stored after the tree, so their offset is never 0 */
+  offset = GPOINTER_TO_INT (g_hash_table_lookup (index->roots, ROOT_KEY (kind, quark)));
+  if (offset == 0)
+    return NULL;
+
+  return (const gint32 *) ((const guint8 *) tree + offset);
+}
+
+static const gint32 *
+gtk_css_selector_tree_get_other_roots (const GtkCssSelectorTree *tree)
+{
+  GtkCssSelectorTreeIndex *index = gtk_css_selector_tree_get_index (tree);
+
+  return (const gint32 *) ((const guint8 *) tree + index->other_roots);
+}
+
+static void
+gtk_css_selector_tree_match_roots (const GtkCssSelectorTree     *tree,
+                                   const gint32                 *roots,
+                                   const GtkCountingBloomFilter *filter,
+                                   GtkCssNode                   *node,
+                                   GtkCssSelectorMatches        *results)
+{
+  if (roots == NULL)
+    return;
+
+  for (; *roots != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET; roots++)
+    gtk_css_selector_tree_match (gtk_css_selector_tree_at_offset (tree, *roots), filter, FALSE, node, results);
+}
+
 void
 _gtk_css_selector_tree_match_all (const GtkCssSelectorTree     *tree,
                                   const GtkCountingBloomFilter *filter,
                                   GtkCssNode                   *node,
                                   GtkCssSelectorMatches        *out_tree_rules)
 {
-  const GtkCssSelectorTree *iter;
+  const GQuark *classes;
+  guint i, n_classes;
 
-  for (iter = tree;
-       iter != NULL;
-       iter = gtk_css_selector_tree_get_sibling (iter))
-    {
-      gtk_css_selector_tree_match (iter, filter, FALSE, node, out_tree_rules);
-    }
+  classes = gtk_css_node_declaration_get_classes (gtk_css_node_get_declaration (node), &n_classes);
+
+  gtk_css_selector_tree_match_roots (tree,
+                                     gtk_css_selector_tree_get_other_roots (tree),
+                                     filter, node, out_tree_rules);
+  gtk_css_selector_tree_match_roots (tree,
+                                     gtk_css_selector_tree_lookup_roots (tree, ROOT_NAME, gtk_css_node_get_name (node)),
+                                     filter, node, out_tree_rules);
+  gtk_css_selector_tree_match_roots (tree,
+                                     gtk_css_selector_tree_lookup_roots (tree, ROOT_ID, gtk_css_node_get_id (node)),
+                                     filter, node, out_tree_rules);
+  for (i = 0; i < n_classes; i++)
+    gtk_css_selector_tree_match_roots (tree,
+                                       gtk_css_selector_tree_lookup_roots (tree, ROOT_CLASS, classes[i]),
+                                       filter, node, out_tree_rules);
 }
 
 gboolean
@@ -1946,21 +2022,120 @@ _gtk_css_selector_tree_is_empty (const GtkCssSelectorTree *tree)
   return tree == NULL;
 }
 
+static GtkCssChange
+gtk_css_selector_tree_change_roots (const GtkCssSelectorTree     *tree,
+                                    const gint32                 *roots,
+                                    const GtkCountingBloomFilter *filter,
+                                    GtkCssNode                   *node)
+{
+  GtkCssChange change = 0;
+
+  if (roots == NULL)
+    return 0;
+
+  for (; *roots != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET; roots++)
+    change |= gtk_css_selector_tree_get_change (gtk_css_selector_tree_at_offset (tree, *roots), filter, node, FALSE);
+
+  return change;
+}
+
+/* Returns the change including GTK_CSS_CHANGE_GOT_MATCH */
+static GtkCssChange
+gtk_css_selector_tree_get_change_internal (const GtkCssSelectorTree     *tree,
+                                           const GtkCountingBloomFilter *filter,
+                                           GtkCssNode                   *node)
+{
+  GtkCssChange change = 0;
+  const GQuark *classes;
+  guint i, n_classes;
+
+  if (tree == NULL)
+    return 0;
+
+  classes = gtk_css_node_declaration_get_classes (gtk_css_node_get_declaration (node), &n_classes);
+
+  change |= gtk_css_selector_tree_change_roots (tree,
+                                                gtk_css_selector_tree_get_other_roots (tree),
+                                                filter, node);
+  change |= gtk_css_selector_tree_change_roots (tree,
+                                                gtk_css_selector_tree_lookup_roots (tree, ROOT_NAME, gtk_css_node_get_name (node)),
+                                                filter, node);
+  change |= gtk_css_selector_tree_change_roots (tree,
+                                                gtk_css_selector_tree_lookup_roots (tree, ROOT_ID, gtk_css_node_get_id (node)),
+                                                filter, node);
+  for (i = 0; i < n_classes; i++)
+    change |= gtk_css_selector_tree_change_roots (tree,
+                                                  gtk_css_selector_tree_lookup_roots (tree, ROOT_CLASS, classes[i]),
+                                                  filter, node);
+
+  return change;
+}
+
 GtkCssChange
 gtk_css_selector_tree_get_change_all (const GtkCssSelectorTree     *tree,
                                       const GtkCountingBloomFilter *filter,
 				      GtkCssNode                   *node)
 {
-  GtkCssChange change = 0;
+  GtkCssChange change;
 
-  for (; tree != NULL;
-       tree = gtk_css_selector_tree_get_sibling (tree))
-    change |= gtk_css_selector_tree_get_change (tree, filter, node, FALSE);
+  change = gtk_css_selector_tree_get_change_internal (tree, filter, node);
 
   /* Never return reserved bit set */
   return change & ~GTK_CSS_CHANGE_RESERVED_BIT;
 }
 
+/*
+ * gtk_css_selector_tree_could_match:
+ * @tree: a selector tree
+ * @filter: (nullable): bloom filter for the ancestors of @node
+ * @node: the node to check
+ *
+ * Checks if any selector in @tree matches @node, or could match it
+ * after changes that don't affect the name, id or classes of @node.
+ * Ancestors and siblings are only checked via @filter, so this may
+ * return %TRUE for selectors that don't match.
+ *
+ * Returns: %FALSE if no selector in @tree can match @node
+ */
+gboolean
+gtk_css_selector_tree_could_match (const GtkCssSelectorTree     *tree,
+                                   const GtkCountingBloomFilter *filter,
+                                   GtkCssNode                   *node)
+{
+  return gtk_css_selector_tree_get_change_internal (tree, filter, node) != 0;
+}
+
+/*
+ * _gtk_css_selector_tree_get_selector:
+ * @tree: the tree node returned as selector_match by the builder
+ *
+ * Recreates the selector that was added to the builder for @tree.
+ * The simple selectors of a compound selector may be in a different
+ * order than they were parsed in.
+ *
+ * Returns: (transfer full): the selector, free with _gtk_css_selector_free()
+ */
+GtkCssSelector *
+_gtk_css_selector_tree_get_selector (const GtkCssSelectorTree *tree)
+{
+  const GtkCssSelectorTree *iter;
+  GtkCssSelector *selector;
+  guint size, i;
+
+  size = 0;
+  for (iter = tree; iter; iter = gtk_css_selector_tree_get_parent (iter))
+    size++;
+
+  /* The root of the tree is the rightmost selector, which comes
+   * first in the array */
+  selector = g_new0 (GtkCssSelector, size + 1);
+  i = size;
+  for (iter = tree; iter; iter = gtk_css_selector_tree_get_parent (iter))
+    selector[--i] = iter->selector;
+
+  return selector;
+}
+
 #ifdef PRINT_TREE
 static void
 _gtk_css_selector_tree_print (const GtkCssSelectorTree *tree, GString *str, const char *prefix)
@@ -2067,10 +2242,14 @@ _gtk_css_selector_tree_match_print (const GtkCssSelectorTree *tree,
 void
 _gtk_css_selector_tree_free (GtkCssSelectorTree *tree)
 {
+  GtkCssSelectorTreeIndex *index;
+
   if (tree == NULL)
     return;
 
-  g_free (tree);
+  index = gtk_css_selector_tree_get_index (tree);
+  g_hash_table_unref (index->roots);
+  g_free (index);
 }
 
 
@@ -2269,17 +2448,95 @@ fixup_offsets (GtkCssSelectorTree *tree, guint8 *data)
     }
 }
 
+static void
+append_roots (GByteArray *array,
+              GArray     *roots)
+{
+  gint32 end = GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET;
+
+  g_byte_array_append (array, (guint8 *) roots->data, roots->len * sizeof (gint32));
+  g_byte_array_append (array, (guint8 *) &end, sizeof (gint32));
+}
+
+/* Appends the lists of roots to the tree in @array and returns the
+ * hash table to find them. */
+static GHashTable *
+index_roots (GByteArray *array,
+             gint32      tree_offset,
+             gint32     *other_roots)
+{
+  const GtkCssSelectorTree *iter;
+  GHashTable *lists, *result;
+  GHashTableIter hiter;
+  GArray *others, *list;
+  gpointer key;
+
+  lists = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+  others = g_array_new (FALSE, FALSE, sizeof (gint32));
+
+  for (iter = get_tree (array, tree_offset);
+       iter != NULL;
+       iter = gtk_css_selector_tree_get_sibling (iter))
+    {
+      gint32 offset = (const guint8 *) iter - (array->data + tree_offset);
+
+      if (iter->selector.class == &GTK_CSS_SELECTOR_NAME)
+        key = ROOT_KEY (ROOT_NAME, iter->selector.name.name);
+      else if (iter->selector.class == &GTK_CSS_SELECTOR_ID)
+        key = ROOT_KEY (ROOT_ID, iter->selector.id.name);
+      else if (iter->selector.class == &GTK_CSS_SELECTOR_CLASS)
+        key = ROOT_KEY (ROOT_CLASS, iter->selector.style_class.style_class);
+      else
+        {
+          g_array_append_val (others, offset);
+          continue;
+        }
+
+      list = g_hash_table_lookup (lists, key);
+      if (list == NULL)
+        {
+          list = g_array_new (FALSE, FALSE, sizeof (gint32));
+          g_hash_table_insert (lists, key, list);
+        }
+      g_array_append_val (list, offset);
+    }
+
+  result = g_hash_table_new (NULL, NULL);
+
+  g_hash_table_iter_init (&hiter, lists);
+  while (g_hash_table_iter_next (&hiter, &key, (gpointer *) &list))
+    {
+      g_hash_table_insert (result, key, GINT_TO_POINTER (array->len - tree_offset));
+      append_roots (array, list);
+    }
+
+  *other_roots = array->len - tree_offset;
+  append_roots (array, others);
+
+  g_array_unref (others);
+  g_hash_table_unref (lists);
+
+  return result;
+}
+
 GtkCssSelectorTree *
 _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
 {
+  GtkCssSelectorTreeIndex *index;
   GtkCssSelectorTree *tree;
   GByteArray *array;
+  GHashTable *roots;
+  gint32 other_roots;
   guint8 *data;
   guint len;
   guint i;
   GtkCssSelectorRuleSetInfo **infos_array;
 
+  if (builder->infos->len == 0)
+    return NULL;
+
   array = g_byte_array_new ();
+  g_byte_array_set_size (array, sizeof (GtkCssSelectorTreeIndex));
 
   infos_array = g_alloca (sizeof (GtkCssSelectorRuleSetInfo *) * builder->infos->len);
   for (i = 0; i < builder->infos->len; i++)
@@ -2287,15 +2544,21 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
 
   subdivide_infos (array, infos_array, builder->infos->len, GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET);
 
+  fixup_offsets (get_tree (array, sizeof (GtkCssSelectorTreeIndex)), array->data);
+
+  roots = index_roots (array, sizeof (GtkCssSelectorTreeIndex), &other_roots);
+
   len = array->len;
   data = g_byte_array_free (array, FALSE);
 
   /* shrink to final size */
   data = g_realloc (data, len);
 
-  tree = (GtkCssSelectorTree *)data;
+  index = (GtkCssSelectorTreeIndex *) data;
+  index->roots = roots;
+  index->other_roots = other_roots;
 
-  fixup_offsets (tree, data);
+  tree = (GtkCssSelectorTree *) (data + sizeof (GtkCssSelectorTreeIndex));
 
   /* Convert offsets to final pointers */
   for (i = 0; i < builder->infos->len; i++)
@@ -32,7 +32,6 @@
 G_BEGIN_DECLS
 
 typedef union _GtkCssSelector GtkCssSelector;
-typedef struct _GtkCssSelectorTree GtkCssSelectorTree;
 typedef struct _GtkCssSelectorTreeBuilder GtkCssSelectorTreeBuilder;
 
 GtkCssSelector *  _gtk_css_selector_parse           (GtkCssParser           *parser);
@@ -59,6 +58,10 @@ GtkCssChange gtk_css_selector_tree_get_change_all    (const GtkCssSelectorTree *
 void         _gtk_css_selector_tree_match_print      (const GtkCssSelectorTree *tree,
 						      GString                  *str);
 gboolean     _gtk_css_selector_tree_is_empty         (const GtkCssSelectorTree *tree) G_GNUC_CONST;
+gboolean     gtk_css_selector_tree_could_match       (const GtkCssSelectorTree *tree,
+                                                      const GtkCountingBloomFilter *filter,
+                                                      GtkCssNode               *node);
+GtkCssSelector * _gtk_css_selector_tree_get_selector (const GtkCssSelectorTree *tree);
 
 
 
@@ -38,6 +38,8 @@
 #include "gtkstyleproviderprivate.h"
 #include "gtkcssdimensionvalueprivate.h"
 
+#include <string.h>
+
 static void gtk_css_static_style_compute_value (GtkCssStaticStyle *style,
                                                 GtkStyleProvider  *provider,
                                                 GtkCssStyle       *parent_style,
@@ -298,6 +300,173 @@ verify_style_groups (void)
 
 G_DEFINE_TYPE (GtkCssStaticStyle, gtk_css_static_style, GTK_TYPE_CSS_STYLE)
 
+/* {{{ Shared styles */
+
+/* Styles are shared between all nodes in the tree that have the same
+ * parent style and matched the same declarations, not just between
+ * siblings like with GtkCssNodeStyleCache. In list views, every row
+ * ends up using the same styles this way.
+ *
+ * Every shared style owns its key and removes itself from the table
+ * when it goes away, so the table does not keep styles alive.
+ */
+
+typedef struct
+{
+  guint          id;
+  GtkCssValue   *value;
+  GtkCssSection *section;
+} GtkCssSharedValue;
+
+struct _GtkCssSharedStyleKey
+{
+  guint              hash;
+  GtkStyleProvider  *provider;
+  guint              generation;
+  GtkCssStyle       *parent_style;
+  GtkCssChange       change;
+  guint              n_values;
+  GtkCssSharedValue  values[];
+};
+
+static GHashTable *shared_styles;
+static guint shared_style_hits;
+static guint shared_style_misses;
+
+static guint
+gtk_css_shared_style_key_hash (gconstpointer data)
+{
+  const GtkCssSharedStyleKey *key = data;
+
+  return key->hash;
+}
+
+static gboolean
+gtk_css_shared_style_key_equal (gconstpointer data1,
+                                gconstpointer data2)
+{
+  const GtkCssSharedStyleKey *key1 = data1;
+  const GtkCssSharedStyleKey *key2 = data2;
+
+  return key1->hash == key2->hash &&
+         key1->provider == key2->provider &&
+         key1->generation == key2->generation &&
+         key1->parent_style == key2->parent_style &&
+         key1->change == key2->change &&
+         key1->n_values == key2->n_values &&
+         memcmp (key1->values, key2->values, sizeof (GtkCssSharedValue) * key1->n_values) == 0;
+}
+
+static GtkCssSharedStyleKey *
+gtk_css_shared_style_key_new (GtkStyleProvider   *provider,
+                              const GtkCssLookup *lookup,
+                              GtkCssStyle        *parent_style,
+                              GtkCssChange        change)
+{
+  GtkCssSharedStyleKey *key;
+  guint i, n, hash;
+
+  /* Lookups usually set only a few properties, so only allocate those */
+  n = 0;
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (lookup->values[i].value != NULL)
+        n++;
+    }
+
+  key = g_malloc0 (sizeof (GtkCssSharedStyleKey) + sizeof (GtkCssSharedValue) * n);
+  key->provider = provider;
+  key->generation = gtk_style_provider_get_generation ();
+  key->parent_style = parent_style;
+  key->change = change;
+
+  hash = g_direct_hash (provider) ^ key->generation ^ g_direct_hash (parent_style) ^ (guint) change;
+
+  n = 0;
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (lookup->values[i].value == NULL)
+        continue;
+
+      key->values[n].id = i;
+      key->values[n].value = lookup->values[i].value;
+      key->values[n].section = lookup->values[i].section;
+      hash = (hash << 5) - hash + g_direct_hash (key->values[n].value);
+      n++;
+    }
+  key->n_values = n;
+  key->hash = hash;
+
+  return key;
+}
+
+/* Stored keys hold references, so that the pointers in them stay
+ * unique while the key is in the table */
+static void
+gtk_css_shared_style_key_ref_contents (GtkCssSharedStyleKey *key)
+{
+  guint i;
+
+  g_object_ref (key->provider);
+  g_object_ref (key->parent_style);
+  for (i = 0; i < key->n_values; i++)
+    {
+      gtk_css_value_ref (key->values[i].value);
+      if (key->values[i].section)
+        gtk_css_section_ref (key->values[i].section);
+    }
+}
+
+static void
+gtk_css_shared_style_key_free (GtkCssSharedStyleKey *key)
+{
+  guint i;
+
+  g_object_unref (key->provider);
+  g_object_unref (key->parent_style);
+  for (i = 0; i < key->n_values; i++)
+    {
+      gtk_css_value_unref (key->values[i].value);
+      if (key->values[i].section)
+        gtk_css_section_unref (key->values[i].section);
+    }
+
+  g_free (key);
+}
+
+static void
+gtk_css_static_style_unshare (GtkCssStaticStyle *style)
+{
+  if (style->shared_key == NULL)
+    return;
+
+  if (g_hash_table_lookup (shared_styles, style->shared_key) == style)
+    g_hash_table_remove (shared_styles, style->shared_key);
+
+  g_clear_pointer (&style->shared_key, gtk_css_shared_style_key_free);
+}
+
+/*
+ * gtk_css_static_style_get_shared_stats:
+ * @hits: (out): number of styles that were shared
+ * @misses: (out): number of styles that had to be computed
+ * @n_shared: (out): number of styles that can currently be shared
+ *
+ * Gets statistics about style sharing. @hits and @misses are
+ * counted since the start of the program.
+ */
+void
+gtk_css_static_style_get_shared_stats (guint *hits,
+                                       guint *misses,
+                                       guint *n_shared)
+{
+  *hits = shared_style_hits;
+  *misses = shared_style_misses;
+  *n_shared = shared_styles ? g_hash_table_size (shared_styles) : 0;
+}
+
+/* }}} */
+
 static GtkCssSection *
 gtk_css_static_style_get_section (GtkCssStyle *style,
                                     guint        id)
@@ -316,6 +485,8 @@ gtk_css_static_style_dispose (GObject *object)
 {
   GtkCssStaticStyle *style = GTK_CSS_STATIC_STYLE (object);
 
+  gtk_css_static_style_unshare (style);
+
   if (style->sections)
     {
       g_ptr_array_unref (style->sections);
@@ -1001,9 +1172,8 @@ gtk_css_static_style_new_compute (GtkStyleProvider             *provider,
                                   GtkCssNode                   *node,
                                   GtkCssChange                  change)
 {
-  GtkCssStaticStyle *result;
+  GtkCssStyle *result;
   GtkCssLookup lookup;
-  GtkCssNode *parent;
 
   _gtk_css_lookup_init (&lookup);
 
@@ -1014,21 +1184,78 @@ gtk_css_static_style_new_compute (GtkStyleProvider             *provider,
                                &lookup,
                                change == 0 ? &change : NULL);
 
-  result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
+  result = gtk_css_static_style_new_from_lookup (provider, &lookup, node, change);
 
-  result->change = change;
+  _gtk_css_lookup_destroy (&lookup);
+
+  return result;
+}
+
+/*
+ * gtk_css_static_style_new_from_lookup:
+ * @lookup: the result of gtk_style_provider_lookup() for @node
+ * @change: the change flags for the new style
+ *
+ * Computes the style from a lookup that was done earlier, possibly
+ * on a different thread. Unlike the lookup, this must happen on the
+ * main thread.
+ *
+ * Returns: (transfer full): the new style
+ */
+GtkCssStyle *
+gtk_css_static_style_new_from_lookup (GtkStyleProvider *provider,
+                                      GtkCssLookup     *lookup,
+                                      GtkCssNode       *node,
+                                      GtkCssChange      change)
+{
+  GtkCssStaticStyle *result;
+  GtkCssSharedStyleKey *key;
+  GtkCssStyle *parent_style;
+  GtkCssNode *parent;
 
   if (node)
     parent = gtk_css_node_get_parent (node);
   else
     parent = NULL;
+  parent_style = parent ? gtk_css_node_get_style (parent) : NULL;
+
+  /* Animated parents change every frame, sharing with them is pointless */
+  if (node && parent_style && gtk_css_style_is_static (parent_style) &&
+      !GTK_DEBUG_CHECK (NO_CSS_CACHE))
+    {
+      if (shared_styles == NULL)
+        shared_styles = g_hash_table_new (gtk_css_shared_style_key_hash,
+                                          gtk_css_shared_style_key_equal);
+
+      key = gtk_css_shared_style_key_new (provider, lookup, parent_style, change);
+      result = g_hash_table_lookup (shared_styles, key);
+      if (result)
+        {
+          shared_style_hits++;
+          g_free (key);
+          return g_object_ref (GTK_CSS_STYLE (result));
+        }
+
+      shared_style_misses++;
+    }
+  else
+    key = NULL;
+
+  result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
 
-  gtk_css_lookup_resolve (&lookup,
+  result->change = change;
+
+  gtk_css_lookup_resolve (lookup,
                           provider,
                           result,
-                          parent ? gtk_css_node_get_style (parent) : NULL);
+                          parent_style);
 
-  _gtk_css_lookup_destroy (&lookup);
+  if (key)
+    {
+      gtk_css_shared_style_key_ref_contents (key);
+      result->shared_key = key;
+      g_hash_table_insert (shared_styles, key, result);
+    }
 
   return GTK_CSS_STYLE (result);
 }
@@ -33,6 +33,7 @@ G_BEGIN_DECLS
 #define GTK_CSS_STATIC_STYLE_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), GTK_TYPE_CSS_STATIC_STYLE, GtkCssStaticStyleClass))
 
 typedef struct _GtkCssStaticStyleClass      GtkCssStaticStyleClass;
+typedef struct _GtkCssSharedStyleKey        GtkCssSharedStyleKey;
 
 
 struct _GtkCssStaticStyle
@@ -42,6 +43,8 @@ struct _GtkCssStaticStyle
   GPtrArray             *sections;             /* sections the values are defined in */
 
   GtkCssChange           change;               /* change as returned by value lookup */
+
+  GtkCssSharedStyleKey  *shared_key;           /* key in the table of shared styles */
 };
 
 struct _GtkCssStaticStyleClass
@@ -56,6 +59,13 @@ GtkCssStyle *           gtk_css_static_style_new_compute        (GtkStyleProvide
                                                                  const GtkCountingBloomFilter   *filter,
                                                                  GtkCssNode                     *node,
                                                                  GtkCssChange                    change);
+GtkCssStyle *           gtk_css_static_style_new_from_lookup    (GtkStyleProvider               *provider,
+                                                                 GtkCssLookup                   *lookup,
+                                                                 GtkCssNode                     *node,
+                                                                 GtkCssChange                    change);
+void                    gtk_css_static_style_get_shared_stats   (guint                          *hits,
+                                                                 guint                          *misses,
+                                                                 guint                          *n_shared);
 GtkCssChange            gtk_css_static_style_get_change         (GtkCssStaticStyle              *style);
 
 G_END_DECLS
@@ -54,6 +54,7 @@
 #include "gdktextureutilsprivate.h"
 #include "gdk/gdktextureprivate.h"
 #include "gdk/gdkprofilerprivate.h"
+#include "gdk/gdkworkerpoolprivate.h"
 
 #define GDK_ARRAY_ELEMENT_TYPE char *
 #define GDK_ARRAY_NULL_TERMINATED 1
@@ -852,7 +853,7 @@ gtk_icon_theme_load_in_thread (GtkIconTheme *self)
 
   task = g_task_new (self, NULL, NULL, NULL);
   g_task_set_task_data (task, g_object_ref (self), g_object_unref);
-  g_task_run_in_thread (task, load_theme_thread);
+  gdk_worker_pool_run_task (task, GDK_WORKER_PRIORITY_BACKGROUND, load_theme_thread);
   g_object_unref (task);
 }
 
@@ -2516,7 +2517,7 @@ gtk_icon_theme_lookup_icon (GtkIconTheme       *self,
           if (!has_texture)
             {
               GTask *task = g_task_new (icon, NULL, NULL, NULL);
-              g_task_run_in_thread (task, load_icon_thread);
+              gdk_worker_pool_run_task (task, GDK_WORKER_PRIORITY_BACKGROUND, load_icon_thread);
               g_object_unref (task);
             }
         }
@@ -194,7 +194,7 @@ static const GdkDebugKey gtk_debug_keys[] = {
   { "layout", GTK_DEBUG_LAYOUT, "Information from layout managers" },
   { "builder", GTK_DEBUG_BUILDER, "Trace GtkBuilder operation" },
   { "builder-objects", GTK_DEBUG_BUILDER_OBJECTS, "Log unused GtkBuilder objects" },
-  { "no-css-cache", GTK_DEBUG_NO_CSS_CACHE, "Disable style property cache" },
+  { "no-css-cache", GTK_DEBUG_NO_CSS_CACHE, "Disable style property and stylesheet caches" },
   { "interactive", GTK_DEBUG_INTERACTIVE, "Enable the GTK inspector" },
   { "snapshot", GTK_DEBUG_SNAPSHOT, "Generate debug render nodes" },
   { "accessibility", GTK_DEBUG_A11Y, "Information about accessibility state changes" },
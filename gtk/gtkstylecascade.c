@@ -38,6 +38,7 @@ struct _GtkStyleProviderData
   GtkStyleProvider *provider;
   guint priority;
   guint changed_signal_id;
+  guint rules_changed_signal_id;
 };
 
 static GtkStyleProvider *
@@ -247,6 +248,7 @@ style_provider_data_clear (gpointer data_)
   GtkStyleProviderData *data = data_;
 
   g_signal_handler_disconnect (data->provider, data->changed_signal_id);
+  g_signal_handler_disconnect (data->provider, data->rules_changed_signal_id);
   g_object_unref (data->provider);
 }
 
@@ -282,6 +284,10 @@ _gtk_style_cascade_set_parent (GtkStyleCascade *cascade,
                                 "gtk-private-changed",
                                 G_CALLBACK (gtk_style_provider_changed),
                                 cascade);
+      g_signal_connect_swapped (parent,
+                                "gtk-private-rules-changed",
+                                G_CALLBACK (gtk_style_provider_rules_changed),
+                                cascade);
     }
 
   if (cascade->parent)
@@ -289,6 +295,9 @@ _gtk_style_cascade_set_parent (GtkStyleCascade *cascade,
       g_signal_handlers_disconnect_by_func (cascade->parent, 
                                             gtk_style_provider_changed,
                                             cascade);
+      g_signal_handlers_disconnect_by_func (cascade->parent,
+                                            gtk_style_provider_rules_changed,
+                                            cascade);
       g_object_unref (cascade->parent);
     }
 
@@ -313,6 +322,10 @@ _gtk_style_cascade_add_provider (GtkStyleCascade  *cascade,
                                                      "gtk-private-changed",
                                                      G_CALLBACK (gtk_style_provider_changed),
                                                      cascade);
+  data.rules_changed_signal_id = g_signal_connect_swapped (provider,
+                                                           "gtk-private-rules-changed",
+                                                           G_CALLBACK (gtk_style_provider_rules_changed),
+                                                           cascade);
 
   /* ensure it gets removed first */
   _gtk_style_cascade_remove_provider (cascade, provider);
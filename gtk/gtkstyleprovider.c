@@ -38,6 +38,7 @@
 
 enum {
   CHANGED,
+  RULES_CHANGED,
   LAST_SIGNAL
 };
 
@@ -45,6 +46,10 @@ G_DEFINE_INTERFACE (GtkStyleProvider, gtk_style_provider, G_TYPE_OBJECT)
 
 static guint signals[LAST_SIGNAL];
 
+/* Changes whenever any provider changes, so results computed
+ * from a provider can be checked for being up to date */
+static guint generation;
+
 static void
 gtk_style_provider_default_init (GtkStyleProviderInterface *iface)
 {
@@ -56,6 +61,14 @@ gtk_style_provider_default_init (GtkStyleProviderInterface *iface)
                                    NULL,
                                    G_TYPE_NONE, 0);
 
+  signals[RULES_CHANGED] = g_signal_new (I_("gtk-private-rules-changed"),
+                                         G_TYPE_FROM_INTERFACE (iface),
+                                         G_SIGNAL_RUN_LAST,
+                                         G_STRUCT_OFFSET (GtkStyleProviderInterface, rules_changed),
+                                         NULL, NULL,
+                                         NULL,
+                                         G_TYPE_NONE, 1,
+                                         G_TYPE_POINTER);
 }
 
 GtkCssValue *
@@ -124,9 +137,37 @@ gtk_style_provider_changed (GtkStyleProvider *provider)
 {
   gtk_internal_return_if_fail (GTK_IS_STYLE_PROVIDER (provider));
 
+  generation++;
+
   g_signal_emit (provider, signals[CHANGED], 0);
 }
 
+/*
+ * gtk_style_provider_rules_changed:
+ * @rules: the selectors of the rules that were added or removed
+ *
+ * Like gtk_style_provider_changed(), but only the rules in @rules
+ * changed, so only nodes that those rules might apply to need to
+ * be restyled.
+ */
+void
+gtk_style_provider_rules_changed (GtkStyleProvider         *provider,
+                                  const GtkCssSelectorTree *rules)
+{
+  gtk_internal_return_if_fail (GTK_IS_STYLE_PROVIDER (provider));
+
+  /* Styles cached before may have been computed with the old rules */
+  generation++;
+
+  g_signal_emit (provider, signals[RULES_CHANGED], 0, rules);
+}
+
+guint
+gtk_style_provider_get_generation (void)
+{
+  return generation;
+}
+
 GtkSettings *
 gtk_style_provider_get_settings (GtkStyleProvider *provider)
 {
@@ -52,6 +52,8 @@ struct _GtkStyleProviderInterface
                                                  const GError            *error);
   /* signal */
   void                  (* changed)             (GtkStyleProvider        *provider);
+  void                  (* rules_changed)       (GtkStyleProvider        *provider,
+                                                 const GtkCssSelectorTree *rules);
 };
 
 GtkSettings *           gtk_style_provider_get_settings          (GtkStyleProvider        *provider);
@@ -67,6 +69,9 @@ void                    gtk_style_provider_lookup                (GtkStyleProvid
                                                                   GtkCssChange            *out_change);
 
 void                    gtk_style_provider_changed               (GtkStyleProvider        *provider);
+void                    gtk_style_provider_rules_changed         (GtkStyleProvider        *provider,
+                                                                  const GtkCssSelectorTree *rules);
+guint                   gtk_style_provider_get_generation        (void);
 
 void                    gtk_style_provider_emit_error            (GtkStyleProvider        *provider,
                                                                   GtkCssSection           *section,
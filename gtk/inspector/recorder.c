@@ -1924,7 +1924,14 @@ render_node_save_response (GObject *source,
   file = gtk_file_dialog_save_finish (dialog, result, &error);
   if (file)
     {
-      GBytes *bytes = gsk_render_node_serialize (node);
+      char *basename = g_file_get_basename (file);
+      GBytes *bytes;
+
+      if (g_str_has_suffix (basename, ".node.bin"))
+        bytes = gsk_render_node_serialize_binary (node);
+      else
+        bytes = gsk_render_node_serialize (node);
+      g_free (basename);
 
       if (!g_file_replace_contents (file,
                                     g_bytes_get_data (bytes, NULL),
@@ -0,0 +1,111 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Measures frame times when only a tiny part of a large window changes.
+ *
+ * The window is filled with a grid of labels, and one of them gets
+ * a new text every frame. With damage tracking, only that label
+ * should be redrawn. Run with GSK_RENDERER=cairo to measure the
+ * Cairo renderer.
+ */
+
+#include <gtk/gtk.h>
+
+#include "frame-stats.h"
+
+#define N_COLUMNS 24
+#define N_ROWS 60
+
+static int width = 1920;
+static int height = 1080;
+
+static GOptionEntry options[] = {
+  { "width", 0, 0, G_OPTION_ARG_INT, &width, "Window width", "WIDTH" },
+  { "height", 0, 0, G_OPTION_ARG_INT, &height, "Window height", "HEIGHT" },
+  { NULL }
+};
+
+static gboolean
+update_label (GtkWidget     *label,
+              GdkFrameClock *frame_clock,
+              gpointer       user_data)
+{
+  char *text;
+
+  text = g_strdup_printf ("Frame %" G_GINT64_FORMAT, gdk_frame_clock_get_frame_counter (frame_clock));
+  gtk_label_set_label (GTK_LABEL (label), text);
+  g_free (text);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+quit_cb (GtkWidget *widget,
+         gpointer   data)
+{
+  gboolean *done = data;
+
+  *done = TRUE;
+
+  g_main_context_wakeup (NULL);
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkWidget *window;
+  GtkWidget *grid;
+  GtkWidget *changing = NULL;
+  GError *error = NULL;
+  gboolean done = FALSE;
+  int x, y;
+
+  GOptionContext *context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+  frame_stats_add_options (g_option_context_get_main_group (context));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+
+  gtk_init ();
+
+  window = gtk_window_new ();
+  frame_stats_ensure (GTK_WINDOW (window));
+  gtk_window_set_default_size (GTK_WINDOW (window), width, height);
+
+  grid = gtk_grid_new ();
+  gtk_grid_set_row_homogeneous (GTK_GRID (grid), TRUE);
+  gtk_grid_set_column_homogeneous (GTK_GRID (grid), TRUE);
+  gtk_window_set_child (GTK_WINDOW (window), grid);
+
+  for (y = 0; y < N_ROWS; y++)
+    {
+      for (x = 0; x < N_COLUMNS; x++)
+        {
+          GtkWidget *label;
+          char *text;
+
+          text = g_strdup_printf ("Label %d/%d", x, y);
+          label = gtk_label_new (text);
+          g_free (text);
+
+          gtk_grid_attach (GTK_GRID (grid), label, x, y, 1, 1);
+
+          if (x == N_COLUMNS / 2 && y == N_ROWS / 2)
+            changing = label;
+        }
+    }
+
+  gtk_widget_add_tick_callback (changing, update_label, NULL, NULL);
+
+  gtk_window_present (GTK_WINDOW (window));
+  g_signal_connect (window, "destroy",
+                    G_CALLBACK (quit_cb), &done);
+
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Measures how long renderers take to draw blur nodes of different radii.
+ *
+ * Every radius is rendered --runs times with the renderer picked by
+ * GSK_RENDERER, and the best and average times are printed. Compare
+ * with GSK_GPU_SKIP=blur-downscale to measure blurring at full resolution.
+ */
+
+#include <gtk/gtk.h>
+
+static int size = 1000;
+static int runs = 10;
+
+static GOptionEntry options[] = {
+  { "size", 's', 0, G_OPTION_ARG_INT, &size, "Size of the blurred area", "PIXELS" },
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Render every radius N times", "N" },
+  { NULL }
+};
+
+static const float radii[] = { 5, 10, 20, 50, 100, 200 };
+
+static GskRenderNode *
+create_scene (void)
+{
+  GskRenderNode *nodes[3];
+  GskRenderNode *container, *white;
+  GskRoundedRect circle;
+
+  nodes[0] = gsk_color_node_new (&(GdkRGBA) { 0, 0, 0, 1 },
+                                 &GRAPHENE_RECT_INIT (0, 0, size, size));
+  nodes[1] = gsk_color_node_new (&(GdkRGBA) { 1, 0.5, 0, 1 },
+                                 &GRAPHENE_RECT_INIT (size / 8., size / 8., size / 4., size * 3 / 4.));
+  gsk_rounded_rect_init_from_rect (&circle,
+                                   &GRAPHENE_RECT_INIT (size / 2., size / 4., size / 2., size / 2.),
+                                   size / 4.);
+  white = gsk_color_node_new (&(GdkRGBA) { 1, 1, 1, 1 }, &circle.bounds);
+  nodes[2] = gsk_rounded_clip_node_new (white, &circle);
+  gsk_render_node_unref (white);
+
+  container = gsk_container_node_new (nodes, G_N_ELEMENTS (nodes));
+
+  gsk_render_node_unref (nodes[0]);
+  gsk_render_node_unref (nodes[1]);
+  gsk_render_node_unref (nodes[2]);
+
+  return container;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GskRenderer *renderer;
+  GdkSurface *surface;
+  GskRenderNode *scene;
+  guint i;
+  int run;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  gtk_init ();
+
+  if (runs < 1)
+    {
+      g_printerr ("Number of runs given with -r/--runs must be at least 1 and not %d.\n", runs);
+      return 1;
+    }
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default ());
+  renderer = gsk_renderer_new_for_surface (surface);
+  g_print ("Blurring %dx%d pixels %d times using %s\n", size, size, runs, G_OBJECT_TYPE_NAME (renderer));
+
+  scene = create_scene ();
+
+  for (i = 0; i < G_N_ELEMENTS (radii); i++)
+    {
+      GskRenderNode *node;
+      GdkTexture *texture;
+      gint64 start, end, best, sum;
+
+      node = gsk_blur_node_new (scene, radii[i]);
+
+      /* warmup */
+      texture = gsk_renderer_render_texture (renderer, node, &GRAPHENE_RECT_INIT (0, 0, size, size));
+      g_object_unref (texture);
+
+      best = G_MAXINT64;
+      sum = 0;
+      for (run = 0; run < runs; run++)
+        {
+          start = g_get_monotonic_time ();
+          texture = gsk_renderer_render_texture (renderer, node, &GRAPHENE_RECT_INIT (0, 0, size, size));
+          end = g_get_monotonic_time ();
+          g_object_unref (texture);
+
+          best = MIN (best, end - start);
+          sum += end - start;
+        }
+
+      g_print ("Radius %3g: best %8.3fms  avg %8.3fms\n",
+               radii[i],
+               (double) best / 1000,
+               (double) sum / runs / 1000);
+
+      gsk_render_node_unref (node);
+    }
+
+  gsk_render_node_unref (scene);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  g_object_unref (surface);
+
+  return 0;
+}
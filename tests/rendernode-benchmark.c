@@ -0,0 +1,342 @@
+/* Renders a corpus of node files and reports the time it took.
+ *
+ * Arguments can be node files or directories, in which case all
+ * .node and .node.bin files in them are used. Every file is rendered
+ * --runs times with the same renderer and the best and average times
+ * are printed, so changes to the renderers can be compared by running
+ * the same corpus with different builds or GSK_RENDERER, GSK_DEBUG and
+ * GSK_GPU_SKIP settings.
+ *
+ * With --damage, the files are rendered into a window instead, with a
+ * redraw region made of that many scattered rectangles, like a frame
+ * that only updates a few widgets. Use GDK_DEBUG=no-vsync to not wait
+ * for the display.
+ */
+
+#include <gtk/gtk.h>
+#include <math.h>
+
+/* the size of the damaged rectangles, like a small widget */
+#define DAMAGE_RECT_SIZE 32
+
+static int runs = 10;
+static int damage = 0;
+static gboolean warmup = TRUE;
+
+static GOptionEntry options[] = {
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Render every file N times", "N" },
+  { "damage", 'd', 0, G_OPTION_ARG_INT, &damage, "Render into a window, with N damaged rectangles", "N" },
+  { "no-warmup", '\0', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &warmup, "Don't render once before timing", NULL },
+  { NULL }
+};
+
+static int window_width;
+static int window_height;
+
+static void
+deserialize_error_func (const GskParseLocation *start,
+                        const GskParseLocation *end,
+                        const GError           *error,
+                        gpointer                user_data)
+{
+  const char *filename = user_data;
+
+  g_warning ("%s:%zu:%zu: %s", filename,
+             start->lines + 1, start->line_chars + 1,
+             error->message);
+}
+
+static gboolean
+is_node_file (const char *filename)
+{
+  return g_str_has_suffix (filename, ".node") ||
+         g_str_has_suffix (filename, ".node.bin");
+}
+
+static int
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+  return strcmp (*(const char **) a, *(const char **) b);
+}
+
+static void
+collect_files (const char *path,
+               GPtrArray  *files)
+{
+  GDir *dir;
+  const char *name;
+  guint first;
+
+  if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+    {
+      g_ptr_array_add (files, g_strdup (path));
+      return;
+    }
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  first = files->len;
+  while ((name = g_dir_read_name (dir)))
+    {
+      if (is_node_file (name))
+        g_ptr_array_add (files, g_build_filename (path, name, NULL));
+    }
+  g_dir_close (dir);
+
+  /* keep the output stable so runs can be diffed */
+  qsort (files->pdata + first, files->len - first, sizeof (gpointer), compare_strings);
+}
+
+static GskRenderNode *
+load_node (const char *filename)
+{
+  GskRenderNode *node;
+  GError *error = NULL;
+  char *contents;
+  gsize len;
+  GBytes *bytes;
+
+  if (!g_file_get_contents (filename, &contents, &len, &error))
+    {
+      g_printerr ("Could not open node file: %s\n", error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  bytes = g_bytes_new_take (contents, len);
+  node = gsk_render_node_deserialize (bytes, deserialize_error_func, (gpointer) filename);
+  g_bytes_unref (bytes);
+
+  return node;
+}
+
+static void
+compute_size (GdkToplevel     *toplevel,
+              GdkToplevelSize *size,
+              gpointer         user_data)
+{
+  gdk_toplevel_size_set_size (size, window_width, window_height);
+}
+
+static gboolean
+timeout_cb (gpointer data)
+{
+  gboolean *timed_out = data;
+
+  *timed_out = TRUE;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+present_window (GdkSurface *window,
+                int         width,
+                int         height)
+{
+  GdkToplevelLayout *layout;
+  gboolean timed_out = FALSE;
+  guint timeout_id;
+
+  window_width = width;
+  window_height = height;
+
+  layout = gdk_toplevel_layout_new ();
+  gdk_toplevel_layout_set_resizable (layout, FALSE);
+  gdk_toplevel_present (GDK_TOPLEVEL (window), layout);
+  gdk_toplevel_layout_unref (layout);
+
+  /* Wait for the window to be mapped at its new size. The windowing
+   * system may not grant that size, then we just use what we got */
+  timeout_id = g_timeout_add (1000, timeout_cb, &timed_out);
+  while (!timed_out &&
+         (!gdk_surface_get_mapped (window) ||
+          gdk_surface_get_width (window) != width ||
+          gdk_surface_get_height (window) != height))
+    g_main_context_iteration (NULL, TRUE);
+  if (!timed_out)
+    g_source_remove (timeout_id);
+}
+
+static cairo_region_t *
+create_damage (int width,
+               int height,
+               int n_rects)
+{
+  cairo_region_t *region;
+  GRand *rand;
+  int i;
+
+  region = cairo_region_create ();
+  /* use a fixed seed, so all runs and builds use the same region */
+  rand = g_rand_new_with_seed (n_rects);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      rect.width = MIN (width, DAMAGE_RECT_SIZE);
+      rect.height = MIN (height, DAMAGE_RECT_SIZE);
+      rect.x = g_rand_int_range (rand, 0, width - rect.width + 1);
+      rect.y = g_rand_int_range (rand, 0, height - rect.height + 1);
+      cairo_region_union_rectangle (region, &rect);
+    }
+
+  g_rand_free (rand);
+
+  return region;
+}
+
+static void
+render (GskRenderer          *renderer,
+        GskRenderNode        *node,
+        const cairo_region_t *region)
+{
+  GdkTexture *texture;
+
+  if (region)
+    {
+      gsk_renderer_render (renderer, node, region);
+    }
+  else
+    {
+      texture = gsk_renderer_render_texture (renderer, node, NULL);
+      g_object_unref (texture);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GskRenderer *renderer;
+  GdkSurface *window;
+  GPtrArray *files;
+  gint64 total_best, total_sum;
+  guint i, n_rendered;
+  int run;
+
+  context = g_option_context_new ("NODE-FILE|DIRECTORY…");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  gtk_init ();
+
+  if (runs < 1)
+    {
+      g_printerr ("Number of runs given with -r/--runs must be at least 1 and not %d.\n", runs);
+      return 1;
+    }
+  if (damage < 0)
+    {
+      g_printerr ("Number of damaged rectangles given with -d/--damage must not be negative.\n");
+      return 1;
+    }
+  if (argc < 2)
+    {
+      g_printerr ("Usage: %s [OPTIONS] NODE-FILE|DIRECTORY…\n", argv[0]);
+      return 1;
+    }
+
+  files = g_ptr_array_new_with_free_func (g_free);
+  for (run = 1; run < argc; run++)
+    collect_files (argv[run], files);
+
+  window = gdk_surface_new_toplevel (gdk_display_get_default ());
+  g_signal_connect (window, "compute-size", G_CALLBACK (compute_size), NULL);
+  renderer = gsk_renderer_new_for_surface (window);
+  if (damage > 0)
+    g_print ("Rendering %u files %d times with %d damaged rectangles using %s\n", files->len, runs, damage, G_OBJECT_TYPE_NAME (renderer));
+  else
+    g_print ("Rendering %u files %d times using %s\n", files->len, runs, G_OBJECT_TYPE_NAME (renderer));
+
+  total_best = 0;
+  total_sum = 0;
+  n_rendered = 0;
+
+  for (i = 0; i < files->len; i++)
+    {
+      const char *filename = g_ptr_array_index (files, i);
+      GskRenderNode *node;
+      cairo_region_t *region;
+      gint64 start, end, best, sum;
+
+      node = load_node (filename);
+      if (node == NULL)
+        continue;
+
+      if (damage > 0)
+        {
+          graphene_rect_t bounds;
+
+          /* windows start at 0,0, so move the node there */
+          gsk_render_node_get_bounds (node, &bounds);
+          if (bounds.origin.x != 0 || bounds.origin.y != 0)
+            {
+              GskRenderNode *child = node;
+              GskTransform *transform;
+
+              transform = gsk_transform_translate (NULL, &GRAPHENE_POINT_INIT (- bounds.origin.x, - bounds.origin.y));
+              node = gsk_transform_node_new (child, transform);
+              gsk_transform_unref (transform);
+              gsk_render_node_unref (child);
+            }
+
+          present_window (window,
+                          MAX (1, ceil (bounds.size.width)),
+                          MAX (1, ceil (bounds.size.height)));
+          region = create_damage (gdk_surface_get_width (window),
+                                  gdk_surface_get_height (window),
+                                  damage);
+        }
+      else
+        region = NULL;
+
+      if (warmup)
+        render (renderer, node, region);
+
+      best = G_MAXINT64;
+      sum = 0;
+      for (run = 0; run < runs; run++)
+        {
+          start = g_get_monotonic_time ();
+          render (renderer, node, region);
+          end = g_get_monotonic_time ();
+
+          best = MIN (best, end - start);
+          sum += end - start;
+        }
+
+      g_print ("%-60s best %8.3fms  avg %8.3fms\n",
+               filename,
+               (double) best / 1000,
+               (double) sum / runs / 1000);
+
+      total_best += best;
+      total_sum += sum;
+      n_rendered++;
+
+      g_clear_pointer (&region, cairo_region_destroy);
+      gsk_render_node_unref (node);
+    }
+
+  g_print ("%u files: best %.3fms  avg %.3fms\n",
+           n_rendered,
+           (double) total_best / 1000,
+           (double) total_sum / runs / 1000);
+
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  g_object_unref (window);
+  g_ptr_array_unref (files);
+
+  return n_rendered == files->len ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Measures frame times while a page of text continuously zooms in and out.
+ *
+ * Every frame draws the text at a different scale, so renderers that
+ * rasterize glyphs per scale have to do so for every frame. Compare
+ * with GSK_DEBUG=sdf-glyphs to measure drawing from distance fields.
+ */
+
+#include <gtk/gtk.h>
+#include <math.h>
+
+#include "frame-stats.h"
+
+static double period = 4.0;
+static double max_zoom = 4.0;
+
+static GOptionEntry options[] = {
+  { "period", 'p', 0, G_OPTION_ARG_DOUBLE, &period, "Duration of one zoom cycle", "SECONDS" },
+  { "max-zoom", 'z', 0, G_OPTION_ARG_DOUBLE, &max_zoom, "Largest zoom factor", "FACTOR" },
+  { NULL }
+};
+
+#define ZOOM_TYPE_TEXT (zoom_text_get_type ())
+G_DECLARE_FINAL_TYPE (ZoomText, zoom_text, ZOOM, TEXT, GtkWidget)
+
+struct _ZoomText
+{
+  GtkWidget parent_instance;
+
+  PangoLayout *layout;
+  double zoom;
+};
+
+G_DEFINE_TYPE (ZoomText, zoom_text, GTK_TYPE_WIDGET)
+
+static void
+zoom_text_snapshot (GtkWidget   *widget,
+                    GtkSnapshot *snapshot)
+{
+  ZoomText *self = ZOOM_TEXT (widget);
+  int width, height;
+
+  width = gtk_widget_get_width (widget);
+  height = gtk_widget_get_height (widget);
+
+  gtk_snapshot_save (snapshot);
+  gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (width / 2.f, height / 2.f));
+  gtk_snapshot_scale (snapshot, self->zoom, self->zoom);
+  gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (- width / 2.f, - height / 2.f));
+  gtk_snapshot_append_layout (snapshot, self->layout, &(GdkRGBA) { 0, 0, 0, 1 });
+  gtk_snapshot_restore (snapshot);
+}
+
+static gboolean
+zoom_text_tick (GtkWidget     *widget,
+                GdkFrameClock *frame_clock,
+                gpointer       user_data)
+{
+  ZoomText *self = ZOOM_TEXT (widget);
+  double t;
+
+  t = gdk_frame_clock_get_frame_time (frame_clock) / (double) G_USEC_PER_SEC;
+  self->zoom = 1.0 + (max_zoom - 1.0) * (0.5 - 0.5 * cos (2 * G_PI * t / period));
+  gtk_widget_queue_draw (widget);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+zoom_text_dispose (GObject *object)
+{
+  ZoomText *self = ZOOM_TEXT (object);
+
+  g_clear_object (&self->layout);
+
+  G_OBJECT_CLASS (zoom_text_parent_class)->dispose (object);
+}
+
+static void
+zoom_text_class_init (ZoomTextClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (class);
+
+  object_class->dispose = zoom_text_dispose;
+  widget_class->snapshot = zoom_text_snapshot;
+}
+
+static void
+zoom_text_init (ZoomText *self)
+{
+  GString *text;
+  int i;
+
+  text = g_string_new (NULL);
+  for (i = 0; i < 40; i++)
+    g_string_append (text, "The quick brown fox jumps over the lazy dog. "
+                           "Pack my box with five dozen liquor jugs.\n");
+
+  self->layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), text->str);
+  self->zoom = 1.0;
+  g_string_free (text, TRUE);
+
+  gtk_widget_add_tick_callback (GTK_WIDGET (self), zoom_text_tick, NULL, NULL);
+}
+
+static void
+quit_cb (GtkWidget *widget,
+         gpointer   data)
+{
+  gboolean *done = data;
+
+  *done = TRUE;
+
+  g_main_context_wakeup (NULL);
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkWidget *window;
+  GError *error = NULL;
+  gboolean done = FALSE;
+
+  GOptionContext *context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+  frame_stats_add_options (g_option_context_get_main_group (context));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+
+  gtk_init ();
+
+  window = gtk_window_new ();
+  frame_stats_ensure (GTK_WINDOW (window));
+  gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+  gtk_window_set_child (GTK_WINDOW (window), g_object_new (ZOOM_TYPE_TEXT, NULL));
+
+  gtk_window_present (GTK_WINDOW (window));
+  g_signal_connect (window, "destroy",
+                    G_CALLBACK (quit_cb), &done);
+
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+
+  return 0;
+}
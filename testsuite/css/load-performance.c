@@ -0,0 +1,105 @@
+/*
+ * Copyright © 2024 the GTK team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures how long it takes to load a stylesheet into a
+ * GtkCssProvider, by default the Default theme.
+ *
+ * The warmup run fills the tokenized stylesheet cache, so the timed
+ * runs measure cache hits. Compare with a run using
+ * GTK_DEBUG=no-css-cache to see what the cache saves.
+ */
+
+#include <gtk/gtk.h>
+
+#define DEFAULT_THEME "resource:///org/gtk/libgtk/theme/Default/Default-light.css"
+
+static int runs = 100;
+
+static GOptionEntry options[] = {
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Load the stylesheet N times", "N" },
+  { NULL }
+};
+
+static void
+load (GFile *file)
+{
+  GtkCssProvider *provider;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_file (provider, file);
+  g_object_unref (provider);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GFile *file;
+  char *uri;
+  gint64 start, end, best, sum;
+  int run;
+
+  context = g_option_context_new ("[CSS-FILE]");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  gtk_init ();
+
+  if (runs < 1)
+    {
+      g_printerr ("Number of runs given with -r/--runs must be at least 1 and not %d.\n", runs);
+      return 1;
+    }
+
+  if (argc > 1)
+    file = g_file_new_for_commandline_arg (argv[1]);
+  else
+    file = g_file_new_for_uri (DEFAULT_THEME);
+
+  uri = g_file_get_uri (file);
+  g_print ("Loading %s %d times\n", uri, runs);
+  g_free (uri);
+
+  /* warmup */
+  load (file);
+
+  best = G_MAXINT64;
+  sum = 0;
+  for (run = 0; run < runs; run++)
+    {
+      start = g_get_monotonic_time ();
+      load (file);
+      end = g_get_monotonic_time ();
+
+      best = MIN (best, end - start);
+      sum += end - start;
+    }
+
+  g_print ("best %8.3fms  avg %8.3fms\n",
+           (double) best / 1000,
+           (double) sum / runs / 1000);
+
+  g_object_unref (file);
+
+  return 0;
+}
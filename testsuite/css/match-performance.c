@@ -0,0 +1,230 @@
+/*
+ * Copyright © 2024 the GTK team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures how long it takes to match the selectors of the theme
+ * against every CSS node of a UI file, by default the widget factory.
+ *
+ * Only selector matching is timed, not computing the style. Use
+ * GTK_THEME to pick the theme to match against.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gtk/gtkcountingbloomfilterprivate.h"
+#include "gtk/gtkcsslookupprivate.h"
+#include "gtk/gtkcssnodeprivate.h"
+#include "gtk/gtkstyleproviderprivate.h"
+#include "gtk/gtkwidgetprivate.h"
+
+static int runs = 100;
+
+static GOptionEntry options[] = {
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Match every node N times", "N" },
+  { NULL }
+};
+
+/* The UI file has callbacks and types from the widget factory,
+ * replace them with no-ops and their parent types */
+typedef GtkBuilderCScope BenchScope;
+typedef GtkBuilderCScopeClass BenchScopeClass;
+
+static GtkBuilderScopeInterface *bench_scope_parent_iface;
+
+static void bench_scope_iface_init (GtkBuilderScopeInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (BenchScope, bench_scope, GTK_TYPE_BUILDER_CSCOPE,
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_BUILDER_SCOPE, bench_scope_iface_init))
+
+static GType
+bench_scope_get_type_from_name (GtkBuilderScope *scope,
+                                GtkBuilder      *builder,
+                                const char      *type_name)
+{
+  if (g_str_equal (type_name, "MyTextView"))
+    return GTK_TYPE_TEXT_VIEW;
+
+  return bench_scope_parent_iface->get_type_from_name (scope, builder, type_name);
+}
+
+static void
+noop (void)
+{
+}
+
+static GClosure *
+bench_scope_create_closure (GtkBuilderScope        *scope,
+                            GtkBuilder             *builder,
+                            const char             *function_name,
+                            GtkBuilderClosureFlags  flags,
+                            GObject                *object,
+                            GError                **error)
+{
+  return g_cclosure_new (G_CALLBACK (noop), NULL, NULL);
+}
+
+static void
+bench_scope_iface_init (GtkBuilderScopeInterface *iface)
+{
+  bench_scope_parent_iface = g_type_interface_peek_parent (iface);
+
+  iface->get_type_from_name = bench_scope_get_type_from_name;
+  iface->get_type_from_function = bench_scope_parent_iface->get_type_from_function;
+  iface->create_closure = bench_scope_create_closure;
+}
+
+static void
+bench_scope_class_init (BenchScopeClass *class)
+{
+}
+
+static void
+bench_scope_init (BenchScope *self)
+{
+}
+
+static void
+collect_nodes (GtkCssNode *node,
+               GPtrArray  *nodes)
+{
+  GtkCssNode *child;
+
+  g_ptr_array_add (nodes, node);
+
+  for (child = gtk_css_node_get_first_child (node);
+       child;
+       child = gtk_css_node_get_next_sibling (child))
+    collect_nodes (child, nodes);
+}
+
+static void
+add_ancestors (GtkCountingBloomFilter *filter,
+               GtkCssNode             *node)
+{
+  GtkCssNode *parent;
+
+  for (parent = gtk_css_node_get_parent (node);
+       parent;
+       parent = gtk_css_node_get_parent (parent))
+    gtk_css_node_declaration_add_bloom_hashes (gtk_css_node_get_declaration (parent), filter);
+}
+
+static void
+match_nodes (GPtrArray *nodes)
+{
+  guint i;
+
+  for (i = 0; i < nodes->len; i++)
+    {
+      GtkCssNode *node = g_ptr_array_index (nodes, i);
+      GtkCountingBloomFilter filter = GTK_COUNTING_BLOOM_FILTER_INIT;
+      GtkCssLookup lookup;
+      GtkCssChange change;
+
+      add_ancestors (&filter, node);
+
+      _gtk_css_lookup_init (&lookup);
+      gtk_style_provider_lookup (gtk_css_node_get_style_provider (node),
+                                 &filter,
+                                 node,
+                                 &lookup,
+                                 &change);
+      _gtk_css_lookup_destroy (&lookup);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkBuilderScope *scope;
+  GtkBuilder *builder;
+  GtkWidget *window;
+  GPtrArray *nodes;
+  const char *filename;
+  gint64 start, end, best, sum;
+  int run;
+
+  context = g_option_context_new ("[UI-FILE]");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  gtk_init ();
+
+  if (runs < 1)
+    {
+      g_printerr ("Number of runs given with -r/--runs must be at least 1 and not %d.\n", runs);
+      return 1;
+    }
+
+  filename = argc > 1 ? argv[1] : WIDGET_FACTORY_UI;
+
+  builder = gtk_builder_new ();
+  scope = g_object_new (bench_scope_get_type (), NULL);
+  gtk_builder_set_scope (builder, scope);
+  g_object_unref (scope);
+
+  if (!gtk_builder_add_from_file (builder, filename, &error))
+    {
+      g_printerr ("Could not load %s: %s\n", filename, error->message);
+      return 1;
+    }
+
+  window = GTK_WIDGET (gtk_builder_get_object (builder, "window"));
+  if (window == NULL)
+    {
+      g_printerr ("%s has no object with id \"window\"\n", filename);
+      return 1;
+    }
+
+  nodes = g_ptr_array_new ();
+  collect_nodes (gtk_widget_get_css_node (window), nodes);
+
+  g_print ("Matching %u nodes %d times\n", nodes->len, runs);
+
+  /* warmup */
+  match_nodes (nodes);
+
+  best = G_MAXINT64;
+  sum = 0;
+  for (run = 0; run < runs; run++)
+    {
+      start = g_get_monotonic_time ();
+      match_nodes (nodes);
+      end = g_get_monotonic_time ();
+
+      best = MIN (best, end - start);
+      sum += end - start;
+    }
+
+  g_print ("best %8.3fms  avg %8.3fms  (%.3fus per node)\n",
+           (double) best / 1000,
+           (double) sum / runs / 1000,
+           (double) best / nodes->len);
+
+  g_ptr_array_unref (nodes);
+  gtk_window_destroy (GTK_WINDOW (window));
+  g_object_unref (builder);
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gtk/gtkcsscolorvalueprivate.h"
+#include "gtk/gtkcssnodeprivate.h"
+#include "gtk/gtkcssstaticstyleprivate.h"
+#include "gtk/gtkstyleproviderprivate.h"
+
+#define N_ROWS 3
+
+typedef struct {
+  GtkCssProvider *provider;
+  GtkCssNode *list;
+  GtkCssNode *rows[N_ROWS];
+  GtkCssNode *labels[N_ROWS];
+} ListFixture;
+
+static GtkCssNode *
+add_node (GtkCssNode *parent,
+          const char *name)
+{
+  GtkCssNode *node;
+
+  node = gtk_css_node_new ();
+  gtk_css_node_set_name (node, g_quark_from_string (name));
+  if (parent)
+    {
+      gtk_css_node_set_parent (node, parent);
+      g_object_unref (node);
+    }
+
+  return node;
+}
+
+/* Every row has its own parent node, so the labels can't share
+ * styles through the sibling cache, only through the shared styles.
+ * The names are chosen so that no theme rules depend on the position
+ * of the rows.
+ */
+static void
+list_fixture_setup (ListFixture   *fixture,
+                    gconstpointer  unused)
+{
+  int i;
+
+  fixture->provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_string (fixture->provider, "sharedstylelabel { color: red; }");
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (fixture->provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  fixture->list = add_node (NULL, "sharedstylelist");
+  for (i = 0; i < N_ROWS; i++)
+    {
+      fixture->rows[i] = add_node (fixture->list, "sharedstylerow");
+      fixture->labels[i] = add_node (fixture->rows[i], "sharedstylelabel");
+    }
+
+  gtk_css_node_validate (fixture->list);
+}
+
+static void
+list_fixture_teardown (ListFixture   *fixture,
+                       gconstpointer  unused)
+{
+  g_object_unref (fixture->list);
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (fixture->provider));
+  g_object_unref (fixture->provider);
+}
+
+static void
+test_share_between_parents (ListFixture   *fixture,
+                            gconstpointer  unused)
+{
+  GtkCssStyle *style;
+  GdkRGBA red;
+  int i;
+
+  style = gtk_css_node_get_style (fixture->labels[0]);
+  g_assert_true (GTK_IS_CSS_STATIC_STYLE (style));
+  /* Make sure the labels were actually styled */
+  g_assert_true (gdk_rgba_parse (&red, "red"));
+  g_assert_true (gdk_rgba_equal (gtk_css_color_value_get_rgba (style->core->color), &red));
+
+  for (i = 1; i < N_ROWS; i++)
+    {
+      g_assert_true (gtk_css_node_get_style (fixture->rows[i]) == gtk_css_node_get_style (fixture->rows[0]));
+      g_assert_true (gtk_css_node_get_style (fixture->labels[i]) == style);
+    }
+}
+
+static void
+test_generation_change (ListFixture   *fixture,
+                        gconstpointer  unused)
+{
+  GtkStyleProvider *provider;
+  GtkCssStyle *style, *before, *after;
+
+  provider = gtk_css_node_get_style_provider (fixture->labels[1]);
+  style = gtk_css_node_get_style (fixture->labels[0]);
+
+  before = gtk_css_static_style_new_compute (provider, NULL, fixture->labels[1], 0);
+  g_assert_true (before == style);
+
+  /* The old style and the parent styles stay alive, only the
+   * generation differs */
+  gtk_style_provider_changed (provider);
+
+  after = gtk_css_static_style_new_compute (provider, NULL, fixture->labels[1], 0);
+  g_assert_true (after != style);
+  g_assert_true (gtk_css_node_get_style (fixture->labels[0]) == style);
+
+  g_object_unref (before);
+  g_object_unref (after);
+}
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add ("/sharedstyle/share-between-parents", ListFixture, NULL,
+              list_fixture_setup, test_share_between_parents, list_fixture_teardown);
+  g_test_add ("/sharedstyle/generation-change", ListFixture, NULL,
+              list_fixture_setup, test_generation_change, list_fixture_teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,165 @@
+#include "../../gtk/css/gtkcsstokenizerprivate.h"
+
+#include <string.h>
+
+#define CSS \
+  "/* comment */\n" \
+  "@define-color accent #3584e4;\n" \
+  "button:hover > label.title, #id {\n" \
+  "  color: rgba(255, 0, 0, 50%);\n" \
+  "  margin: -1px 2.5em +3 4ex;\n" \
+  "  background-image: url(\"image.png\"), url(other.png);\n" \
+  "  font-family: \"A font name that is longer than sixteen bytes\";\n" \
+  "}\n" \
+  "a[href^=\"http\"] { transition: all 200ms ease-in; }\n"
+
+static GBytes *
+precompile_string (const char *text)
+{
+  GBytes *bytes, *result;
+
+  bytes = g_bytes_new_static (text, strlen (text));
+  result = gtk_css_tokenizer_precompile (bytes);
+  g_bytes_unref (bytes);
+
+  return result;
+}
+
+/* Reads all tokens from @bytes, and returns them as a string */
+static char *
+tokenize (GBytes   *bytes,
+          gboolean  precompiled)
+{
+  GtkCssTokenizer *tokenizer;
+  const GtkCssLocation *location;
+  GtkCssToken token;
+  GString *string;
+
+  if (precompiled)
+    tokenizer = gtk_css_tokenizer_new_precompiled (bytes);
+  else
+    tokenizer = gtk_css_tokenizer_new (bytes);
+
+  string = g_string_new (NULL);
+  while (TRUE)
+    {
+      char *s;
+
+      g_assert_true (gtk_css_tokenizer_read_token (tokenizer, &token, NULL));
+      if (gtk_css_token_is (&token, GTK_CSS_TOKEN_EOF))
+        break;
+
+      location = gtk_css_tokenizer_get_location (tokenizer);
+      s = gtk_css_token_to_string (&token);
+      g_string_append_printf (string, "%u %s %zu:%zu:%zu:%zu:%zu\n",
+                              token.type, s,
+                              location->bytes, location->chars,
+                              location->lines, location->line_bytes, location->line_chars);
+      g_free (s);
+      gtk_css_token_clear (&token);
+    }
+
+  gtk_css_tokenizer_unref (tokenizer);
+
+  return g_string_free (string, FALSE);
+}
+
+static void
+test_roundtrip (void)
+{
+  GBytes *bytes, *precompiled;
+  char *expected, *result;
+
+  bytes = g_bytes_new_static (CSS, strlen (CSS));
+  precompiled = gtk_css_tokenizer_precompile (bytes);
+  g_assert_nonnull (precompiled);
+  g_assert_true (gtk_css_tokenizer_is_precompiled (precompiled));
+
+  expected = tokenize (bytes, FALSE);
+  result = tokenize (precompiled, TRUE);
+  g_assert_cmpstr (result, ==, expected);
+
+  g_free (result);
+  g_free (expected);
+  g_bytes_unref (precompiled);
+  g_bytes_unref (bytes);
+}
+
+static void
+test_errors_not_precompiled (void)
+{
+  GBytes *precompiled;
+
+  precompiled = precompile_string ("a { content: \"unterminated\n }");
+  g_assert_null (precompiled);
+}
+
+static void
+test_truncated (void)
+{
+  GBytes *precompiled;
+  const guchar *data;
+  gsize size, i;
+
+  precompiled = precompile_string (CSS);
+  data = g_bytes_get_data (precompiled, &size);
+
+  for (i = 0; i < size; i++)
+    {
+      GBytes *truncated;
+
+      /* copy, so reading past the end is caught by memory checkers */
+      truncated = g_bytes_new_take (g_memdup2 (data, i), i);
+      /* cuts between tokens are valid data */
+      if (gtk_css_tokenizer_is_precompiled (truncated))
+        g_free (tokenize (truncated, TRUE));
+      g_bytes_unref (truncated);
+    }
+
+  g_bytes_unref (precompiled);
+}
+
+static void
+test_corrupt (void)
+{
+  GBytes *precompiled, *corrupt;
+  guchar *data;
+  gsize size;
+
+  precompiled = precompile_string (CSS);
+  data = g_memdup2 (g_bytes_get_data (precompiled, NULL), g_bytes_get_size (precompiled));
+  size = g_bytes_get_size (precompiled);
+
+  /* the first token follows the 4 byte magic, make its type invalid */
+  data[4] = 0xff;
+  corrupt = g_bytes_new (data, size);
+  g_assert_false (gtk_css_tokenizer_is_precompiled (corrupt));
+  g_bytes_unref (corrupt);
+
+  /* EOF tokens are never stored */
+  data[4] = GTK_CSS_TOKEN_EOF;
+  corrupt = g_bytes_new (data, size);
+  g_assert_false (gtk_css_tokenizer_is_precompiled (corrupt));
+  g_bytes_unref (corrupt);
+
+  /* neither is text */
+  corrupt = g_bytes_new_static (CSS, strlen (CSS));
+  g_assert_false (gtk_css_tokenizer_is_precompiled (corrupt));
+  g_bytes_unref (corrupt);
+
+  g_free (data);
+  g_bytes_unref (precompiled);
+}
+
+int
+main (int argc, char *argv[])
+{
+  (g_test_init) (&argc, &argv, NULL);
+
+  g_test_add_func ("/tokenizer/precompile/roundtrip", test_roundtrip);
+  g_test_add_func ("/tokenizer/precompile/errors", test_errors_not_precompiled);
+  g_test_add_func ("/tokenizer/precompile/truncated", test_truncated);
+  g_test_add_func ("/tokenizer/precompile/corrupt", test_corrupt);
+
+  return g_test_run ();
+}
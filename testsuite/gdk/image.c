@@ -135,6 +135,128 @@ test_load_image_fail (gconstpointer data)
   g_free (path);
 }
 
+typedef struct {
+  int width_hint;
+  int height_hint;
+  int width;
+  int height;
+} SizeTest;
+
+static void
+assert_load_at_size (const char     *dirname,
+                     const char     *filename,
+                     const SizeTest *sizes,
+                     gsize           n_sizes)
+{
+  char *path;
+  GFile *file;
+  GBytes *bytes;
+  GError *error = NULL;
+  gsize i;
+
+  path = g_test_build_filename (G_TEST_DIST, dirname, filename, NULL);
+  file = g_file_new_for_path (path);
+  bytes = g_file_load_bytes (file, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  for (i = 0; i < n_sizes; i++)
+    {
+      GdkTexture *texture;
+
+      texture = gdk_texture_new_from_bytes_at_size (bytes,
+                                                    sizes[i].width_hint,
+                                                    sizes[i].height_hint,
+                                                    &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (gdk_texture_get_width (texture), ==, sizes[i].width);
+      g_assert_cmpint (gdk_texture_get_height (texture), ==, sizes[i].height);
+
+      g_object_unref (texture);
+    }
+
+  g_bytes_unref (bytes);
+  g_object_unref (file);
+  g_free (path);
+}
+
+static void
+test_load_jpeg_at_size (void)
+{
+  const SizeTest sizes[] = {
+    { -1, -1, 32, 32 },
+    { 64, 64, 32, 32 },
+    { 16, 16, 16, 16 },
+    { 10, -1, 16, 16 },
+    { -1, 4, 4, 4 },
+    { 1, 1, 4, 4 },
+  };
+
+  assert_load_at_size ("image-data", "image.jpeg", sizes, G_N_ELEMENTS (sizes));
+}
+
+static void
+test_load_tiff_at_size (void)
+{
+  /* The file has reduced-resolution subfiles of 16x16 and 8x8,
+   * and a 4x4 page that is not a reduced image and must be skipped.
+   */
+  const SizeTest sizes[] = {
+    { -1, -1, 32, 32 },
+    { 64, 64, 32, 32 },
+    { 17, -1, 32, 32 },
+    { 16, 16, 16, 16 },
+    { 10, -1, 16, 16 },
+    { -1, 8, 8, 8 },
+    { 1, 1, 8, 8 },
+  };
+
+  assert_load_at_size ("image-data", "image-subfiles.tiff", sizes, G_N_ELEMENTS (sizes));
+}
+
+static gboolean
+pixbuf_has_format (const char *name)
+{
+  GSList *formats, *l;
+  gboolean found = FALSE;
+
+  formats = gdk_pixbuf_get_formats ();
+  for (l = formats; l; l = l->next)
+    {
+      if (g_str_equal (gdk_pixbuf_format_get_name (l->data), name))
+        {
+          found = TRUE;
+          break;
+        }
+    }
+  g_slist_free (formats);
+
+  return found;
+}
+
+static void
+test_load_pixbuf_at_size (void)
+{
+  /* A 40x20 image is never scaled up, and is scaled down
+   * just enough to cover the hint.
+   */
+  const SizeTest sizes[] = {
+    { -1, -1, 40, 20 },
+    { 80, 80, 40, 20 },
+    { 40, 10, 40, 20 },
+    { 20, -1, 20, 10 },
+    { -1, 5, 10, 5 },
+    { 20, 15, 30, 15 },
+  };
+
+  if (!pixbuf_has_format ("gif"))
+    {
+      g_test_skip ("gdk-pixbuf has no GIF loader");
+      return;
+    }
+
+  assert_load_at_size ("fallback-image-data", "image.gif", sizes, G_N_ELEMENTS (sizes));
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -172,6 +294,9 @@ main (int argc, char *argv[])
   g_test_add_data_func ("/image/save/image.png", "image.png", test_save_image);
   g_test_add_data_func ("/image/save/image.tiff", "image.tiff", test_save_image);
   g_test_add_data_func ("/image/save/image.jpeg", "image.jpeg", test_save_image);
+  g_test_add_func ("/image/load-at-size/image.jpeg", test_load_jpeg_at_size);
+  g_test_add_func ("/image/load-at-size/image-subfiles.tiff", test_load_tiff_at_size);
+  g_test_add_func ("/image/load-at-size/image.gif", test_load_pixbuf_at_size);
 
   return g_test_run ();
 }
@@ -0,0 +1,317 @@
+#include <gtk/gtk.h>
+
+#include <math.h>
+
+#include "gdk/gdkmemoryformatprivate.h"
+
+/* Compares gdk_memory_convert() against a conversion that goes through
+ * a float format, so that the direct conversion functions get checked
+ * against the generic code.
+ *
+ * Run with -m perf to get throughput numbers for every format pair.
+ */
+
+#define WIDTH 19
+#define HEIGHT 7
+
+#define PERF_WIDTH 1024
+#define PERF_HEIGHT 1024
+#define PERF_RUNS 20
+
+static const char *
+format_name (GdkMemoryFormat format)
+{
+  GEnumClass *class = g_type_class_peek (GDK_TYPE_MEMORY_FORMAT);
+
+  return g_enum_get_value (class, format)->value_nick;
+}
+
+static GdkMemoryFormat
+float_format_for (GdkMemoryAlpha alpha)
+{
+  if (alpha == GDK_MEMORY_ALPHA_STRAIGHT)
+    return GDK_MEMORY_R32G32B32A32_FLOAT;
+  else
+    return GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED;
+}
+
+static float
+tolerance_for (GdkMemoryFormat format)
+{
+  switch (gdk_memory_format_get_depth (format))
+    {
+    case GDK_MEMORY_U8:
+      return 1.0f / 255 + 0.0001f;
+    case GDK_MEMORY_U16:
+      return 2.0f / 65535;
+    case GDK_MEMORY_FLOAT16:
+      return 0.001f;
+    case GDK_MEMORY_FLOAT32:
+      return 0.00001f;
+    default:
+      g_assert_not_reached ();
+      return 0;
+    }
+}
+
+static guchar *
+create_source (GdkMemoryFormat format,
+               gsize           width,
+               gsize           height,
+               gsize          *out_stride)
+{
+  GdkMemoryFormat float_format;
+  float *pixels;
+  guchar *data;
+  gsize i, stride;
+
+  float_format = float_format_for (gdk_memory_format_alpha (format));
+  pixels = g_new (float, width * height * 4);
+  for (i = 0; i < width * height; i++)
+    {
+      float *p = &pixels[4 * i];
+
+      p[3] = g_test_rand_double ();
+      p[0] = g_test_rand_double ();
+      p[1] = g_test_rand_double ();
+      p[2] = g_test_rand_double ();
+      if (float_format == GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED)
+        {
+          p[0] *= p[3];
+          p[1] *= p[3];
+          p[2] *= p[3];
+        }
+    }
+
+  stride = width * gdk_memory_format_bytes_per_pixel (format);
+  data = g_malloc (stride * height);
+  gdk_memory_convert (data, stride, format,
+                      (guchar *) pixels, width * 4 * sizeof (float), float_format,
+                      width, height);
+  g_free (pixels);
+
+  *out_stride = stride;
+  return data;
+}
+
+static float *
+to_float (const guchar    *data,
+          gsize            stride,
+          GdkMemoryFormat  format,
+          GdkMemoryFormat  float_format,
+          gsize            width,
+          gsize            height)
+{
+  float *result = g_new (float, width * height * 4);
+
+  gdk_memory_convert ((guchar *) result, width * 4 * sizeof (float), float_format,
+                      data, stride, format,
+                      width, height);
+
+  return result;
+}
+
+static void
+test_convert (gconstpointer data)
+{
+  GdkMemoryFormat src_format = GPOINTER_TO_UINT (data) / GDK_MEMORY_N_FORMATS;
+  GdkMemoryFormat dest_format = GPOINTER_TO_UINT (data) % GDK_MEMORY_N_FORMATS;
+  GdkMemoryFormat intermediate, compare;
+  gsize width, height, src_stride, dest_stride, i;
+  guchar *src, *dest, *reference, *tmp;
+  float *dest_float, *reference_float;
+  float tolerance;
+
+  if (g_test_perf ())
+    {
+      width = PERF_WIDTH;
+      height = PERF_HEIGHT;
+    }
+  else
+    {
+      width = WIDTH;
+      height = HEIGHT;
+    }
+
+  src = create_source (src_format, width, height, &src_stride);
+  dest_stride = width * gdk_memory_format_bytes_per_pixel (dest_format);
+  dest = g_malloc (dest_stride * height);
+  reference = g_malloc (dest_stride * height);
+
+  if (gdk_memory_format_alpha (src_format) == GDK_MEMORY_ALPHA_STRAIGHT &&
+      gdk_memory_format_alpha (dest_format) == GDK_MEMORY_ALPHA_STRAIGHT)
+    intermediate = GDK_MEMORY_R32G32B32A32_FLOAT;
+  else
+    intermediate = GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED;
+
+  tmp = (guchar *) to_float (src, src_stride, src_format, intermediate, width, height);
+  gdk_memory_convert (reference, dest_stride, dest_format,
+                      tmp, width * 4 * sizeof (float), intermediate,
+                      width, height);
+  g_free (tmp);
+
+  if (g_test_perf ())
+    {
+      double elapsed, gbytes;
+
+      g_test_timer_start ();
+      for (i = 0; i < PERF_RUNS; i++)
+        gdk_memory_convert (dest, dest_stride, dest_format,
+                            src, src_stride, src_format,
+                            width, height);
+      elapsed = g_test_timer_elapsed ();
+
+      gbytes = (double) (src_stride + dest_stride) * height * PERF_RUNS / (1000 * 1000 * 1000);
+      g_test_maximized_result (gbytes / elapsed, "%s -> %s: %.2f GB/s",
+                               format_name (src_format), format_name (dest_format),
+                               gbytes / elapsed);
+    }
+  else
+    {
+      gdk_memory_convert (dest, dest_stride, dest_format,
+                          src, src_stride, src_format,
+                          width, height);
+    }
+
+  compare = float_format_for (gdk_memory_format_alpha (dest_format));
+  dest_float = to_float (dest, dest_stride, dest_format, compare, width, height);
+  reference_float = to_float (reference, dest_stride, dest_format, compare, width, height);
+  tolerance = tolerance_for (dest_format);
+
+  for (i = 0; i < width * height * 4; i++)
+    {
+      if (fabs (dest_float[i] - reference_float[i]) > tolerance)
+        {
+          g_test_message ("pixel %" G_GSIZE_FORMAT " channel %" G_GSIZE_FORMAT ": %g != %g",
+                          i / 4, i % 4, dest_float[i], reference_float[i]);
+          g_test_fail ();
+          break;
+        }
+    }
+
+  g_free (dest_float);
+  g_free (reference_float);
+  g_free (reference);
+  g_free (dest);
+  g_free (src);
+}
+
+static void
+test_convert_parallel (void)
+{
+  const struct {
+    GdkMemoryFormat src;
+    GdkMemoryFormat dest;
+  } pairs[] = {
+    { GDK_MEMORY_R8G8B8A8, GDK_MEMORY_B8G8R8A8_PREMULTIPLIED },
+    { GDK_MEMORY_R16G16B16A16, GDK_MEMORY_R8G8B8A8_PREMULTIPLIED },
+    { GDK_MEMORY_R16G16B16A16_FLOAT, GDK_MEMORY_A8R8G8B8 },
+  };
+  /* odd sizes so that the last band is a partial one */
+  gsize width = 1001, height = 333;
+  gsize i;
+
+  for (i = 0; i < G_N_ELEMENTS (pairs); i++)
+    {
+      gsize src_stride, dest_stride;
+      guchar *src, *dest, *reference;
+
+      src = create_source (pairs[i].src, width, height, &src_stride);
+      dest_stride = width * gdk_memory_format_bytes_per_pixel (pairs[i].dest);
+      dest = g_malloc (dest_stride * height);
+      reference = g_malloc (dest_stride * height);
+
+      gdk_memory_convert (reference, dest_stride, pairs[i].dest,
+                          src, src_stride, pairs[i].src,
+                          width, height);
+      gdk_memory_convert_parallel (dest, dest_stride, pairs[i].dest,
+                                   src, src_stride, pairs[i].src,
+                                   width, height);
+
+      g_assert_cmpmem (dest, dest_stride * height, reference, dest_stride * height);
+
+      g_free (reference);
+      g_free (dest);
+      g_free (src);
+    }
+}
+
+static void
+test_mipmap (void)
+{
+  const GdkMemoryFormat format = GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED;
+  /* odd sizes so that the last row and column are partial blocks */
+  gsize width = 11, height = 6;
+  guint lod_level;
+
+  for (lod_level = 0; lod_level < 4; lod_level++)
+    {
+      gsize n = (gsize) 1 << lod_level;
+      gsize dest_width = (width + n - 1) / n;
+      gsize dest_height = (height + n - 1) / n;
+      gsize src_stride, x, y, c, i, j, count;
+      float *src, *dest;
+
+      src = (float *) create_source (format, width, height, &src_stride);
+      dest = g_new (float, dest_width * dest_height * 4);
+
+      gdk_memory_mipmap ((guchar *) dest, dest_width * 4 * sizeof (float), format,
+                         (guchar *) src, src_stride, format,
+                         width, height,
+                         lod_level);
+
+      for (y = 0; y < dest_height; y++)
+        for (x = 0; x < dest_width; x++)
+          for (c = 0; c < 4; c++)
+            {
+              float sum = 0;
+
+              count = 0;
+              for (j = y * n; j < MIN ((y + 1) * n, height); j++)
+                for (i = x * n; i < MIN ((x + 1) * n, width); i++)
+                  {
+                    sum += src[(j * width + i) * 4 + c];
+                    count++;
+                  }
+
+              g_assert_cmpfloat_with_epsilon (dest[(y * dest_width + x) * 4 + c], sum / count, 0.0001);
+            }
+
+      g_free (dest);
+      g_free (src);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  GdkMemoryFormat src_format, dest_format;
+
+  (g_test_init) (&argc, &argv, NULL);
+
+  g_type_class_ref (GDK_TYPE_MEMORY_FORMAT);
+
+  g_test_add_func ("/memoryconvert/parallel", test_convert_parallel);
+  g_test_add_func ("/memoryconvert/mipmap", test_mipmap);
+
+  for (src_format = 0; src_format < GDK_MEMORY_N_FORMATS; src_format++)
+    {
+      for (dest_format = 0; dest_format < GDK_MEMORY_N_FORMATS; dest_format++)
+        {
+          char *path;
+
+          if (src_format == dest_format)
+            continue;
+
+          path = g_strdup_printf ("/memoryconvert/%s/%s",
+                                  format_name (src_format),
+                                  format_name (dest_format));
+          g_test_add_data_func (path,
+                                GUINT_TO_POINTER (src_format * GDK_MEMORY_N_FORMATS + dest_format),
+                                test_convert);
+          g_free (path);
+        }
+    }
+
+  return g_test_run ();
+}
@@ -2,6 +2,8 @@
 #include "gsk/gskrendernodeprivate.h"
 
 #include <gobject/gvaluecollector.h>
+#include <math.h>
+#include <string.h>
 
 static void
 test_rendernode_gvalue (void)
@@ -149,6 +151,155 @@ test_container_disjoint (void)
   gsk_render_node_unref (nodes[1]);
 }
 
+static void
+count_errors (const GskParseLocation *start,
+              const GskParseLocation *end,
+              const GError           *error,
+              gpointer                user_data)
+{
+  guint *n_errors = user_data;
+
+  (*n_errors)++;
+}
+
+static GskRenderNode *
+create_binary_test_node (void)
+{
+  GskColorStop stops[] = {
+    { 0.375f, (GdkRGBA) { 0, 0, 0, 1} },
+    { 0.625f, (GdkRGBA) { 1, 0, 1, 1} },
+  };
+  GskShadow shadow = { (GdkRGBA) { 0, 0, 0, 1 }, 2, 2, 5.5f };
+  GskRenderNode *nodes[6], *node;
+  GskPathBuilder *builder;
+  GskStroke *stroke;
+  GskPath *path;
+  guint i;
+
+  nodes[0] = gsk_linear_gradient_node_new (&GRAPHENE_RECT_INIT (0, 0, 50, 50),
+                                           &GRAPHENE_POINT_INIT (0, 0),
+                                           &GRAPHENE_POINT_INIT (0, 50),
+                                           stops, G_N_ELEMENTS (stops));
+  nodes[1] = gsk_radial_gradient_node_new (&GRAPHENE_RECT_INIT (0, 0, 50, 50),
+                                           &GRAPHENE_POINT_INIT (25, 25),
+                                           13.5f, 14.5f, 0.25f, 0.75f,
+                                           stops, G_N_ELEMENTS (stops));
+  nodes[2] = gsk_blur_node_new (nodes[0], 7.25f);
+  nodes[3] = gsk_outset_shadow_node_new (&GSK_ROUNDED_RECT_INIT (10, 10, 30, 30),
+                                         &(GdkRGBA) { 0, 0, 0, 1 },
+                                         1, 1, 0, 6.75f);
+  nodes[4] = gsk_shadow_node_new (nodes[1], &shadow, 1);
+
+  builder = gsk_path_builder_new ();
+  gsk_path_builder_add_rect (builder, &GRAPHENE_RECT_INIT (10, 10, 30, 30));
+  path = gsk_path_builder_free_to_path (builder);
+  stroke = gsk_stroke_new (3.25f);
+  nodes[5] = gsk_stroke_node_new (nodes[0], path, stroke);
+  gsk_stroke_free (stroke);
+  gsk_path_unref (path);
+
+  node = gsk_container_node_new (nodes, G_N_ELEMENTS (nodes));
+  for (i = 0; i < G_N_ELEMENTS (nodes); i++)
+    gsk_render_node_unref (nodes[i]);
+
+  return node;
+}
+
+static void
+test_binary_truncated (void)
+{
+  GskRenderNode *node, *loaded;
+  GBytes *bytes, *part;
+  guint n_errors;
+  gsize i, size;
+
+  node = create_binary_test_node ();
+  bytes = gsk_render_node_serialize_binary (node);
+  size = g_bytes_get_size (bytes);
+
+  n_errors = 0;
+  loaded = gsk_render_node_deserialize (bytes, count_errors, &n_errors);
+  g_assert_nonnull (loaded);
+  g_assert_cmpuint (n_errors, ==, 0);
+  gsk_render_node_unref (loaded);
+
+  /* Shorter than the magic, the data would be parsed as text */
+  for (i = 8; i < size; i++)
+    {
+      part = g_bytes_new_from_bytes (bytes, 0, i);
+      n_errors = 0;
+      loaded = gsk_render_node_deserialize (part, count_errors, &n_errors);
+      g_assert_null (loaded);
+      g_assert_cmpuint (n_errors, ==, 1);
+      g_bytes_unref (part);
+    }
+
+  g_bytes_unref (bytes);
+  gsk_render_node_unref (node);
+}
+
+/* Loads the binary data of the test node with every float
+ * that is @from changed to @to, which must fail to load */
+static void
+assert_binary_value_fails (float from,
+                           float to)
+{
+  GskRenderNode *node, *loaded;
+  GBytes *bytes, *modified;
+  guchar *data;
+  guint32 from_bits, to_bits;
+  gsize i, size, found;
+  guint n_errors;
+
+  memcpy (&from_bits, &from, sizeof (float));
+  from_bits = GUINT32_TO_LE (from_bits);
+  memcpy (&to_bits, &to, sizeof (float));
+  to_bits = GUINT32_TO_LE (to_bits);
+
+  node = create_binary_test_node ();
+  bytes = gsk_render_node_serialize_binary (node);
+  data = g_bytes_unref_to_data (bytes, &size);
+
+  found = 0;
+  for (i = 0; i + 4 <= size; i += 4)
+    {
+      if (memcmp (data + i, &from_bits, 4) == 0)
+        {
+          memcpy (data + i, &to_bits, 4);
+          found++;
+        }
+    }
+  g_assert_cmpuint (found, >, 0);
+
+  modified = g_bytes_new_take (data, size);
+  n_errors = 0;
+  loaded = gsk_render_node_deserialize (modified, count_errors, &n_errors);
+  g_assert_null (loaded);
+  g_assert_cmpuint (n_errors, ==, 1);
+
+  g_bytes_unref (modified);
+  gsk_render_node_unref (node);
+}
+
+static void
+test_binary_invalid_values (void)
+{
+  /* color stops out of order, below 0 and above 1 */
+  assert_binary_value_fails (0.625f, 0.125f);
+  assert_binary_value_fails (0.375f, -0.5f);
+  assert_binary_value_fails (0.375f, 1.5f);
+  /* radial gradient radius and range */
+  assert_binary_value_fails (13.5f, 0.f);
+  assert_binary_value_fails (0.75f, 0.125f);
+  /* blur radius */
+  assert_binary_value_fails (7.25f, -7.25f);
+  assert_binary_value_fails (7.25f, NAN);
+  /* shadow blur radius */
+  assert_binary_value_fails (6.75f, -6.75f);
+  /* line width */
+  assert_binary_value_fails (3.25f, 0.f);
+}
+
 const char shader1[] =
 "uniform float progress;\n"
 "uniform sampler2D u_texture1;\n"
@@ -278,6 +429,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/rendernode/border/uniform", test_bordernode_uniform);
   g_test_add_func ("/rendernode/conic-gradient/angle", test_conic_gradient_angle);
   g_test_add_func ("/rendernode/container/disjoint", test_container_disjoint);
+  g_test_add_func ("/rendernode/binary/truncated", test_binary_truncated);
+  g_test_add_func ("/rendernode/binary/invalid-values", test_binary_invalid_values);
   g_test_add_func ("/renderer/cairo", test_cairo_renderer);
   g_test_add_func ("/renderer/gl", test_gl_renderer);
 
@@ -1,4 +1,6 @@
 #include <gtk/gtk.h>
+#include "gtk/gtkcssnodeprivate.h"
+#include "gtk/gtkwidgetprivate.h"
 
 static void
 assert_section_is_not_null (GtkCssProvider *provider,
@@ -33,6 +35,155 @@ test_section_load_nonexisting_file (void)
   g_object_unref (provider);
 }
 
+static void
+test_add_remove_rules (void)
+{
+  GtkCssProvider *provider;
+  char *before, *added, *after;
+  guint id;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_string (provider, "label { color: red; } box label { margin: 2px; }");
+  before = gtk_css_provider_to_string (provider);
+
+  id = gtk_css_provider_add_rules (provider, "label.highlight { color: blue; }");
+  g_assert_cmpuint (id, !=, 0);
+  added = gtk_css_provider_to_string (provider);
+  g_assert_nonnull (strstr (added, ".highlight"));
+
+  gtk_css_provider_remove_rules (provider, id);
+  after = gtk_css_provider_to_string (provider);
+  g_assert_cmpstr (before, ==, after);
+
+  g_free (before);
+  g_free (added);
+  g_free (after);
+  g_object_unref (provider);
+}
+
+typedef struct {
+  GtkCssProvider *provider;
+  GtkWidget *window;
+  GtkWidget *box;
+  GtkWidget *highlighted;
+  GtkWidget *other;
+} RestyleFixture;
+
+static void
+restyle_fixture_setup (RestyleFixture *fixture,
+                       gconstpointer   unused)
+{
+  fixture->provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_string (fixture->provider, "label { color: red; }");
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (fixture->provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  fixture->window = gtk_window_new ();
+  fixture->box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  fixture->highlighted = gtk_label_new ("highlighted");
+  gtk_widget_add_css_class (fixture->highlighted, "highlight");
+  fixture->other = gtk_label_new ("other");
+  gtk_box_append (GTK_BOX (fixture->box), fixture->highlighted);
+  gtk_box_append (GTK_BOX (fixture->box), fixture->other);
+  gtk_window_set_child (GTK_WINDOW (fixture->window), fixture->box);
+
+  /* Only realized widgets follow changes of the providers */
+  gtk_widget_realize (fixture->highlighted);
+  gtk_widget_realize (fixture->other);
+}
+
+static void
+restyle_fixture_teardown (RestyleFixture *fixture,
+                          gconstpointer   unused)
+{
+  gtk_window_destroy (GTK_WINDOW (fixture->window));
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (fixture->provider));
+  g_object_unref (fixture->provider);
+}
+
+static void
+validate_styles (RestyleFixture *fixture)
+{
+  gtk_css_node_validate (gtk_widget_get_css_node (fixture->window));
+}
+
+static GtkCssStyle *
+get_style (GtkWidget *widget)
+{
+  return gtk_css_node_get_style (gtk_widget_get_css_node (widget));
+}
+
+static void
+assert_color (GtkWidget  *widget,
+              const char *expected)
+{
+  GdkRGBA color, expected_color;
+
+  gtk_widget_get_color (widget, &color);
+  g_assert_true (gdk_rgba_parse (&expected_color, expected));
+  g_assert_true (gdk_rgba_equal (&color, &expected_color));
+}
+
+static void
+test_add_rules_restyle (RestyleFixture *fixture,
+                        gconstpointer   unused)
+{
+  GtkCssStyle *box_style, *other_style;
+  guint id;
+
+  validate_styles (fixture);
+  assert_color (fixture->highlighted, "red");
+  box_style = g_object_ref (get_style (fixture->box));
+  other_style = g_object_ref (get_style (fixture->other));
+
+  id = gtk_css_provider_add_rules (fixture->provider, "label.highlight { color: blue; }");
+  validate_styles (fixture);
+
+  assert_color (fixture->highlighted, "blue");
+  assert_color (fixture->other, "red");
+  /* Nodes the rules don't apply to must not be restyled */
+  g_assert_true (get_style (fixture->box) == box_style);
+  g_assert_true (get_style (fixture->other) == other_style);
+
+  gtk_css_provider_remove_rules (fixture->provider, id);
+  validate_styles (fixture);
+
+  assert_color (fixture->highlighted, "red");
+  assert_color (fixture->other, "red");
+  g_assert_true (get_style (fixture->box) == box_style);
+  g_assert_true (get_style (fixture->other) == other_style);
+
+  g_object_unref (box_style);
+  g_object_unref (other_style);
+}
+
+static void
+test_add_rules_named_color (RestyleFixture *fixture,
+                            gconstpointer   unused)
+{
+  GtkCssStyle *box_style, *other_style;
+
+  validate_styles (fixture);
+  box_style = g_object_ref (get_style (fixture->box));
+  other_style = g_object_ref (get_style (fixture->other));
+
+  /* Any rule may use the color, so everything must be restyled */
+  gtk_css_provider_add_rules (fixture->provider,
+                              "@define-color accent_test blue;"
+                              "label.highlight { color: @accent_test; }");
+  validate_styles (fixture);
+
+  assert_color (fixture->highlighted, "blue");
+  assert_color (fixture->other, "red");
+  g_assert_true (get_style (fixture->box) != box_style);
+  g_assert_true (get_style (fixture->other) != other_style);
+
+  g_object_unref (box_style);
+  g_object_unref (other_style);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -41,6 +192,11 @@ main (int argc, char *argv[])
 
   g_test_add_func ("/cssprovider/section-in-load-from-data", test_section_in_load_from_data);
   g_test_add_func ("/cssprovider/load-nonexisting-file", test_section_load_nonexisting_file);
+  g_test_add_func ("/cssprovider/add-remove-rules", test_add_remove_rules);
+  g_test_add ("/cssprovider/add-rules/restyle", RestyleFixture, NULL,
+              restyle_fixture_setup, test_add_rules_restyle, restyle_fixture_teardown);
+  g_test_add ("/cssprovider/add-rules/named-color", RestyleFixture, NULL,
+              restyle_fixture_setup, test_add_rules_named_color, restyle_fixture_teardown);
 
   return g_test_run ();
 }
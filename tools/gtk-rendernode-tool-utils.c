@@ -58,11 +58,25 @@ load_node_file (const char *filename)
 {
   GFile *file;
   GBytes *bytes;
+  GMappedFile *mapped;
+  GskRenderNode *node;
   GError *error = NULL;
 
-  file = g_file_new_for_commandline_arg (filename);
-  bytes = g_file_load_bytes (file, NULL, NULL, &error);
-  g_object_unref (file);
+  /* Map local files, so that textures in binary files
+   * don't need to be copied
+   */
+  mapped = g_mapped_file_new (filename, FALSE, NULL);
+  if (mapped)
+    {
+      bytes = g_mapped_file_get_bytes (mapped);
+      g_mapped_file_unref (mapped);
+    }
+  else
+    {
+      file = g_file_new_for_commandline_arg (filename);
+      bytes = g_file_load_bytes (file, NULL, NULL, &error);
+      g_object_unref (file);
+    }
 
   if (bytes == NULL)
     {
@@ -71,5 +85,8 @@ load_node_file (const char *filename)
       exit (1);
     }
 
-  return gsk_render_node_deserialize (bytes, deserialize_error_func, NULL);
+  node = gsk_render_node_deserialize (bytes, deserialize_error_func, NULL);
+  g_bytes_unref (bytes);
+
+  return node;
 }
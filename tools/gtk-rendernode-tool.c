@@ -41,6 +41,7 @@ usage (void)
              "  info         Provide information about the node\n"
              "  show         Show the node\n"
              "  render       Take a screenshot of the node\n"
+             "  convert      Convert to the text or binary format\n"
              "\n"));
   exit (1);
 }
@@ -113,6 +114,8 @@ main (int argc, const char *argv[])
     do_render (&argc, &argv);
   else if (strcmp (argv[0], "info") == 0)
     do_info (&argc, &argv);
+  else if (strcmp (argv[0], "convert") == 0)
+    do_convert (&argc, &argv);
   else
     usage ();
 